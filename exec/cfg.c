@@ -51,9 +51,11 @@
 #include <assert.h>
 
 #include <corosync/corotypes.h>
+#include <qb/qbipcs.h>
 #include <qb/qbipc_common.h>
 #include <corosync/cfg.h>
 #include <qb/qblist.h>
+#include <qb/qbutil.h>
 #include <corosync/mar_gen.h>
 #include <corosync/totem/totemip.h>
 #include <corosync/totem/totem.h>
@@ -65,6 +67,8 @@
 
 #include "service.h"
 #include "main.h"
+#include "ipcs_stats.h"
+#include "stats.h"
 
 LOGSYS_DECLARE_SUBSYS ("CFG");
 
@@ -533,6 +537,92 @@ static void message_handler_req_exec_cfg_shutdown (
 	LEAVE();
 }
 
+/*
+ * Key of the map which differs between running and reloaded configuration
+ */
+struct cfg_reload_key {
+	struct qb_list_head list;
+	char *key_name;
+};
+
+/*
+ * Prefixes where keys missing in the new config file are deleted from the running config
+ */
+static const char *reload_deletable_prefixes[] = {
+	"logging.",
+	"totem.",
+	"nodelist.",
+	"quorum.",
+	"uidgid.config.",
+};
+
+/*
+ * Keys which cannot be changed at run time. A log message will be issued for each
+ * entry that the user wants to change but they cannot.
+ *
+ * Add more here as needed.
+ */
+static const char *reload_ro_keys[] = {
+	"totem.secauth",
+	"totem.crypto_hash",
+	"totem.crypto_cipher",
+	"totem.version",
+	"totem.threads",
+	"totem.ip_version",
+	"totem.rrp_mode",
+	"totem.netmtu",
+	"totem.interface.ringnumber",
+	"totem.interface.bindnetaddr",
+	"totem.interface.mcastaddr",
+	"totem.interface.broadcast",
+	"totem.interface.mcastport",
+	"totem.interface.ttl",
+	"totem.vsftype",
+	"totem.transport",
+	"totem.cluster_name",
+	"quorum.provider",
+	"qb.ipc_type",
+};
+
+static struct cfg_reload_stats cfg_reload_stats;
+
+static int cfg_reload_key_add(struct qb_list_head *head, const char *key_name)
+{
+	struct cfg_reload_key *reload_key;
+
+	reload_key = malloc(sizeof(*reload_key));
+	if (reload_key == NULL) {
+		return (-1);
+	}
+
+	reload_key->key_name = strdup(key_name);
+	if (reload_key->key_name == NULL) {
+		free(reload_key);
+		return (-1);
+	}
+
+	qb_list_add_tail(&reload_key->list, head);
+
+	return (0);
+}
+
+static void cfg_reload_key_del(struct cfg_reload_key *reload_key)
+{
+
+	qb_list_del(&reload_key->list);
+	free(reload_key->key_name);
+	free(reload_key);
+}
+
+static void cfg_reload_keys_free(struct qb_list_head *head)
+{
+	struct qb_list_head *iter, *tmp_iter;
+
+	qb_list_for_each_safe(iter, tmp_iter, head) {
+		cfg_reload_key_del(qb_list_entry(iter, struct cfg_reload_key, list));
+	}
+}
+
 /* strcmp replacement that can handle NULLs */
 static int nullcheck_strcmp(const char* left, const char *right)
 {
@@ -548,59 +638,19 @@ static int nullcheck_strcmp(const char* left, const char *right)
 }
 
 /*
- * If a key has changed value in the new file, then warn the user and remove it from the temp_map
- */
-static void delete_and_notify_if_changed(icmap_map_t temp_map, const char *key_name)
-{
-	if (!(icmap_key_value_eq(temp_map, key_name, icmap_get_global_map(), key_name))) {
-		if (icmap_delete_r(temp_map, key_name) == CS_OK) {
-			log_printf(LOGSYS_LEVEL_NOTICE, "Modified entry '%s' in corosync.conf cannot be changed at run-time", key_name);
-		}
-	}
-}
-/*
- * Remove any keys from the new config file that in the new corosync.conf but that
- * cannot be changed at run time. A log message will be issued for each
- * entry that the user wants to change but they cannot.
- *
- * Add more here as needed.
- */
-static void remove_ro_entries(icmap_map_t temp_map)
-{
-	delete_and_notify_if_changed(temp_map, "totem.secauth");
-	delete_and_notify_if_changed(temp_map, "totem.crypto_hash");
-	delete_and_notify_if_changed(temp_map, "totem.crypto_cipher");
-	delete_and_notify_if_changed(temp_map, "totem.version");
-	delete_and_notify_if_changed(temp_map, "totem.threads");
-	delete_and_notify_if_changed(temp_map, "totem.ip_version");
-	delete_and_notify_if_changed(temp_map, "totem.rrp_mode");
-	delete_and_notify_if_changed(temp_map, "totem.netmtu");
-	delete_and_notify_if_changed(temp_map, "totem.interface.ringnumber");
-	delete_and_notify_if_changed(temp_map, "totem.interface.bindnetaddr");
-	delete_and_notify_if_changed(temp_map, "totem.interface.mcastaddr");
-	delete_and_notify_if_changed(temp_map, "totem.interface.broadcast");
-	delete_and_notify_if_changed(temp_map, "totem.interface.mcastport");
-	delete_and_notify_if_changed(temp_map, "totem.interface.ttl");
-	delete_and_notify_if_changed(temp_map, "totem.vsftype");
-	delete_and_notify_if_changed(temp_map, "totem.transport");
-	delete_and_notify_if_changed(temp_map, "totem.cluster_name");
-	delete_and_notify_if_changed(temp_map, "quorum.provider");
-	delete_and_notify_if_changed(temp_map, "qb.ipc_type");
-}
-
-/*
- * Remove entries that exist in the global map, but not in the temp_map, this will
- * cause delete notifications to be sent to any listeners.
+ * Find entries that exist in the global map, but not in the temp_map. Deleting
+ * them later will cause delete notifications to be sent to any listeners.
  *
  * NOTE: This routine depends entirely on the keys returned by the iterators
  * being in alpha-sorted order.
  */
-static void remove_deleted_entries(icmap_map_t temp_map, const char *prefix)
+static int find_deleted_entries(icmap_map_t temp_map, const char *prefix, struct qb_list_head *deleted)
 {
 	icmap_iter_t old_iter;
 	icmap_iter_t new_iter;
 	const char *old_key, *new_key;
 	int ret;
+	int res = 0;
 
 	old_iter = icmap_iter_init(prefix);
 	new_iter = icmap_iter_init_r(temp_map, prefix);
@@ -616,8 +666,10 @@ static void remove_deleted_entries(icmap_map_t temp_map, const char *prefix)
 			 * Continue until old is >= new
 			 */
 			do {
-				/* Remove it from icmap & send notifications */
-				icmap_delete(old_key);
+				if (cfg_reload_key_add(deleted, old_key) != 0) {
+					res = -1;
+					goto iter_finalize;
+				}
 
 				old_key = icmap_iter_next(old_iter, NULL, NULL);
 				ret = nullcheck_strcmp(old_key, new_key);
@@ -628,8 +680,8 @@ static void remove_deleted_entries(icmap_map_t temp_map, const char *prefix)
 			 * old_key is greater, a line (or more) has been added
 			 * Continue until new is >= old
 			 *
-			 * we don't need to do anything special with this like tell
-			 * icmap. That will happen when we copy the values over
+			 * we don't need to do anything special with this, it is found
+			 * by find_changed_entries
 			 */
 			do {
 				new_key = icmap_iter_next(new_iter, NULL, NULL);
@@ -641,8 +693,138 @@ static void remove_deleted_entries(icmap_map_t temp_map, const char *prefix)
 			old_key = icmap_iter_next(old_iter, NULL, NULL);
 		}
 	}
+
+iter_finalize:
 	icmap_iter_finalize(new_iter);
 	icmap_iter_finalize(old_iter);
+
+	return (res);
+}
+
+/*
+ * Find entries which are new or have different value in the temp_map. Keys which
+ * cannot be changed at run time are skipped and user is warned.
+ */
+static int find_changed_entries(icmap_map_t temp_map, struct qb_list_head *changed)
+{
+	icmap_iter_t iter;
+	const char *key_name;
+	int ro_key;
+	int res = 0;
+	int i;
+
+	iter = icmap_iter_init_r(temp_map, NULL);
+
+	while ((key_name = icmap_iter_next(iter, NULL, NULL)) != NULL) {
+		if (icmap_key_value_eq(temp_map, key_name, icmap_get_global_map(), key_name)) {
+			continue;
+		}
+
+		ro_key = 0;
+		for (i = 0; i < sizeof(reload_ro_keys) / sizeof(*reload_ro_keys); i++) {
+			if (strcmp(key_name, reload_ro_keys[i]) == 0) {
+				ro_key = 1;
+				break;
+			}
+		}
+
+		if (ro_key) {
+			log_printf(LOGSYS_LEVEL_NOTICE, "Modified entry '%s' in corosync.conf cannot be changed at run-time", key_name);
+			continue;
+		}
+
+		if (cfg_reload_key_add(changed, key_name) != 0) {
+			res = -1;
+			break;
+		}
+	}
+
+	icmap_iter_finalize(iter);
+
+	return (res);
+}
+
+/*
+ * Make differences between temp_map and running config live
+ */
+static cs_error_t apply_changed_entries(icmap_map_t temp_map,
+	struct qb_list_head *deleted,
+	struct qb_list_head *changed)
+{
+	struct qb_list_head *iter;
+	struct cfg_reload_key *reload_key;
+	size_t value_len;
+	icmap_value_types_t value_type;
+	void *value;
+	cs_error_t err;
+
+	qb_list_for_each(iter, deleted) {
+		reload_key = qb_list_entry(iter, struct cfg_reload_key, list);
+
+		/* Remove it from icmap & send notifications */
+		icmap_delete(reload_key->key_name);
+	}
+
+	qb_list_for_each(iter, changed) {
+		reload_key = qb_list_entry(iter, struct cfg_reload_key, list);
+
+		err = icmap_get_r(temp_map, reload_key->key_name, NULL, &value_len, &value_type);
+		if (err != CS_OK) {
+			return (err);
+		}
+
+		value = malloc(value_len);
+		if (value == NULL) {
+			return (CS_ERR_NO_MEMORY);
+		}
+
+		err = icmap_get_r(temp_map, reload_key->key_name, value, &value_len, &value_type);
+		if (err == CS_OK) {
+			err = icmap_set(reload_key->key_name, value, value_len, value_type);
+		}
+		free(value);
+
+		if (err != CS_OK) {
+			return (err);
+		}
+	}
+
+	return (CS_OK);
+}
+
+void cfg_reload_stats_get(struct cfg_reload_stats *stats)
+{
+
+	memcpy(stats, &cfg_reload_stats, sizeof(*stats));
+}
+
+void cfg_reload_stats_clear(void)
+{
+
+	memset(&cfg_reload_stats, 0, sizeof(cfg_reload_stats));
+}
+
+static void cfg_reload_stats_update(uint64_t start_time, uint64_t parsed_time, int changed)
+{
+	uint64_t reload_time;
+
+	reload_time = (qb_util_nano_current_get() - start_time) / QB_TIME_NS_IN_USEC;
+
+	cfg_reload_stats.reload_time_last = reload_time;
+	cfg_reload_stats.reload_parse_time_last = (parsed_time - start_time) / QB_TIME_NS_IN_USEC;
+	if (reload_time > cfg_reload_stats.reload_time_max) {
+		cfg_reload_stats.reload_time_max = reload_time;
+	}
+	cfg_reload_stats.reload_time_ave =
+	    (cfg_reload_stats.reload_time_ave * cfg_reload_stats.reloads + reload_time) /
+	    (cfg_reload_stats.reloads + 1);
+	cfg_reload_stats.reloads++;
+	cfg_reload_stats.reload_changed_keys_last = changed;
+	if (changed == 0) {
+		cfg_reload_stats.reloads_unchanged++;
+	}
+
+	stats_source_changed(STATS_SOURCE_CONFIG);
 }
 
 /*
@@ -657,11 +839,22 @@ static void message_handler_req_exec_cfg_reload_config (
 	icmap_map_t temp_map;
 	const char *error_string;
 	int res = CS_OK;
+	struct qb_list_head deleted;
+	struct qb_list_head changed;
+	struct qb_list_head *iter;
+	uint64_t start_time;
+	uint64_t parsed_time;
+	int no_changes;
+	int i;
 
 	ENTER();
 
 	log_printf(LOGSYS_LEVEL_NOTICE, "Config reload requested by node %d", nodeid);
 
+	start_time = qb_util_nano_current_get();
+	qb_list_init(&deleted);
+	qb_list_init(&changed);
+
 	/*
 	 * Set up a new hashtable as a staging area.
 	 */
@@ -679,33 +872,60 @@ static void message_handler_req_exec_cfg_reload_config (
 		res = CS_ERR_LIBRARY;
 		goto reload_return;
 	}
+	parsed_time = qb_util_nano_current_get();
 
-	/* Tell interested listeners that we have started a reload */
-	icmap_set_uint8("config.reload_in_progress", 1);
+	/*
+	 * Find differences between running and new config first, so listeners
+	 * are only notified about keys which really changed
+	 */
+	for (i = 0; i < sizeof(reload_deletable_prefixes) / sizeof(*reload_deletable_prefixes); i++) {
+		if (find_deleted_entries(temp_map, reload_deletable_prefixes[i], &deleted) != 0) {
+			res = CS_ERR_NO_MEMORY;
+			goto reload_fini;
+		}
+	}
+
+	if (find_changed_entries(temp_map, &changed) != 0) {
+		res = CS_ERR_NO_MEMORY;
+		goto reload_fini;
+	}
 
-	/* Detect deleted entries and remove them from the main icmap hashtable */
-	remove_deleted_entries(temp_map, "logging.");
-	remove_deleted_entries(temp_map, "totem.");
-	remove_deleted_entries(temp_map, "nodelist.");
-	remove_deleted_entries(temp_map, "quorum.");
-	remove_deleted_entries(temp_map, "uidgid.config.");
+	no_changes = 0;
+	qb_list_for_each(iter, &deleted) {
+		no_changes++;
+	}
+	qb_list_for_each(iter, &changed) {
+		no_changes++;
+	}
+
+	if (no_changes == 0) {
+		log_printf(LOGSYS_LEVEL_NOTICE, "Config file is unchanged, nothing to reload");
+		res = CS_OK;
+		goto reload_stats;
+	}
 
-	/* Remove entries that cannot be changed */
-	remove_ro_entries(temp_map);
+	/* Tell interested listeners that we have started a reload */
+	icmap_set_uint8("config.reload_in_progress", 1);
 
 	/*
-	 * Copy new keys into live config.
+	 * Make changes live.
 	 * If this fails we will have a partially loaded config because some keys (above) might
 	 * have been reset to defaults - I'm not sure what to do here, we might have to quit.
 	 */
-	if ( (res = icmap_copy_map(icmap_get_global_map(), temp_map)) != CS_OK) {
+	if ( (res = apply_changed_entries(temp_map, &deleted, &changed)) != CS_OK) {
 		log_printf (LOGSYS_LEVEL_ERROR, "Error making new config live. cmap database may be inconsistent\n");
 	}
 
 	/* All done - let clients know */
 	icmap_set_uint8("config.reload_in_progress", 0);
 
+reload_stats:
+	cfg_reload_stats_update(start_time, parsed_time, no_changes);
+
 reload_fini:
+	cfg_reload_keys_free(&deleted);
+	cfg_reload_keys_free(&changed);
+
 	/* Finished with the temporary storage */
 	icmap_fini_r(temp_map);
 
@@ -51,6 +51,7 @@
 #include <corosync/corodefs.h>
 #include <corosync/mar_gen.h>
 #include <corosync/ipc_cmap.h>
+#include <corosync/cmap.h>
 #include <corosync/logsys.h>
 #include <corosync/coroapi.h>
 #include <corosync/icmap.h>
@@ -64,6 +65,18 @@ LOGSYS_DECLARE_SUBSYS ("CMAP");
 #define MAX_REQ_EXEC_CMAP_MCAST_ITEMS		32
 #define ICMAP_VALUETYPE_NOT_EXIST		0
 
+/*
+ * Default coalesce interval (in ms) of CMAP_TRACK_COALESCE trackers. Can be changed
+ * by cmap.track_coalesce_interval key.
+ */
+#define CMAP_TRACK_COALESCE_DEFAULT_INTERVAL	100
+
+/*
+ * Maximum size of one batched notification. Must fit into smallest dispatch
+ * buffer of libcmap.
+ */
+#define CMAP_NOTIFY_BATCH_MAX_SIZE		(1024*64)
+
 struct cmap_map {
 	cs_error_t (*map_get)(const char *key_name,
 			      void *value,
@@ -127,6 +140,9 @@ struct cmap_conn_info {
 	struct hdb_handle_database iter_db;
 	struct hdb_handle_database track_db;
 	struct cmap_map map_fns;
+	struct qb_list_head pending_notify_head;
+	corosync_timer_handle_t coalesce_timer;
+	int coalesce_timer_running;
 };
 
 typedef uint64_t cmap_iter_handle_t;
@@ -136,6 +152,24 @@ struct cmap_track_user_data {
 	void *conn;
 	cmap_track_handle_t track_handle;
 	uint64_t track_inst_handle;
+	int coalesce;
+};
+
+/*
+ * Notification of CMAP_TRACK_COALESCE tracker waiting for coalesce timer. Old value
+ * is kept from the first change, event and new value are replaced by latest change.
+ */
+struct cmap_pending_notify {
+	struct qb_list_head list;
+	struct cmap_track_user_data *track_user_data;
+	int32_t event;
+	char *key_name;
+	icmap_value_types_t new_value_type;
+	icmap_value_types_t old_value_type;
+	size_t new_value_len;
+	size_t old_value_len;
+	void *new_value;
+	void *old_value;
 };
 
 enum cmap_message_req_types {
@@ -165,6 +199,7 @@ static void message_handler_req_lib_cmap_iter_finalize(void *conn, const void *m
 static void message_handler_req_lib_cmap_track_add(void *conn, const void *message);
 static void message_handler_req_lib_cmap_track_delete(void *conn, const void *message);
 static void message_handler_req_lib_cmap_set_current_map(void *conn, const void *message);
+static void message_handler_req_lib_cmap_stats_snapshot(void *conn, const void *message);
 
 static void cmap_notify_fn(int32_t event,
 		const char *key_name,
@@ -172,6 +207,9 @@ static void cmap_notify_fn(int32_t event,
 		struct icmap_notify_value old_val,
 		void *user_data);
 
+static void cmap_pending_notify_del(struct cmap_conn_info *conn_info,
+		const struct cmap_track_user_data *cmap_track_user_data);
+
 static void message_handler_req_exec_cmap_mcast(
 		const void *message,
 		unsigned int nodeid);
@@ -250,6 +288,10 @@ static struct corosync_lib_handler cmap_lib_engine[] =
 		.lib_handler_fn				= message_handler_req_lib_cmap_set_current_map,
 		.flow_control				= CS_LIB_FLOW_CONTROL_NOT_REQUIRED
 	},
+	{ /* 10 */
+		.lib_handler_fn				= message_handler_req_lib_cmap_stats_snapshot,
+		.flow_control				= CS_LIB_FLOW_CONTROL_NOT_REQUIRED
+	},
 };
 
 static struct corosync_exec_handler cmap_exec_engine[] =
@@ -310,6 +352,7 @@ static uint64_t cmap_highest_config_version_received = 0;
 static uint64_t cmap_my_config_version = 0;
 static int cmap_first_sync = 1;
 static icmap_track_t cmap_config_version_track;
+static struct cmap_notify_stats cmap_notify_stats;
 
 static void cmap_config_version_track_cb(
 	int32_t event,
@@ -378,6 +421,7 @@ static int cmap_lib_init_fn (void *conn)
 	conn_info->map_fns = icmap_map;
 	hdb_create(&conn_info->iter_db);
 	hdb_create(&conn_info->track_db);
+	qb_list_init(&conn_info->pending_notify_head);
 
 	return (0);
 }
@@ -392,6 +436,13 @@ static int cmap_lib_exit_fn (void *conn)
 
 	log_printf(LOGSYS_LEVEL_DEBUG, "exit_fn for conn=%p", conn);
 
+	if (conn_info->coalesce_timer_running) {
+		api->timer_delete(conn_info->coalesce_timer);
+		conn_info->coalesce_timer_running = 0;
+	}
+
+	cmap_pending_notify_del(conn_info, NULL);
+
 	hdb_iterator_reset(&conn_info->iter_db);
         while (hdb_iterator_next(&conn_info->iter_db,
                 (void*)&iter, &iter_handle) == 0) {
@@ -728,13 +779,12 @@ reply_send:
 	api->ipc_response_send(conn, &res_lib_cmap_iter_finalize, sizeof(res_lib_cmap_iter_finalize));
 }
 
-static void cmap_notify_fn(int32_t event,
+static void cmap_notify_send(struct cmap_track_user_data *cmap_track_user_data,
+		int32_t event,
 		const char *key_name,
 		struct icmap_notify_value new_val,
-		struct icmap_notify_value old_val,
-		void *user_data)
+		struct icmap_notify_value old_val)
 {
-	struct cmap_track_user_data *cmap_track_user_data = (struct cmap_track_user_data *)user_data;
 	struct res_lib_cmap_notify_callback res_lib_cmap_notify_callback;
 	struct iovec iov[3];
 
@@ -764,6 +814,286 @@ static void cmap_notify_fn(int32_t event,
 	api->ipc_dispatch_iov_send(cmap_track_user_data->conn, iov, 3);
 }
 
+static void cmap_pending_notify_free(struct cmap_pending_notify *pending)
+{
+
+	qb_list_del(&pending->list);
+	free(pending->key_name);
+	free(pending->new_value);
+	free(pending->old_value);
+	free(pending);
+}
+
+/*
+ * Remove pending notifications of given tracker (or of all trackers if
+ * cmap_track_user_data is NULL) without sending them
+ */
+static void cmap_pending_notify_del(struct cmap_conn_info *conn_info,
+		const struct cmap_track_user_data *cmap_track_user_data)
+{
+	struct cmap_pending_notify *pending;
+	struct qb_list_head *iter, *tmp_iter;
+
+	qb_list_for_each_safe(iter, tmp_iter, &conn_info->pending_notify_head) {
+		pending = qb_list_entry(iter, struct cmap_pending_notify, list);
+
+		if (cmap_track_user_data == NULL || pending->track_user_data == cmap_track_user_data) {
+			cmap_pending_notify_free(pending);
+		}
+	}
+}
+
+static int cmap_pending_notify_set_value(void **dst_value, size_t *dst_value_len,
+		icmap_value_types_t *dst_value_type, struct icmap_notify_value val)
+{
+	void *value = NULL;
+
+	if (val.len > 0) {
+		value = malloc(val.len);
+		if (value == NULL) {
+			return (-1);
+		}
+		memcpy(value, val.data, val.len);
+	}
+
+	free(*dst_value);
+	*dst_value = value;
+	*dst_value_len = val.len;
+	*dst_value_type = val.type;
+
+	return (0);
+}
+
+static void cmap_pending_notify_flush(void *conn)
+{
+	struct cmap_conn_info *conn_info = (struct cmap_conn_info *)api->ipc_private_data_get (conn);
+	struct res_lib_cmap_notify_batch_callback *res_lib_cmap_notify_batch_callback;
+	struct res_lib_cmap_notify_callback *item;
+	struct cmap_pending_notify *pending;
+	struct icmap_notify_value new_val;
+	struct icmap_notify_value old_val;
+	struct qb_list_head *iter, *tmp_iter;
+	char *batch_buf;
+	size_t batch_len;
+	size_t item_len;
+
+	batch_buf = malloc(CMAP_NOTIFY_BATCH_MAX_SIZE);
+	res_lib_cmap_notify_batch_callback = (struct res_lib_cmap_notify_batch_callback *)batch_buf;
+	batch_len = sizeof(*res_lib_cmap_notify_batch_callback);
+
+	qb_list_for_each_safe(iter, tmp_iter, &conn_info->pending_notify_head) {
+		pending = qb_list_entry(iter, struct cmap_pending_notify, list);
+
+		item_len = MAR_ALIGN_UP(sizeof(*item) + pending->new_value_len + pending->old_value_len, 8);
+
+		if (batch_buf != NULL && batch_len + item_len > CMAP_NOTIFY_BATCH_MAX_SIZE &&
+		    batch_len > sizeof(*res_lib_cmap_notify_batch_callback)) {
+			/*
+			 * Batch is full -> send it and start new one
+			 */
+			res_lib_cmap_notify_batch_callback->header.size = batch_len;
+			if (api->ipc_dispatch_send(conn, batch_buf, batch_len) == 0) {
+				cmap_notify_stats.batches++;
+			}
+
+			batch_len = sizeof(*res_lib_cmap_notify_batch_callback);
+		}
+
+		if (batch_buf == NULL ||
+		    sizeof(*res_lib_cmap_notify_batch_callback) + item_len > CMAP_NOTIFY_BATCH_MAX_SIZE) {
+			/*
+			 * No memory for batch or item is too big to fit into batch -> use standard
+			 * notification
+			 */
+			new_val.type = pending->new_value_type;
+			new_val.len = pending->new_value_len;
+			new_val.data = pending->new_value;
+			old_val.type = pending->old_value_type;
+			old_val.len = pending->old_value_len;
+			old_val.data = pending->old_value;
+
+			cmap_notify_send(pending->track_user_data, pending->event, pending->key_name,
+			    new_val, old_val);
+
+			cmap_pending_notify_free(pending);
+			continue;
+		}
+
+		if (batch_len == sizeof(*res_lib_cmap_notify_batch_callback)) {
+			memset(res_lib_cmap_notify_batch_callback, 0, sizeof(*res_lib_cmap_notify_batch_callback));
+			res_lib_cmap_notify_batch_callback->header.id = MESSAGE_RES_CMAP_NOTIFY_BATCH_CALLBACK;
+			res_lib_cmap_notify_batch_callback->header.error = CS_OK;
+		}
+
+		item = (struct res_lib_cmap_notify_callback *)(batch_buf + batch_len);
+		memset(item, 0, item_len);
+
+		item->header.size = item_len;
+		item->header.id = MESSAGE_RES_CMAP_NOTIFY_CALLBACK;
+		item->header.error = CS_OK;
+		item->new_value_type = pending->new_value_type;
+		item->old_value_type = pending->old_value_type;
+		item->new_value_len = pending->new_value_len;
+		item->old_value_len = pending->old_value_len;
+		item->event = pending->event;
+		item->key_name.length = strlen(pending->key_name);
+		item->track_inst_handle = pending->track_user_data->track_inst_handle;
+		memcpy(item->key_name.value, pending->key_name, strlen(pending->key_name));
+		if (pending->new_value_len > 0) {
+			memcpy(item->new_value, pending->new_value, pending->new_value_len);
+		}
+		if (pending->old_value_len > 0) {
+			memcpy(item->new_value + pending->new_value_len, pending->old_value,
+			    pending->old_value_len);
+		}
+
+		batch_len += item_len;
+		res_lib_cmap_notify_batch_callback->no_items++;
+		cmap_notify_stats.batched_items++;
+
+		cmap_pending_notify_free(pending);
+	}
+
+	if (batch_buf != NULL && batch_len > sizeof(*res_lib_cmap_notify_batch_callback)) {
+		res_lib_cmap_notify_batch_callback->header.size = batch_len;
+		if (api->ipc_dispatch_send(conn, batch_buf, batch_len) == 0) {
+			cmap_notify_stats.batches++;
+		}
+	}
+	stats_source_changed(STATS_SOURCE_CMAP);
+
+	free(batch_buf);
+}
+
+static void cmap_coalesce_timer_fn(void *data)
+{
+	void *conn = data;
+	struct cmap_conn_info *conn_info = (struct cmap_conn_info *)api->ipc_private_data_get (conn);
+
+	conn_info->coalesce_timer_running = 0;
+
+	cmap_pending_notify_flush(conn);
+}
+
+static void cmap_notify_coalesce(struct cmap_track_user_data *cmap_track_user_data,
+		int32_t event,
+		const char *key_name,
+		struct icmap_notify_value new_val,
+		struct icmap_notify_value old_val)
+{
+	struct cmap_conn_info *conn_info;
+	struct cmap_pending_notify *pending;
+	struct qb_list_head *iter;
+	uint32_t coalesce_interval;
+
+	conn_info = (struct cmap_conn_info *)api->ipc_private_data_get (cmap_track_user_data->conn);
+
+	qb_list_for_each(iter, &conn_info->pending_notify_head) {
+		pending = qb_list_entry(iter, struct cmap_pending_notify, list);
+
+		if (pending->track_user_data != cmap_track_user_data ||
+		    strcmp(pending->key_name, key_name) != 0) {
+			continue;
+		}
+
+		cmap_notify_stats.coalesced++;
+		stats_source_changed(STATS_SOURCE_CMAP);
+
+		if (pending->event == ICMAP_TRACK_ADD && event == ICMAP_TRACK_DELETE) {
+			/*
+			 * Key was created and deleted again -> nothing to report
+			 */
+			cmap_pending_notify_free(pending);
+			return ;
+		}
+
+		if (pending->event == ICMAP_TRACK_DELETE && event == ICMAP_TRACK_ADD) {
+			/*
+			 * Key was deleted and created again -> client still has old value
+			 */
+			pending->event = ICMAP_TRACK_MODIFY;
+		} else if (!(pending->event == ICMAP_TRACK_ADD && event == ICMAP_TRACK_MODIFY)) {
+			pending->event = event;
+		}
+
+		if (cmap_pending_notify_set_value(&pending->new_value, &pending->new_value_len,
+		    &pending->new_value_type, new_val) != 0) {
+			log_printf(LOGSYS_LEVEL_ERROR, "Can't store coalesced notification for %s",
+			    key_name);
+		}
+
+		return ;
+	}
+
+	pending = malloc(sizeof(*pending));
+	if (pending == NULL) {
+		goto send_direct;
+	}
+	memset(pending, 0, sizeof(*pending));
+
+	qb_list_init(&pending->list);
+	pending->track_user_data = cmap_track_user_data;
+	pending->event = event;
+	pending->key_name = strdup(key_name);
+
+	if (pending->key_name == NULL ||
+	    cmap_pending_notify_set_value(&pending->new_value, &pending->new_value_len,
+	    &pending->new_value_type, new_val) != 0 ||
+	    cmap_pending_notify_set_value(&pending->old_value, &pending->old_value_len,
+	    &pending->old_value_type, old_val) != 0) {
+		cmap_pending_notify_free(pending);
+		goto send_direct;
+	}
+
+	qb_list_add_tail(&pending->list, &conn_info->pending_notify_head);
+
+	if (!conn_info->coalesce_timer_running) {
+		if (icmap_get_uint32("cmap.track_coalesce_interval", &coalesce_interval) != CS_OK) {
+			coalesce_interval = CMAP_TRACK_COALESCE_DEFAULT_INTERVAL;
+		}
+
+		if (api->timer_add_duration((unsigned long long)coalesce_interval * QB_TIME_NS_IN_MSEC,
+		    cmap_track_user_data->conn, cmap_coalesce_timer_fn, &conn_info->coalesce_timer) != 0) {
+			log_printf(LOGSYS_LEVEL_ERROR, "Can't add coalesce timer, sending notifications directly");
+			cmap_pending_notify_flush(cmap_track_user_data->conn);
+		} else {
+			conn_info->coalesce_timer_running = 1;
+		}
+	}
+
+	return ;
+
+send_direct:
+	cmap_notify_send(cmap_track_user_data, event, key_name, new_val, old_val);
+}
+
+static void cmap_notify_fn(int32_t event,
+		const char *key_name,
+		struct icmap_notify_value new_val,
+		struct icmap_notify_value old_val,
+		void *user_data)
+{
+	struct cmap_track_user_data *cmap_track_user_data = (struct cmap_track_user_data *)user_data;
+
+	if (cmap_track_user_data->coalesce) {
+		cmap_notify_coalesce(cmap_track_user_data, event, key_name, new_val, old_val);
+	} else {
+		cmap_notify_send(cmap_track_user_data, event, key_name, new_val, old_val);
+	}
+}
+
+void cmap_notify_stats_get(struct cmap_notify_stats *stats)
+{
+
+	memcpy(stats, &cmap_notify_stats, sizeof(*stats));
+}
+
+void cmap_notify_stats_clear(void)
+{
+
+	memset(&cmap_notify_stats, 0, sizeof(cmap_notify_stats));
+}
+
 static void message_handler_req_lib_cmap_track_add(void *conn, const void *message)
 {
 	const struct req_lib_cmap_track_add *req_lib_cmap_track_add = message;
@@ -791,8 +1121,12 @@ static void message_handler_req_lib_cmap_track_add(void *conn, const void *messa
 		key_name = NULL;
 	}
 
+	if (req_lib_cmap_track_add->track_type & CMAP_TRACK_COALESCE) {
+		cmap_track_user_data->coalesce = 1;
+	}
+
 	ret = conn_info->map_fns.map_track_add(key_name,
-					       req_lib_cmap_track_add->track_type,
+					       req_lib_cmap_track_add->track_type & ~CMAP_TRACK_COALESCE,
 					       cmap_notify_fn,
 					       cmap_track_user_data,
 					       &track);
@@ -850,6 +1184,8 @@ static void message_handler_req_lib_cmap_track_delete(void *conn, const void *me
 
 	track_inst_handle = ((struct cmap_track_user_data *)icmap_track_get_user_data(*track))->track_inst_handle;
 
+	cmap_pending_notify_del(conn_info, conn_info->map_fns.map_track_get_user_data(*track));
+
 	free(conn_info->map_fns.map_track_get_user_data(*track));
 
 	ret = conn_info->map_fns.map_track_delete(*track);
@@ -918,6 +1254,37 @@ reply_send:
 	api->ipc_response_send(conn, &res, sizeof(res));
 }
 
+static void message_handler_req_lib_cmap_stats_snapshot(void *conn, const void *message)
+{
+	const struct req_lib_cmap_stats_snapshot *req_lib_cmap_stats_snapshot = message;
+	struct res_lib_cmap_stats_snapshot res_lib_cmap_stats_snapshot;
+	struct iovec iov[2];
+	void *snapshot = NULL;
+	size_t snapshot_len = 0;
+	cs_error_t ret;
+
+	if (req_lib_cmap_stats_snapshot->max_len < sizeof(res_lib_cmap_stats_snapshot)) {
+		ret = CS_ERR_INVALID_PARAM;
+	} else {
+		ret = stats_map_snapshot(req_lib_cmap_stats_snapshot->max_len - sizeof(res_lib_cmap_stats_snapshot),
+		    &snapshot, &snapshot_len);
+	}
+
+	memset(&res_lib_cmap_stats_snapshot, 0, sizeof(res_lib_cmap_stats_snapshot));
+	res_lib_cmap_stats_snapshot.header.size = sizeof(res_lib_cmap_stats_snapshot) + snapshot_len;
+	res_lib_cmap_stats_snapshot.header.id = MESSAGE_RES_CMAP_STATS_SNAPSHOT;
+	res_lib_cmap_stats_snapshot.header.error = ret;
+	res_lib_cmap_stats_snapshot.snapshot_len = snapshot_len;
+
+	iov[0].iov_base = (void *)&res_lib_cmap_stats_snapshot;
+	iov[0].iov_len = sizeof(res_lib_cmap_stats_snapshot);
+	iov[1].iov_base = snapshot;
+	iov[1].iov_len = snapshot_len;
+
+	api->ipc_response_iov_send(conn, iov, (snapshot_len > 0 ? 2 : 1));
+	free(snapshot);
+}
+
 static cs_error_t cmap_mcast_send(enum cmap_mcast_reason reason, int argc, char *argv[])
 {
 	int i;
@@ -85,6 +85,7 @@ enum main_cp_cb_data_state {
 	MAIN_CP_CB_DATA_STATE_NODELIST_NODE,
 	MAIN_CP_CB_DATA_STATE_PLOAD,
 	MAIN_CP_CB_DATA_STATE_QB,
+	MAIN_CP_CB_DATA_STATE_CMAP,
 	MAIN_CP_CB_DATA_STATE_RESOURCES,
 	MAIN_CP_CB_DATA_STATE_RESOURCES_SYSTEM,
 	MAIN_CP_CB_DATA_STATE_RESOURCES_PROCESS,
@@ -696,6 +697,29 @@ static int main_config_parser_cb(const char *path,
 					return (0);
 				}
 			}
+			if ((strcmp(path, "qb.ipc_sched_budget") == 0) ||
+			    (strcmp(path, "qb.ipc_fc_high_watermark") == 0) ||
+			    (strcmp(path, "qb.ipc_fc_low_watermark") == 0) ||
+			    (strncmp(path, "qb.ipc_sched_weight_", strlen("qb.ipc_sched_weight_")) == 0)) {
+				val_type = ICMAP_VALUETYPE_UINT32;
+				if (safe_atoq(value, &val, val_type) != 0) {
+					goto atoi_error;
+				}
+				icmap_set_uint32_r(config_map, path, val);
+				add_as_string = 0;
+			}
+			break;
+
+		case MAIN_CP_CB_DATA_STATE_CMAP:
+			if ((strcmp(path, "cmap.track_coalesce_interval") == 0) ||
+			    (strcmp(path, "cmap.stats_track_min_interval") == 0)) {
+				val_type = ICMAP_VALUETYPE_UINT32;
+				if (safe_atoq(value, &val, val_type) != 0) {
+					goto atoi_error;
+				}
+				icmap_set_uint32_r(config_map, path, val);
+				add_as_string = 0;
+			}
 			break;
 
 		case MAIN_CP_CB_DATA_STATE_INTERFACE:
@@ -982,6 +1006,9 @@ static int main_config_parser_cb(const char *path,
 		if (strcmp(path, "qb") == 0) {
 			*state = MAIN_CP_CB_DATA_STATE_QB;
 		}
+		if (strcmp(path, "cmap") == 0) {
+			*state = MAIN_CP_CB_DATA_STATE_CMAP;
+		}
 		if (strcmp(path, "logging.logger_subsys") == 0) {
 			*state = MAIN_CP_CB_DATA_STATE_LOGGER_SUBSYS;
 			qb_list_init(&data->logger_subsys_items_head);
@@ -1230,6 +1257,7 @@ static int main_config_parser_cb(const char *path,
 		case MAIN_CP_CB_DATA_STATE_NODELIST:
 		case MAIN_CP_CB_DATA_STATE_TOTEM:
 		case MAIN_CP_CB_DATA_STATE_QB:
+		case MAIN_CP_CB_DATA_STATE_CMAP:
 			break;
 		case MAIN_CP_CB_DATA_STATE_RESOURCES:
 			*state = MAIN_CP_CB_DATA_STATE_NORMAL;
@@ -84,6 +84,8 @@ enum cpg_message_req_types {
 	MESSAGE_REQ_EXEC_CPG_DOWNLIST_OLD = 4,
 	MESSAGE_REQ_EXEC_CPG_DOWNLIST = 5,
 	MESSAGE_REQ_EXEC_CPG_PARTIAL_MCAST = 6,
+	MESSAGE_REQ_EXEC_CPG_MCAST_BATCH = 7,
+	MESSAGE_REQ_EXEC_CPG_CAPABILITIES = 8,
 };
 
 struct zcb_mapped {
@@ -137,9 +139,16 @@ enum cpd_state {
 
 enum cpg_sync_state {
 	CPGSYNC_DOWNLIST,
-	CPGSYNC_JOINLIST
+	CPGSYNC_JOINLIST,
+	CPGSYNC_CAPABILITIES
 };
 
+/*
+ * Capabilities announced by node during sync. Nodes running older version
+ * of corosync don't send (and discard) capabilities message.
+ */
+#define CPG_CAPABILITY_MCAST_BATCH	(1 << 0)
+
 enum cpg_downlist_state_e {
        CPG_DOWNLIST_NONE,
        CPG_DOWNLIST_WAITING_FOR_MESSAGES,
@@ -161,6 +170,8 @@ struct cpg_pd {
 	struct qb_list_head list;
 	struct qb_list_head iteration_instance_list_head;
 	struct qb_list_head zcb_mapped_list_head;
+	void *zc_arena;
+	size_t zc_arena_size;
 };
 
 struct cpg_iteration_instance {
@@ -186,6 +197,23 @@ static struct corosync_api_v1 *api = NULL;
 
 static enum cpg_sync_state my_sync_state = CPGSYNC_DOWNLIST;
 
+static unsigned int my_batch_capable_list[PROCESSOR_COUNT_MAX];
+
+static unsigned int my_batch_capable_list_entries;
+
+/*
+ * Set when every node of current membership supports
+ * MESSAGE_REQ_EXEC_CPG_MCAST_BATCH
+ */
+static int cpg_mcast_batch_supported = 0;
+
+/*
+ * Lengths of batch entries captured during validation of library request
+ */
+static uint32_t *batch_msglens;
+
+static uint32_t batch_msglens_size;
+
 static mar_cpg_ring_id_t last_sync_ring_id;
 
 struct process_info {
@@ -196,6 +224,31 @@ struct process_info {
 };
 QB_LIST_DECLARE (process_info_list_head);
 
+/*
+ * Members of local only groups. They are never sent to other nodes, so they
+ * are kept out of process_info_list_head and its synchronization.
+ */
+QB_LIST_DECLARE (local_process_info_list_head);
+
+static inline struct qb_list_head *process_info_list_get (int local_only)
+{
+
+	return (local_only ? &local_process_info_list_head : &process_info_list_head);
+}
+
+/*
+ * Flag of cpg_pd set for group joined by MESSAGE_REQ_CPG_JOIN_LOCAL_ONLY.
+ * Separate request is used (instead of flag of regular join) so older
+ * corosync refuses it instead of joining cluster wide group.
+ */
+#define CPD_FLAG_LOCAL_ONLY	0x80000000
+
+static inline int cpg_pd_local_only (const struct cpg_pd *cpd)
+{
+
+	return ((cpd->flags & CPD_FLAG_LOCAL_ONLY) ? 1 : 0);
+}
+
 struct join_list_entry {
 	uint32_t pid;
 	mar_cpg_name_t group_name;
@@ -230,6 +283,14 @@ static void message_handler_req_exec_cpg_partial_mcast (
 	const void *message,
 	unsigned int nodeid);
 
+static void message_handler_req_exec_cpg_mcast_batch (
+	const void *message,
+	unsigned int nodeid);
+
+static void message_handler_req_exec_cpg_capabilities (
+	const void *message,
+	unsigned int nodeid);
+
 static void message_handler_req_exec_cpg_downlist_old (
 	const void *message,
 	unsigned int nodeid);
@@ -246,6 +307,10 @@ static void exec_cpg_mcast_endian_convert (void *msg);
 
 static void exec_cpg_partial_mcast_endian_convert (void *msg);
 
+static void exec_cpg_mcast_batch_endian_convert (void *msg);
+
+static void exec_cpg_capabilities_endian_convert (void *msg);
+
 static void exec_cpg_downlist_endian_convert_old (void *msg);
 
 static void exec_cpg_downlist_endian_convert (void *msg);
@@ -260,6 +325,8 @@ static void message_handler_req_lib_cpg_mcast (void *conn, const void *message);
 
 static void message_handler_req_lib_cpg_partial_mcast (void *conn, const void *message);
 
+static void message_handler_req_lib_cpg_mcast_batch (void *conn, const void *message);
+
 static void message_handler_req_lib_cpg_membership (void *conn,
 						    const void *message);
 
@@ -290,12 +357,22 @@ static void message_handler_req_lib_cpg_zc_execute (
 	void *conn,
 	const void *message);
 
+static void message_handler_req_lib_cpg_zc_arena_map (
+	void *conn,
+	const void *message);
+
+static void message_handler_req_lib_cpg_zc_arena_execute (
+	void *conn,
+	const void *message);
+
 static int cpg_node_joinleave_send (unsigned int pid, const mar_cpg_name_t *group_name, int fn, int reason);
 
 static int cpg_exec_send_downlist(void);
 
 static int cpg_exec_send_joinlist(void);
 
+static int cpg_exec_send_capabilities(void);
+
 static void downlist_messages_delete (void);
 
 static void downlist_master_choose_and_send (void);
@@ -321,13 +398,15 @@ static void do_proc_join(
 	const mar_cpg_name_t *name,
 	uint32_t pid,
 	unsigned int nodeid,
-	int reason);
+	int reason,
+	int local_only);
 
 static void do_proc_leave(
 	const mar_cpg_name_t *name,
 	uint32_t pid,
 	unsigned int nodeid,
-	int reason);
+	int reason,
+	int local_only);
 
 static int notify_lib_totem_membership (
 	void *conn,
@@ -397,6 +476,26 @@ static struct corosync_lib_handler cpg_lib_engine[] =
 		.lib_handler_fn				= message_handler_req_lib_cpg_partial_mcast,
 		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
 	},
+	{ /* 13 */
+		.lib_handler_fn				= message_handler_req_lib_cpg_zc_arena_map,
+		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
+	},
+	{ /* 14 */
+		.lib_handler_fn				= message_handler_req_lib_cpg_zc_arena_execute,
+		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
+	},
+	{ /* 15 */
+		.lib_handler_fn				= message_handler_req_lib_cpg_mcast_batch,
+		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
+	},
+	{ /* 16 */
+		.lib_handler_fn				= message_handler_req_lib_cpg_partial_mcast,
+		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
+	},
+	{ /* 17 */
+		.lib_handler_fn				= message_handler_req_lib_cpg_join,
+		.flow_control				= CS_LIB_FLOW_CONTROL_REQUIRED
+	},
 
 };
 
@@ -430,6 +529,14 @@ static struct corosync_exec_handler cpg_exec_engine[] =
 		.exec_handler_fn	= message_handler_req_exec_cpg_partial_mcast,
 		.exec_endian_convert_fn	= exec_cpg_partial_mcast_endian_convert
 	},
+	{ /* 7 - MESSAGE_REQ_EXEC_CPG_MCAST_BATCH */
+		.exec_handler_fn	= message_handler_req_exec_cpg_mcast_batch,
+		.exec_endian_convert_fn	= exec_cpg_mcast_batch_endian_convert
+	},
+	{ /* 8 - MESSAGE_REQ_EXEC_CPG_CAPABILITIES */
+		.exec_handler_fn	= message_handler_req_exec_cpg_capabilities,
+		.exec_endian_convert_fn	= exec_cpg_capabilities_endian_convert
+	},
 };
 
 struct corosync_service_engine cpg_service_engine = {
@@ -485,6 +592,23 @@ struct req_exec_cpg_partial_mcast {
 	mar_uint8_t message[] __attribute__((aligned(8)));
 };
 
+/*
+ * message contains msg_count of cpg_mcast_batch_entry (as received from library)
+ */
+struct req_exec_cpg_mcast_batch {
+	struct qb_ipc_request_header header __attribute__((aligned(8)));
+	mar_cpg_name_t group_name __attribute__((aligned(8)));
+	mar_uint32_t msg_count __attribute__((aligned(8)));
+	mar_uint32_t pid __attribute__((aligned(8)));
+	mar_message_source_t source __attribute__((aligned(8)));
+	mar_uint8_t message[] __attribute__((aligned(8)));
+};
+
+struct req_exec_cpg_capabilities {
+	struct qb_ipc_request_header header __attribute__((aligned(8)));
+	mar_uint32_t capabilities __attribute__((aligned(8)));
+};
+
 struct req_exec_cpg_downlist_old {
 	struct qb_ipc_request_header header __attribute__((aligned(8)));
 	mar_uint32_t left_nodes __attribute__((aligned(8)));
@@ -559,6 +683,7 @@ static void cpg_sync_init (
 	int found;
 
 	my_sync_state = CPGSYNC_DOWNLIST;
+	my_batch_capable_list_entries = 0;
 
 	memcpy (my_member_list, member_list, member_list_entries *
 		sizeof (unsigned int));
@@ -602,16 +727,46 @@ static int cpg_sync_process (void)
 	}
 	if (my_sync_state == CPGSYNC_JOINLIST) {
 		res = cpg_exec_send_joinlist();
+		if (res == -1) {
+			return (-1);
+		}
+		my_sync_state = CPGSYNC_CAPABILITIES;
+	}
+	if (my_sync_state == CPGSYNC_CAPABILITIES) {
+		res = cpg_exec_send_capabilities();
 	}
 	return (res);
 }
 
 static void cpg_sync_activate (void)
 {
+	int i, j;
+	int found;
+
 	memcpy (my_old_member_list, my_member_list,
 		my_member_list_entries * sizeof (unsigned int));
 	my_old_member_list_entries = my_member_list_entries;
 
+	/*
+	 * Batch is used only when all members announced support during this sync
+	 */
+	cpg_mcast_batch_supported = 1;
+	for (i = 0; i < my_member_list_entries; i++) {
+		found = 0;
+		for (j = 0; j < my_batch_capable_list_entries; j++) {
+			if (my_member_list[i] == my_batch_capable_list[j]) {
+				found = 1;
+				break;
+			}
+		}
+		if (!found) {
+			cpg_mcast_batch_supported = 0;
+			break;
+		}
+	}
+	log_printf(LOGSYS_LEVEL_DEBUG, "mcast batch %s by all members",
+		(cpg_mcast_batch_supported ? "supported" : "not supported"));
+
 	if (downlist_state == CPG_DOWNLIST_WAITING_FOR_MESSAGES) {
 		downlist_master_choose_and_send ();
 	}
@@ -627,6 +782,7 @@ static void cpg_sync_activate (void)
 
 static void cpg_sync_abort (void)
 {
+	my_batch_capable_list_entries = 0;
 	downlist_state = CPG_DOWNLIST_NONE;
 	downlist_messages_delete ();
 	joinlist_messages_delete ();
@@ -676,18 +832,20 @@ static int notify_lib_joinlist(
 	mar_cpg_address_t *joined_list,
 	int left_list_entries,
 	mar_cpg_address_t *left_list,
-	int id)
+	int id,
+	int local_only)
 {
 	int size;
 	char *buf;
 	struct qb_list_head *iter;
+	struct qb_list_head *pi_list_head = process_info_list_get (local_only);
 	int count;
 	struct res_lib_cpg_confchg_callback *res;
 	mar_cpg_address_t *retgi;
 
 	count = 0;
 
-	qb_list_for_each(iter, &process_info_list_head) {
+	qb_list_for_each(iter, pi_list_head) {
 		struct process_info *pi = qb_list_entry (iter, struct process_info, list);
 		if (mar_name_compare (&pi->group, group_name) == 0) {
 			int i;
@@ -720,7 +878,7 @@ static int notify_lib_joinlist(
 	res->header.error = CS_OK;
 	memcpy(&res->group_name, group_name, sizeof(mar_cpg_name_t));
 
-	qb_list_for_each(iter, &process_info_list_head) {
+	qb_list_for_each(iter, pi_list_head) {
 		struct process_info *pi=qb_list_entry (iter, struct process_info, list);
 
 		if (mar_name_compare (&pi->group, group_name) == 0) {
@@ -756,7 +914,8 @@ static int notify_lib_joinlist(
 	} else {
 	qb_list_for_each(iter, &cpg_pd_list_head) {
 			struct cpg_pd *cpd = qb_list_entry (iter, struct cpg_pd, list);
-			if (mar_name_compare (&cpd->group_name, group_name) == 0) {
+			if (mar_name_compare (&cpd->group_name, group_name) == 0 &&
+			    cpg_pd_local_only (cpd) == local_only) {
 				assert (joined_list_entries <= 1);
 				if (joined_list_entries) {
 					if (joined_list[0].pid == cpd->pid &&
@@ -948,7 +1107,7 @@ static void downlist_master_choose_and_send (void)
 			0, NULL,
 			pcd->left_list_entries,
 			pcd->left_list,
-			MESSAGE_RES_CPG_CONFCHG_CALLBACK);
+			MESSAGE_RES_CPG_CONFCHG_CALLBACK, 0);
 
 		free(pcd);
 	}
@@ -997,7 +1156,7 @@ static void joinlist_remove_zombie_pi_entries (void)
 		}
 
 		if (!found) {
-			do_proc_leave(&pi->group, pi->pid, pi->nodeid, CONFCHG_CPG_REASON_PROCDOWN);
+			do_proc_leave(&pi->group, pi->pid, pi->nodeid, CONFCHG_CPG_REASON_PROCDOWN, 0);
 		}
 	}
 }
@@ -1023,7 +1182,7 @@ static void joinlist_inform_clients (void)
 		}
 
 		do_proc_join (&stored_msg->group_name, stored_msg->pid, stored_msg->sender_nodeid,
-			CONFCHG_CPG_REASON_NODEUP);
+			CONFCHG_CPG_REASON_NODEUP, 0);
 	}
 
 	joinlist_remove_zombie_pi_entries ();
@@ -1099,8 +1258,15 @@ static int cpg_lib_exit_fn (void *conn)
 	log_printf(LOGSYS_LEVEL_DEBUG, "exit_fn for conn=%p", conn);
 
 	if (cpd->group_name.length > 0 && cpd->cpd_state != CPD_STATE_LEAVE_STARTED) {
-		cpg_node_joinleave_send (cpd->pid, &cpd->group_name,
-				MESSAGE_REQ_EXEC_CPG_PROCLEAVE, CONFCHG_CPG_REASON_PROCDOWN);
+		if (cpg_pd_local_only (cpd)) {
+			/* Don't send confchg to connection which is being closed */
+			cpd->cpd_state = CPD_STATE_UNJOINED;
+			do_proc_leave (&cpd->group_name, cpd->pid, api->totem_nodeid_get (),
+				CONFCHG_CPG_REASON_PROCDOWN, 1);
+		} else {
+			cpg_node_joinleave_send (cpd->pid, &cpd->group_name,
+					MESSAGE_REQ_EXEC_CPG_PROCLEAVE, CONFCHG_CPG_REASON_PROCDOWN);
+		}
 	}
 
 	cpg_pd_finalize (cpd);
@@ -1184,6 +1350,39 @@ static void exec_cpg_mcast_endian_convert (void *msg)
 	swab_mar_message_source_t (&req_exec_cpg_mcast->source);
 }
 
+static void exec_cpg_mcast_batch_endian_convert (void *msg)
+{
+	struct req_exec_cpg_mcast_batch *req_exec_cpg_mcast_batch = msg;
+	struct cpg_mcast_batch_entry *entry;
+	size_t offset;
+	uint32_t i;
+
+	swab_coroipc_request_header_t (&req_exec_cpg_mcast_batch->header);
+	swab_mar_cpg_name_t (&req_exec_cpg_mcast_batch->group_name);
+	req_exec_cpg_mcast_batch->pid = swab32(req_exec_cpg_mcast_batch->pid);
+	req_exec_cpg_mcast_batch->msg_count = swab32(req_exec_cpg_mcast_batch->msg_count);
+	swab_mar_message_source_t (&req_exec_cpg_mcast_batch->source);
+
+	offset = sizeof (struct req_exec_cpg_mcast_batch);
+	for (i = 0; i < req_exec_cpg_mcast_batch->msg_count; i++) {
+		if (offset + sizeof (struct cpg_mcast_batch_entry) > req_exec_cpg_mcast_batch->header.size) {
+			break;
+		}
+
+		entry = (struct cpg_mcast_batch_entry *)((char *)msg + offset);
+		entry->msglen = swab32(entry->msglen);
+		offset += CPG_MCAST_BATCH_ENTRY_SIZE(entry->msglen);
+	}
+}
+
+static void exec_cpg_capabilities_endian_convert (void *msg)
+{
+	struct req_exec_cpg_capabilities *req_exec_cpg_capabilities = msg;
+
+	swab_coroipc_request_header_t (&req_exec_cpg_capabilities->header);
+	req_exec_cpg_capabilities->capabilities = swab32(req_exec_cpg_capabilities->capabilities);
+}
+
 static void exec_cpg_partial_mcast_endian_convert (void *msg)
 {
 	struct req_exec_cpg_partial_mcast *req_exec_cpg_mcast = msg;
@@ -1197,10 +1396,11 @@ static void exec_cpg_partial_mcast_endian_convert (void *msg)
 	swab_mar_message_source_t (&req_exec_cpg_mcast->source);
 }
 
-static struct process_info *process_info_find(const mar_cpg_name_t *group_name, uint32_t pid, unsigned int nodeid) {
+static struct process_info *process_info_find(const mar_cpg_name_t *group_name, uint32_t pid,
+	unsigned int nodeid, int local_only) {
 	struct qb_list_head *iter;
 
-	qb_list_for_each(iter, &process_info_list_head) {
+	qb_list_for_each(iter, process_info_list_get (local_only)) {
 		struct process_info *pi = qb_list_entry (iter, struct process_info, list);
 
 		if (pi->pid == pid && pi->nodeid == nodeid &&
@@ -1216,15 +1416,17 @@ static void do_proc_join(
 	const mar_cpg_name_t *name,
 	uint32_t pid,
 	unsigned int nodeid,
-	int reason)
+	int reason,
+	int local_only)
 {
 	struct process_info *pi;
 	struct process_info *pi_entry;
 	mar_cpg_address_t notify_info;
 	struct qb_list_head *list;
 	struct qb_list_head *list_to_add = NULL;
+	struct qb_list_head *pi_list_head = process_info_list_get (local_only);
 
-	if (process_info_find (name, pid, nodeid) != NULL) {
+	if (process_info_find (name, pid, nodeid, local_only) != NULL) {
 		return ;
  	}
 	pi = malloc (sizeof (struct process_info));
@@ -1240,8 +1442,8 @@ static void do_proc_join(
 	/*
 	 * Insert new process in sorted order so synchronization works properly
 	 */
-	list_to_add = &process_info_list_head;
-	qb_list_for_each(list, &process_info_list_head) {
+	list_to_add = pi_list_head;
+	qb_list_for_each(list, pi_list_head) {
 		pi_entry = qb_list_entry(list, struct process_info, list);
 		if (pi_entry->nodeid > pi->nodeid ||
 			(pi_entry->nodeid == pi->nodeid && pi_entry->pid > pi->pid)) {
@@ -1259,14 +1461,15 @@ static void do_proc_join(
 	notify_lib_joinlist(&pi->group, NULL,
 			    1, &notify_info,
 			    0, NULL,
-			    MESSAGE_RES_CPG_CONFCHG_CALLBACK);
+			    MESSAGE_RES_CPG_CONFCHG_CALLBACK, local_only);
 }
 
 static void do_proc_leave(
 	const mar_cpg_name_t *name,
 	uint32_t pid,
 	unsigned int nodeid,
-	int reason)
+	int reason,
+	int local_only)
 {
 	struct process_info *pi;
 	struct qb_list_head *iter, *tmp_iter;
@@ -1279,9 +1482,9 @@ static void do_proc_leave(
 	notify_lib_joinlist(name, NULL,
 		0, NULL,
 		1, &notify_info,
-		MESSAGE_RES_CPG_CONFCHG_CALLBACK);
+		MESSAGE_RES_CPG_CONFCHG_CALLBACK, local_only);
 
-	qb_list_for_each_safe(iter, tmp_iter, &process_info_list_head) {
+	qb_list_for_each_safe(iter, tmp_iter, process_info_list_get (local_only)) {
 		pi = qb_list_entry(iter, struct process_info, list);
 
 		if (pi->pid == pid && pi->nodeid == nodeid &&
@@ -1356,7 +1559,7 @@ static void message_handler_req_exec_cpg_procjoin (
 
 	do_proc_join (&req_exec_cpg_procjoin->group_name,
 		req_exec_cpg_procjoin->pid, nodeid,
-		CONFCHG_CPG_REASON_JOIN);
+		CONFCHG_CPG_REASON_JOIN, 0);
 }
 
 static void message_handler_req_exec_cpg_procleave (
@@ -1372,7 +1575,7 @@ static void message_handler_req_exec_cpg_procleave (
 
 	do_proc_leave (&req_exec_cpg_procjoin->group_name,
 		req_exec_cpg_procjoin->pid, nodeid,
-		req_exec_cpg_procjoin->reason);
+		req_exec_cpg_procjoin->reason, 0);
 }
 
 
@@ -1401,13 +1604,15 @@ static void message_handler_req_exec_cpg_joinlist (
 	}
 }
 
-static void message_handler_req_exec_cpg_mcast (
-	const void *message,
-	unsigned int nodeid)
+static void cpg_mcast_deliver (
+	const mar_cpg_name_t *group_name,
+	uint32_t pid,
+	unsigned int nodeid,
+	const void *msg,
+	uint32_t msglen,
+	int local_only)
 {
-	const struct req_exec_cpg_mcast *req_exec_cpg_mcast = message;
 	struct res_lib_cpg_deliver_callback res_lib_cpg_mcast;
-	int msglen = req_exec_cpg_mcast->msglen;
 	struct qb_list_head *iter, *pi_iter, *tmp_iter;
 	struct cpg_pd *cpd;
 	struct iovec iovec[2];
@@ -1416,29 +1621,30 @@ static void message_handler_req_exec_cpg_mcast (
 	res_lib_cpg_mcast.header.id = MESSAGE_RES_CPG_DELIVER_CALLBACK;
 	res_lib_cpg_mcast.header.size = sizeof(res_lib_cpg_mcast) + msglen;
 	res_lib_cpg_mcast.msglen = msglen;
-	res_lib_cpg_mcast.pid = req_exec_cpg_mcast->pid;
+	res_lib_cpg_mcast.pid = pid;
 	res_lib_cpg_mcast.nodeid = nodeid;
 
-	memcpy(&res_lib_cpg_mcast.group_name, &req_exec_cpg_mcast->group_name,
+	memcpy(&res_lib_cpg_mcast.group_name, group_name,
 		sizeof(mar_cpg_name_t));
 	iovec[0].iov_base = (void *)&res_lib_cpg_mcast;
 	iovec[0].iov_len = sizeof (res_lib_cpg_mcast);
 
-	iovec[1].iov_base = (char*)message+sizeof(*req_exec_cpg_mcast);
+	iovec[1].iov_base = (void *)msg;
 	iovec[1].iov_len = msglen;
 
 	qb_list_for_each_safe(iter, tmp_iter, &cpg_pd_list_head) {
 		cpd = qb_list_entry(iter, struct cpg_pd, list);
 		if ((cpd->cpd_state == CPD_STATE_LEAVE_STARTED || cpd->cpd_state == CPD_STATE_JOIN_COMPLETED)
-			&& (mar_name_compare (&cpd->group_name, &req_exec_cpg_mcast->group_name) == 0)) {
+			&& (mar_name_compare (&cpd->group_name, group_name) == 0)
+			&& cpg_pd_local_only (cpd) == local_only) {
 
 			if (!known_node) {
 				/* Try to find, if we know the node */
-				qb_list_for_each(pi_iter, &process_info_list_head) {
+				qb_list_for_each(pi_iter, process_info_list_get (local_only)) {
 					struct process_info *pi = qb_list_entry (pi_iter, struct process_info, list);
 
 					if (pi->nodeid == nodeid &&
-						mar_name_compare (&pi->group, &req_exec_cpg_mcast->group_name) == 0) {
+						mar_name_compare (&pi->group, group_name) == 0) {
 						known_node = 1;
 						break;
 					}
@@ -1455,11 +1661,78 @@ static void message_handler_req_exec_cpg_mcast (
 	}
 }
 
-static void message_handler_req_exec_cpg_partial_mcast (
+static void message_handler_req_exec_cpg_mcast (
 	const void *message,
 	unsigned int nodeid)
 {
-	const struct req_exec_cpg_partial_mcast *req_exec_cpg_mcast = message;
+	const struct req_exec_cpg_mcast *req_exec_cpg_mcast = message;
+
+	cpg_mcast_deliver (&req_exec_cpg_mcast->group_name, req_exec_cpg_mcast->pid, nodeid,
+		(const char *)message + sizeof(*req_exec_cpg_mcast), req_exec_cpg_mcast->msglen, 0);
+}
+
+static void message_handler_req_exec_cpg_capabilities (
+	const void *message,
+	unsigned int nodeid)
+{
+	const struct req_exec_cpg_capabilities *req_exec_cpg_capabilities = message;
+	int i;
+
+	log_printf(LOGSYS_LEVEL_DEBUG, "got capabilities 0x%x from node 0x%x",
+		req_exec_cpg_capabilities->capabilities, nodeid);
+
+	if (!(req_exec_cpg_capabilities->capabilities & CPG_CAPABILITY_MCAST_BATCH)) {
+		return ;
+	}
+
+	for (i = 0; i < my_batch_capable_list_entries; i++) {
+		if (my_batch_capable_list[i] == nodeid) {
+			return ;
+		}
+	}
+
+	if (my_batch_capable_list_entries < PROCESSOR_COUNT_MAX) {
+		my_batch_capable_list[my_batch_capable_list_entries++] = nodeid;
+	}
+}
+
+/*
+ * Every message of the batch is delivered separately, so library sees
+ * no difference between batch and msg_count of regular messages
+ */
+static void message_handler_req_exec_cpg_mcast_batch (
+	const void *message,
+	unsigned int nodeid)
+{
+	const struct req_exec_cpg_mcast_batch *req_exec_cpg_mcast_batch = message;
+	const struct cpg_mcast_batch_entry *entry;
+	size_t offset;
+	uint32_t i;
+
+	offset = sizeof (struct req_exec_cpg_mcast_batch);
+
+	for (i = 0; i < req_exec_cpg_mcast_batch->msg_count; i++) {
+		entry = (const struct cpg_mcast_batch_entry *)((const char *)message + offset);
+
+		if (offset + sizeof (struct cpg_mcast_batch_entry) > req_exec_cpg_mcast_batch->header.size ||
+		    entry->msglen > req_exec_cpg_mcast_batch->header.size - offset - sizeof (struct cpg_mcast_batch_entry)) {
+			log_printf(LOGSYS_LEVEL_WARNING, "Malformed batch message from node %u", nodeid);
+			return ;
+		}
+
+		cpg_mcast_deliver (&req_exec_cpg_mcast_batch->group_name, req_exec_cpg_mcast_batch->pid,
+			nodeid, entry->message, entry->msglen, 0);
+
+		offset += CPG_MCAST_BATCH_ENTRY_SIZE(entry->msglen);
+	}
+}
+
+static void cpg_partial_mcast_deliver (
+	const struct req_exec_cpg_partial_mcast *req_exec_cpg_mcast,
+	const void *msg,
+	unsigned int nodeid,
+	int local_only)
+{
 	struct res_lib_cpg_partial_deliver_callback res_lib_cpg_mcast;
 	int msglen = req_exec_cpg_mcast->fraglen;
 	struct qb_list_head *iter, *pi_iter, *tmp_iter;
@@ -1482,18 +1755,19 @@ static void message_handler_req_exec_cpg_partial_mcast (
 	iovec[0].iov_base = (void *)&res_lib_cpg_mcast;
 	iovec[0].iov_len = sizeof (res_lib_cpg_mcast);
 
-	iovec[1].iov_base = (char*)message+sizeof(*req_exec_cpg_mcast);
+	iovec[1].iov_base = (void *)msg;
 	iovec[1].iov_len = msglen;
 
 	qb_list_for_each_safe(iter, tmp_iter, &cpg_pd_list_head) {
 		cpd = qb_list_entry(iter, struct cpg_pd, list);
 
 		if ((cpd->cpd_state == CPD_STATE_LEAVE_STARTED || cpd->cpd_state == CPD_STATE_JOIN_COMPLETED)
-		    && (mar_name_compare (&cpd->group_name, &req_exec_cpg_mcast->group_name) == 0)) {
+		    && (mar_name_compare (&cpd->group_name, &req_exec_cpg_mcast->group_name) == 0)
+		    && cpg_pd_local_only (cpd) == local_only) {
 
 			if (!known_node) {
 				/* Try to find, if we know the node */
-				qb_list_for_each(pi_iter, &process_info_list_head) {
+				qb_list_for_each(pi_iter, process_info_list_get (local_only)) {
 					struct process_info *pi = qb_list_entry (pi_iter, struct process_info, list);
 
 					if (pi->nodeid == nodeid &&
@@ -1514,6 +1788,16 @@ static void message_handler_req_exec_cpg_partial_mcast (
 	}
 }
 
+static void message_handler_req_exec_cpg_partial_mcast (
+	const void *message,
+	unsigned int nodeid)
+{
+	const struct req_exec_cpg_partial_mcast *req_exec_cpg_mcast = message;
+
+	cpg_partial_mcast_deliver (req_exec_cpg_mcast, (const char *)message + sizeof(*req_exec_cpg_mcast),
+		nodeid, 0);
+}
+
 
 static int cpg_exec_send_downlist(void)
 {
@@ -1530,6 +1814,22 @@ static int cpg_exec_send_downlist(void)
 	return (api->totem_mcast (&iov, 1, TOTEM_AGREED));
 }
 
+static int cpg_exec_send_capabilities(void)
+{
+	struct req_exec_cpg_capabilities req_exec_cpg_capabilities;
+	struct iovec iov;
+
+	req_exec_cpg_capabilities.header.id = SERVICE_ID_MAKE(CPG_SERVICE,
+		MESSAGE_REQ_EXEC_CPG_CAPABILITIES);
+	req_exec_cpg_capabilities.header.size = sizeof(req_exec_cpg_capabilities);
+	req_exec_cpg_capabilities.capabilities = CPG_CAPABILITY_MCAST_BATCH;
+
+	iov.iov_base = (void *)&req_exec_cpg_capabilities;
+	iov.iov_len = sizeof(req_exec_cpg_capabilities);
+
+	return (api->totem_mcast (&iov, 1, TOTEM_AGREED));
+}
+
 static int cpg_exec_send_joinlist(void)
 {
 	int count = 0;
@@ -1588,6 +1888,8 @@ static int cpg_lib_init_fn (void *conn)
 
 	qb_list_init (&cpd->iteration_instance_list_head);
 	qb_list_init (&cpd->zcb_mapped_list_head);
+	cpd->zc_arena = NULL;
+	cpd->zc_arena_size = 0;
 
 	api->ipc_refcnt_inc (conn);
 	log_printf(LOGSYS_LEVEL_DEBUG, "lib_init_fn: conn=%p, cpd=%p", conn, cpd);
@@ -1602,6 +1904,12 @@ static void message_handler_req_lib_cpg_join (void *conn, const void *message)
 	struct res_lib_cpg_join res_lib_cpg_join;
 	cs_error_t error = CS_OK;
 	struct qb_list_head *iter;
+	uint32_t flags;
+
+	flags = req_lib_cpg_join->flags & ~CPD_FLAG_LOCAL_ONLY;
+	if (req_lib_cpg_join->header.id == MESSAGE_REQ_CPG_JOIN_LOCAL_ONLY) {
+		flags |= CPD_FLAG_LOCAL_ONLY;
+	}
 
 	/* Test, if we don't have same pid and group name joined */
 	qb_list_for_each(iter, &cpg_pd_list_head) {
@@ -1620,7 +1928,7 @@ static void message_handler_req_lib_cpg_join (void *conn, const void *message)
 	 * Same check must be done in process info list, because there may be not yet delivered
 	 * leave of client.
 	 */
-	qb_list_for_each(iter, &process_info_list_head) {
+	qb_list_for_each(iter, process_info_list_get ((flags & CPD_FLAG_LOCAL_ONLY) ? 1 : 0)) {
 		struct process_info *pi = qb_list_entry (iter, struct process_info, list);
 
 		if (pi->nodeid == api->totem_nodeid_get () && pi->pid == req_lib_cpg_join->pid &&
@@ -1641,13 +1949,22 @@ static void message_handler_req_lib_cpg_join (void *conn, const void *message)
 		error = CS_OK;
 		cpd->cpd_state = CPD_STATE_JOIN_STARTED;
 		cpd->pid = req_lib_cpg_join->pid;
-		cpd->flags = req_lib_cpg_join->flags;
+		cpd->flags = flags;
 		memcpy (&cpd->group_name, &req_lib_cpg_join->group_name,
 			sizeof (cpd->group_name));
 
-		cpg_node_joinleave_send (req_lib_cpg_join->pid,
-			&req_lib_cpg_join->group_name,
-			MESSAGE_REQ_EXEC_CPG_PROCJOIN, CONFCHG_CPG_REASON_JOIN);
+		if (cpg_pd_local_only (cpd)) {
+			/*
+			 * Local only group never leaves this node, join is completed
+			 * (and confchg sent) right now
+			 */
+			do_proc_join (&req_lib_cpg_join->group_name, req_lib_cpg_join->pid,
+				api->totem_nodeid_get (), CONFCHG_CPG_REASON_JOIN, 1);
+		} else {
+			cpg_node_joinleave_send (req_lib_cpg_join->pid,
+				&req_lib_cpg_join->group_name,
+				MESSAGE_REQ_EXEC_CPG_PROCJOIN, CONFCHG_CPG_REASON_JOIN);
+		}
 		break;
 	case CPD_STATE_LEAVE_STARTED:
 		error = CS_ERR_BUSY;
@@ -1690,10 +2007,15 @@ static void message_handler_req_lib_cpg_leave (void *conn, const void *message)
 	case CPD_STATE_JOIN_COMPLETED:
 		error = CS_OK;
 		cpd->cpd_state = CPD_STATE_LEAVE_STARTED;
-		cpg_node_joinleave_send (req_lib_cpg_leave->pid,
-			&req_lib_cpg_leave->group_name,
-			MESSAGE_REQ_EXEC_CPG_PROCLEAVE,
-			CONFCHG_CPG_REASON_LEAVE);
+		if (cpg_pd_local_only (cpd)) {
+			do_proc_leave (&req_lib_cpg_leave->group_name, req_lib_cpg_leave->pid,
+				api->totem_nodeid_get (), CONFCHG_CPG_REASON_LEAVE, 1);
+		} else {
+			cpg_node_joinleave_send (req_lib_cpg_leave->pid,
+				&req_lib_cpg_leave->group_name,
+				MESSAGE_REQ_EXEC_CPG_PROCLEAVE,
+				CONFCHG_CPG_REASON_LEAVE);
+		}
 		break;
 	}
 
@@ -1847,6 +2169,10 @@ static inline int zcb_all_free (
 
 		zcb_free (zcb_mapped);
 	}
+
+	cpd->zc_arena = NULL;
+	cpd->zc_arena_size = 0;
+
 	return (0);
 }
 
@@ -1907,20 +2233,52 @@ static void message_handler_req_lib_cpg_zc_free (
 	void *addr = NULL;
 	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
 
+	cs_error_t error = CS_OK;
+
 	log_printf(LOGSYS_LEVEL_DEBUG, " free'ing");
 
 	addr = serveraddr2void (hdr->server_address);
 
-	zcb_by_addr_free (cpd, addr);
+	/*
+	 * Arena stays mapped for whole life of connection and it's unmapped
+	 * only by zcb_all_free
+	 */
+	if (cpd->zc_arena != NULL && addr == cpd->zc_arena) {
+		error = CS_ERR_BUSY;
+	} else {
+		zcb_by_addr_free (cpd, addr);
+	}
 
 	res_header.size = sizeof (struct qb_ipc_response_header);
 	res_header.id = 0;
+	res_header.error = error;
 	api->ipc_response_send (
 		conn, &res_header,
 		res_header.size);
 }
 
 /* Fragmented mcast message from the library */
+/*
+ * Report failed mcast to library which doesn't wait for response
+ */
+static void cpg_mcast_error_notify (
+	void *conn,
+	uint32_t req_id,
+	uint32_t msg_count,
+	cs_error_t error)
+{
+	struct res_lib_cpg_mcast_error res_lib_cpg_mcast_error;
+
+	res_lib_cpg_mcast_error.header.size = sizeof(res_lib_cpg_mcast_error);
+	res_lib_cpg_mcast_error.header.id = MESSAGE_RES_CPG_MCAST_ERROR;
+	res_lib_cpg_mcast_error.header.error = error;
+	res_lib_cpg_mcast_error.req_id = req_id;
+	res_lib_cpg_mcast_error.msg_count = msg_count;
+
+	api->ipc_dispatch_send (conn, &res_lib_cpg_mcast_error,
+		sizeof (res_lib_cpg_mcast_error));
+}
+
 static void message_handler_req_lib_cpg_partial_mcast (void *conn, const void *message)
 {
 	const struct req_lib_cpg_partial_mcast *req_lib_cpg_mcast = message;
@@ -1979,13 +2337,29 @@ static void message_handler_req_lib_cpg_partial_mcast (void *conn, const void *m
 		req_exec_cpg_iovec[1].iov_base = (char *)&req_lib_cpg_mcast->message;
 		req_exec_cpg_iovec[1].iov_len = msglen;
 
-		result = api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED);
-		assert(result == 0);
+		if (cpg_pd_local_only (cpd)) {
+			cpg_partial_mcast_deliver (&req_exec_cpg_mcast, &req_lib_cpg_mcast->message,
+				api->totem_nodeid_get (), 1);
+		} else {
+			result = api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED);
+			assert(result == 0);
+		}
 	} else {
 		log_printf(LOGSYS_LEVEL_ERROR, "*** %p can't mcast to group %s state:%d, error:%d",
 			   conn, group_name.value, cpd->cpd_state, error);
 	}
 
+	/*
+	 * Async variant of request is used by library with CPG_MODEL_V1_ASYNC_SEND
+	 */
+	if (req_lib_cpg_mcast->header.id == MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC) {
+		if (error != CS_OK) {
+			cpg_mcast_error_notify (conn, req_lib_cpg_mcast->header.id, 1, error);
+		}
+
+		return ;
+	}
+
 	res_lib_cpg_partial_send.header.error = error;
 	api->ipc_response_send (conn, &res_lib_cpg_partial_send,
 				sizeof (res_lib_cpg_partial_send));
@@ -2021,7 +2395,10 @@ static void message_handler_req_lib_cpg_mcast (void *conn, const void *message)
 		break;
 	}
 
-	if (error == CS_OK) {
+	if (error == CS_OK && cpg_pd_local_only (cpd)) {
+		cpg_mcast_deliver (&group_name, cpd->pid, api->totem_nodeid_get (),
+			&req_lib_cpg_mcast->message, msglen, 1);
+	} else if (error == CS_OK) {
 		req_exec_cpg_mcast.header.size = sizeof(req_exec_cpg_mcast) + msglen;
 		req_exec_cpg_mcast.header.id = SERVICE_ID_MAKE(CPG_SERVICE,
 			MESSAGE_REQ_EXEC_CPG_MCAST);
@@ -2041,27 +2418,39 @@ static void message_handler_req_lib_cpg_mcast (void *conn, const void *message)
 	} else {
 		log_printf(LOGSYS_LEVEL_ERROR, "*** %p can't mcast to group %s state:%d, error:%d",
 			conn, group_name.value, cpd->cpd_state, error);
+
+		if (cpd->flags & CPG_MODEL_V1_ASYNC_SEND) {
+			cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST, 1, error);
+		}
 	}
 }
 
-static void message_handler_req_lib_cpg_zc_execute (
-	void *conn,
-	const void *message)
+/*
+ * Batch is checked (so totem never carries malformed message) and then sent
+ * to totem as one message. Entries are passed to totem exactly as they were
+ * packed by library.
+ */
+static void message_handler_req_lib_cpg_mcast_batch (void *conn, const void *message)
 {
-	mar_req_coroipcc_zc_execute_t *hdr = (mar_req_coroipcc_zc_execute_t *)message;
-	struct qb_ipc_request_header *header;
-	struct res_lib_cpg_mcast res_lib_cpg_mcast;
+	const struct req_lib_cpg_mcast_batch *req_lib_cpg_mcast_batch = message;
+	const struct cpg_mcast_batch_entry *entry;
 	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
+	mar_cpg_name_t group_name = cpd->group_name;
 	struct iovec req_exec_cpg_iovec[2];
+	struct req_exec_cpg_mcast_batch req_exec_cpg_mcast_batch;
 	struct req_exec_cpg_mcast req_exec_cpg_mcast;
-	struct req_lib_cpg_mcast *req_lib_cpg_mcast;
+	uint32_t *new_msglens;
+	uint32_t msg_count;
+	uint32_t msglen;
+	size_t packed_len;
+	size_t offset;
+	uint32_t i;
 	int result;
 	cs_error_t error = CS_ERR_NOT_EXIST;
 
-	log_printf(LOGSYS_LEVEL_TRACE, "got ZC mcast request on %p", conn);
+	log_printf(LOGSYS_LEVEL_TRACE, "got mcast batch request on %p", conn);
 
-	header = (struct qb_ipc_request_header *)(((char *)serveraddr2void(hdr->server_address) + sizeof (struct coroipcs_zc_header)));
-	req_lib_cpg_mcast = (struct req_lib_cpg_mcast *)header;
+	msg_count = req_lib_cpg_mcast_batch->msg_count;
 
 	switch (cpd->cpd_state) {
 	case CPD_STATE_UNJOINED:
@@ -2078,53 +2467,334 @@ static void message_handler_req_lib_cpg_zc_execute (
 		break;
 	}
 
-	res_lib_cpg_mcast.header.size = sizeof(res_lib_cpg_mcast);
-	res_lib_cpg_mcast.header.id = MESSAGE_RES_CPG_MCAST;
-	if (error == CS_OK) {
-		req_exec_cpg_mcast.header.size = sizeof(req_exec_cpg_mcast) + req_lib_cpg_mcast->msglen;
+	if (error != CS_OK) {
+		log_printf(LOGSYS_LEVEL_ERROR, "*** %p can't mcast batch to group %s state:%d, error:%d",
+			conn, group_name.value, cpd->cpd_state, error);
+		cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH, msg_count, error);
+		return ;
+	}
+
+	if (req_lib_cpg_mcast_batch->header.size < sizeof (struct req_lib_cpg_mcast_batch)) {
+		log_printf(LOGSYS_LEVEL_ERROR, "*** %p sent malformed mcast batch", conn);
+		cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH, msg_count,
+			CS_ERR_INVALID_PARAM);
+		return ;
+	}
+	packed_len = req_lib_cpg_mcast_batch->header.size - sizeof (struct req_lib_cpg_mcast_batch);
+
+	if (msg_count > packed_len / sizeof (struct cpg_mcast_batch_entry)) {
+		log_printf(LOGSYS_LEVEL_ERROR, "*** %p sent malformed mcast batch", conn);
+		cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH, msg_count,
+			CS_ERR_INVALID_PARAM);
+		return ;
+	}
+
+	if (msg_count > batch_msglens_size) {
+		new_msglens = realloc (batch_msglens, msg_count * sizeof (uint32_t));
+		if (new_msglens == NULL) {
+			cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH, msg_count,
+				CS_ERR_NO_MEMORY);
+			return ;
+		}
+		batch_msglens = new_msglens;
+		batch_msglens_size = msg_count;
+	}
+
+	/*
+	 * Request is in memory shared with client, so every msglen is read
+	 * only once and later steps use lengths captured here
+	 */
+	offset = 0;
+	for (i = 0; i < msg_count; i++) {
+		if (offset + sizeof (struct cpg_mcast_batch_entry) > packed_len) {
+			break;
+		}
+
+		entry = (const struct cpg_mcast_batch_entry *)(req_lib_cpg_mcast_batch->message + offset);
+		msglen = __atomic_load_n (&entry->msglen, __ATOMIC_RELAXED);
+
+		if (msglen > packed_len - offset - sizeof (struct cpg_mcast_batch_entry) ||
+		    CPG_MCAST_BATCH_ENTRY_SIZE(msglen) > packed_len - offset) {
+			break;
+		}
+
+		batch_msglens[i] = msglen;
+		offset += CPG_MCAST_BATCH_ENTRY_SIZE(msglen);
+	}
+
+	if (i < msg_count) {
+		log_printf(LOGSYS_LEVEL_ERROR, "*** %p sent malformed mcast batch", conn);
+		cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH, msg_count,
+			CS_ERR_INVALID_PARAM);
+		return ;
+	}
+
+	if (cpg_pd_local_only (cpd)) {
+		offset = 0;
+		for (i = 0; i < msg_count; i++) {
+			entry = (const struct cpg_mcast_batch_entry *)(req_lib_cpg_mcast_batch->message + offset);
+
+			cpg_mcast_deliver (&group_name, cpd->pid, api->totem_nodeid_get (),
+				entry->message, batch_msglens[i], 1);
+
+			offset += CPG_MCAST_BATCH_ENTRY_SIZE(batch_msglens[i]);
+		}
+
+		return ;
+	}
+
+	if (!cpg_mcast_batch_supported) {
+		/*
+		 * Some node of membership runs corosync without batch support
+		 * and would discard the batch, so every message is sent as
+		 * regular mcast
+		 */
 		req_exec_cpg_mcast.header.id = SERVICE_ID_MAKE(CPG_SERVICE,
 			MESSAGE_REQ_EXEC_CPG_MCAST);
 		req_exec_cpg_mcast.pid = cpd->pid;
-		req_exec_cpg_mcast.msglen = req_lib_cpg_mcast->msglen;
 		api->ipc_source_set (&req_exec_cpg_mcast.source, conn);
-		memcpy(&req_exec_cpg_mcast.group_name, &cpd->group_name,
+		memcpy(&req_exec_cpg_mcast.group_name, &group_name,
 			sizeof(mar_cpg_name_t));
 
 		req_exec_cpg_iovec[0].iov_base = (char *)&req_exec_cpg_mcast;
 		req_exec_cpg_iovec[0].iov_len = sizeof(req_exec_cpg_mcast);
-		req_exec_cpg_iovec[1].iov_base = (char *)header + sizeof(struct req_lib_cpg_mcast);
-		req_exec_cpg_iovec[1].iov_len = req_exec_cpg_mcast.msglen;
 
-		result = api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED);
-		if (result == 0) {
-			res_lib_cpg_mcast.header.error = CS_OK;
-		} else {
-			res_lib_cpg_mcast.header.error = CS_ERR_TRY_AGAIN;
+		offset = 0;
+		for (i = 0; i < msg_count; i++) {
+			entry = (const struct cpg_mcast_batch_entry *)(req_lib_cpg_mcast_batch->message + offset);
+
+			req_exec_cpg_mcast.header.size = sizeof(req_exec_cpg_mcast) + batch_msglens[i];
+			req_exec_cpg_mcast.msglen = batch_msglens[i];
+			req_exec_cpg_iovec[1].iov_base = (char *)entry->message;
+			req_exec_cpg_iovec[1].iov_len = batch_msglens[i];
+
+			if (api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED) != 0) {
+				cpg_mcast_error_notify (conn, MESSAGE_REQ_CPG_MCAST_BATCH,
+					msg_count - i, CS_ERR_TRY_AGAIN);
+				return ;
+			}
+
+			offset += CPG_MCAST_BATCH_ENTRY_SIZE(batch_msglens[i]);
 		}
+
+		return ;
+	}
+
+	req_exec_cpg_mcast_batch.header.size = sizeof(req_exec_cpg_mcast_batch) + offset;
+	req_exec_cpg_mcast_batch.header.id = SERVICE_ID_MAKE(CPG_SERVICE,
+		MESSAGE_REQ_EXEC_CPG_MCAST_BATCH);
+	req_exec_cpg_mcast_batch.pid = cpd->pid;
+	req_exec_cpg_mcast_batch.msg_count = msg_count;
+	api->ipc_source_set (&req_exec_cpg_mcast_batch.source, conn);
+	memcpy(&req_exec_cpg_mcast_batch.group_name, &group_name,
+		sizeof(mar_cpg_name_t));
+
+	req_exec_cpg_iovec[0].iov_base = (char *)&req_exec_cpg_mcast_batch;
+	req_exec_cpg_iovec[0].iov_len = sizeof(req_exec_cpg_mcast_batch);
+	req_exec_cpg_iovec[1].iov_base = (char *)&req_lib_cpg_mcast_batch->message;
+	req_exec_cpg_iovec[1].iov_len = offset;
+
+	result = api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED);
+	assert(result == 0);
+}
+
+/*
+ * Send message stored in zero copy buffer (shared memory mapped both by library
+ * and corosync) and return error code for response. Buffer is writable by
+ * client so msglen must be read by caller only once and passed here.
+ */
+static cs_error_t zc_mcast_send (
+	void *conn,
+	struct cpg_pd *cpd,
+	const struct req_lib_cpg_mcast *req_lib_cpg_mcast,
+	uint32_t msglen)
+{
+	struct iovec req_exec_cpg_iovec[2];
+	struct req_exec_cpg_mcast req_exec_cpg_mcast;
+	int result;
+	cs_error_t error = CS_ERR_NOT_EXIST;
+
+	switch (cpd->cpd_state) {
+	case CPD_STATE_UNJOINED:
+		error = CS_ERR_NOT_EXIST;
+		break;
+	case CPD_STATE_LEAVE_STARTED:
+		error = CS_ERR_NOT_EXIST;
+		break;
+	case CPD_STATE_JOIN_STARTED:
+		error = CS_OK;
+		break;
+	case CPD_STATE_JOIN_COMPLETED:
+		error = CS_OK;
+		break;
+	}
+
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	if (cpg_pd_local_only (cpd)) {
+		cpg_mcast_deliver (&cpd->group_name, cpd->pid, api->totem_nodeid_get (),
+			(const char *)req_lib_cpg_mcast + sizeof(struct req_lib_cpg_mcast),
+			msglen, 1);
+
+		return (CS_OK);
+	}
+
+	req_exec_cpg_mcast.header.size = sizeof(req_exec_cpg_mcast) + msglen;
+	req_exec_cpg_mcast.header.id = SERVICE_ID_MAKE(CPG_SERVICE,
+		MESSAGE_REQ_EXEC_CPG_MCAST);
+	req_exec_cpg_mcast.pid = cpd->pid;
+	req_exec_cpg_mcast.msglen = msglen;
+	api->ipc_source_set (&req_exec_cpg_mcast.source, conn);
+	memcpy(&req_exec_cpg_mcast.group_name, &cpd->group_name,
+		sizeof(mar_cpg_name_t));
+
+	req_exec_cpg_iovec[0].iov_base = (char *)&req_exec_cpg_mcast;
+	req_exec_cpg_iovec[0].iov_len = sizeof(req_exec_cpg_mcast);
+	req_exec_cpg_iovec[1].iov_base = (char *)req_lib_cpg_mcast + sizeof(struct req_lib_cpg_mcast);
+	req_exec_cpg_iovec[1].iov_len = msglen;
+
+	result = api->totem_mcast (req_exec_cpg_iovec, 2, TOTEM_AGREED);
+	if (result == 0) {
+		error = CS_OK;
 	} else {
-		res_lib_cpg_mcast.header.error = error;
+		error = CS_ERR_TRY_AGAIN;
 	}
 
+	return (error);
+}
+
+static void message_handler_req_lib_cpg_zc_execute (
+	void *conn,
+	const void *message)
+{
+	mar_req_coroipcc_zc_execute_t *hdr = (mar_req_coroipcc_zc_execute_t *)message;
+	struct res_lib_cpg_mcast res_lib_cpg_mcast;
+	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
+	struct req_lib_cpg_mcast *req_lib_cpg_mcast;
+
+	log_printf(LOGSYS_LEVEL_TRACE, "got ZC mcast request on %p", conn);
+
+	req_lib_cpg_mcast = (struct req_lib_cpg_mcast *)(((char *)serveraddr2void(hdr->server_address) + sizeof (struct coroipcs_zc_header)));
+
+	res_lib_cpg_mcast.header.size = sizeof(res_lib_cpg_mcast);
+	res_lib_cpg_mcast.header.id = MESSAGE_RES_CPG_MCAST;
+	res_lib_cpg_mcast.header.error = zc_mcast_send (conn, cpd, req_lib_cpg_mcast,
+		req_lib_cpg_mcast->msglen);
+
 	api->ipc_response_send (conn, &res_lib_cpg_mcast,
 		sizeof (res_lib_cpg_mcast));
 
 }
 
+/*
+ * Arena is mapped exactly the same way as regular zero copy buffer (so it is
+ * also unmapped by zcb_all_free on finalize), but only once per connection.
+ * Library then allocates buffers from arena itself and sends just offset.
+ */
+static void message_handler_req_lib_cpg_zc_arena_map (
+	void *conn,
+	const void *message)
+{
+	mar_req_coroipcc_zc_alloc_t *hdr = (mar_req_coroipcc_zc_alloc_t *)message;
+	struct qb_ipc_response_header res_header;
+	void *addr = NULL;
+	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
+	cs_error_t error = CS_OK;
+
+	log_printf(LOGSYS_LEVEL_DEBUG, "arena path: %s", hdr->path_to_file);
+
+	if (cpd->zc_arena != NULL) {
+		error = CS_ERR_EXIST;
+		goto response_send;
+	}
+
+	if (zcb_alloc (cpd, hdr->path_to_file, hdr->map_size, &addr) != 0) {
+		error = CS_ERR_NO_MEMORY;
+		goto response_send;
+	}
+
+	cpd->zc_arena = addr;
+	cpd->zc_arena_size = hdr->map_size;
+
+response_send:
+	res_header.size = sizeof (struct qb_ipc_response_header);
+	res_header.id = MESSAGE_RES_CPG_ZC_ARENA_MAP;
+	res_header.error = error;
+	api->ipc_response_send (conn,
+		&res_header,
+		res_header.size);
+}
+
+static void message_handler_req_lib_cpg_zc_arena_execute (
+	void *conn,
+	const void *message)
+{
+	mar_req_coroipcc_zc_arena_execute_t *hdr = (mar_req_coroipcc_zc_arena_execute_t *)message;
+	struct res_lib_cpg_mcast res_lib_cpg_mcast;
+	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
+	struct req_lib_cpg_mcast *req_lib_cpg_mcast;
+	uint32_t msglen;
+
+	log_printf(LOGSYS_LEVEL_TRACE, "got ZC arena mcast request on %p", conn);
+
+	res_lib_cpg_mcast.header.size = sizeof(res_lib_cpg_mcast);
+	res_lib_cpg_mcast.header.id = MESSAGE_RES_CPG_MCAST;
+
+	/*
+	 * Offset is controlled by client so both header and message must be
+	 * checked to not cross arena boundary
+	 */
+	if (cpd->zc_arena == NULL ||
+	    hdr->offset > cpd->zc_arena_size ||
+	    cpd->zc_arena_size - hdr->offset < sizeof (struct req_lib_cpg_mcast)) {
+		res_lib_cpg_mcast.header.error = CS_ERR_INVALID_PARAM;
+		goto response_send;
+	}
+
+	req_lib_cpg_mcast = (struct req_lib_cpg_mcast *)((char *)cpd->zc_arena + hdr->offset);
+
+	/*
+	 * Client can change arena content at any time so msglen is fetched
+	 * exactly once and only the checked value is used
+	 */
+	msglen = __atomic_load_n (&req_lib_cpg_mcast->msglen, __ATOMIC_RELAXED);
+	if (msglen > cpd->zc_arena_size - hdr->offset - sizeof (struct req_lib_cpg_mcast)) {
+		res_lib_cpg_mcast.header.error = CS_ERR_INVALID_PARAM;
+		goto response_send;
+	}
+
+	res_lib_cpg_mcast.header.error = zc_mcast_send (conn, cpd, req_lib_cpg_mcast, msglen);
+
+response_send:
+	api->ipc_response_send (conn, &res_lib_cpg_mcast,
+		sizeof (res_lib_cpg_mcast));
+}
+
 static void message_handler_req_lib_cpg_membership (void *conn,
 						    const void *message)
 {
 	struct req_lib_cpg_membership_get *req_lib_cpg_membership_get =
 		(struct req_lib_cpg_membership_get *)message;
 	struct res_lib_cpg_membership_get res_lib_cpg_membership_get;
+	struct cpg_pd *cpd = (struct cpg_pd *)api->ipc_private_data_get (conn);
 	struct qb_list_head *iter;
 	int member_count = 0;
+	int local_only;
 
 	res_lib_cpg_membership_get.header.id = MESSAGE_RES_CPG_MEMBERSHIP;
 	res_lib_cpg_membership_get.header.error = CS_OK;
 	res_lib_cpg_membership_get.header.size =
 		sizeof (struct res_lib_cpg_membership_get);
 
-	qb_list_for_each(iter, &process_info_list_head) {
+	/*
+	 * Members of local only group are returned only to its members
+	 */
+	local_only = (cpg_pd_local_only (cpd) &&
+	    mar_name_compare (&cpd->group_name, &req_lib_cpg_membership_get->group_name) == 0);
+
+	qb_list_for_each(iter, process_info_list_get (local_only)) {
 		struct process_info *pi = qb_list_entry (iter, struct process_info, list);
 		if (mar_name_compare (&pi->group, &req_lib_cpg_membership_get->group_name) == 0) {
 			res_lib_cpg_membership_get.member_list[member_count].nodeid = pi->nodeid;
@@ -53,6 +53,8 @@
 #include <corosync/totem/totempg.h>
 #include <corosync/logsys.h>
 #include <corosync/icmap.h>
+#include <corosync/cpg.h>
+#include <corosync/ipc_cpg.h>
 
 #include "sync.h"
 #include "timer.h"
@@ -65,12 +67,57 @@
 
 LOGSYS_DECLARE_SUBSYS ("MAIN");
 
+/*
+ * Fair scheduling of library requests. Time spent in handlers of library
+ * requests is limited to ipc_sched_budget microseconds per scheduling round
+ * (token rotation). After the budget is used, flow controlled requests of
+ * connections which consumed more than their share (given by weight of their
+ * service) are refused with CS_ERR_TRY_AGAIN until the next round. Requests
+ * which never returned CS_ERR_TRY_AGAIN to the library (like all cmap and quorum
+ * requests or plain async CPG mcast) are not refused but delayed. They are queued in connection context and
+ * processed (in order) once the connection gets share again, rechecked every
+ * CS_IPCS_SCHED_DELAY. Round is also restarted if the token doesn't come back
+ * in CS_IPCS_SCHED_ROUND_MAX (membership change). Disabled by default.
+ */
+#define CS_IPCS_SCHED_DEFAULT_BUDGET		0
+#define CS_IPCS_SCHED_DEFAULT_WEIGHT		10
+#define CS_IPCS_SCHED_ROUND_MAX			(100 * QB_TIME_NS_IN_MSEC)
+#define CS_IPCS_SCHED_DELAY			(1 * QB_TIME_NS_IN_MSEC)
+
+/*
+ * Per connection flow control. Every connection owns part of totem queue
+ * proportional to its share of bytes sent to totem recently (backlog).
+ * When totem queue usage reaches high watermark (in percents), connections
+ * owning more than fair share (1/N for N active senders) of the used queue
+ * are flow controlled. They are released when queue usage drops to low
+ * watermark or their part drops to fair share. Lone sender (or senders
+ * sending evenly) are left to global flow control. So is plain async CPG
+ * mcast, because library would never learn it was refused.
+ */
+#define CS_IPCS_FC_DEFAULT_HIGH_WATERMARK	50
+#define CS_IPCS_FC_DEFAULT_LOW_WATERMARK	25
+
 static struct corosync_api_v1 *api = NULL;
 static int32_t ipc_not_enough_fds_left = 0;
 static int32_t ipc_fc_is_quorate; /* boolean */
 static int32_t ipc_fc_totem_queue_level; /* percentage used */
 static int32_t ipc_fc_sync_in_process; /* boolean */
 static int32_t ipc_allow_connections = 0; /* boolean */
+static uint32_t ipc_sched_budget = CS_IPCS_SCHED_DEFAULT_BUDGET; /* us, 0 = disabled */
+static uint32_t ipc_sched_weight[SERVICES_COUNT_MAX]; /* 0 = never throttled */
+static uint64_t ipc_sched_round;
+static uint64_t ipc_sched_round_start;
+static uint64_t ipc_sched_round_time; /* ns used by all connections */
+static uint64_t ipc_sched_round_weight; /* sum of weights of active connections */
+static uint32_t ipc_fc_high_watermark = CS_IPCS_FC_DEFAULT_HIGH_WATERMARK; /* 0 = disabled */
+static uint32_t ipc_fc_low_watermark = CS_IPCS_FC_DEFAULT_LOW_WATERMARK;
+static uint64_t ipc_fc_backlog_total; /* sum of backlogs of all connections */
+static uint64_t ipc_fc_backlog_total_round;
+static uint32_t ipc_fc_senders; /* connections which sent to totem in current round */
+static uint32_t ipc_fc_senders_prev; /* ... and in previous round */
+static uint32_t ipc_fc_controlled; /* connections with per connection flow control enabled */
+static icmap_track_t ipc_config_icmap_track = NULL;
+static void *ipc_sched_token_handle;
 
 #define CS_IPCS_MAPPER_SERV_NAME		256
 
@@ -80,9 +127,14 @@ struct cs_ipcs_mapper {
 	char name[CS_IPCS_MAPPER_SERV_NAME];
 };
 
+/*
+ * Item of outgoing dispatch queue. Also used for requests delayed by
+ * fair scheduler.
+ */
 struct outq_item {
 	void *msg;
 	size_t mlen;
+	uint64_t queued_time;
 	struct qb_list_head list;
 };
 
@@ -95,6 +147,7 @@ static int32_t cs_ipcs_dispatch_mod(enum qb_loop_priority p, int32_t fd, int32_t
 	void *data, qb_ipcs_dispatch_fn_t fn);
 static int32_t cs_ipcs_dispatch_del(int32_t fd);
 static void outq_flush (void *data);
+static void cs_ipcs_sched_inq_flush (void *data);
 
 
 static struct qb_ipcs_poll_handlers corosync_poll_funcs = {
@@ -110,6 +163,9 @@ static int32_t cs_ipcs_msg_process(qb_ipcs_connection_t *c,
 		void *data, size_t size);
 static int32_t cs_ipcs_connection_closed (qb_ipcs_connection_t *c);
 static void cs_ipcs_connection_destroyed (qb_ipcs_connection_t *c);
+static void cs_ipcs_fc_backlog_remove(struct cs_ipcs_conn_context *cnx);
+static void cs_ipcs_fc_set(struct cs_ipcs_conn_context *cnx, uint32_t enabled, uint64_t now);
+static void cs_ipcs_fc_recheck(uint64_t now);
 
 static struct qb_ipcs_service_handlers corosync_service_funcs = {
 	.connection_accept	= cs_ipcs_connection_accept,
@@ -121,6 +177,10 @@ static struct qb_ipcs_service_handlers corosync_service_funcs = {
 
 static struct ipcs_global_stats global_stats;
 
+/* Indexed by service id and lib_engine handler id */
+static struct ipcs_handler_stats *handler_stats[SERVICES_COUNT_MAX];
+static int32_t handler_stats_count[SERVICES_COUNT_MAX];
+
 static const char* cs_ipcs_serv_short_name(int32_t service_id)
 {
 	const char *name;
@@ -167,6 +227,12 @@ int32_t cs_ipcs_service_destroy(int32_t service_id)
 		qb_ipcs_destroy(ipcs_mapper[service_id].inst);
 		ipcs_mapper[service_id].inst = NULL;
 	}
+	if (handler_stats[service_id]) {
+		stats_ipcs_del_service(service_id, handler_stats_count[service_id]);
+		free(handler_stats[service_id]);
+		handler_stats[service_id] = NULL;
+		handler_stats_count[service_id] = 0;
+	}
 	return 0;
 }
 
@@ -278,6 +344,7 @@ static void cs_ipcs_connection_created(qb_ipcs_connection_t *c)
 	}
 
 	qb_list_init(&context->outq_head);
+	qb_list_init(&context->sched_inq_head);
 	context->queuing = QB_FALSE;
 	context->queued = 0;
 	context->sent = 0;
@@ -297,6 +364,7 @@ static void cs_ipcs_connection_created(qb_ipcs_connection_t *c)
 	}
 	stats_ipcs_add_connection(service, stats.client_pid, c);
 	global_stats.active++;
+	stats_source_changed(STATS_SOURCE_IPCS);
 }
 
 void cs_ipc_refcnt_inc(void *conn)
@@ -316,6 +384,20 @@ void *cs_ipcs_private_data_get(void *conn)
 	return &cnx->data[0];
 }
 
+static void cs_ipcs_sched_inq_free(struct cs_ipcs_conn_context *cnx)
+{
+	struct qb_list_head *list, *tmp_iter;
+	struct outq_item *inq_item;
+
+	qb_list_for_each_safe(list, tmp_iter, &(cnx->sched_inq_head)) {
+		inq_item = qb_list_entry (list, struct outq_item, list);
+
+		qb_list_del (list);
+		free (inq_item->msg);
+		free (inq_item);
+	}
+}
+
 static void cs_ipcs_connection_destroyed (qb_ipcs_connection_t *c)
 {
 	struct cs_ipcs_conn_context *context;
@@ -326,6 +408,8 @@ static void cs_ipcs_connection_destroyed (qb_ipcs_connection_t *c)
 
 	context = qb_ipcs_context_get(c);
 	if (context) {
+		cs_ipcs_fc_backlog_remove(context);
+
 		qb_list_for_each_safe(list, tmp_iter, &(context->outq_head)) {
 			outq_item = qb_list_entry (list, struct outq_item, list);
 
@@ -333,12 +417,14 @@ static void cs_ipcs_connection_destroyed (qb_ipcs_connection_t *c)
 			free (outq_item->msg);
 			free (outq_item);
 		}
+		cs_ipcs_sched_inq_free(context);
 		free(context);
 	}
 }
 
 static int32_t cs_ipcs_connection_closed (qb_ipcs_connection_t *c)
 {
+	struct cs_ipcs_conn_context *cnx;
 	int32_t res = 0;
 	int32_t service = qb_ipcs_service_id_get(c);
 	struct qb_ipcs_connection_stats stats;
@@ -350,6 +436,11 @@ static int32_t cs_ipcs_connection_closed (qb_ipcs_connection_t *c)
 	}
 
 	qb_loop_job_del(cs_poll_handle_get(), QB_LOOP_HIGH, c, outq_flush);
+	cnx = qb_ipcs_context_get(c);
+	if (cnx != NULL && !qb_list_empty (&cnx->sched_inq_head)) {
+		qb_loop_timer_del(cs_poll_handle_get(), cnx->sched_inq_timer);
+		cs_ipcs_sched_inq_free(cnx);
+	}
 
 	qb_ipcs_connection_stats_get(c, &stats, QB_FALSE);
 
@@ -357,6 +448,7 @@ static int32_t cs_ipcs_connection_closed (qb_ipcs_connection_t *c)
 
 	global_stats.active--;
 	global_stats.closed++;
+	stats_source_changed(STATS_SOURCE_IPCS);
 	return 0;
 }
 
@@ -387,6 +479,10 @@ static void outq_flush (void *data)
 	struct outq_item *outq_item;
 	int32_t rc;
 	struct cs_ipcs_conn_context *context = qb_ipcs_context_get(conn);
+	uint64_t now;
+	uint64_t queue_time;
+
+	now = qb_util_nano_current_get();
 
 	qb_list_for_each_safe(list, tmp_iter, &(context->outq_head)) {
 		outq_item = qb_list_entry (list, struct outq_item, list);
@@ -402,6 +498,13 @@ static void outq_flush (void *data)
 		assert(rc == outq_item->mlen);
 		context->sent++;
 		context->queued--;
+		stats_source_changed(STATS_SOURCE_IPCS);
+
+		queue_time = now - outq_item->queued_time;
+		context->queue_time += queue_time;
+		if (queue_time > context->queue_time_max) {
+			context->queue_time_max = queue_time;
+		}
 
 		qb_list_del (list);
 		free (outq_item->msg);
@@ -436,6 +539,7 @@ static void msg_send_or_queue(qb_ipcs_connection_t *conn, const struct iovec *io
 		rc = qb_ipcs_event_sendv(conn, iov, iov_len);
 		if (rc == bytes_msg) {
 			context->sent++;
+			stats_source_changed(STATS_SOURCE_IPCS);
 			return;
 		}
 		if (rc == -EAGAIN) {
@@ -466,9 +570,11 @@ static void msg_send_or_queue(qb_ipcs_connection_t *conn, const struct iovec *io
 		write_buf += iov[i].iov_len;
 	}
 	outq_item->mlen = bytes_msg;
+	outq_item->queued_time = qb_util_nano_current_get();
 	qb_list_init (&outq_item->list);
 	qb_list_add_tail (&outq_item->list, &context->outq_head);
 	context->queued++;
+	stats_source_changed(STATS_SOURCE_IPCS);
 }
 
 int cs_ipcs_dispatch_send(void *conn, const void *msg, size_t mlen)
@@ -488,24 +594,359 @@ int cs_ipcs_dispatch_iov_send (void *conn,
 	return 0;
 }
 
-static int32_t cs_ipcs_msg_process(qb_ipcs_connection_t *c,
-		void *data, size_t size)
+/*
+ * Library doesn't wait for response to async CPG calls so error is sent as
+ * dispatch message. Plain mcast (2) is also used by old libraries which
+ * doesn't know such message, so for it error is only logged. Returns -1 if
+ * library can't be told about the error.
+ */
+static int32_t cs_ipcs_cpg_async_error_send(qb_ipcs_connection_t *c,
+		const struct qb_ipc_request_header *request_pt, cs_error_t error)
+{
+	struct res_lib_cpg_mcast_error res_lib_cpg_mcast_error;
+
+	if (request_pt->id == MESSAGE_REQ_CPG_MCAST) {
+		return (-1);
+	}
+
+	res_lib_cpg_mcast_error.header.size = sizeof(res_lib_cpg_mcast_error);
+	res_lib_cpg_mcast_error.header.id = MESSAGE_RES_CPG_MCAST_ERROR;
+	res_lib_cpg_mcast_error.header.error = error;
+	res_lib_cpg_mcast_error.req_id = request_pt->id;
+	res_lib_cpg_mcast_error.msg_count = 1;
+
+	if (request_pt->id == MESSAGE_REQ_CPG_MCAST_BATCH &&
+	    request_pt->size >= sizeof(struct req_lib_cpg_mcast_batch)) {
+		res_lib_cpg_mcast_error.msg_count =
+		    ((const struct req_lib_cpg_mcast_batch *)request_pt)->msg_count;
+	}
+
+	cs_ipcs_dispatch_send(c, &res_lib_cpg_mcast_error, sizeof(res_lib_cpg_mcast_error));
+
+	return (0);
+}
+
+/*
+ * Returns QB_TRUE if request may be refused with CS_ERR_TRY_AGAIN by fair
+ * scheduler or per connection flow control. Request must require flow control
+ * and library must learn about the error. Plain async CPG mcast is refused
+ * only by global flow control, same as before.
+ */
+static int32_t cs_ipcs_request_refusable(int32_t service, const struct qb_ipc_request_header *request_pt)
+{
+
+	if ((uint32_t)request_pt->id >= corosync_service[service]->lib_engine_count ||
+	    corosync_service[service]->lib_engine[request_pt->id].flow_control !=
+	    CS_LIB_FLOW_CONTROL_REQUIRED) {
+		return QB_FALSE;
+	}
+
+	return (!(service == CPG_SERVICE && request_pt->id == MESSAGE_REQ_CPG_MCAST));
+}
+
+/*
+ * Library doesn't wait for result of async partial mcast fragments. When one
+ * fragment is refused, the rest of the message (up to next first fragment)
+ * is dropped, so receivers never get message with missing part.
+ */
+static int32_t cs_ipcs_cpg_partial_stream_failed(int32_t service, struct cs_ipcs_conn_context *cnx,
+		const struct qb_ipc_request_header *request_pt)
+{
+	const struct req_lib_cpg_partial_mcast *req_lib_cpg_partial_mcast;
+
+	if (service != CPG_SERVICE || cnx == NULL ||
+	    request_pt->id != MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC ||
+	    request_pt->size < sizeof(struct req_lib_cpg_partial_mcast)) {
+		return QB_FALSE;
+	}
+
+	req_lib_cpg_partial_mcast = (const struct req_lib_cpg_partial_mcast *)request_pt;
+	if (req_lib_cpg_partial_mcast->type == LIBCPG_PARTIAL_FIRST) {
+		cnx->cpg_partial_failed = QB_FALSE;
+	}
+
+	return (cnx->cpg_partial_failed);
+}
+
+static void cs_ipcs_sched_round_start(uint64_t now)
+{
+	ipc_sched_round++;
+	ipc_sched_round_start = now;
+	ipc_fc_senders_prev = ipc_fc_senders;
+	ipc_fc_senders = 0;
+	ipc_sched_round_time = 0;
+	ipc_sched_round_weight = 0;
+}
+
+static int cs_ipcs_sched_token_received(enum totem_callback_token_type type, const void *data)
+{
+	uint64_t now;
+
+	now = qb_util_nano_current_get();
+	cs_ipcs_sched_round_start(now);
+	cs_ipcs_fc_recheck(now);
+	return (0);
+}
+
+/*
+ * Returns QB_FALSE if connection already used its share of current round
+ */
+static int32_t cs_ipcs_sched_allowed(int32_t service, struct cs_ipcs_conn_context *cnx, uint64_t now)
+{
+	uint64_t share;
+
+	if (ipc_sched_budget == 0 || cnx == NULL || ipc_sched_weight[service] == 0) {
+		return QB_TRUE;
+	}
+
+	if (now - ipc_sched_round_start > CS_IPCS_SCHED_ROUND_MAX) {
+		cs_ipcs_sched_round_start(now);
+	}
+
+	if (cnx->sched_round != ipc_sched_round) {
+		cnx->sched_round = ipc_sched_round;
+		cnx->sched_time = 0;
+		ipc_sched_round_weight += ipc_sched_weight[service];
+	}
+
+	if (ipc_sched_round_time < (uint64_t)ipc_sched_budget * QB_TIME_NS_IN_USEC) {
+		return QB_TRUE;
+	}
+
+	share = (uint64_t)ipc_sched_budget * QB_TIME_NS_IN_USEC * ipc_sched_weight[service] /
+	    ipc_sched_round_weight;
+
+	return (cnx->sched_time < share);
+}
+
+static uint64_t cs_ipcs_fc_backlog_decay(uint64_t backlog, uint64_t *backlog_round)
+{
+	uint64_t rounds;
+
+	rounds = ipc_sched_round - *backlog_round;
+	*backlog_round = ipc_sched_round;
+
+	if (rounds >= 64) {
+		return (0);
+	}
+
+	return (backlog >> rounds);
+}
+
+/*
+ * Decay backlog of connection and total backlog to current round
+ */
+static void cs_ipcs_fc_backlog_update(struct cs_ipcs_conn_context *cnx)
+{
+
+	cnx->fc_backlog = cs_ipcs_fc_backlog_decay(cnx->fc_backlog, &cnx->fc_backlog_round);
+	ipc_fc_backlog_total = cs_ipcs_fc_backlog_decay(ipc_fc_backlog_total, &ipc_fc_backlog_total_round);
+	if (ipc_fc_backlog_total < cnx->fc_backlog) {
+		/* Rounding error of decay */
+		ipc_fc_backlog_total = cnx->fc_backlog;
+	}
+}
+
+static void cs_ipcs_fc_backlog_remove(struct cs_ipcs_conn_context *cnx)
+{
+
+	cs_ipcs_fc_set(cnx, QB_FALSE, qb_util_nano_current_get());
+	cs_ipcs_fc_backlog_update(cnx);
+
+	if (ipc_fc_backlog_total > cnx->fc_backlog) {
+		ipc_fc_backlog_total -= cnx->fc_backlog;
+	} else {
+		ipc_fc_backlog_total = 0;
+	}
+	cnx->fc_backlog = 0;
+}
+
+static void cs_ipcs_fc_set(struct cs_ipcs_conn_context *cnx, uint32_t enabled, uint64_t now)
+{
+
+	if (cnx->fc_enabled == enabled) {
+		return;
+	}
+
+	if (enabled) {
+		cnx->fc_start = now;
+		cnx->fc_count++;
+		ipc_fc_controlled++;
+	} else {
+		cnx->fc_time += (now - cnx->fc_start) / QB_TIME_NS_IN_USEC;
+		ipc_fc_controlled--;
+	}
+	cnx->fc_enabled = enabled;
+	stats_source_changed(STATS_SOURCE_IPCS);
+}
+
+/*
+ * Enable or release flow control of connection based on its current backlog
+ */
+static void cs_ipcs_fc_update(struct cs_ipcs_conn_context *cnx, uint64_t now)
+{
+	uint32_t q_level;
+	uint32_t senders;
+	int32_t over_share;
+
+	if (ipc_fc_high_watermark == 0) {
+		cs_ipcs_fc_set(cnx, QB_FALSE, now);
+		return;
+	}
+
+	cs_ipcs_fc_backlog_update(cnx);
+
+	senders = QB_MAX(ipc_fc_senders, ipc_fc_senders_prev);
+	if (senders < 1) {
+		senders = 1;
+	}
+
+	over_share = (cnx->fc_backlog * senders > ipc_fc_backlog_total);
+	q_level = totempg_q_level_percent_used();
+
+	if (over_share && q_level >= ipc_fc_high_watermark) {
+		cs_ipcs_fc_set(cnx, QB_TRUE, now);
+	} else if (!over_share || q_level <= ipc_fc_low_watermark) {
+		cs_ipcs_fc_set(cnx, QB_FALSE, now);
+	}
+}
+
+/*
+ * Returns QB_FALSE if connection is flow controlled
+ */
+static int32_t cs_ipcs_fc_allowed(struct cs_ipcs_conn_context *cnx, uint64_t now)
+{
+
+	if (cnx == NULL) {
+		return QB_TRUE;
+	}
+
+	cs_ipcs_fc_update(cnx, now);
+
+	return (!cnx->fc_enabled);
+}
+
+/*
+ * Flow controlled connection may stop sending requests, so its state is
+ * also rechecked on every token. Otherwise it would stay flow controlled
+ * until its next request.
+ */
+static void cs_ipcs_fc_recheck(uint64_t now)
+{
+	struct cs_ipcs_conn_context *cnx;
+	qb_ipcs_connection_t *c, *prev;
+	int32_t i;
+
+	if (ipc_fc_controlled == 0) {
+		return;
+	}
+
+	for (i = 0; i < SERVICES_COUNT_MAX; i++) {
+		if (ipcs_mapper[i].inst == NULL) {
+			continue;
+		}
+
+		for (c = qb_ipcs_connection_first_get(ipcs_mapper[i].inst);
+		     c;
+		     prev = c, c = qb_ipcs_connection_next_get(ipcs_mapper[i].inst, prev), qb_ipcs_connection_unref(prev)) {
+
+			cnx = qb_ipcs_context_get(c);
+			if (cnx == NULL || !cnx->fc_enabled) continue;
+
+			cs_ipcs_fc_update(cnx, now);
+		}
+	}
+}
+
+static void cs_ipcs_config_read(void)
+{
+	char key_name[ICMAP_KEYNAME_MAXLEN];
+	const char *serv_short_name;
+	int32_t i;
+
+	if (icmap_get_uint32("qb.ipc_fc_high_watermark", &ipc_fc_high_watermark) != CS_OK) {
+		ipc_fc_high_watermark = CS_IPCS_FC_DEFAULT_HIGH_WATERMARK;
+	}
+
+	if (icmap_get_uint32("qb.ipc_fc_low_watermark", &ipc_fc_low_watermark) != CS_OK) {
+		ipc_fc_low_watermark = CS_IPCS_FC_DEFAULT_LOW_WATERMARK;
+	}
+
+	if (ipc_fc_low_watermark > ipc_fc_high_watermark) {
+		log_printf(LOGSYS_LEVEL_WARNING, "qb.ipc_fc_low_watermark (%u) is greater than "
+		    "qb.ipc_fc_high_watermark (%u), using high watermark value",
+		    ipc_fc_low_watermark, ipc_fc_high_watermark);
+		ipc_fc_low_watermark = ipc_fc_high_watermark;
+	}
+
+	if (icmap_get_uint32("qb.ipc_sched_budget", &ipc_sched_budget) != CS_OK) {
+		ipc_sched_budget = CS_IPCS_SCHED_DEFAULT_BUDGET;
+	}
+
+	for (i = 0; i < SERVICES_COUNT_MAX; i++) {
+		ipc_sched_weight[i] = CS_IPCS_SCHED_DEFAULT_WEIGHT;
+
+		serv_short_name = cs_ipcs_serv_short_name(i);
+		if (serv_short_name == NULL) {
+			continue;
+		}
+
+		snprintf(key_name, ICMAP_KEYNAME_MAXLEN, "qb.ipc_sched_weight_%s", serv_short_name);
+		if (icmap_get_uint32(key_name, &ipc_sched_weight[i]) != CS_OK) {
+			ipc_sched_weight[i] = CS_IPCS_SCHED_DEFAULT_WEIGHT;
+		}
+	}
+}
+
+static void cs_ipcs_config_changed(int32_t event,
+	const char *key_name,
+	struct icmap_notify_value new_val,
+	struct icmap_notify_value old_val,
+	void *user_data)
+{
+
+	cs_ipcs_config_read();
+}
+
+static int32_t cs_ipcs_request_process(qb_ipcs_connection_t *c, int32_t service,
+		struct qb_ipc_request_header *request_pt)
 {
 	struct qb_ipc_response_header response;
-	struct qb_ipc_request_header *request_pt = (struct qb_ipc_request_header *)data;
-	int32_t service = qb_ipcs_service_id_get(c);
 	int32_t send_ok = 0;
 	int32_t is_async_call = QB_FALSE;
 	ssize_t res = -1;
 	int sending_allowed_private_data;
 	struct cs_ipcs_conn_context *cnx;
+	struct ipcs_handler_stats *hstats;
+	uint64_t start_time;
+	uint64_t handler_time;
+	uint64_t mcast_bytes;
+	int32_t refusable;
+
+	cnx = qb_ipcs_context_get(c);
+	if (cs_ipcs_cpg_partial_stream_failed(service, cnx, request_pt)) {
+		return 0;
+	}
 
 	send_ok = corosync_sending_allowed (service,
 			request_pt->id,
 			request_pt,
 			&sending_allowed_private_data);
 
-	is_async_call = (service == CPG_SERVICE && request_pt->id == 2);
+	start_time = qb_util_nano_current_get();
+	refusable = (send_ok >= 0 && cs_ipcs_request_refusable(service, request_pt));
+	if (refusable && !cs_ipcs_sched_allowed(service, cnx, start_time)) {
+		cnx->sched_throttled++;
+		send_ok = -EAGAIN;
+	}
+
+	if (send_ok >= 0 && refusable && !cs_ipcs_fc_allowed(cnx, start_time)) {
+		send_ok = -EAGAIN;
+	}
+
+	is_async_call = (service == CPG_SERVICE && (request_pt->id == MESSAGE_REQ_CPG_MCAST ||
+	    request_pt->id == MESSAGE_REQ_CPG_MCAST_BATCH ||
+	    request_pt->id == MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC));
 
 	/*
 	 * This happens when the message contains some kind of invalid
@@ -524,6 +965,10 @@ static int32_t cs_ipcs_msg_process(qb_ipcs_connection_t *c,
 		if (is_async_call) {
 			log_printf(LOGSYS_LEVEL_INFO, "*** %s() invalid message! size:%d error:%d",
 				__func__, response.size, response.error);
+			cs_ipcs_cpg_async_error_send(c, request_pt, CS_ERR_INVALID_PARAM);
+			if (cnx && request_pt->id == MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC) {
+				cnx->cpg_partial_failed = QB_TRUE;
+			}
 		} else {
 			qb_ipcs_response_send (c,
 				&response,
@@ -546,22 +991,169 @@ static int32_t cs_ipcs_msg_process(qb_ipcs_connection_t *c,
 				&response,
 				sizeof (response));
 		} else {
-			log_printf(LOGSYS_LEVEL_WARNING,
-				"*** %s() (%d:%d - %d) %s!",
-				__func__, service, request_pt->id,
-				is_async_call, strerror(-send_ok));
+			if (cs_ipcs_cpg_async_error_send(c, request_pt, CS_ERR_TRY_AGAIN) != 0 ||
+			    send_ok != -EAGAIN) {
+				log_printf(LOGSYS_LEVEL_WARNING,
+					"*** %s() (%d:%d - %d) %s!",
+					__func__, service, request_pt->id,
+					is_async_call, strerror(-send_ok));
+			}
+			if (cnx && request_pt->id == MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC) {
+				cnx->cpg_partial_failed = QB_TRUE;
+			}
 		}
 		res = -ENOBUFS;
 	}
 
 	if (send_ok >= 0) {
+		mcast_bytes = main_mcast_bytes_get();
 		corosync_service[service]->lib_engine[request_pt->id].lib_handler_fn(c, request_pt);
+		handler_time = qb_util_nano_current_get() - start_time;
+		mcast_bytes = main_mcast_bytes_get() - mcast_bytes;
+
+		ipc_sched_round_time += handler_time;
+		cnx = qb_ipcs_context_get(c);
+		/*
+		 * Only bytes really passed to totem count (request may fail
+		 * or be delivered locally)
+		 */
+		if (cnx && mcast_bytes > 0) {
+			cs_ipcs_fc_backlog_update(cnx);
+			cnx->fc_backlog += mcast_bytes;
+			ipc_fc_backlog_total += mcast_bytes;
+			if (cnx->fc_sender_round != ipc_sched_round) {
+				cnx->fc_sender_round = ipc_sched_round;
+				ipc_fc_senders++;
+			}
+		}
+		if (cnx) {
+			cnx->sched_time += handler_time;
+			cnx->handler_time += handler_time;
+			if (handler_time > cnx->handler_time_max) {
+				cnx->handler_time_max = handler_time;
+			}
+		}
+
+		if (handler_stats[service] && request_pt->id < handler_stats_count[service]) {
+			hstats = &handler_stats[service][request_pt->id];
+			hstats->calls++;
+			hstats->time += handler_time;
+			if (handler_time > hstats->time_max) {
+				hstats->time_max = handler_time;
+			}
+		}
 		res = 0;
 	}
 	corosync_sending_allowed_release (&sending_allowed_private_data);
 	return res;
 }
 
+/*
+ * Returns QB_TRUE if request must be delayed by fair scheduler. Refusable
+ * requests are refused by cs_ipcs_request_process instead. Once some request
+ * is delayed, all following requests of the connection are delayed too, to
+ * keep their order.
+ */
+static int32_t cs_ipcs_sched_delayed(int32_t service, struct cs_ipcs_conn_context *cnx,
+		const struct qb_ipc_request_header *request_pt)
+{
+
+	if (cnx == NULL) {
+		return QB_FALSE;
+	}
+
+	if (!qb_list_empty(&cnx->sched_inq_head)) {
+		return QB_TRUE;
+	}
+
+	if ((uint32_t)request_pt->id >= corosync_service[service]->lib_engine_count ||
+	    cs_ipcs_request_refusable(service, request_pt)) {
+		return QB_FALSE;
+	}
+
+	return (!cs_ipcs_sched_allowed(service, cnx, qb_util_nano_current_get()));
+}
+
+static int32_t cs_ipcs_sched_inq_add(qb_ipcs_connection_t *c, struct cs_ipcs_conn_context *cnx,
+		const void *data, size_t size)
+{
+	struct outq_item *inq_item;
+
+	inq_item = malloc (sizeof (struct outq_item));
+	if (inq_item == NULL) {
+		qb_ipcs_disconnect(c);
+		return -ENOMEM;
+	}
+	inq_item->msg = malloc (size);
+	if (inq_item->msg == NULL) {
+		free (inq_item);
+		qb_ipcs_disconnect(c);
+		return -ENOMEM;
+	}
+	memcpy (inq_item->msg, data, size);
+	inq_item->mlen = size;
+	inq_item->queued_time = qb_util_nano_current_get();
+
+	if (qb_list_empty (&cnx->sched_inq_head)) {
+		qb_loop_timer_add(cs_poll_handle_get(), QB_LOOP_MED, CS_IPCS_SCHED_DELAY,
+			c, cs_ipcs_sched_inq_flush, &cnx->sched_inq_timer);
+	}
+	qb_list_init (&inq_item->list);
+	qb_list_add_tail (&inq_item->list, &cnx->sched_inq_head);
+	cnx->sched_throttled++;
+
+	return 0;
+}
+
+static void cs_ipcs_sched_inq_flush (void *data)
+{
+	qb_ipcs_connection_t *c = data;
+	struct cs_ipcs_conn_context *cnx = qb_ipcs_context_get(c);
+	int32_t service = qb_ipcs_service_id_get(c);
+	struct outq_item *inq_item;
+
+	/*
+	 * Handler may disconnect the client, keep context until loop ends
+	 */
+	qb_ipcs_connection_ref(c);
+
+	while (!qb_list_empty (&cnx->sched_inq_head)) {
+		if (!cs_ipcs_sched_allowed(service, cnx, qb_util_nano_current_get())) {
+			qb_loop_timer_add(cs_poll_handle_get(), QB_LOOP_MED, CS_IPCS_SCHED_DELAY,
+				c, cs_ipcs_sched_inq_flush, &cnx->sched_inq_timer);
+			break;
+		}
+
+		inq_item = qb_list_first_entry (&cnx->sched_inq_head, struct outq_item, list);
+		qb_list_del (&inq_item->list);
+
+		cs_ipcs_request_process(c, service, inq_item->msg);
+
+		free (inq_item->msg);
+		free (inq_item);
+	}
+
+	qb_ipcs_connection_unref(c);
+}
+
+static int32_t cs_ipcs_msg_process(qb_ipcs_connection_t *c,
+		void *data, size_t size)
+{
+	struct qb_ipc_request_header *request_pt = (struct qb_ipc_request_header *)data;
+	int32_t service = qb_ipcs_service_id_get(c);
+	struct cs_ipcs_conn_context *cnx;
+
+	/* Request counter of connection was increased by libqb */
+	stats_source_changed(STATS_SOURCE_IPCS);
+
+	cnx = qb_ipcs_context_get(c);
+	if (cs_ipcs_sched_delayed(service, cnx, request_pt)) {
+		return (cs_ipcs_sched_inq_add(c, cnx, data, size));
+	}
+
+	return (cs_ipcs_request_process(c, service, request_pt));
+}
+
 
 static int32_t cs_ipcs_job_add(enum qb_loop_priority p,	void *data, qb_loop_job_dispatch_fn fn)
 {
@@ -606,6 +1198,7 @@ int32_t cs_ipcs_q_level_get(void)
 static qb_loop_timer_handle ipcs_check_for_flow_control_timer;
 static void cs_ipcs_check_for_flow_control(void)
 {
+	static int32_t fc_enabled_last[SERVICES_COUNT_MAX];
 	int32_t i;
 	int32_t fc_enabled;
 
@@ -620,6 +1213,11 @@ static void cs_ipcs_check_for_flow_control(void)
 			 * we are quorate
 			 * now check flow control
 			 */
+			/*
+			 * Single connections are flow controlled by cs_ipcs_fc_allowed
+			 * long before the queue gets critical, stopping all of them is
+			 * only last resort.
+			 */
 			if (ipc_fc_totem_queue_level != TOTEM_Q_LEVEL_CRITICAL &&
 			    ipc_fc_sync_in_process == 0) {
 				fc_enabled = QB_FALSE;
@@ -634,6 +1232,11 @@ static void cs_ipcs_check_for_flow_control(void)
 				fc_enabled = QB_IPCS_RATE_OFF_2;
 			}
 		}
+		if (fc_enabled != fc_enabled_last[i]) {
+			/* Reported as stats.ipcs.*.flow_control */
+			fc_enabled_last[i] = fc_enabled;
+			stats_source_changed(STATS_SOURCE_IPCS);
+		}
 		if (fc_enabled) {
 			qb_ipcs_request_rate_limit(ipcs_mapper[i].inst, fc_enabled);
 
@@ -672,6 +1275,19 @@ void cs_ipcs_get_global_stats(struct ipcs_global_stats *ipcs_stats)
 	memcpy(ipcs_stats, &global_stats, sizeof(global_stats));
 }
 
+cs_error_t cs_ipcs_get_handler_stats(int service_id, int handler_id, struct ipcs_handler_stats *ipcs_stats)
+{
+	if (service_id < 0 || service_id >= SERVICES_COUNT_MAX || !handler_stats[service_id] ||
+	    handler_id < 0 || handler_id >= handler_stats_count[service_id]) {
+		return CS_ERR_NOT_EXIST;
+	}
+
+	memcpy(ipcs_stats, &handler_stats[service_id][handler_id], sizeof(struct ipcs_handler_stats));
+	ipcs_stats->time /= QB_TIME_NS_IN_USEC;
+	ipcs_stats->time_max /= QB_TIME_NS_IN_USEC;
+	return CS_OK;
+}
+
 cs_error_t cs_ipcs_get_conn_stats(int service_id, uint32_t pid, void *conn_ptr, struct ipcs_conn_stats *ipcs_stats)
 {
 	struct cs_ipcs_conn_context *cnx;
@@ -697,7 +1313,17 @@ cs_error_t cs_ipcs_get_conn_stats(int service_id, uint32_t pid, void *conn_ptr,
 			continue;
 		}
 		found = 1;
+		/* Report backlog as of current round */
+		cs_ipcs_fc_backlog_update(cnx);
 		memcpy(&ipcs_stats->cnx, cnx, sizeof(struct cs_ipcs_conn_context));
+		ipcs_stats->cnx.handler_time /= QB_TIME_NS_IN_USEC;
+		ipcs_stats->cnx.handler_time_max /= QB_TIME_NS_IN_USEC;
+		ipcs_stats->cnx.queue_time /= QB_TIME_NS_IN_USEC;
+		ipcs_stats->cnx.queue_time_max /= QB_TIME_NS_IN_USEC;
+		if (cnx->fc_enabled) {
+			/* Include currently running flow control period */
+			ipcs_stats->cnx.fc_time += (qb_util_nano_current_get() - cnx->fc_start) / QB_TIME_NS_IN_USEC;
+		}
 	}
 	if (!found) {
 		return CS_ERR_NOT_EXIST;
@@ -717,6 +1343,11 @@ void cs_ipcs_clear_stats()
 	memset(&global_stats, 0, sizeof(global_stats));
 
 	for (service_id = 0; service_id < SERVICES_COUNT_MAX; service_id++) {
+		if (handler_stats[service_id]) {
+			memset(handler_stats[service_id], 0,
+			    handler_stats_count[service_id] * sizeof(struct ipcs_handler_stats));
+		}
+
 		if (!ipcs_mapper[service_id].inst) {
 			continue;
 		}
@@ -733,6 +1364,16 @@ void cs_ipcs_clear_stats()
 			cnx->invalid_request = 0;
 			cnx->overload = 0;
 			cnx->sent = 0;
+			cnx->handler_time = 0;
+			cnx->handler_time_max = 0;
+			cnx->queue_time = 0;
+			cnx->queue_time_max = 0;
+			cnx->sched_throttled = 0;
+			cnx->fc_count = 0;
+			cnx->fc_time = 0;
+			if (cnx->fc_enabled) {
+				cnx->fc_start = qb_util_nano_current_get();
+			}
 
 		}
 	}
@@ -812,6 +1453,12 @@ const char *cs_ipcs_service_init(struct corosync_service_engine *service)
 		return "qb_ipcs_run error";
 	}
 
+	handler_stats[service->id] = calloc(service->lib_engine_count, sizeof(struct ipcs_handler_stats));
+	if (handler_stats[service->id]) {
+		handler_stats_count[service->id] = service->lib_engine_count;
+		stats_ipcs_add_service(service->id, service->lib_engine_count);
+	}
+
 	return NULL;
 }
 
@@ -824,6 +1471,17 @@ void cs_ipcs_init(void)
 	api->quorum_register_callback (cs_ipcs_fc_quorum_changed, NULL);
 	totempg_queue_level_register_callback (cs_ipcs_totem_queue_level_changed);
 
+	cs_ipcs_config_read();
+	icmap_track_add("qb.ipc_",
+		ICMAP_TRACK_ADD | ICMAP_TRACK_DELETE | ICMAP_TRACK_MODIFY | ICMAP_TRACK_PREFIX,
+		cs_ipcs_config_changed,
+		NULL,
+		&ipc_config_icmap_track);
+	api->totem_callback_token_create(&ipc_sched_token_handle,
+		TOTEM_CALLBACK_TOKEN_RECEIVED, 0,
+		cs_ipcs_sched_token_received, NULL);
+	cs_ipcs_sched_round_start(qb_util_nano_current_get());
+
 	global_stats.active = 0;
 	global_stats.closed = 0;
 }
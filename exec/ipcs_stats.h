@@ -39,6 +39,36 @@ struct cs_ipcs_conn_context {
 	uint64_t invalid_request;
 	uint64_t overload;
 	uint32_t sent;
+	/*
+	 * Times are accumulated in nanoseconds and reported in microseconds
+	 * by cs_ipcs_get_conn_stats
+	 */
+	uint64_t handler_time;
+	uint64_t handler_time_max;
+	uint64_t queue_time;
+	uint64_t queue_time_max;
+	/*
+	 * Fair scheduler state, sched_time is in nanoseconds. Delayed requests
+	 * are kept in sched_inq_head.
+	 */
+	uint64_t sched_round;
+	uint64_t sched_time;
+	uint64_t sched_throttled;
+	struct qb_list_head sched_inq_head;
+	qb_loop_timer_handle sched_inq_timer;
+	/*
+	 * Per connection flow control. Backlog is number of bytes of requests
+	 * sent to totem, halved every scheduler round.
+	 */
+	uint64_t fc_backlog;
+	uint64_t fc_backlog_round;
+	uint64_t fc_sender_round;
+	uint32_t fc_enabled;
+	uint64_t fc_start;
+	uint64_t fc_count;
+	uint64_t fc_time;
+	/* Fragment of async CPG partial message was refused */
+	int32_t cpg_partial_failed;
 	char proc_name[32];
 	char data[1];
 };
@@ -49,6 +79,17 @@ struct ipcs_global_stats
 	uint64_t closed;
 };
 
+/*
+ * Stats of one lib_engine handler of service. Times are accumulated in
+ * nanoseconds and reported in microseconds by cs_ipcs_get_handler_stats.
+ */
+struct ipcs_handler_stats
+{
+	uint64_t calls;
+	uint64_t time;
+	uint64_t time_max;
+};
+
 struct ipcs_conn_stats
 {
 	struct qb_ipcs_stats srv;
@@ -58,4 +99,5 @@ struct ipcs_conn_stats
 
 cs_error_t cs_ipcs_get_conn_stats(int service_id, uint32_t pid, void *conn_ptr, struct ipcs_conn_stats *ipcs_stats);
 void cs_ipcs_get_global_stats(struct ipcs_global_stats *ipcs_stats);
+cs_error_t cs_ipcs_get_handler_stats(int service_id, int handler_id, struct ipcs_handler_stats *ipcs_stats);
 void cs_ipcs_clear_stats(void);
@@ -588,6 +588,7 @@ static void main_logging_notify(
 {
 	const char *error_string;
 	static int reload_in_progress = 0;
+	static int reload_changed = 0;
 
 	/* If a full reload happens then suspend updates for individual keys until
 	 * it's all completed
@@ -595,12 +596,22 @@ static void main_logging_notify(
 	if (strcmp(key_name, "config.reload_in_progress") == 0) {
 		if (*(uint8_t *)new_val.data == 1) {
 			reload_in_progress = 1;
-		} else {
-			reload_in_progress = 0;
+			reload_changed = 0;
+			return;
+		}
+
+		reload_in_progress = 0;
+		/*
+		 * Only reconfigure logging if reload touched some logging. key
+		 */
+		if (!reload_changed) {
+			return;
 		}
+		reload_changed = 0;
 	}
 	if (reload_in_progress) {
 		log_printf(LOGSYS_LEVEL_DEBUG, "Ignoring key change, reload in progress. %s\n", key_name);
+		reload_changed = 1;
 		return;
 	}
 
@@ -161,6 +161,11 @@ static struct corosync_api_v1 *api = NULL;
 
 static int sync_in_process = 1;
 
+/*
+ * Number of bytes successfully passed to totem by main_mcast
+ */
+static uint64_t main_mcast_bytes;
+
 static qb_loop_t *corosync_poll_handle;
 
 struct sched_param global_sched_param;
@@ -477,6 +482,38 @@ static void corosync_mlockall (void)
 }
 
 
+/*
+ * Values of totem stats at last update, used to find out if trackers of
+ * totem stats have to be evaluated
+ */
+static totemsrp_stats_t corosync_totem_stats_srp_last;
+static totempg_stats_t corosync_totem_stats_pg_last;
+
+static int corosync_totem_stats_changed (const totempg_stats_t *stats)
+{
+	/*
+	 * Token ring (earliest_token and later) is only used for computing
+	 * exported averages
+	 */
+	size_t srp_start = offsetof(totemsrp_stats_t, orf_token_tx);
+	size_t srp_len = offsetof(totemsrp_stats_t, earliest_token) - srp_start;
+	int changed;
+
+	changed = (stats->msg_reserved != corosync_totem_stats_pg_last.msg_reserved ||
+	    stats->msg_queue_avail != corosync_totem_stats_pg_last.msg_queue_avail ||
+	    memcmp((const char *)stats->srp + srp_start,
+	    (const char *)&corosync_totem_stats_srp_last + srp_start, srp_len) != 0);
+
+	if (changed) {
+		corosync_totem_stats_pg_last.msg_reserved = stats->msg_reserved;
+		corosync_totem_stats_pg_last.msg_queue_avail = stats->msg_queue_avail;
+		memcpy((char *)&corosync_totem_stats_srp_last + srp_start,
+		    (const char *)stats->srp + srp_start, srp_len);
+	}
+
+	return (changed);
+}
+
 static void corosync_totem_stats_updater (void *data)
 {
 	totempg_stats_t * stats;
@@ -542,6 +579,9 @@ static void corosync_totem_stats_updater (void *data)
 		stats->srp->avg_backlog_calc = (total_backlog_calc / token_count);
 	}
 
+	if (corosync_totem_stats_changed (stats)) {
+		stats_source_changed(STATS_SOURCE_TOTEM);
+	}
 	stats_trigger_trackers();
 
 	api->timer_add_duration (1500 * MILLI_2_NANO_SECONDS, NULL,
@@ -610,6 +650,8 @@ int main_mcast (
 	const struct qb_ipc_request_header *req = iovec->iov_base;
 	int32_t service;
 	int32_t fn_id;
+	unsigned int i;
+	int res;
 
 	service = req->id >> 16;
 	fn_id = req->id & 0xffff;
@@ -618,7 +660,125 @@ int main_mcast (
 		icmap_fast_inc(service_stats_tx[service][fn_id]);
 	}
 
-	return (totempg_groups_mcast_joined (corosync_group_handle, iovec, iov_len, guarantee));
+	res = totempg_groups_mcast_joined (corosync_group_handle, iovec, iov_len, guarantee);
+	if (res == 0) {
+		for (i = 0; i < iov_len; i++) {
+			main_mcast_bytes += iovec[i].iov_len;
+		}
+	}
+
+	return (res);
+}
+
+uint64_t main_mcast_bytes_get (void)
+{
+	return (main_mcast_bytes);
+}
+
+/*
+ * Ring id file is mmap-ed so storing new ring id during membership change is
+ * just a memory write. Flushing to stable storage is done by separate thread
+ * so main loop never waits for disk.
+ */
+static struct ring_id_store {
+	char filename[PATH_MAX];
+	int fd;
+	uint64_t *seq;
+	pthread_t flush_thread;
+	int flush_thread_running;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int flush_requested;
+	int exit_requested;
+} ring_id_store = {
+	.fd = -1,
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *corosync_ring_id_flush_thread (void *data)
+{
+	pthread_mutex_lock (&ring_id_store.mutex);
+	while (1) {
+		while (!ring_id_store.flush_requested && !ring_id_store.exit_requested) {
+			pthread_cond_wait (&ring_id_store.cond, &ring_id_store.mutex);
+		}
+		if (!ring_id_store.flush_requested) {
+			break;
+		}
+		ring_id_store.flush_requested = 0;
+		pthread_mutex_unlock (&ring_id_store.mutex);
+
+		if (msync (ring_id_store.seq, sizeof (uint64_t), MS_SYNC) == -1) {
+			LOGSYS_PERROR (errno, LOGSYS_LEVEL_WARNING,
+				"Couldn't flush ringid file '%s'", ring_id_store.filename);
+		}
+
+		pthread_mutex_lock (&ring_id_store.mutex);
+	}
+	pthread_mutex_unlock (&ring_id_store.mutex);
+
+	return (NULL);
+}
+
+static void corosync_ring_id_map (int fd, const char *filename)
+{
+	struct stat stat_buf;
+	void *addr;
+
+	if (fstat (fd, &stat_buf) == -1 ||
+	    (stat_buf.st_size < sizeof (uint64_t) && ftruncate (fd, sizeof (uint64_t)) == -1)) {
+		LOGSYS_PERROR (errno, LOGSYS_LEVEL_WARNING,
+			"Couldn't resize ringid file '%s'", filename);
+		return ;
+	}
+
+	addr = mmap (NULL, sizeof (uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		LOGSYS_PERROR (errno, LOGSYS_LEVEL_WARNING,
+			"Couldn't map ringid file '%s'", filename);
+		return ;
+	}
+
+	ring_id_store.fd = dup (fd);
+	if (ring_id_store.fd == -1) {
+		munmap (addr, sizeof (uint64_t));
+		return ;
+	}
+	ring_id_store.seq = addr;
+	strncpy (ring_id_store.filename, filename, sizeof (ring_id_store.filename) - 1);
+
+	if (pthread_create (&ring_id_store.flush_thread, NULL,
+	    corosync_ring_id_flush_thread, NULL) == 0) {
+		ring_id_store.flush_thread_running = 1;
+	} else {
+		log_printf (LOGSYS_LEVEL_WARNING,
+			"Couldn't create ringid flush thread, flushing asynchronously by kernel");
+	}
+}
+
+static void corosync_ring_id_unmap (void)
+{
+
+	if (ring_id_store.flush_thread_running) {
+		pthread_mutex_lock (&ring_id_store.mutex);
+		ring_id_store.exit_requested = 1;
+		pthread_cond_signal (&ring_id_store.cond);
+		pthread_mutex_unlock (&ring_id_store.mutex);
+
+		pthread_join (ring_id_store.flush_thread, NULL);
+		ring_id_store.flush_thread_running = 0;
+	}
+
+	if (ring_id_store.seq != NULL) {
+		munmap (ring_id_store.seq, sizeof (uint64_t));
+		ring_id_store.seq = NULL;
+	}
+
+	if (ring_id_store.fd != -1) {
+		close (ring_id_store.fd);
+		ring_id_store.fd = -1;
+	}
 }
 
 static void corosync_ring_id_create_or_load (
@@ -665,6 +825,18 @@ static void corosync_ring_id_create_or_load (
 
 	totemip_copy(&memb_ring_id->rep, addr);
 	assert (!totemip_zero_check(&memb_ring_id->rep));
+
+	/*
+	 * Failure to map file is not fatal, corosync_ring_id_store falls back
+	 * to writing the file
+	 */
+	if (ring_id_store.seq == NULL) {
+		fd = open (filename, O_RDWR, 0700);
+		if (fd != -1) {
+			corosync_ring_id_map (fd, filename);
+			close (fd);
+		}
+	}
 }
 
 static void corosync_ring_id_store (
@@ -678,6 +850,24 @@ static void corosync_ring_id_store (
 	snprintf (filename, sizeof(filename), "%s/ringid_%s",
 		get_run_dir(), totemip_print (addr));
 
+	log_printf (LOGSYS_LEVEL_DEBUG,
+		"Storing new sequence id for ring %llx", memb_ring_id->seq);
+
+	if (ring_id_store.seq != NULL && strcmp (filename, ring_id_store.filename) == 0) {
+		*ring_id_store.seq = memb_ring_id->seq;
+
+		if (ring_id_store.flush_thread_running) {
+			pthread_mutex_lock (&ring_id_store.mutex);
+			ring_id_store.flush_requested = 1;
+			pthread_cond_signal (&ring_id_store.cond);
+			pthread_mutex_unlock (&ring_id_store.mutex);
+		} else {
+			(void)msync (ring_id_store.seq, sizeof (uint64_t), MS_ASYNC);
+		}
+
+		return ;
+	}
+
 	fd = open (filename, O_WRONLY, 0700);
 	if (fd == -1) {
 		fd = open (filename, O_CREAT|O_RDWR, 0700);
@@ -689,8 +879,6 @@ static void corosync_ring_id_store (
 
 		corosync_exit_error (COROSYNC_DONE_STORE_RINGID);
 	}
-	log_printf (LOGSYS_LEVEL_DEBUG,
-		"Storing new sequence id for ring %llx", memb_ring_id->seq);
 	res = write (fd, &memb_ring_id->seq, sizeof(memb_ring_id->seq));
 	close (fd);
 	if (res != sizeof(memb_ring_id->seq)) {
@@ -1529,6 +1717,11 @@ int main (int argc, char **argv, char **envp)
 	 */
 	totempg_finalize ();
 
+	/*
+	 * Flush and unmap ring id file
+	 */
+	corosync_ring_id_unmap ();
+
 	/*
 	 * free the loop resources
 	 */
@@ -58,6 +58,8 @@ extern int main_mcast (
 	unsigned int iov_len,
 	unsigned int guarantee);
 
+extern uint64_t main_mcast_bytes_get (void);
+
 extern void message_source_set (mar_message_source_t *source, void *conn);
 
 extern int message_source_is_local (const mar_message_source_t *source);
@@ -43,6 +43,7 @@
 #include <libknet.h>
 
 #include <qb/qblist.h>
+#include <qb/qbutil.h>
 #include <qb/qbipcs.h>
 #include <qb/qbipc_common.h>
 
@@ -50,6 +51,7 @@
 #include <corosync/coroapi.h>
 #include <corosync/logsys.h>
 #include <corosync/icmap.h>
+#include <corosync/cmap.h>
 #include <corosync/totem/totemstats.h>
 
 #include "util.h"
@@ -62,7 +64,7 @@ static qb_map_t *stats_map;
 
 /* Convert iterator number to text and a stats pointer */
 struct cs_stats_conv {
-	enum {STAT_PG, STAT_SRP, STAT_KNET, STAT_KNET_HANDLE, STAT_IPCSC, STAT_IPCSG} type;
+	enum {STAT_PG, STAT_SRP, STAT_KNET, STAT_KNET_HANDLE, STAT_IPCSC, STAT_IPCSG, STAT_CMAP, STAT_CONFIG, STAT_IPCSH} type;
 	const char *name;
 	const size_t offset;
 	const icmap_value_types_t value_type;
@@ -102,6 +104,10 @@ struct cs_stats_conv cs_srp_stats[] = {
 	{ STAT_SRP, "mtt_rx_token",           offsetof(totemsrp_stats_t, mtt_rx_token),           ICMAP_VALUETYPE_UINT32},
 	{ STAT_SRP, "avg_token_workload",     offsetof(totemsrp_stats_t, avg_token_workload),     ICMAP_VALUETYPE_UINT32},
 	{ STAT_SRP, "avg_backlog_calc",       offsetof(totemsrp_stats_t, avg_backlog_calc),       ICMAP_VALUETYPE_UINT32},
+	{ STAT_SRP, "ring_id_store_count",    offsetof(totemsrp_stats_t, ring_id_store_count),    ICMAP_VALUETYPE_UINT64},
+	{ STAT_SRP, "ring_id_store_time_last", offsetof(totemsrp_stats_t, ring_id_store_time_last), ICMAP_VALUETYPE_UINT64},
+	{ STAT_SRP, "ring_id_store_time_max", offsetof(totemsrp_stats_t, ring_id_store_time_max), ICMAP_VALUETYPE_UINT64},
+	{ STAT_SRP, "ring_id_store_time_ave", offsetof(totemsrp_stats_t, ring_id_store_time_ave), ICMAP_VALUETYPE_UINT64},
 };
 
 struct cs_stats_conv cs_knet_stats[] = {
@@ -184,11 +190,39 @@ struct cs_stats_conv cs_ipcs_conn_stats[] = {
 	{ STAT_IPCSC, "recv_retries",    offsetof(struct ipcs_conn_stats, conn.recv_retries),    ICMAP_VALUETYPE_UINT64},
 	{ STAT_IPCSC, "flow_control",    offsetof(struct ipcs_conn_stats, conn.flow_control_state),    ICMAP_VALUETYPE_UINT32},
 	{ STAT_IPCSC, "flow_control_count",   offsetof(struct ipcs_conn_stats, conn.flow_control_count),    ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "handler_time",    offsetof(struct ipcs_conn_stats, cnx.handler_time),     ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "handler_time_max", offsetof(struct ipcs_conn_stats, cnx.handler_time_max), ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "queue_time",      offsetof(struct ipcs_conn_stats, cnx.queue_time),       ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "queue_time_max",  offsetof(struct ipcs_conn_stats, cnx.queue_time_max),   ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "sched_throttled", offsetof(struct ipcs_conn_stats, cnx.sched_throttled),  ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "totem_backlog",   offsetof(struct ipcs_conn_stats, cnx.fc_backlog),       ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "totem_fc",        offsetof(struct ipcs_conn_stats, cnx.fc_enabled),       ICMAP_VALUETYPE_UINT32},
+	{ STAT_IPCSC, "totem_fc_count",  offsetof(struct ipcs_conn_stats, cnx.fc_count),         ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSC, "totem_fc_time",   offsetof(struct ipcs_conn_stats, cnx.fc_time),          ICMAP_VALUETYPE_UINT64},
+};
+struct cs_stats_conv cs_ipcs_handler_stats[] = {
+	{ STAT_IPCSH, "calls",           offsetof(struct ipcs_handler_stats, calls),             ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSH, "time",            offsetof(struct ipcs_handler_stats, time),              ICMAP_VALUETYPE_UINT64},
+	{ STAT_IPCSH, "time_max",        offsetof(struct ipcs_handler_stats, time_max),          ICMAP_VALUETYPE_UINT64},
 };
 struct cs_stats_conv cs_ipcs_global_stats[] = {
 	{ STAT_IPCSG, "global.active",        offsetof(struct ipcs_global_stats, active),           ICMAP_VALUETYPE_UINT64},
 	{ STAT_IPCSG, "global.closed",        offsetof(struct ipcs_global_stats, closed),           ICMAP_VALUETYPE_UINT64},
 };
+struct cs_stats_conv cs_cmap_stats[] = {
+	{ STAT_CMAP, "notify_coalesced",      offsetof(struct cmap_notify_stats, coalesced),        ICMAP_VALUETYPE_UINT64},
+	{ STAT_CMAP, "notify_batches",        offsetof(struct cmap_notify_stats, batches),          ICMAP_VALUETYPE_UINT64},
+	{ STAT_CMAP, "notify_batched_items",  offsetof(struct cmap_notify_stats, batched_items),    ICMAP_VALUETYPE_UINT64},
+};
+struct cs_stats_conv cs_config_stats[] = {
+	{ STAT_CONFIG, "reloads",                 offsetof(struct cfg_reload_stats, reloads),                  ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reloads_unchanged",       offsetof(struct cfg_reload_stats, reloads_unchanged),        ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reload_time_last",        offsetof(struct cfg_reload_stats, reload_time_last),         ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reload_time_max",         offsetof(struct cfg_reload_stats, reload_time_max),          ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reload_time_ave",         offsetof(struct cfg_reload_stats, reload_time_ave),          ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reload_parse_time_last",  offsetof(struct cfg_reload_stats, reload_parse_time_last),   ICMAP_VALUETYPE_UINT64},
+	{ STAT_CONFIG, "reload_changed_keys_last", offsetof(struct cfg_reload_stats, reload_changed_keys_last), ICMAP_VALUETYPE_UINT32},
+};
 
 #define NUM_PG_STATS (sizeof(cs_pg_stats) / sizeof(struct cs_stats_conv))
 #define NUM_SRP_STATS (sizeof(cs_srp_stats) / sizeof(struct cs_stats_conv))
@@ -196,6 +230,41 @@ struct cs_stats_conv cs_ipcs_global_stats[] = {
 #define NUM_KNET_HANDLE_STATS (sizeof(cs_knet_handle_stats) / sizeof(struct cs_stats_conv))
 #define NUM_IPCSC_STATS (sizeof(cs_ipcs_conn_stats) / sizeof(struct cs_stats_conv))
 #define NUM_IPCSG_STATS (sizeof(cs_ipcs_global_stats) / sizeof(struct cs_stats_conv))
+#define NUM_IPCSH_STATS (sizeof(cs_ipcs_handler_stats) / sizeof(struct cs_stats_conv))
+#define NUM_CMAP_STATS (sizeof(cs_cmap_stats) / sizeof(struct cs_stats_conv))
+#define NUM_CONFIG_STATS (sizeof(cs_config_stats) / sizeof(struct cs_stats_conv))
+
+/* No per-tracker rate limit unless cmap.stats_track_min_interval is set */
+#define STATS_TRACK_MIN_INTERVAL_DEFAULT 0
+
+/* Tables indexed by cs_stats_conv type, also used as snapshot schemas */
+static const struct {
+	struct cs_stats_conv *conv;
+	size_t count;
+} cs_stats_schemas[] = {
+	[STAT_PG]          = { cs_pg_stats,          NUM_PG_STATS },
+	[STAT_SRP]         = { cs_srp_stats,         NUM_SRP_STATS },
+	[STAT_KNET]        = { cs_knet_stats,        NUM_KNET_STATS },
+	[STAT_KNET_HANDLE] = { cs_knet_handle_stats, NUM_KNET_HANDLE_STATS },
+	[STAT_IPCSC]       = { cs_ipcs_conn_stats,   NUM_IPCSC_STATS },
+	[STAT_IPCSG]       = { cs_ipcs_global_stats, NUM_IPCSG_STATS },
+	[STAT_CMAP]        = { cs_cmap_stats,        NUM_CMAP_STATS },
+	[STAT_CONFIG]      = { cs_config_stats,      NUM_CONFIG_STATS },
+	[STAT_IPCSH]       = { cs_ipcs_handler_stats, NUM_IPCSH_STATS },
+};
+#define NUM_STATS_SCHEMAS (sizeof(cs_stats_schemas) / sizeof(cs_stats_schemas[0]))
+
+/* Source structure of one group of stats (one knet link, one connection, ...) */
+struct stats_instance {
+	void *data;
+	struct knet_link_status link_status;
+	struct knet_handle_stats knet_handle_stats;
+	struct ipcs_conn_stats ipcs_conn_stats;
+	struct ipcs_global_stats ipcs_global_stats;
+	struct ipcs_handler_stats ipcs_handler_stats;
+	struct cmap_notify_stats cmap_notify_stats;
+	struct cfg_reload_stats cfg_reload_stats;
+};
 
 /* What goes in the trie */
 struct stats_item {
@@ -203,6 +272,22 @@ struct stats_item {
 	struct cs_stats_conv * cs_conv;
 };
 
+/*
+ * Link status shared by all trackers watching the same knet link, so
+ * totemknet_link_get_status() is called at most once per link per
+ * stats_trigger_trackers() cycle
+ */
+struct stats_knet_link {
+	knet_node_id_t nodeid;
+	uint8_t link_no;
+	int refcount;
+	uint64_t generation;
+	cs_error_t res;
+	struct knet_link_status status;
+	struct qb_list_head list;
+};
+QB_LIST_DECLARE (stats_knet_link_list_head);
+
 /* One of these per tracker */
 struct cs_stats_tracker
 {
@@ -212,10 +297,31 @@ struct cs_stats_tracker
 	icmap_notify_fn_t notify_fn;
 	uint64_t old_value;
 	struct qb_list_head list;
+
+	/* Resolved on first use, NULL until the key exists in the map */
+	struct cs_stats_conv *cs_conv;
+	struct stats_knet_link *knet_link;
+	int service_id;
+	uint32_t pid;
+	void *conn_ptr;
+
+	int pending;
+	uint64_t min_interval;
+	uint64_t last_notify;
 };
 QB_LIST_DECLARE (stats_tracker_list_head);
 static const struct corosync_api_v1 *api;
 
+/* Bitmask of stats sources changed since the last stats_trigger_trackers() */
+static uint32_t stats_sources_changed;
+static uint64_t stats_generation;
+
+static uint64_t knet_handle_stats_generation;
+static int knet_handle_stats_res;
+static struct knet_handle_stats knet_handle_stats_cache;
+
+static void stats_tracker_unresolve(struct cs_stats_tracker *tracker);
+
 static void stats_map_set_value(struct cs_stats_conv *conv,
 				void *stat_array,
 				void *value,
@@ -249,8 +355,17 @@ static void stats_add_entry(const char *key, struct cs_stats_conv *cs_conv)
 static void stats_rm_entry(const char *key)
 {
 	struct stats_item *item = qb_map_get(stats_map, key);
+	struct cs_stats_tracker *tracker;
+	struct qb_list_head *iter;
 
 	if (item) {
+		qb_list_for_each(iter, &stats_tracker_list_head) {
+			tracker = qb_list_entry(iter, struct cs_stats_tracker, list);
+			if (tracker->cs_conv && strcmp(tracker->key_name, key) == 0) {
+				stats_tracker_unresolve(tracker);
+			}
+		}
+
 		qb_map_rm(stats_map, item->key_name);
 		free(item->key_name);
 		free(item);
@@ -282,51 +397,51 @@ cs_error_t stats_map_init(const struct corosync_api_v1 *corosync_api)
 		sprintf(param, "stats.ipcs.%s", cs_ipcs_global_stats[i].name);
 		stats_add_entry(param, &cs_ipcs_global_stats[i]);
 	}
+	for (i = 0; i<NUM_CMAP_STATS; i++) {
+		sprintf(param, "stats.cmap.%s", cs_cmap_stats[i].name);
+		stats_add_entry(param, &cs_cmap_stats[i]);
+	}
+	for (i = 0; i<NUM_CONFIG_STATS; i++) {
+		sprintf(param, "stats.config.%s", cs_config_stats[i].name);
+		stats_add_entry(param, &cs_config_stats[i]);
+	}
 
 	/* KNET and IPCS stats are added when appropriate */
 	return CS_OK;
 }
 
-cs_error_t stats_map_get(const char *key_name,
-			 void *value,
-			 size_t *value_len,
-			 icmap_value_types_t *type)
+/*
+ * Fetch the structure a stats key is read from. key_name can be either full
+ * key name or just the instance part of it (without field name)
+ */
+static cs_error_t stats_instance_get(const struct cs_stats_conv *statinfo,
+				     const char *key_name,
+				     struct stats_instance *inst)
 {
-	struct cs_stats_conv *statinfo;
-	struct stats_item *item;
 	totempg_stats_t *pg_stats;
-	struct knet_link_status link_status;
-	struct ipcs_conn_stats ipcs_conn_stats;
-	struct ipcs_global_stats ipcs_global_stats;
-	struct knet_handle_stats knet_handle_stats;
 	int res;
 	int nodeid;
 	int link_no;
 	int service_id;
+	int handler_id;
 	uint32_t pid;
 	void *conn_ptr;
 
-	item = qb_map_get(stats_map, key_name);
-	if (!item) {
-		return CS_ERR_NOT_EXIST;
-	}
-
-	statinfo = item->cs_conv;
 	switch (statinfo->type) {
 		case STAT_PG:
 			pg_stats = api->totem_get_stats();
-			stats_map_set_value(statinfo, pg_stats, value, value_len, type);
+			inst->data = pg_stats;
 			break;
 		case STAT_SRP:
 			pg_stats = api->totem_get_stats();
-			stats_map_set_value(statinfo, pg_stats->srp, value, value_len, type);
+			inst->data = pg_stats->srp;
 			break;
 		case STAT_KNET_HANDLE:
-			res = totemknet_handle_get_stats(&knet_handle_stats);
+			res = totemknet_handle_get_stats(&inst->knet_handle_stats);
 			if (res) {
 				return res;
 			}
-			stats_map_set_value(statinfo, &knet_handle_stats, value, value_len, type);
+			inst->data = &inst->knet_handle_stats;
 			break;
 		case STAT_KNET:
 			if (sscanf(key_name, "stats.knet.node%d.link%d", &nodeid, &link_no) != 2) {
@@ -340,25 +455,43 @@ cs_error_t stats_map_get(const char *key_name,
 			}
 
 			/* Always get the latest stats */
-			res = totemknet_link_get_status((knet_node_id_t)nodeid, (uint8_t)link_no, &link_status);
+			res = totemknet_link_get_status((knet_node_id_t)nodeid, (uint8_t)link_no, &inst->link_status);
 			if (res != CS_OK) {
 				return CS_ERR_LIBRARY;
 			}
-			stats_map_set_value(statinfo, &link_status, value, value_len, type);
+			inst->data = &inst->link_status;
 			break;
 		case STAT_IPCSC:
 			if (sscanf(key_name, "stats.ipcs.service%d.%d.%p", &service_id, &pid, &conn_ptr) != 3) {
 				return CS_ERR_NOT_EXIST;
 			}
-			res = cs_ipcs_get_conn_stats(service_id, pid, conn_ptr, &ipcs_conn_stats);
+			res = cs_ipcs_get_conn_stats(service_id, pid, conn_ptr, &inst->ipcs_conn_stats);
 			if (res != CS_OK) {
 				return res;
 			}
-			stats_map_set_value(statinfo, &ipcs_conn_stats, value, value_len, type);
+			inst->data = &inst->ipcs_conn_stats;
 			break;
 		case STAT_IPCSG:
-			cs_ipcs_get_global_stats(&ipcs_global_stats);
-			stats_map_set_value(statinfo, &ipcs_global_stats, value, value_len, type);
+			cs_ipcs_get_global_stats(&inst->ipcs_global_stats);
+			inst->data = &inst->ipcs_global_stats;
+			break;
+		case STAT_IPCSH:
+			if (sscanf(key_name, "stats.ipcs.service%d.handler%d", &service_id, &handler_id) != 2) {
+				return CS_ERR_NOT_EXIST;
+			}
+			res = cs_ipcs_get_handler_stats(service_id, handler_id, &inst->ipcs_handler_stats);
+			if (res != CS_OK) {
+				return res;
+			}
+			inst->data = &inst->ipcs_handler_stats;
+			break;
+		case STAT_CMAP:
+			cmap_notify_stats_get(&inst->cmap_notify_stats);
+			inst->data = &inst->cmap_notify_stats;
+			break;
+		case STAT_CONFIG:
+			cfg_reload_stats_get(&inst->cfg_reload_stats);
+			inst->data = &inst->cfg_reload_stats;
 			break;
 		default:
 			return CS_ERR_LIBRARY;
@@ -366,10 +499,182 @@ cs_error_t stats_map_get(const char *key_name,
 	return CS_OK;
 }
 
+cs_error_t stats_map_get(const char *key_name,
+			 void *value,
+			 size_t *value_len,
+			 icmap_value_types_t *type)
+{
+	struct stats_item *item;
+	struct stats_instance inst;
+	cs_error_t res;
+
+	item = qb_map_get(stats_map, key_name);
+	if (!item) {
+		return CS_ERR_NOT_EXIST;
+	}
+
+	res = stats_instance_get(item->cs_conv, key_name, &inst);
+	if (res != CS_OK) {
+		return res;
+	}
+	stats_map_set_value(item->cs_conv, inst.data, value, value_len, type);
+
+	return CS_OK;
+}
+
+/* Buffer the snapshot is built in */
+struct stats_snapshot_buf {
+	char *data;
+	size_t len;
+	size_t alloced;
+	size_t max_len;
+	cs_error_t err;
+};
+
+#define STATS_SNAPSHOT_INITIAL_SIZE (1024*16)
+
+static void stats_snapshot_append(struct stats_snapshot_buf *sb, const void *data, size_t len)
+{
+	char *new_data;
+	size_t new_alloced;
+
+	if (sb->err != CS_OK) {
+		return ;
+	}
+
+	if (sb->len + len > sb->max_len) {
+		sb->err = CS_ERR_TOO_BIG;
+		return ;
+	}
+
+	if (sb->len + len > sb->alloced) {
+		new_alloced = (sb->alloced > 0 ? sb->alloced : STATS_SNAPSHOT_INITIAL_SIZE);
+		while (new_alloced < sb->len + len) {
+			new_alloced *= 2;
+		}
+
+		new_data = realloc(sb->data, new_alloced);
+		if (new_data == NULL) {
+			sb->err = CS_ERR_NO_MEMORY;
+			return ;
+		}
+		sb->data = new_data;
+		sb->alloced = new_alloced;
+	}
+
+	memcpy(sb->data + sb->len, data, len);
+	sb->len += len;
+}
+
+/*
+ * Build binary snapshot of all stats (format is described in cmap.h). Every
+ * source structure is fetched only once, so all values of one instance (and
+ * all totem values) are consistent with each other.
+ */
+cs_error_t stats_map_snapshot(size_t max_len, void **snapshot, size_t *snapshot_len)
+{
+	struct stats_snapshot_buf sb;
+	struct cmap_stats_snapshot_header header;
+	struct cmap_stats_snapshot_schema schema;
+	struct cmap_stats_snapshot_field field;
+	struct cmap_stats_snapshot_instance instance;
+	struct stats_instance inst;
+	struct cs_stats_conv *conv;
+	struct stats_item *item;
+	qb_map_iter_t *iter;
+	const char *key_name;
+	size_t value_len;
+	icmap_value_types_t type;
+	uint16_t str_len;
+	int i, j;
+
+	memset(&sb, 0, sizeof(sb));
+	sb.max_len = max_len;
+	sb.err = CS_OK;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = CMAP_STATS_SNAPSHOT_MAGIC;
+	header.version = CMAP_STATS_SNAPSHOT_VERSION;
+	header.header_len = sizeof(header);
+	header.timestamp = qb_util_nano_from_epoch_get();
+	header.no_schemas = NUM_STATS_SCHEMAS;
+	stats_snapshot_append(&sb, &header, sizeof(header));
+
+	/* Schema descriptors come straight from the conversion tables */
+	for (i = 0; i < NUM_STATS_SCHEMAS; i++) {
+		schema.schema_id = i;
+		schema.no_fields = cs_stats_schemas[i].count;
+		stats_snapshot_append(&sb, &schema, sizeof(schema));
+
+		for (j = 0; j < cs_stats_schemas[i].count; j++) {
+			conv = &cs_stats_schemas[i].conv[j];
+			field.value_type = conv->value_type;
+			field.name_len = strlen(conv->name);
+			stats_snapshot_append(&sb, &field, sizeof(field));
+			stats_snapshot_append(&sb, conv->name, field.name_len);
+		}
+	}
+
+	/*
+	 * Every instance (knet link, ipc connection, ...) is recognized by key of
+	 * the first field of its table
+	 */
+	iter = qb_map_pref_iter_create(stats_map, "stats.");
+	if (iter == NULL) {
+		free(sb.data);
+		return (CS_ERR_NO_MEMORY);
+	}
+
+	while ((key_name = qb_map_iter_next(iter, (void **)&item)) != NULL) {
+		conv = item->cs_conv;
+		if (conv != &cs_stats_schemas[conv->type].conv[0]) {
+			continue;
+		}
+
+		if (stats_instance_get(conv, key_name, &inst) != CS_OK) {
+			continue;
+		}
+
+		instance.schema_id = conv->type;
+		instance.name_len = strlen(key_name) - strlen(conv->name) - 1;
+		stats_snapshot_append(&sb, &instance, sizeof(instance));
+		stats_snapshot_append(&sb, key_name, instance.name_len);
+
+		for (j = 0; j < cs_stats_schemas[instance.schema_id].count; j++) {
+			conv = &cs_stats_schemas[instance.schema_id].conv[j];
+
+			stats_map_set_value(conv, inst.data, NULL, &value_len, &type);
+			if (type == ICMAP_VALUETYPE_STRING) {
+				str_len = value_len;
+				stats_snapshot_append(&sb, &str_len, sizeof(str_len));
+			}
+			stats_snapshot_append(&sb, (char *)inst.data + conv->offset, value_len);
+		}
+
+		header.no_instances++;
+	}
+	qb_map_iter_free(iter);
+
+	if (sb.err != CS_OK) {
+		free(sb.data);
+		return (sb.err);
+	}
+
+	header.total_len = sb.len;
+	memcpy(sb.data, &header, sizeof(header));
+
+	*snapshot = sb.data;
+	*snapshot_len = sb.len;
+
+	return (CS_OK);
+}
+
 #define STATS_CLEAR       "stats.clear."
 #define STATS_CLEAR_KNET  "stats.clear.knet"
 #define STATS_CLEAR_IPC   "stats.clear.ipc"
 #define STATS_CLEAR_TOTEM "stats.clear.totem"
+#define STATS_CLEAR_CMAP  "stats.clear.cmap"
+#define STATS_CLEAR_CONFIG "stats.clear.config"
 #define STATS_CLEAR_ALL   "stats.clear.all"
 
 cs_error_t stats_map_set(const char *key_name,
@@ -381,19 +686,39 @@ cs_error_t stats_map_set(const char *key_name,
 
 	if (strncmp(key_name, STATS_CLEAR_KNET, strlen(STATS_CLEAR_KNET)) == 0) {
 		totempg_stats_clear(TOTEMPG_STATS_CLEAR_TRANSPORT);
+		stats_source_changed(STATS_SOURCE_KNET);
 		cleared = 1;
 	}
 	if (strncmp(key_name, STATS_CLEAR_IPC, strlen(STATS_CLEAR_IPC)) == 0) {
 		cs_ipcs_clear_stats();
+		stats_source_changed(STATS_SOURCE_IPCS);
 		cleared = 1;
 	}
 	if (strncmp(key_name, STATS_CLEAR_TOTEM, strlen(STATS_CLEAR_TOTEM)) == 0) {
 		totempg_stats_clear(TOTEMPG_STATS_CLEAR_TOTEM);
+		stats_source_changed(STATS_SOURCE_TOTEM);
+		cleared = 1;
+	}
+	if (strncmp(key_name, STATS_CLEAR_CMAP, strlen(STATS_CLEAR_CMAP)) == 0) {
+		cmap_notify_stats_clear();
+		stats_source_changed(STATS_SOURCE_CMAP);
+		cleared = 1;
+	}
+	if (strncmp(key_name, STATS_CLEAR_CONFIG, strlen(STATS_CLEAR_CONFIG)) == 0) {
+		cfg_reload_stats_clear();
+		stats_source_changed(STATS_SOURCE_CONFIG);
 		cleared = 1;
 	}
 	if (strncmp(key_name, STATS_CLEAR_ALL, strlen(STATS_CLEAR_ALL)) == 0) {
 		totempg_stats_clear(TOTEMPG_STATS_CLEAR_TRANSPORT | TOTEMPG_STATS_CLEAR_TOTEM);
 		cs_ipcs_clear_stats();
+		cmap_notify_stats_clear();
+		cfg_reload_stats_clear();
+		stats_source_changed(STATS_SOURCE_TOTEM);
+		stats_source_changed(STATS_SOURCE_KNET);
+		stats_source_changed(STATS_SOURCE_IPCS);
+		stats_source_changed(STATS_SOURCE_CMAP);
+		stats_source_changed(STATS_SOURCE_CONFIG);
 		cleared = 1;
 	}
 	if (!cleared) {
@@ -448,6 +773,168 @@ void stats_map_iter_finalize(icmap_iter_t iter)
 }
 
 
+static enum stats_source stats_conv_source(const struct cs_stats_conv *conv)
+{
+	switch (conv->type) {
+		case STAT_PG:
+		case STAT_SRP:
+			return STATS_SOURCE_TOTEM;
+		case STAT_KNET:
+		case STAT_KNET_HANDLE:
+			return STATS_SOURCE_KNET;
+		case STAT_IPCSC:
+		case STAT_IPCSG:
+		case STAT_IPCSH:
+			return STATS_SOURCE_IPCS;
+		case STAT_CONFIG:
+			return STATS_SOURCE_CONFIG;
+		case STAT_CMAP:
+		default:
+			return STATS_SOURCE_CMAP;
+	}
+}
+
+void stats_source_changed(enum stats_source source)
+{
+	stats_sources_changed |= (1 << source);
+}
+
+static struct stats_knet_link *stats_knet_link_get(knet_node_id_t nodeid, uint8_t link_no)
+{
+	struct stats_knet_link *link;
+	struct qb_list_head *iter;
+
+	qb_list_for_each(iter, &stats_knet_link_list_head) {
+		link = qb_list_entry(iter, struct stats_knet_link, list);
+		if (link->nodeid == nodeid && link->link_no == link_no) {
+			link->refcount++;
+			return (link);
+		}
+	}
+
+	link = calloc(1, sizeof(*link));
+	if (!link) {
+		return (NULL);
+	}
+	link->nodeid = nodeid;
+	link->link_no = link_no;
+	link->refcount = 1;
+	qb_list_add(&link->list, &stats_knet_link_list_head);
+
+	return (link);
+}
+
+static void stats_knet_link_put(struct stats_knet_link *link)
+{
+	if (--link->refcount == 0) {
+		qb_list_del(&link->list);
+		free(link);
+	}
+}
+
+/*
+ * Cache everything stats_map_get() would otherwise look up (trie entry,
+ * node/link or connection IDs parsed from the key) on every cycle
+ */
+static cs_error_t stats_tracker_resolve(struct cs_stats_tracker *tracker)
+{
+	struct stats_item *item;
+	int nodeid;
+	int link_no;
+
+	item = qb_map_get(stats_map, tracker->key_name);
+	if (!item) {
+		return CS_ERR_NOT_EXIST;
+	}
+
+	switch (item->cs_conv->type) {
+		case STAT_KNET:
+			if (sscanf(tracker->key_name, "stats.knet.node%d.link%d", &nodeid, &link_no) != 2 ||
+			    nodeid <= 0 || nodeid > KNET_MAX_HOST ||
+			    link_no < 0 || link_no > KNET_MAX_LINK) {
+				return CS_ERR_NOT_EXIST;
+			}
+			tracker->knet_link = stats_knet_link_get((knet_node_id_t)nodeid, (uint8_t)link_no);
+			if (!tracker->knet_link) {
+				return CS_ERR_NO_MEMORY;
+			}
+			break;
+		case STAT_IPCSC:
+			if (sscanf(tracker->key_name, "stats.ipcs.service%d.%u.%p",
+			    &tracker->service_id, &tracker->pid, &tracker->conn_ptr) != 3) {
+				return CS_ERR_NOT_EXIST;
+			}
+			break;
+		default:
+			break;
+	}
+
+	tracker->cs_conv = item->cs_conv;
+	/* Evaluate once straight away, the value may have changed meanwhile */
+	tracker->pending = 1;
+
+	return CS_OK;
+}
+
+static void stats_tracker_unresolve(struct cs_stats_tracker *tracker)
+{
+	if (tracker->knet_link) {
+		stats_knet_link_put(tracker->knet_link);
+		tracker->knet_link = NULL;
+	}
+	tracker->cs_conv = NULL;
+}
+
+static cs_error_t stats_tracker_get_value(struct cs_stats_tracker *tracker,
+					  void *value,
+					  size_t *value_len,
+					  icmap_value_types_t *type)
+{
+	struct cs_stats_conv *statinfo = tracker->cs_conv;
+	struct stats_knet_link *link = tracker->knet_link;
+	struct stats_instance inst;
+	cs_error_t res;
+
+	switch (statinfo->type) {
+		case STAT_KNET_HANDLE:
+			if (knet_handle_stats_generation != stats_generation) {
+				knet_handle_stats_res = totemknet_handle_get_stats(&knet_handle_stats_cache);
+				knet_handle_stats_generation = stats_generation;
+			}
+			if (knet_handle_stats_res) {
+				return knet_handle_stats_res;
+			}
+			stats_map_set_value(statinfo, &knet_handle_stats_cache, value, value_len, type);
+			break;
+		case STAT_KNET:
+			if (link->generation != stats_generation) {
+				link->res = totemknet_link_get_status(link->nodeid, link->link_no, &link->status);
+				link->generation = stats_generation;
+			}
+			if (link->res != CS_OK) {
+				return CS_ERR_LIBRARY;
+			}
+			stats_map_set_value(statinfo, &link->status, value, value_len, type);
+			break;
+		case STAT_IPCSC:
+			res = cs_ipcs_get_conn_stats(tracker->service_id, tracker->pid,
+						     tracker->conn_ptr, &inst.ipcs_conn_stats);
+			if (res != CS_OK) {
+				return res;
+			}
+			stats_map_set_value(statinfo, &inst.ipcs_conn_stats, value, value_len, type);
+			break;
+		default:
+			res = stats_instance_get(statinfo, tracker->key_name, &inst);
+			if (res != CS_OK) {
+				return res;
+			}
+			stats_map_set_value(statinfo, inst.data, value, value_len, type);
+			break;
+	}
+	return CS_OK;
+}
+
 void stats_trigger_trackers()
 {
 	struct cs_stats_tracker *tracker;
@@ -458,6 +945,17 @@ void stats_trigger_trackers()
 	uint64_t value;
 	struct icmap_notify_value new_val;
 	struct icmap_notify_value old_val;
+	uint32_t sources;
+	uint64_t now;
+
+	/*
+	 * knet counters live inside libknet and nothing tells us when they
+	 * change, so they are always re-read (but only once per link)
+	 */
+	sources = stats_sources_changed | (1 << STATS_SOURCE_KNET);
+	stats_sources_changed = 0;
+	stats_generation++;
+	now = qb_util_nano_current_get();
 
 	qb_list_for_each(iter, &stats_tracker_list_head) {
 
@@ -466,8 +964,20 @@ void stats_trigger_trackers()
 			continue;
 		}
 
-		res = stats_map_get(tracker->key_name,
-				    &value, &value_len, &type);
+		if (!tracker->cs_conv && stats_tracker_resolve(tracker) != CS_OK) {
+			continue;
+		}
+
+		if (sources & (1 << stats_conv_source(tracker->cs_conv))) {
+			tracker->pending = 1;
+		}
+		if (!tracker->pending ||
+		    now - tracker->last_notify < tracker->min_interval) {
+			continue;
+		}
+		tracker->pending = 0;
+
+		res = stats_tracker_get_value(tracker, &value, &value_len, &type);
 
 		/* Check if it has changed */
 		if ((res == CS_OK) && (memcmp(&value, &tracker->old_value, value_len) != 0)) {
@@ -480,6 +990,7 @@ void stats_trigger_trackers()
 					   old_val, new_val, tracker->user_data);
 
 			memcpy(&tracker->old_value, &value, value_len);
+			tracker->last_notify = now;
 		}
 	}
 }
@@ -527,6 +1038,7 @@ cs_error_t stats_map_track_add(const char *key_name,
 	size_t value_len;
 	icmap_value_types_t type;
 	cs_error_t err;
+	uint32_t min_interval;
 
 	/* We can track adding or deleting a key under a prefix */
 	if ((track_type & ICMAP_TRACK_PREFIX) &&
@@ -535,11 +1047,16 @@ cs_error_t stats_map_track_add(const char *key_name,
 		return CS_ERR_NOT_SUPPORTED;
 	}
 
-	tracker = malloc(sizeof(struct cs_stats_tracker));
+	tracker = calloc(1, sizeof(struct cs_stats_tracker));
 	if (!tracker) {
 		return CS_ERR_NO_MEMORY;
 	}
 
+	if (icmap_get_uint32("cmap.stats_track_min_interval", &min_interval) != CS_OK) {
+		min_interval = STATS_TRACK_MIN_INTERVAL_DEFAULT;
+	}
+	tracker->min_interval = (uint64_t)min_interval * QB_TIME_NS_IN_MSEC;
+
 	tracker->notify_fn = notify_fn;
 	tracker->user_data = user_data;
 	if (key_name) {
@@ -596,6 +1113,7 @@ cs_error_t stats_map_track_delete(icmap_track_t icmap_track)
 	}
 
 	qb_list_del(&tracker->list);
+	stats_tracker_unresolve(tracker);
 	free(tracker->key_name);
 	free(tracker);
 
@@ -665,3 +1183,29 @@ void stats_ipcs_del_connection(int service_id, uint32_t pid, void *ptr)
 		stats_rm_entry(param);
 	}
 }
+
+/* Per handler stats are added when service IPC is initialized */
+void stats_ipcs_add_service(int service_id, int handlers)
+{
+	int i, j;
+	char param[ICMAP_KEYNAME_MAXLEN];
+
+	for (j = 0; j<handlers; j++) {
+		for (i = 0; i<NUM_IPCSH_STATS; i++) {
+			sprintf(param, "stats.ipcs.service%d.handler%d.%s", service_id, j, cs_ipcs_handler_stats[i].name);
+			stats_add_entry(param, &cs_ipcs_handler_stats[i]);
+		}
+	}
+}
+void stats_ipcs_del_service(int service_id, int handlers)
+{
+	int i, j;
+	char param[ICMAP_KEYNAME_MAXLEN];
+
+	for (j = 0; j<handlers; j++) {
+		for (i = 0; i<NUM_IPCSH_STATS; i++) {
+			sprintf(param, "stats.ipcs.service%d.handler%d.%s", service_id, j, cs_ipcs_handler_stats[i].name);
+			stats_rm_entry(param);
+		}
+	}
+}
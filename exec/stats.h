@@ -32,6 +32,32 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* Producers of stats values, see stats_source_changed() */
+enum stats_source {
+	STATS_SOURCE_TOTEM,
+	STATS_SOURCE_KNET,
+	STATS_SOURCE_IPCS,
+	STATS_SOURCE_CMAP,
+	STATS_SOURCE_CONFIG,
+};
+
+struct cmap_notify_stats {
+	uint64_t coalesced;
+	uint64_t batches;
+	uint64_t batched_items;
+};
+
+/* Times are in microseconds */
+struct cfg_reload_stats {
+	uint64_t reloads;
+	uint64_t reloads_unchanged;
+	uint64_t reload_time_last;
+	uint64_t reload_time_max;
+	uint64_t reload_time_ave;
+	uint64_t reload_parse_time_last;
+	uint32_t reload_changed_keys_last;
+};
+
 cs_error_t stats_map_init(const struct corosync_api_v1 *api);
 
 cs_error_t stats_map_get(const char *key_name,
@@ -65,7 +91,23 @@ void *stats_map_track_get_user_data(icmap_track_t icmap_track);
 
 void stats_trigger_trackers(void);
 
+cs_error_t stats_map_snapshot(size_t max_len, void **snapshot, size_t *snapshot_len);
+
+/*
+ * Called by a producer when one of its counters changed. Only trackers of
+ * changed sources are re-evaluated by the next stats_trigger_trackers()
+ */
+void stats_source_changed(enum stats_source source);
+
 
 void stats_ipcs_add_connection(int service_id, uint32_t pid, void *ptr);
 void stats_ipcs_del_connection(int service_id, uint32_t pid, void *ptr);
+void stats_ipcs_add_service(int service_id, int handlers);
+void stats_ipcs_del_service(int service_id, int handlers);
 cs_error_t cs_ipcs_get_conn_stats(int service_id, uint32_t pid, void *conn_ptr, struct ipcs_conn_stats *ipcs_stats);
+
+void cmap_notify_stats_get(struct cmap_notify_stats *stats);
+void cmap_notify_stats_clear(void);
+
+void cfg_reload_stats_get(struct cfg_reload_stats *stats);
+void cfg_reload_stats_clear(void);
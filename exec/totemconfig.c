@@ -87,6 +87,8 @@
 
 static char error_string_response[512];
 
+static int totem_reload_changed = 0;
+
 static void add_totem_config_notification(struct totem_config *totem_config);
 
 static void *totem_get_param_by_name(struct totem_config *totem_config, const char *param_name)
@@ -931,6 +933,7 @@ static void nodelist_dynamic_notify(
 	* can reconfigure it all atomically
 	*/
 	if (icmap_get_uint8("config.totemconfig_reload_in_progress", &reloading) == CS_OK && reloading) {
+		totem_reload_changed = 1;
 		return ;
 	}
 
@@ -1794,8 +1797,10 @@ static void totem_change_notify(
 	 * If a full reload is in progress then don't do anything until it's done and
 	 * can reconfigure it all atomically
 	 */
-	if (icmap_get_uint8("config.reload_in_progress", &reloading) == CS_OK && reloading)
+	if (icmap_get_uint8("config.reload_in_progress", &reloading) == CS_OK && reloading) {
+		totem_reload_changed = 1;
 		return;
+	}
 
 	param = totem_get_param_by_name((struct totem_config *)user_data, key_name);
 	/*
@@ -1847,6 +1852,16 @@ static void totem_reload_notify(
 
 	/* Reload has completed */
 	if (*(uint8_t *)new_val.data == 0) {
+		/*
+		 * Nothing in totem. or nodelist.node. changed so there is no need
+		 * to rebuild interfaces and reconfigure totem
+		 */
+		if (!totem_reload_changed) {
+			log_printf(LOGSYS_LEVEL_DEBUG, "Configuration reloaded. Totem config unchanged.");
+			icmap_set_uint8("config.totemconfig_reload_in_progress", 0);
+			return ;
+		}
+		totem_reload_changed = 0;
 
 		totem_config->orig_interfaces = malloc (sizeof (struct totem_interface) * INTERFACE_MAX);
 		assert(totem_config->orig_interfaces != NULL);
@@ -1878,6 +1893,7 @@ static void totem_reload_notify(
 
 		icmap_set_uint8("config.totemconfig_reload_in_progress", 0);
 	} else {
+		totem_reload_changed = 0;
 		icmap_set_uint8("config.totemconfig_reload_in_progress", 1);
 	}
 }
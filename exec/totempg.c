@@ -1270,6 +1270,23 @@ void totempg_check_q_level(
 	check_q_level(instance);
 }
 
+uint32_t totempg_q_level_percent_used(void)
+{
+	uint32_t res;
+
+	if (totempg_threaded_mode == 1) {
+		pthread_mutex_lock (&totempg_mutex);
+	}
+
+	res = q_level_precent_used();
+
+	if (totempg_threaded_mode == 1) {
+		pthread_mutex_unlock (&totempg_mutex);
+	}
+
+	return (res);
+}
+
 int totempg_groups_joined_reserve (
 	void *totempg_groups_instance,
 	const struct iovec *iovec,
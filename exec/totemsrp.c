@@ -634,6 +634,7 @@ static void messages_free (struct totemsrp_instance *instance, unsigned int toke
 
 static void memb_ring_id_set (struct totemsrp_instance *instance,
 	const struct memb_ring_id *ring_id);
+static void memb_ring_id_store (struct totemsrp_instance *instance);
 static void target_set_completed (void *context);
 static void memb_state_commit_token_update (struct totemsrp_instance *instance);
 static void memb_state_commit_token_target_set (struct totemsrp_instance *instance);
@@ -2199,7 +2200,7 @@ static void memb_state_commit_enter (
 	instance->memb_timer_state_gather_consensus_timeout = 0;
 
 	memb_ring_id_set (instance, &instance->commit_token->ring_id);
-	instance->memb_ring_id_store (&instance->my_ring_id, &instance->my_id.addr[0]);
+	memb_ring_id_store (instance);
 
 	instance->token_ring_id_seq = instance->my_ring_id.seq;
 
@@ -3389,6 +3390,30 @@ static void memb_ring_id_set (
 	memcpy (&instance->my_ring_id, ring_id, sizeof (struct memb_ring_id));
 }
 
+/*
+ * Storing of ring id blocks membership change, so measure how long it takes
+ * (in microseconds)
+ */
+static void memb_ring_id_store (
+	struct totemsrp_instance *instance)
+{
+	uint64_t store_start;
+	uint64_t store_time;
+
+	store_start = qb_util_nano_current_get ();
+	instance->memb_ring_id_store (&instance->my_ring_id, &instance->my_id.addr[0]);
+	store_time = (qb_util_nano_current_get () - store_start) / QB_TIME_NS_IN_USEC;
+
+	instance->stats.ring_id_store_time_last = store_time;
+	if (store_time > instance->stats.ring_id_store_time_max) {
+		instance->stats.ring_id_store_time_max = store_time;
+	}
+	instance->stats.ring_id_store_time_ave =
+	    (instance->stats.ring_id_store_time_ave * instance->stats.ring_id_store_count + store_time) /
+	    (instance->stats.ring_id_store_count + 1);
+	instance->stats.ring_id_store_count++;
+}
+
 int totemsrp_callback_token_create (
 	void *srp_context,
 	void **handle_out,
@@ -1551,6 +1551,7 @@ static void votequorum_refresh_config(
 	int old_votes, old_expected_votes;
 	uint8_t reloading;
 	uint8_t cancel_wfa;
+	static int reload_changed = 0;
 
 	ENTER();
 
@@ -1559,9 +1560,24 @@ static void votequorum_refresh_config(
 	 * can reconfigure it all atomically
 	 */
 	if (icmap_get_uint8("config.totemconfig_reload_in_progress", &reloading) == CS_OK && reloading) {
+		if (strcmp(key_name, "config.totemconfig_reload_in_progress") != 0) {
+			reload_changed = 1;
+		}
 		return ;
 	}
 
+	/*
+	 * Reload finished without touching nodelist. or quorum. keys, so there
+	 * is nothing to refresh
+	 */
+	if (strcmp(key_name, "config.totemconfig_reload_in_progress") == 0) {
+		if (!reload_changed) {
+			LEAVE();
+			return ;
+		}
+		reload_changed = 0;
+	}
+
 	icmap_get_uint8("quorum.cancel_wait_for_all", &cancel_wfa);
 	if (strcmp(key_name, "quorum.cancel_wait_for_all") == 0 &&
 	    cancel_wfa >= 1) {
@@ -86,6 +86,14 @@ typedef uint64_t cmap_track_handle_t;
  */
 #define CMAP_TRACK_PREFIX	8
 
+/**
+ * Changes are not delivered one by one, but coalesced by corosync for
+ * cmap.track_coalesce_interval milliseconds and then delivered together. Only the
+ * latest value of each changed key is delivered. This value is also never returned
+ * inside of callback and is used only in adding track
+ */
+#define CMAP_TRACK_COALESCE	16
+
 /**
  * Possible types of value. Binary is raw data without trailing zero with given length
  */
@@ -110,6 +118,50 @@ typedef enum {
 	CMAP_MAP_STATS          = 1,
 } cmap_map_t;
 
+/*
+ * Stats snapshot returned by cmap_stats_snapshot_get. All numbers are in host
+ * byte order and nothing is aligned, so items must be read using memcpy.
+ *
+ * Snapshot starts with cmap_stats_snapshot_header followed by no_schemas
+ * schemas. Each schema is cmap_stats_snapshot_schema followed by no_fields
+ * cmap_stats_snapshot_field items, each immediately followed by name_len bytes
+ * of field name (without trailing zero).
+ *
+ * Schemas are followed by no_instances instances. Instance is
+ * cmap_stats_snapshot_instance followed by name_len bytes of instance name
+ * (for example "stats.knet.node1.link0") and values of all fields of its schema
+ * in schema order. Numeric values have their natural size, strings are prefixed
+ * by uint16_t length (including trailing zero). Full key name is instance
+ * name, dot and field name.
+ */
+#define CMAP_STATS_SNAPSHOT_MAGIC	0x54534d43
+#define CMAP_STATS_SNAPSHOT_VERSION	1
+
+struct cmap_stats_snapshot_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_len;
+	uint64_t timestamp;
+	uint32_t total_len;
+	uint32_t no_schemas;
+	uint32_t no_instances;
+} __attribute__((packed));
+
+struct cmap_stats_snapshot_schema {
+	uint16_t schema_id;
+	uint16_t no_fields;
+} __attribute__((packed));
+
+struct cmap_stats_snapshot_field {
+	uint8_t value_type;
+	uint8_t name_len;
+} __attribute__((packed));
+
+struct cmap_stats_snapshot_instance {
+	uint16_t schema_id;
+	uint16_t name_len;
+} __attribute__((packed));
+
 /**
  * Structure passed as new_value and old_value in change callback. It contains type of
  * key, length of key and pointer to value of key
@@ -367,6 +419,16 @@ extern cs_error_t cmap_track_add(
  */
 extern cs_error_t cmap_track_delete(cmap_handle_t handle, cmap_track_handle_t track_handle);
 
+/**
+ * Take consistent snapshot of all statistics in one call. Snapshot is in binary
+ * format described above cmap_stats_snapshot_header and must be freed by
+ * caller using free(3).
+ * @param handle cmap handle
+ * @param snapshot Pointer to snapshot buffer allocated by library
+ * @param snapshot_len Length of snapshot
+ */
+extern cs_error_t cmap_stats_snapshot_get(cmap_handle_t handle, void **snapshot, size_t *snapshot_len);
+
 /** @} */
 
 #ifdef __cplusplus
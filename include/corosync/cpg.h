@@ -155,6 +155,22 @@ typedef void (*cpg_deliver_fn_t) (
 	void *msg,
 	size_t msg_len);
 
+/**
+ * @brief The cpg_deliver_iov_fn_t callback
+ *
+ * Used (if set by cpg_deliver_iov_callback_set) for delivery of fragmented
+ * messages. Message is passed as iov_len fragment buffers with total length
+ * msg_len instead of one contiguous buffer.
+ */
+typedef void (*cpg_deliver_iov_fn_t) (
+	cpg_handle_t handle,
+	const struct cpg_name *group_name,
+	uint32_t nodeid,
+	uint32_t pid,
+	const struct iovec *iov,
+	unsigned int iov_len,
+	size_t msg_len);
+
 /**
  * @brief The cpg_confchg_fn_t callback
  */
@@ -190,6 +206,12 @@ typedef struct {
 } cpg_model_data_t;
 
 #define CPG_MODEL_V1_DELIVER_INITIAL_TOTEM_CONF 0x01
+/*
+ * Don't wait for corosync reply when sending fragmented messages. Errors of
+ * async sends are reported via dispatch (see cpg_async_send_error_get)
+ * and cpg_flow_control_state_get reports flow control state of last send.
+ */
+#define CPG_MODEL_V1_ASYNC_SEND 0x02
 
 /**
  * @brief The cpg_model_v1_data_t struct
@@ -280,6 +302,26 @@ cs_error_t cpg_context_set (
 	cpg_handle_t handle,
 	void *context);
 
+/**
+ * @brief Set callback used for delivery of fragmented messages as iovec
+ * @param handle
+ * @param deliver_iov_fn callback or NULL to deliver as contiguous buffer
+ * @return
+ */
+cs_error_t cpg_deliver_iov_callback_set (
+	cpg_handle_t handle,
+	cpg_deliver_iov_fn_t deliver_iov_fn);
+
+/**
+ * @brief Set maximum memory kept for reuse by fragmented message assembly
+ * @param handle
+ * @param max_size maximum size in bytes (0 disables buffer reuse)
+ * @return
+ */
+cs_error_t cpg_assembly_pool_size_set (
+	cpg_handle_t handle,
+	size_t max_size);
+
 /**
  * @brief  Dispatch messages and configuration changes
  * @param handle
@@ -290,6 +332,18 @@ cs_error_t cpg_dispatch (
 	cpg_handle_t handle,
 	cs_dispatch_flags_t dispatch_types);
 
+/**
+ * @brief Dispatch up to max_events pending messages without blocking
+ * @param handle
+ * @param max_events maximum number of events to dispatch (0 means all pending)
+ * @param dispatched_events number of dispatched events (may be NULL)
+ * @return
+ */
+cs_error_t cpg_dispatch_batch (
+	cpg_handle_t handle,
+	unsigned int max_events,
+	unsigned int *dispatched_events);
+
 /**
  * @brief Join one or more groups.
  *
@@ -305,6 +359,24 @@ cs_error_t cpg_join (
 	cpg_handle_t handle,
 	const struct cpg_name *group);
 
+/*
+ * Group is local only. Its messages are ordered and delivered by local
+ * corosync without sending them to other nodes.
+ */
+#define CPG_JOIN_FLAG_LOCAL_ONLY 0x01
+
+/**
+ * @brief Join group with flags (CPG_JOIN_FLAG_*)
+ * @param handle
+ * @param group
+ * @param flags
+ * @return
+ */
+cs_error_t cpg_join_flags (
+	cpg_handle_t handle,
+	const struct cpg_name *group,
+	unsigned int flags);
+
 /**
  * @brief Leave one or more groups
  * @param handle
@@ -330,6 +402,28 @@ cs_error_t cpg_mcast_joined (
 	const struct iovec *iovec,
 	unsigned int iov_len);
 
+/**
+ * @brief Multicast batch of independent messages to groups joined with cpg_join.
+ *
+ * Every entry of msgs is delivered as separate message (exactly as if
+ * cpg_mcast_joined was called for every entry), but whole batch is sent
+ * to corosync as one request. Batch is either sent completely or not at all.
+ * Packed size of the batch (msg_count * 8 bytes plus every message padded
+ * to 8 bytes) must not exceed cpg_max_atomic_msgsize_get, otherwise
+ * CS_ERR_TOO_BIG is returned.
+ *
+ * @param handle
+ * @param guarantee
+ * @param msgs array of msg_count messages
+ * @param msg_count number of messages in the batch
+ * @return
+ */
+cs_error_t cpg_mcast_joined_batch (
+	cpg_handle_t handle,
+	cpg_guarantee_t guarantee,
+	const struct iovec *msgs,
+	unsigned int msg_count);
+
 /**
  * @brief Get membership information from cpg
  * @param handle
@@ -363,6 +457,23 @@ cs_error_t cpg_flow_control_state_get (
 	cpg_handle_t handle,
 	cpg_flow_control_state_t *flow_control_enabled);
 
+/**
+ * @brief Get error of failed async sends (CPG_MODEL_V1_ASYNC_SEND)
+ *
+ * Failed async sends are reported by corosync via dispatch, so cpg_dispatch
+ * must be called for the error to be noticed. Error and number of failed
+ * messages are cleared by this call.
+ *
+ * @param handle
+ * @param error last error (CS_OK if no send failed since previous call)
+ * @param failed_msgs number of messages which failed since previous call
+ * @return
+ */
+cs_error_t cpg_async_send_error_get (
+	cpg_handle_t handle,
+	cs_error_t *error,
+	uint32_t *failed_msgs);
+
 /**
  * @brief cpg_zcb_alloc
  * @param handle
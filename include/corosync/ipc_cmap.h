@@ -53,6 +53,7 @@ enum req_cmap_types {
 	MESSAGE_REQ_CMAP_TRACK_ADD = 7,
 	MESSAGE_REQ_CMAP_TRACK_DELETE = 8,
 	MESSAGE_REQ_CMAP_SET_CURRENT_MAP = 9,
+	MESSAGE_REQ_CMAP_STATS_SNAPSHOT = 10,
 };
 
 /**
@@ -70,6 +71,8 @@ enum res_cmap_types {
 	MESSAGE_RES_CMAP_TRACK_DELETE = 8,
 	MESSAGE_RES_CMAP_NOTIFY_CALLBACK = 9,
 	MESSAGE_RES_CMAP_SET_CURRENT_MAP = 10,
+	MESSAGE_RES_CMAP_NOTIFY_BATCH_CALLBACK = 11,
+	MESSAGE_RES_CMAP_STATS_SNAPSHOT = 12,
 };
 
 enum {
@@ -250,6 +253,18 @@ struct res_lib_cmap_notify_callback {
 	mar_uint8_t new_value[];
 };
 
+/**
+ * @brief The res_lib_cmap_notify_batch_callback struct
+ */
+struct res_lib_cmap_notify_batch_callback {
+	struct qb_ipc_response_header header __attribute__((aligned(8)));
+	mar_uint32_t no_items __attribute__((aligned(8)));
+	/*
+	 * Following are no_items res_lib_cmap_notify_callback structures. Each of them
+	 * has header.size set to its own length (including values) aligned to 8 bytes.
+	 */
+};
+
 /**
  * @brief The req_lib_cmap_set_current_map struct
  * used by cmap_initialize_map()
@@ -259,5 +274,21 @@ struct req_lib_cmap_set_current_map {
 	mar_int32_t map __attribute__((aligned(8)));
 };
 
+/**
+ * @brief The req_lib_cmap_stats_snapshot struct
+ */
+struct req_lib_cmap_stats_snapshot {
+	struct qb_ipc_request_header header __attribute__((aligned(8)));
+	mar_size_t max_len __attribute__((aligned(8)));
+};
+
+/**
+ * @brief The res_lib_cmap_stats_snapshot struct
+ */
+struct res_lib_cmap_stats_snapshot {
+	struct qb_ipc_response_header header __attribute__((aligned(8)));
+	mar_size_t snapshot_len __attribute__((aligned(8)));
+	mar_uint8_t snapshot[] __attribute__((aligned(8)));
+};
 
 #endif /* IPC_CMAP_H_DEFINED */
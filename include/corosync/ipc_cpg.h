@@ -59,6 +59,11 @@ enum req_cpg_types {
 	MESSAGE_REQ_CPG_ZC_FREE = 10,
 	MESSAGE_REQ_CPG_ZC_EXECUTE = 11,
 	MESSAGE_REQ_CPG_PARTIAL_MCAST = 12,
+	MESSAGE_REQ_CPG_ZC_ARENA_MAP = 13,
+	MESSAGE_REQ_CPG_ZC_ARENA_EXECUTE = 14,
+	MESSAGE_REQ_CPG_MCAST_BATCH = 15,
+	MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC = 16,
+	MESSAGE_REQ_CPG_JOIN_LOCAL_ONLY = 17,
 };
 
 /**
@@ -84,6 +89,8 @@ enum res_cpg_types {
 	MESSAGE_RES_CPG_ZC_EXECUTE = 16,
 	MESSAGE_RES_CPG_PARTIAL_DELIVER_CALLBACK = 17,
 	MESSAGE_RES_CPG_PARTIAL_SEND = 18,
+	MESSAGE_RES_CPG_ZC_ARENA_MAP = 19,
+	MESSAGE_RES_CPG_MCAST_ERROR = 20,
 };
 
 /**
@@ -298,6 +305,18 @@ struct res_lib_cpg_partial_send {
 	struct qb_ipc_response_header header __attribute__((aligned(8)));
 };
 
+/**
+ * @brief The res_lib_cpg_mcast_error struct
+ *
+ * Sent as dispatch message to clients with CPG_MODEL_V1_ASYNC_SEND
+ * flag when mcast request fails. Error is stored in header.
+ */
+struct res_lib_cpg_mcast_error {
+	struct qb_ipc_response_header header __attribute__((aligned(8)));
+	mar_uint32_t req_id __attribute__((aligned(8)));
+	mar_uint32_t msg_count __attribute__((aligned(8)));
+};
+
 /**
  * @brief The req_lib_cpg_mcast struct
  */
@@ -308,6 +327,30 @@ struct req_lib_cpg_mcast {
 	mar_uint8_t message[] __attribute__((aligned(8)));
 };
 
+/**
+ * @brief The req_lib_cpg_mcast_batch struct
+ *
+ * message contains msg_count of cpg_mcast_batch_entry, every entry is padded
+ * to 8 bytes
+ */
+struct req_lib_cpg_mcast_batch {
+	struct qb_ipc_response_header header __attribute__((aligned(8)));
+	mar_uint32_t guarantee __attribute__((aligned(8)));
+	mar_uint32_t msg_count __attribute__((aligned(8)));
+	mar_uint8_t message[] __attribute__((aligned(8)));
+};
+
+/**
+ * @brief The cpg_mcast_batch_entry struct
+ */
+struct cpg_mcast_batch_entry {
+	mar_uint32_t msglen __attribute__((aligned(8)));
+	mar_uint8_t message[] __attribute__((aligned(8)));
+};
+
+#define CPG_MCAST_BATCH_ENTRY_SIZE(msglen) \
+	(sizeof (struct cpg_mcast_batch_entry) + (((size_t)(msglen) + 7) & ~(size_t)7))
+
 /**
  * @brief The req_lib_cpg_partial_mcast struct
  */
@@ -492,6 +535,14 @@ typedef struct {
 	uint64_t server_address __attribute__((aligned(8)));
 } mar_req_coroipcc_zc_execute_t __attribute__((aligned(8)));
 
+/**
+ * @brief mar_req_coroipcc_zc_arena_execute_t struct
+ */
+typedef struct {
+        struct qb_ipc_request_header header __attribute__((aligned(8)));
+	uint64_t offset __attribute__((aligned(8)));
+} mar_req_coroipcc_zc_arena_execute_t __attribute__((aligned(8)));
+
 /**
  * @brief coroipcs_zc_header struct
  */
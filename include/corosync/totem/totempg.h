@@ -182,6 +182,8 @@ enum totem_q_level {
 
 void totempg_check_q_level(void *instance);
 
+extern uint32_t totempg_q_level_percent_used(void);
+
 typedef void (*totem_queue_level_changed_fn) (enum totem_q_level level);
 extern void totempg_queue_level_register_callback (totem_queue_level_changed_fn);
 
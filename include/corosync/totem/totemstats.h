@@ -83,6 +83,11 @@ typedef struct {
 	uint32_t avg_token_workload;
 	uint32_t avg_backlog_calc;
 
+	uint64_t ring_id_store_count;
+	uint64_t ring_id_store_time_last;
+	uint64_t ring_id_store_time_max;
+	uint64_t ring_id_store_time_ave;
+
 	int earliest_token;
 	int latest_token;
 #define TOTEM_TOKEN_STATS_MAX 100
@@ -83,6 +83,10 @@ static cs_error_t cmap_get_int(
 
 static cs_error_t cmap_adjust_int(cmap_handle_t handle, const char *key_name, int32_t step);
 
+static cs_error_t cmap_notify_callback_deliver(
+	cmap_handle_t handle,
+	const struct res_lib_cmap_notify_callback *res_lib_cmap_notify_callback);
+
 /*
  * Function implementations
  */
@@ -237,9 +241,11 @@ cs_error_t cmap_dispatch (
 	struct qb_ipc_response_header *dispatch_data;
 	char dispatch_buf[IPC_DISPATCH_SIZE];
 	struct res_lib_cmap_notify_callback *res_lib_cmap_notify_callback;
-	struct cmap_track_inst *cmap_track_inst;
-	struct cmap_notify_value old_val;
-	struct cmap_notify_value new_val;
+	struct res_lib_cmap_notify_batch_callback *res_lib_cmap_notify_batch_callback;
+	const char *item_ptr;
+	const char *batch_end;
+	size_t item_size;
+	uint32_t i;
 
 	error = hdb_error_to_cs(hdb_handle_get (&cmap_handle_t_db, handle, (void *)&cmap_inst));
 	if (error != CS_OK) {
@@ -292,35 +298,48 @@ cs_error_t cmap_dispatch (
 		case MESSAGE_RES_CMAP_NOTIFY_CALLBACK:
 			res_lib_cmap_notify_callback = (struct res_lib_cmap_notify_callback *)dispatch_data;
 
-			error = hdb_error_to_cs(hdb_handle_get(&cmap_track_handle_t_db,
-					res_lib_cmap_notify_callback->track_inst_handle,
-					(void *)&cmap_track_inst));
-			if (error == CS_ERR_BAD_HANDLE) {
-				/*
-				 * User deleted tracker -> ignore error
-				 */
-				 break;
-			}
+			error = cmap_notify_callback_deliver(handle, res_lib_cmap_notify_callback);
 			if (error != CS_OK) {
 				goto error_put;
 			}
+			break;
+		case MESSAGE_RES_CMAP_NOTIFY_BATCH_CALLBACK:
+			res_lib_cmap_notify_batch_callback = (struct res_lib_cmap_notify_batch_callback *)dispatch_data;
+			if (dispatch_data->size < sizeof(*res_lib_cmap_notify_batch_callback) ||
+			    dispatch_data->size > IPC_DISPATCH_SIZE) {
+				error = CS_ERR_LIBRARY;
+				goto error_put;
+			}
+			item_ptr = (const char *)dispatch_data + sizeof(*res_lib_cmap_notify_batch_callback);
+			batch_end = (const char *)dispatch_data + dispatch_data->size;
 
-			new_val.type = res_lib_cmap_notify_callback->new_value_type;
-			old_val.type = res_lib_cmap_notify_callback->old_value_type;
-			new_val.len = res_lib_cmap_notify_callback->new_value_len;
-			old_val.len = res_lib_cmap_notify_callback->old_value_len;
-			new_val.data = res_lib_cmap_notify_callback->new_value;
-			old_val.data = (((const char *)res_lib_cmap_notify_callback->new_value) + new_val.len);
-
-			cmap_track_inst->notify_fn(handle,
-					cmap_track_inst->track_handle,
-					res_lib_cmap_notify_callback->event,
-					(char *)res_lib_cmap_notify_callback->key_name.value,
-					new_val,
-					old_val,
-					cmap_track_inst->user_data);
-
-			(void)hdb_handle_put(&cmap_track_handle_t_db, res_lib_cmap_notify_callback->track_inst_handle);
+			for (i = 0; i < res_lib_cmap_notify_batch_callback->no_items && !cmap_inst->finalize; i++) {
+				/*
+				 * Every item must fit into rest of the batch, including its values
+				 */
+				if ((size_t)(batch_end - item_ptr) < sizeof(*res_lib_cmap_notify_callback)) {
+					error = CS_ERR_LIBRARY;
+					goto error_put;
+				}
+				res_lib_cmap_notify_callback = (struct res_lib_cmap_notify_callback *)item_ptr;
+				item_size = res_lib_cmap_notify_callback->header.size;
+				if (item_size < sizeof(*res_lib_cmap_notify_callback) ||
+				    item_size > (size_t)(batch_end - item_ptr) ||
+				    res_lib_cmap_notify_callback->new_value_len > item_size ||
+				    res_lib_cmap_notify_callback->old_value_len > item_size ||
+				    sizeof(*res_lib_cmap_notify_callback) + res_lib_cmap_notify_callback->new_value_len +
+				    res_lib_cmap_notify_callback->old_value_len > item_size) {
+					error = CS_ERR_LIBRARY;
+					goto error_put;
+				}
+
+				error = cmap_notify_callback_deliver(handle, res_lib_cmap_notify_callback);
+				if (error != CS_OK) {
+					goto error_put;
+				}
+
+				item_ptr += item_size;
+			}
 			break;
 		default:
 			error = CS_ERR_LIBRARY;
@@ -349,6 +368,48 @@ error_put:
 	return (error);
 }
 
+static cs_error_t cmap_notify_callback_deliver(
+	cmap_handle_t handle,
+	const struct res_lib_cmap_notify_callback *res_lib_cmap_notify_callback)
+{
+	cs_error_t error;
+	struct cmap_track_inst *cmap_track_inst;
+	struct cmap_notify_value old_val;
+	struct cmap_notify_value new_val;
+
+	error = hdb_error_to_cs(hdb_handle_get(&cmap_track_handle_t_db,
+			res_lib_cmap_notify_callback->track_inst_handle,
+			(void *)&cmap_track_inst));
+	if (error == CS_ERR_BAD_HANDLE) {
+		/*
+		 * User deleted tracker -> ignore error
+		 */
+		return (CS_OK);
+	}
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	new_val.type = res_lib_cmap_notify_callback->new_value_type;
+	old_val.type = res_lib_cmap_notify_callback->old_value_type;
+	new_val.len = res_lib_cmap_notify_callback->new_value_len;
+	old_val.len = res_lib_cmap_notify_callback->old_value_len;
+	new_val.data = res_lib_cmap_notify_callback->new_value;
+	old_val.data = (((const char *)res_lib_cmap_notify_callback->new_value) + new_val.len);
+
+	cmap_track_inst->notify_fn(handle,
+			cmap_track_inst->track_handle,
+			res_lib_cmap_notify_callback->event,
+			(char *)res_lib_cmap_notify_callback->key_name.value,
+			new_val,
+			old_val,
+			cmap_track_inst->user_data);
+
+	(void)hdb_handle_put(&cmap_track_handle_t_db, res_lib_cmap_notify_callback->track_inst_handle);
+
+	return (CS_OK);
+}
+
 cs_error_t cmap_context_get (
 	cmap_handle_t handle,
 	const void **context)
@@ -1115,3 +1176,67 @@ error_put:
 
 	return (error);
 }
+
+cs_error_t cmap_stats_snapshot_get(
+		cmap_handle_t handle,
+		void **snapshot,
+		size_t *snapshot_len)
+{
+	cs_error_t error;
+	struct iovec iov;
+	struct cmap_inst *cmap_inst;
+	struct req_lib_cmap_stats_snapshot req_lib_cmap_stats_snapshot;
+	struct res_lib_cmap_stats_snapshot *res_lib_cmap_stats_snapshot;
+
+	if (snapshot == NULL || snapshot_len == NULL) {
+		return (CS_ERR_INVALID_PARAM);
+	}
+
+	error = hdb_error_to_cs(hdb_handle_get (&cmap_handle_t_db, handle, (void *)&cmap_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	res_lib_cmap_stats_snapshot = malloc(IPC_RESPONSE_SIZE);
+	if (res_lib_cmap_stats_snapshot == NULL) {
+		error = CS_ERR_NO_MEMORY;
+		goto error_put;
+	}
+
+	memset(&req_lib_cmap_stats_snapshot, 0, sizeof(req_lib_cmap_stats_snapshot));
+	req_lib_cmap_stats_snapshot.header.size = sizeof(req_lib_cmap_stats_snapshot);
+	req_lib_cmap_stats_snapshot.header.id = MESSAGE_REQ_CMAP_STATS_SNAPSHOT;
+	req_lib_cmap_stats_snapshot.max_len = IPC_RESPONSE_SIZE;
+
+	iov.iov_base = (char *)&req_lib_cmap_stats_snapshot;
+	iov.iov_len = sizeof(req_lib_cmap_stats_snapshot);
+
+	error = qb_to_cs_error(qb_ipcc_sendv_recv(
+		cmap_inst->c,
+		&iov,
+		1,
+		res_lib_cmap_stats_snapshot,
+		IPC_RESPONSE_SIZE, CS_IPC_TIMEOUT_MS));
+
+	if (error == CS_OK) {
+		error = res_lib_cmap_stats_snapshot->header.error;
+	}
+
+	if (error == CS_OK) {
+		*snapshot = malloc(res_lib_cmap_stats_snapshot->snapshot_len);
+		if (*snapshot == NULL) {
+			error = CS_ERR_NO_MEMORY;
+		} else {
+			memcpy(*snapshot, res_lib_cmap_stats_snapshot->snapshot,
+			    res_lib_cmap_stats_snapshot->snapshot_len);
+			*snapshot_len = res_lib_cmap_stats_snapshot->snapshot_len;
+		}
+	}
+
+	free(res_lib_cmap_stats_snapshot);
+
+error_put:
+	(void)hdb_handle_put (&cmap_handle_t_db, handle);
+
+	return (error);
+}
@@ -80,13 +80,69 @@
  */
 #define CPG_MEMORY_MAP_UMASK		077
 
+/*
+ * Zero copy buffers of up to CPG_ZC_ARENA_SLOT_SIZE (including headers) are
+ * allocated from per handle arena which is mapped (and sent to corosync) only
+ * once. Slot allocation is tracked by bitmap in one 64-bit word, so number of
+ * slots must not be greater than 64.
+ */
+#define CPG_ZC_ARENA_SLOTS		64
+#define CPG_ZC_ARENA_SLOT_SIZE		(64 * 1024)
+
+/*
+ * Batches of up to CPG_MCAST_BATCH_STATIC_MSGS messages are sent without
+ * allocating iovec array on heap
+ */
+#define CPG_MCAST_BATCH_STATIC_MSGS	64
+
+/*
+ * Partial message assemblies are looked up by (nodeid, pid) in hash table
+ * with 2^CPG_ASSEMBLY_HASH_BITS buckets
+ */
+#define CPG_ASSEMBLY_HASH_BITS		6
+#define CPG_ASSEMBLY_HASH_SIZE		(1 << CPG_ASSEMBLY_HASH_BITS)
+
+/*
+ * Default maximum amount of memory kept in idle assembly buffers (and free
+ * fragment buffers) for reuse by next large message
+ */
+#define CPG_ASSEMBLY_POOL_DEFAULT_SIZE	(8 * 1024 * 1024)
+
+enum cpg_zc_arena_state {
+	CPG_ZC_ARENA_STATE_NONE,
+	CPG_ZC_ARENA_STATE_INITIALIZING,
+	CPG_ZC_ARENA_STATE_READY,
+	CPG_ZC_ARENA_STATE_FAILED,
+};
+
+struct cpg_assembly_frag
+{
+	struct qb_list_head list;
+	char *buf;
+	size_t buf_size;
+	size_t len;
+};
+
+/*
+ * Assembly data are kept (idle) after message is delivered so buffer can be
+ * reused by next message from the same sender.
+ */
 struct cpg_assembly_data
 {
 	struct qb_list_head list;
+	struct qb_list_head idle_list;
 	uint32_t nodeid;
 	uint32_t pid;
+	int in_progress;
+	uint32_t msglen;
 	char *assembly_buf;
+	size_t assembly_buf_size;
 	uint32_t assembly_buf_ptr;
+	cpg_deliver_iov_fn_t deliver_iov_fn;
+	struct qb_list_head frag_list_head;
+	unsigned int frag_count;
+	struct iovec *iov;
+	unsigned int iov_size;
 };
 
 struct cpg_inst {
@@ -99,7 +155,20 @@ struct cpg_inst {
 	};
 	struct qb_list_head iteration_list_head;
 	uint32_t max_msg_size;
-	struct qb_list_head assembly_list_head;
+	struct qb_list_head assembly_hash[CPG_ASSEMBLY_HASH_SIZE];
+	struct qb_list_head assembly_idle_list_head;
+	struct qb_list_head assembly_free_frag_list_head;
+	size_t assembly_pool_size;
+	size_t assembly_pool_max_size;
+	cpg_deliver_iov_fn_t deliver_iov_fn;
+	int zc_arena_state;
+	char *zc_arena;
+	uint64_t zc_arena_used_slots;
+	cpg_flow_control_state_t flow_control_state;
+	cs_error_t async_send_error;
+	uint32_t async_send_failed_msgs;
+	char *dispatch_buf;
+	int dispatch_buf_busy;
 };
 static void cpg_inst_free (void *inst);
 
@@ -137,10 +206,257 @@ static void cpg_iteration_instance_finalize (struct cpg_iteration_instance_t *cp
 	hdb_handle_destroy (&cpg_iteration_handle_t_db, cpg_iteration_instance->cpg_iteration_handle);
 }
 
+static unsigned int cpg_assembly_hash (uint32_t nodeid, uint32_t pid)
+{
+
+	return ((((nodeid * 31) + pid) * 2654435761U) >> (32 - CPG_ASSEMBLY_HASH_BITS));
+}
+
+static struct cpg_assembly_data *cpg_assembly_find (
+	struct cpg_inst *cpg_inst,
+	uint32_t nodeid,
+	uint32_t pid)
+{
+	struct qb_list_head *iter;
+	struct cpg_assembly_data *assembly_data;
+
+	qb_list_for_each(iter, &cpg_inst->assembly_hash[cpg_assembly_hash (nodeid, pid)]) {
+		assembly_data = qb_list_entry (iter, struct cpg_assembly_data, list);
+		if (assembly_data->nodeid == nodeid && assembly_data->pid == pid) {
+			return (assembly_data);
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Free idle buffers until pool fits into configured maximum size. Free
+ * fragment buffers go first, then least recently used assemblies.
+ */
+static void cpg_assembly_pool_trim (struct cpg_inst *cpg_inst)
+{
+	struct cpg_assembly_frag *frag;
+	struct cpg_assembly_data *assembly_data;
+
+	while (cpg_inst->assembly_pool_size > cpg_inst->assembly_pool_max_size) {
+		if (!qb_list_empty (&cpg_inst->assembly_free_frag_list_head)) {
+			frag = qb_list_first_entry (&cpg_inst->assembly_free_frag_list_head,
+				struct cpg_assembly_frag, list);
+			qb_list_del (&frag->list);
+			cpg_inst->assembly_pool_size -= frag->buf_size;
+			free (frag->buf);
+			free (frag);
+		} else if (!qb_list_empty (&cpg_inst->assembly_idle_list_head)) {
+			assembly_data = qb_list_first_entry (&cpg_inst->assembly_idle_list_head,
+				struct cpg_assembly_data, idle_list);
+			qb_list_del (&assembly_data->idle_list);
+			qb_list_del (&assembly_data->list);
+			cpg_inst->assembly_pool_size -= assembly_data->assembly_buf_size;
+			free (assembly_data->assembly_buf);
+			free (assembly_data->iov);
+			free (assembly_data);
+		} else {
+			break;
+		}
+	}
+}
+
+static struct cpg_assembly_frag *cpg_assembly_frag_get (
+	struct cpg_inst *cpg_inst,
+	size_t len)
+{
+	struct cpg_assembly_frag *frag;
+
+	if (!qb_list_empty (&cpg_inst->assembly_free_frag_list_head)) {
+		frag = qb_list_first_entry (&cpg_inst->assembly_free_frag_list_head,
+			struct cpg_assembly_frag, list);
+		qb_list_del (&frag->list);
+		cpg_inst->assembly_pool_size -= frag->buf_size;
+	} else {
+		frag = malloc (sizeof (struct cpg_assembly_frag));
+		if (frag == NULL) {
+			return (NULL);
+		}
+		frag->buf = NULL;
+		frag->buf_size = 0;
+	}
+
+	if (frag->buf_size < len) {
+		free (frag->buf);
+		frag->buf = malloc (len);
+		if (frag->buf == NULL) {
+			free (frag);
+			return (NULL);
+		}
+		frag->buf_size = len;
+	}
+	frag->len = 0;
+	qb_list_init (&frag->list);
+
+	return (frag);
+}
+
+/*
+ * Return all fragments of assembly into the free fragment list
+ */
+static void cpg_assembly_frags_put (
+	struct cpg_inst *cpg_inst,
+	struct cpg_assembly_data *assembly_data)
+{
+	struct qb_list_head *iter, *tmp_iter;
+	struct cpg_assembly_frag *frag;
+
+	qb_list_for_each_safe(iter, tmp_iter, &assembly_data->frag_list_head) {
+		frag = qb_list_entry (iter, struct cpg_assembly_frag, list);
+		qb_list_del (&frag->list);
+		qb_list_add_tail (&frag->list, &cpg_inst->assembly_free_frag_list_head);
+		cpg_inst->assembly_pool_size += frag->buf_size;
+	}
+	assembly_data->frag_count = 0;
+}
+
+/*
+ * Free assembly without trimming the pool, so it is safe to call while
+ * iterating assembly hash
+ */
+static void cpg_assembly_free (
+	struct cpg_inst *cpg_inst,
+	struct cpg_assembly_data *assembly_data)
+{
+
+	if (assembly_data->in_progress) {
+		cpg_assembly_frags_put (cpg_inst, assembly_data);
+	} else {
+		qb_list_del (&assembly_data->idle_list);
+		cpg_inst->assembly_pool_size -= assembly_data->assembly_buf_size;
+	}
+
+	qb_list_del (&assembly_data->list);
+	free (assembly_data->assembly_buf);
+	free (assembly_data->iov);
+	free (assembly_data);
+}
+
+static void cpg_assembly_destroy (
+	struct cpg_inst *cpg_inst,
+	struct cpg_assembly_data *assembly_data)
+{
+
+	cpg_assembly_free (cpg_inst, assembly_data);
+	cpg_assembly_pool_trim (cpg_inst);
+}
+
+/*
+ * Message was delivered. Keep assembly data (and buffer) for reuse.
+ */
+static void cpg_assembly_release (
+	struct cpg_inst *cpg_inst,
+	struct cpg_assembly_data *assembly_data)
+{
+
+	cpg_assembly_frags_put (cpg_inst, assembly_data);
+
+	assembly_data->in_progress = 0;
+	qb_list_add_tail (&assembly_data->idle_list, &cpg_inst->assembly_idle_list_head);
+	cpg_inst->assembly_pool_size += assembly_data->assembly_buf_size;
+
+	cpg_assembly_pool_trim (cpg_inst);
+}
+
+static struct cpg_assembly_data *cpg_assembly_start (
+	struct cpg_inst *cpg_inst,
+	struct cpg_assembly_data *assembly_data,
+	uint32_t nodeid,
+	uint32_t pid,
+	uint32_t msglen)
+{
+
+	if (assembly_data == NULL) {
+		assembly_data = malloc (sizeof (struct cpg_assembly_data));
+		if (assembly_data == NULL) {
+			return (NULL);
+		}
+		memset (assembly_data, 0, sizeof (struct cpg_assembly_data));
+
+		assembly_data->nodeid = nodeid;
+		assembly_data->pid = pid;
+		qb_list_init (&assembly_data->list);
+		qb_list_init (&assembly_data->frag_list_head);
+		qb_list_add (&assembly_data->list,
+			&cpg_inst->assembly_hash[cpg_assembly_hash (nodeid, pid)]);
+	} else {
+		qb_list_del (&assembly_data->idle_list);
+		cpg_inst->assembly_pool_size -= assembly_data->assembly_buf_size;
+	}
+
+	assembly_data->in_progress = 1;
+	assembly_data->msglen = msglen;
+	assembly_data->assembly_buf_ptr = 0;
+	assembly_data->deliver_iov_fn = cpg_inst->deliver_iov_fn;
+
+	if (assembly_data->deliver_iov_fn == NULL && assembly_data->assembly_buf_size < msglen) {
+		free (assembly_data->assembly_buf);
+		assembly_data->assembly_buf = malloc (msglen);
+		if (assembly_data->assembly_buf == NULL) {
+			assembly_data->assembly_buf_size = 0;
+			cpg_assembly_destroy (cpg_inst, assembly_data);
+			return (NULL);
+		}
+		assembly_data->assembly_buf_size = msglen;
+	}
+
+	return (assembly_data);
+}
+
 static void cpg_inst_free (void *inst)
 {
 	struct cpg_inst *cpg_inst = (struct cpg_inst *)inst;
+	struct qb_list_head *iter, *tmp_iter;
+	unsigned int i;
+
 	qb_ipcc_disconnect(cpg_inst->c);
+
+	for (i = 0; i < CPG_ASSEMBLY_HASH_SIZE; i++) {
+		qb_list_for_each_safe(iter, tmp_iter, &cpg_inst->assembly_hash[i]) {
+			cpg_assembly_free (cpg_inst,
+				qb_list_entry (iter, struct cpg_assembly_data, list));
+		}
+	}
+	cpg_inst->assembly_pool_max_size = 0;
+	cpg_assembly_pool_trim (cpg_inst);
+
+	if (cpg_inst->zc_arena_state == CPG_ZC_ARENA_STATE_READY) {
+		munmap (cpg_inst->zc_arena, CPG_ZC_ARENA_SLOTS * CPG_ZC_ARENA_SLOT_SIZE);
+	}
+
+	free (cpg_inst->dispatch_buf);
+}
+
+/*
+ * Dispatch buffer is allocated once per handle. Nested (dispatch called
+ * from callback) or concurrent dispatch uses temporary buffer.
+ */
+static char *cpg_dispatch_buf_get (struct cpg_inst *cpg_inst)
+{
+	int busy = 0;
+
+	if (__atomic_compare_exchange_n (&cpg_inst->dispatch_buf_busy, &busy, 1,
+	    0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return (cpg_inst->dispatch_buf);
+	}
+
+	return (malloc (IPC_DISPATCH_SIZE));
+}
+
+static void cpg_dispatch_buf_put (struct cpg_inst *cpg_inst, char *dispatch_buf)
+{
+
+	if (dispatch_buf == cpg_inst->dispatch_buf) {
+		__atomic_store_n (&cpg_inst->dispatch_buf_busy, 0, __ATOMIC_RELEASE);
+	} else {
+		free (dispatch_buf);
+	}
 }
 
 static void cpg_inst_finalize (struct cpg_inst *cpg_inst, hdb_handle_t handle)
@@ -190,6 +506,7 @@ cs_error_t cpg_model_initialize (
 {
 	cs_error_t error;
 	struct cpg_inst *cpg_inst;
+	unsigned int i;
 
 	if (model != CPG_MODEL_V1) {
 		error = CS_ERR_INVALID_PARAM;
@@ -212,11 +529,19 @@ cs_error_t cpg_model_initialize (
 		goto error_put_destroy;
 	}
 
+	cpg_inst->dispatch_buf = malloc (IPC_DISPATCH_SIZE);
+	if (cpg_inst->dispatch_buf == NULL) {
+		error = CS_ERR_NO_MEMORY;
+		goto error_put_destroy;
+	}
+	cpg_inst->dispatch_buf_busy = 0;
+
 	if (model_data != NULL) {
 		switch (model) {
 		case CPG_MODEL_V1:
 			memcpy (&cpg_inst->model_v1_data, model_data, sizeof (cpg_model_v1_data_t));
-			if ((cpg_inst->model_v1_data.flags & ~(CPG_MODEL_V1_DELIVER_INITIAL_TOTEM_CONF)) != 0) {
+			if ((cpg_inst->model_v1_data.flags & ~(CPG_MODEL_V1_DELIVER_INITIAL_TOTEM_CONF |
+			    CPG_MODEL_V1_ASYNC_SEND)) != 0) {
 				error = CS_ERR_INVALID_PARAM;
 
 				goto error_destroy;
@@ -232,7 +557,21 @@ cs_error_t cpg_model_initialize (
 
 	qb_list_init(&cpg_inst->iteration_list_head);
 
-	qb_list_init(&cpg_inst->assembly_list_head);
+	for (i = 0; i < CPG_ASSEMBLY_HASH_SIZE; i++) {
+		qb_list_init(&cpg_inst->assembly_hash[i]);
+	}
+	qb_list_init(&cpg_inst->assembly_idle_list_head);
+	qb_list_init(&cpg_inst->assembly_free_frag_list_head);
+	cpg_inst->assembly_pool_size = 0;
+	cpg_inst->assembly_pool_max_size = CPG_ASSEMBLY_POOL_DEFAULT_SIZE;
+	cpg_inst->deliver_iov_fn = NULL;
+
+	cpg_inst->zc_arena_state = CPG_ZC_ARENA_STATE_NONE;
+	cpg_inst->zc_arena = NULL;
+	cpg_inst->zc_arena_used_slots = 0;
+	cpg_inst->flow_control_state = CPG_FLOW_CONTROL_DISABLED;
+	cpg_inst->async_send_error = CS_OK;
+	cpg_inst->async_send_failed_msgs = 0;
 
 	hdb_handle_put (&cpg_handle_t_db, *handle);
 
@@ -367,39 +706,362 @@ cs_error_t cpg_context_set (
 	return (CS_OK);
 }
 
-cs_error_t cpg_dispatch (
+cs_error_t cpg_deliver_iov_callback_set (
 	cpg_handle_t handle,
-	cs_dispatch_flags_t dispatch_types)
+	cpg_deliver_iov_fn_t deliver_iov_fn)
 {
-	int timeout = -1;
 	cs_error_t error;
-	int cont = 1; /* always continue do loop except when set to 0 */
 	struct cpg_inst *cpg_inst;
-	struct res_lib_cpg_confchg_callback *res_cpg_confchg_callback;
-	struct res_lib_cpg_deliver_callback *res_cpg_deliver_callback;
-	struct res_lib_cpg_partial_deliver_callback *res_cpg_partial_deliver_callback;
-	struct res_lib_cpg_totem_confchg_callback *res_cpg_totem_confchg_callback;
-	struct cpg_inst cpg_inst_copy;
-	struct qb_ipc_response_header *dispatch_data;
+
+	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	cpg_inst->deliver_iov_fn = deliver_iov_fn;
+
+	hdb_handle_put (&cpg_handle_t_db, handle);
+
+	return (CS_OK);
+}
+
+cs_error_t cpg_assembly_pool_size_set (
+	cpg_handle_t handle,
+	size_t max_size)
+{
+	cs_error_t error;
+	struct cpg_inst *cpg_inst;
+
+	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	cpg_inst->assembly_pool_max_size = max_size;
+	cpg_assembly_pool_trim (cpg_inst);
+
+	hdb_handle_put (&cpg_handle_t_db, handle);
+
+	return (CS_OK);
+}
+
+/*
+ * Confchg callbacks need big arrays so they are processed in separate
+ * functions to keep stack of deliver path small
+ */
+static void cpg_dispatch_confchg (
+	cpg_handle_t handle,
+	struct cpg_inst *cpg_inst,
+	const cpg_model_v1_data_t *model_v1_data,
+	const struct res_lib_cpg_confchg_callback *res_cpg_confchg_callback)
+{
 	struct cpg_address member_list[CPG_MEMBERS_MAX];
 	struct cpg_address left_list[CPG_MEMBERS_MAX];
 	struct cpg_address joined_list[CPG_MEMBERS_MAX];
 	struct cpg_name group_name;
 	struct cpg_assembly_data *assembly_data;
-	struct qb_list_head *iter, *tmp_iter;
-	mar_cpg_address_t *left_list_start;
-	mar_cpg_address_t *joined_list_start;
+	const mar_cpg_address_t *left_list_start;
+	const mar_cpg_address_t *joined_list_start;
 	unsigned int i;
+
+	for (i = 0; i < res_cpg_confchg_callback->member_list_entries; i++) {
+		marshall_from_mar_cpg_address_t (&member_list[i],
+			&res_cpg_confchg_callback->member_list[i]);
+	}
+	left_list_start = res_cpg_confchg_callback->member_list +
+		res_cpg_confchg_callback->member_list_entries;
+	for (i = 0; i < res_cpg_confchg_callback->left_list_entries; i++) {
+		marshall_from_mar_cpg_address_t (&left_list[i],
+			&left_list_start[i]);
+	}
+	joined_list_start = res_cpg_confchg_callback->member_list +
+		res_cpg_confchg_callback->member_list_entries +
+		res_cpg_confchg_callback->left_list_entries;
+	for (i = 0; i < res_cpg_confchg_callback->joined_list_entries; i++) {
+		marshall_from_mar_cpg_address_t (&joined_list[i],
+			&joined_list_start[i]);
+	}
+	marshall_from_mar_cpg_name_t (
+		&group_name,
+		&res_cpg_confchg_callback->group_name);
+
+	model_v1_data->cpg_confchg_fn (handle,
+		&group_name,
+		member_list,
+		res_cpg_confchg_callback->member_list_entries,
+		left_list,
+		res_cpg_confchg_callback->left_list_entries,
+		joined_list,
+		res_cpg_confchg_callback->joined_list_entries);
+
+	/*
+	 * If member left while his partial packet was being assembled (or his idle
+	 * assembly buffer is kept in pool), assembly data must be removed
+	 */
+	for (i = 0; i < res_cpg_confchg_callback->left_list_entries; i++) {
+		assembly_data = cpg_assembly_find (cpg_inst, left_list[i].nodeid, left_list[i].pid);
+		if (assembly_data != NULL) {
+			cpg_assembly_destroy (cpg_inst, assembly_data);
+		}
+	}
+}
+
+static void cpg_dispatch_totem_confchg (
+	cpg_handle_t handle,
+	const cpg_model_v1_data_t *model_v1_data,
+	const struct res_lib_cpg_totem_confchg_callback *res_cpg_totem_confchg_callback)
+{
 	struct cpg_ring_id ring_id;
 	uint32_t totem_member_list[CPG_MEMBERS_MAX];
+	unsigned int i;
+
+	marshall_from_mar_cpg_ring_id_t (&ring_id, &res_cpg_totem_confchg_callback->ring_id);
+	for (i = 0; i < res_cpg_totem_confchg_callback->member_list_entries; i++) {
+		totem_member_list[i] = res_cpg_totem_confchg_callback->member_list[i];
+	}
+
+	model_v1_data->cpg_totem_confchg_fn (handle,
+		ring_id,
+		res_cpg_totem_confchg_callback->member_list_entries,
+		totem_member_list);
+}
+
+/*
+ * Add fragment to assembly of (nodeid, pid) message and deliver message
+ * when last fragment is received. Assembly is either contiguous buffer
+ * (reused for next message from the same sender) or list of fragment buffers
+ * delivered as iovec if deliver iov callback is set.
+ */
+static cs_error_t cpg_dispatch_partial (
+	cpg_handle_t handle,
+	struct cpg_inst *cpg_inst,
+	const cpg_model_v1_data_t *model_v1_data,
+	const struct cpg_name *group_name,
+	const struct res_lib_cpg_partial_deliver_callback *res_cpg_partial_deliver_callback)
+{
+	struct cpg_assembly_data *assembly_data;
+	struct cpg_assembly_frag *frag;
+	struct qb_list_head *iter;
+	struct iovec *iov;
+	unsigned int i;
+
+	assembly_data = cpg_assembly_find (cpg_inst,
+		res_cpg_partial_deliver_callback->nodeid,
+		res_cpg_partial_deliver_callback->pid);
+
+	if (res_cpg_partial_deliver_callback->type == LIBCPG_PARTIAL_FIRST) {
+		/*
+		 * Ongoing assembly means last fragment of previous message was never
+		 * sent (sender failed in the middle of message), so it is discarded
+		 */
+		if (assembly_data != NULL && assembly_data->in_progress) {
+			cpg_assembly_destroy (cpg_inst, assembly_data);
+			assembly_data = NULL;
+		}
+
+		assembly_data = cpg_assembly_start (cpg_inst, assembly_data,
+			res_cpg_partial_deliver_callback->nodeid,
+			res_cpg_partial_deliver_callback->pid,
+			res_cpg_partial_deliver_callback->msglen);
+		if (assembly_data == NULL) {
+			return (CS_ERR_NO_MEMORY);
+		}
+	}
+
+	if (assembly_data == NULL || !assembly_data->in_progress) {
+		/*
+		 * First fragment was not received (member joined during sending)
+		 */
+		return (CS_OK);
+	}
+
+	if (res_cpg_partial_deliver_callback->fraglen >
+	    assembly_data->msglen - assembly_data->assembly_buf_ptr) {
+		cpg_assembly_destroy (cpg_inst, assembly_data);
+		return (CS_ERR_MESSAGE_ERROR);
+	}
+
+	if (assembly_data->deliver_iov_fn != NULL) {
+		frag = cpg_assembly_frag_get (cpg_inst, res_cpg_partial_deliver_callback->fraglen);
+		if (frag == NULL) {
+			cpg_assembly_destroy (cpg_inst, assembly_data);
+			return (CS_ERR_NO_MEMORY);
+		}
+		memcpy (frag->buf, res_cpg_partial_deliver_callback->message,
+			res_cpg_partial_deliver_callback->fraglen);
+		frag->len = res_cpg_partial_deliver_callback->fraglen;
+		qb_list_add_tail (&frag->list, &assembly_data->frag_list_head);
+		assembly_data->frag_count++;
+	} else {
+		memcpy (assembly_data->assembly_buf + assembly_data->assembly_buf_ptr,
+			res_cpg_partial_deliver_callback->message,
+			res_cpg_partial_deliver_callback->fraglen);
+	}
+	assembly_data->assembly_buf_ptr += res_cpg_partial_deliver_callback->fraglen;
+
+	if (res_cpg_partial_deliver_callback->type != LIBCPG_PARTIAL_LAST) {
+		return (CS_OK);
+	}
+
+	/*
+	 * Some fragment of the message was lost
+	 */
+	if (assembly_data->assembly_buf_ptr != assembly_data->msglen) {
+		cpg_assembly_destroy (cpg_inst, assembly_data);
+		return (CS_ERR_MESSAGE_ERROR);
+	}
+
+	if (assembly_data->deliver_iov_fn != NULL) {
+		if (assembly_data->iov_size < assembly_data->frag_count) {
+			iov = realloc (assembly_data->iov, assembly_data->frag_count * sizeof (struct iovec));
+			if (iov == NULL) {
+				cpg_assembly_destroy (cpg_inst, assembly_data);
+				return (CS_ERR_NO_MEMORY);
+			}
+			assembly_data->iov = iov;
+			assembly_data->iov_size = assembly_data->frag_count;
+		}
+
+		i = 0;
+		qb_list_for_each(iter, &assembly_data->frag_list_head) {
+			frag = qb_list_entry (iter, struct cpg_assembly_frag, list);
+			assembly_data->iov[i].iov_base = frag->buf;
+			assembly_data->iov[i].iov_len = frag->len;
+			i++;
+		}
+
+		assembly_data->deliver_iov_fn (handle,
+			group_name,
+			res_cpg_partial_deliver_callback->nodeid,
+			res_cpg_partial_deliver_callback->pid,
+			assembly_data->iov,
+			assembly_data->frag_count,
+			assembly_data->msglen);
+	} else if (model_v1_data->cpg_deliver_fn != NULL) {
+		model_v1_data->cpg_deliver_fn (handle,
+			group_name,
+			res_cpg_partial_deliver_callback->nodeid,
+			res_cpg_partial_deliver_callback->pid,
+			assembly_data->assembly_buf,
+			assembly_data->msglen);
+	}
+
+	cpg_assembly_release (cpg_inst, assembly_data);
+
+	return (CS_OK);
+}
+
+/*
+ * Process one dispatch message. Message data are passed to deliver callback
+ * directly from receive buffer (without copying).
+ */
+static cs_error_t cpg_dispatch_event (
+	cpg_handle_t handle,
+	struct cpg_inst *cpg_inst,
+	const struct qb_ipc_response_header *dispatch_data)
+{
+	const struct res_lib_cpg_deliver_callback *res_cpg_deliver_callback;
+	const struct res_lib_cpg_partial_deliver_callback *res_cpg_partial_deliver_callback;
+	const struct res_lib_cpg_mcast_error *res_cpg_mcast_error;
+	cpg_model_v1_data_t model_v1_data;
+	struct cpg_name group_name;
+
+	/*
+	 * Make copy of callbacks, unlock instance, and call callback
+	 * A risk of this dispatch method is that the callback routines may
+	 * operate at the same time that cpgFinalize has been called.
+	 */
+	memcpy (&model_v1_data, &cpg_inst->model_v1_data, sizeof (cpg_model_v1_data_t));
+	switch (model_v1_data.model) {
+	case CPG_MODEL_V1:
+		/*
+		 * Dispatch incoming message
+		 */
+		switch (dispatch_data->id) {
+		case MESSAGE_RES_CPG_DELIVER_CALLBACK:
+			if (model_v1_data.cpg_deliver_fn == NULL) {
+				break;
+			}
+
+			res_cpg_deliver_callback = (const struct res_lib_cpg_deliver_callback *)dispatch_data;
+
+			marshall_from_mar_cpg_name_t (
+				&group_name,
+				&res_cpg_deliver_callback->group_name);
+
+			model_v1_data.cpg_deliver_fn (handle,
+				&group_name,
+				res_cpg_deliver_callback->nodeid,
+				res_cpg_deliver_callback->pid,
+				(void *)&res_cpg_deliver_callback->message,
+				res_cpg_deliver_callback->msglen);
+			break;
+
+		case MESSAGE_RES_CPG_PARTIAL_DELIVER_CALLBACK:
+			res_cpg_partial_deliver_callback = (const struct res_lib_cpg_partial_deliver_callback *)dispatch_data;
+
+			marshall_from_mar_cpg_name_t (
+				&group_name,
+				&res_cpg_partial_deliver_callback->group_name);
+
+			return (cpg_dispatch_partial (handle, cpg_inst, &model_v1_data,
+				&group_name, res_cpg_partial_deliver_callback));
+
+		case MESSAGE_RES_CPG_CONFCHG_CALLBACK:
+			if (model_v1_data.cpg_confchg_fn == NULL) {
+				break;
+			}
+
+			cpg_dispatch_confchg (handle, cpg_inst, &model_v1_data,
+				(const struct res_lib_cpg_confchg_callback *)dispatch_data);
+			break;
+		case MESSAGE_RES_CPG_TOTEM_CONFCHG_CALLBACK:
+			if (model_v1_data.cpg_totem_confchg_fn == NULL) {
+				break;
+			}
+
+			cpg_dispatch_totem_confchg (handle, &model_v1_data,
+				(const struct res_lib_cpg_totem_confchg_callback *)dispatch_data);
+			break;
+		case MESSAGE_RES_CPG_MCAST_ERROR:
+			res_cpg_mcast_error = (const struct res_lib_cpg_mcast_error *)dispatch_data;
+
+			cpg_inst->async_send_error = res_cpg_mcast_error->header.error;
+			cpg_inst->async_send_failed_msgs += res_cpg_mcast_error->msg_count;
+			break;
+		default:
+			return (CS_ERR_LIBRARY);
+			break;
+		} /* - switch (dispatch_data->id) */
+		break; /* case CPG_MODEL_V1 */
+	} /* - switch (model_v1_data.model) */
+
+	return (CS_OK);
+}
+
+cs_error_t cpg_dispatch (
+	cpg_handle_t handle,
+	cs_dispatch_flags_t dispatch_types)
+{
+	int timeout = -1;
+	cs_error_t error;
+	int cont = 1; /* always continue do loop except when set to 0 */
+	struct cpg_inst *cpg_inst;
+	struct qb_ipc_response_header *dispatch_data;
 	int32_t errno_res;
-	char dispatch_buf[IPC_DISPATCH_SIZE];
+	char *dispatch_buf;
 
 	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
 	if (error != CS_OK) {
 		return (error);
 	}
 
+	dispatch_buf = cpg_dispatch_buf_get (cpg_inst);
+	if (dispatch_buf == NULL) {
+		hdb_handle_put (&cpg_handle_t_db, handle);
+		return (CS_ERR_NO_MEMORY);
+	}
+
 	/*
 	 * Timeout instantly for CS_DISPATCH_ONE_NONBLOCKING or CS_DISPATCH_ALL and
 	 * wait indefinitely for CS_DISPATCH_ONE or CS_DISPATCH_BLOCKING
@@ -439,187 +1101,19 @@ cs_error_t cpg_dispatch (
 		}
 
 		/*
-		 * Make copy of callbacks, message data, unlock instance, and call callback
-		 * A risk of this dispatch method is that the callback routines may
-		 * operate at the same time that cpgFinalize has been called.
+		 * Corosync is processing messages, so let application try to send again
 		 */
-		memcpy (&cpg_inst_copy, cpg_inst, sizeof (struct cpg_inst));
-		switch (cpg_inst_copy.model_data.model) {
-		case CPG_MODEL_V1:
-			/*
-			 * Dispatch incoming message
-			 */
-			switch (dispatch_data->id) {
-			case MESSAGE_RES_CPG_DELIVER_CALLBACK:
-				if (cpg_inst_copy.model_v1_data.cpg_deliver_fn == NULL) {
-					break;
-				}
-
-				res_cpg_deliver_callback = (struct res_lib_cpg_deliver_callback *)dispatch_data;
-
-				marshall_from_mar_cpg_name_t (
-					&group_name,
-					&res_cpg_deliver_callback->group_name);
-
-				cpg_inst_copy.model_v1_data.cpg_deliver_fn (handle,
-					&group_name,
-					res_cpg_deliver_callback->nodeid,
-					res_cpg_deliver_callback->pid,
-					&res_cpg_deliver_callback->message,
-					res_cpg_deliver_callback->msglen);
-				break;
-
-			case MESSAGE_RES_CPG_PARTIAL_DELIVER_CALLBACK:
-				res_cpg_partial_deliver_callback = (struct res_lib_cpg_partial_deliver_callback *)dispatch_data;
-
-				marshall_from_mar_cpg_name_t (
-					&group_name,
-					&res_cpg_partial_deliver_callback->group_name);
-
-				/*
-				 * Search for assembly data for current messages (nodeid, pid) pair in list of assemblies
-				 */
-				assembly_data = NULL;
-				qb_list_for_each(iter, &(cpg_inst->assembly_list_head)) {
-					struct cpg_assembly_data *current_assembly_data = qb_list_entry (iter, struct cpg_assembly_data, list);
-					if (current_assembly_data->nodeid == res_cpg_partial_deliver_callback->nodeid && current_assembly_data->pid == res_cpg_partial_deliver_callback->pid) {
-						assembly_data = current_assembly_data;
-						break;
-					}
-				}
-
-				if (res_cpg_partial_deliver_callback->type == LIBCPG_PARTIAL_FIRST) {
-
-					/*
-					 * As this is LIBCPG_PARTIAL_FIRST packet, check that there is no ongoing assembly
-					 */
-					if (assembly_data) {
-						error = CS_ERR_MESSAGE_ERROR;
-						goto error_put;
-					}
-
-					assembly_data = malloc(sizeof(struct cpg_assembly_data));
-					if (!assembly_data) {
-						error = CS_ERR_NO_MEMORY;
-						goto error_put;
-					}
-
-					assembly_data->nodeid = res_cpg_partial_deliver_callback->nodeid;
-					assembly_data->pid = res_cpg_partial_deliver_callback->pid;
-					assembly_data->assembly_buf = malloc(res_cpg_partial_deliver_callback->msglen);
-					if (!assembly_data->assembly_buf) {
-						free(assembly_data);
-						error = CS_ERR_NO_MEMORY;
-						goto error_put;
-					}
-					assembly_data->assembly_buf_ptr = 0;
-					qb_list_init (&assembly_data->list);
-
-					qb_list_add (&assembly_data->list, &cpg_inst->assembly_list_head);
-				}
-				if (assembly_data) {
-					memcpy(assembly_data->assembly_buf + assembly_data->assembly_buf_ptr,
-						res_cpg_partial_deliver_callback->message, res_cpg_partial_deliver_callback->fraglen);
-					assembly_data->assembly_buf_ptr += res_cpg_partial_deliver_callback->fraglen;
-
-					if (res_cpg_partial_deliver_callback->type == LIBCPG_PARTIAL_LAST) {
-						cpg_inst_copy.model_v1_data.cpg_deliver_fn (handle,
-							&group_name,
-							res_cpg_partial_deliver_callback->nodeid,
-							res_cpg_partial_deliver_callback->pid,
-							assembly_data->assembly_buf,
-							res_cpg_partial_deliver_callback->msglen);
-
-						qb_list_del (&assembly_data->list);
-						free(assembly_data->assembly_buf);
-						free(assembly_data);
-					}
-				}
-				break;
+		cpg_inst->flow_control_state = CPG_FLOW_CONTROL_DISABLED;
 
-			case MESSAGE_RES_CPG_CONFCHG_CALLBACK:
-				if (cpg_inst_copy.model_v1_data.cpg_confchg_fn == NULL) {
-					break;
-				}
-
-				res_cpg_confchg_callback = (struct res_lib_cpg_confchg_callback *)dispatch_data;
-
-				for (i = 0; i < res_cpg_confchg_callback->member_list_entries; i++) {
-					marshall_from_mar_cpg_address_t (&member_list[i],
-						&res_cpg_confchg_callback->member_list[i]);
-				}
-				left_list_start = res_cpg_confchg_callback->member_list +
-					res_cpg_confchg_callback->member_list_entries;
-				for (i = 0; i < res_cpg_confchg_callback->left_list_entries; i++) {
-					marshall_from_mar_cpg_address_t (&left_list[i],
-						&left_list_start[i]);
-				}
-				joined_list_start = res_cpg_confchg_callback->member_list +
-					res_cpg_confchg_callback->member_list_entries +
-					res_cpg_confchg_callback->left_list_entries;
-				for (i = 0; i < res_cpg_confchg_callback->joined_list_entries; i++) {
-					marshall_from_mar_cpg_address_t (&joined_list[i],
-						&joined_list_start[i]);
-				}
-				marshall_from_mar_cpg_name_t (
-					&group_name,
-					&res_cpg_confchg_callback->group_name);
-
-				cpg_inst_copy.model_v1_data.cpg_confchg_fn (handle,
-					&group_name,
-					member_list,
-					res_cpg_confchg_callback->member_list_entries,
-					left_list,
-					res_cpg_confchg_callback->left_list_entries,
-					joined_list,
-					res_cpg_confchg_callback->joined_list_entries);
-
-				/*
-				 * If member left while his partial packet was being assembled, assembly data must be removed from list
-				 */
-				for (i = 0; i < res_cpg_confchg_callback->left_list_entries; i++) {
-					qb_list_for_each_safe(iter, tmp_iter, &(cpg_inst->assembly_list_head)) {
-						struct cpg_assembly_data *current_assembly_data = qb_list_entry (iter, struct cpg_assembly_data, list);
-						if (current_assembly_data->nodeid != left_list[i].nodeid || current_assembly_data->pid != left_list[i].pid)
-							continue;
-
-						qb_list_del (&current_assembly_data->list);
-						free(current_assembly_data->assembly_buf);
-						free(current_assembly_data);
-					}
-				}
-
-				break;
-			case MESSAGE_RES_CPG_TOTEM_CONFCHG_CALLBACK:
-				if (cpg_inst_copy.model_v1_data.cpg_totem_confchg_fn == NULL) {
-					break;
-				}
-
-				res_cpg_totem_confchg_callback = (struct res_lib_cpg_totem_confchg_callback *)dispatch_data;
-
-				marshall_from_mar_cpg_ring_id_t (&ring_id, &res_cpg_totem_confchg_callback->ring_id);
-				for (i = 0; i < res_cpg_totem_confchg_callback->member_list_entries; i++) {
-					totem_member_list[i] = res_cpg_totem_confchg_callback->member_list[i];
-				}
-
-				cpg_inst_copy.model_v1_data.cpg_totem_confchg_fn (handle,
-					ring_id,
-					res_cpg_totem_confchg_callback->member_list_entries,
-					totem_member_list);
-				break;
-			default:
-				error = CS_ERR_LIBRARY;
-				goto error_put;
-				break;
-			} /* - switch (dispatch_data->id) */
-			break; /* case CPG_MODEL_V1 */
-		} /* - switch (cpg_inst_copy.model_data.model) */
+		error = cpg_dispatch_event (handle, cpg_inst, dispatch_data);
+		if (error != CS_OK) {
+			goto error_put;
+		}
 
-		if (cpg_inst_copy.finalize || cpg_inst->finalize) {
+		if (cpg_inst->finalize) {
 			/*
 			 * If the finalize has been called then get out of the dispatch.
 			 */
-			cpg_inst->finalize = 1;
 			error = CS_ERR_BAD_HANDLE;
 			goto error_put;
 		}
@@ -633,7 +1127,76 @@ cs_error_t cpg_dispatch (
 	} while (cont);
 
 error_put:
+	cpg_dispatch_buf_put (cpg_inst, dispatch_buf);
+	hdb_handle_put (&cpg_handle_t_db, handle);
+	return (error);
+}
+
+cs_error_t cpg_dispatch_batch (
+	cpg_handle_t handle,
+	unsigned int max_events,
+	unsigned int *dispatched_events)
+{
+	cs_error_t error;
+	struct cpg_inst *cpg_inst;
+	struct qb_ipc_response_header *dispatch_data;
+	int32_t errno_res;
+	char *dispatch_buf;
+	unsigned int dispatched;
+
+	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	dispatch_buf = cpg_dispatch_buf_get (cpg_inst);
+	if (dispatch_buf == NULL) {
+		hdb_handle_put (&cpg_handle_t_db, handle);
+		return (CS_ERR_NO_MEMORY);
+	}
+
+	dispatch_data = (struct qb_ipc_response_header *)dispatch_buf;
+	dispatched = 0;
+
+	while (max_events == 0 || dispatched < max_events) {
+		errno_res = qb_ipcc_event_recv (
+			cpg_inst->c,
+			dispatch_buf,
+			IPC_DISPATCH_SIZE,
+			0);
+		error = qb_to_cs_error (errno_res);
+		if (error == CS_ERR_BAD_HANDLE || error == CS_ERR_TRY_AGAIN) {
+			error = CS_OK;
+			break;
+		}
+		if (error != CS_OK) {
+			break;
+		}
+
+		dispatched++;
+
+		error = cpg_dispatch_event (handle, cpg_inst, dispatch_data);
+		if (error != CS_OK) {
+			break;
+		}
+
+		if (cpg_inst->finalize) {
+			error = CS_ERR_BAD_HANDLE;
+			break;
+		}
+	}
+
+	if (dispatched > 0) {
+		cpg_inst->flow_control_state = CPG_FLOW_CONTROL_DISABLED;
+	}
+
+	if (dispatched_events != NULL) {
+		*dispatched_events = dispatched;
+	}
+
+	cpg_dispatch_buf_put (cpg_inst, dispatch_buf);
 	hdb_handle_put (&cpg_handle_t_db, handle);
+
 	return (error);
 }
 
@@ -641,6 +1204,15 @@ cs_error_t cpg_join (
     cpg_handle_t handle,
     const struct cpg_name *group)
 {
+
+	return (cpg_join_flags (handle, group, 0));
+}
+
+cs_error_t cpg_join_flags (
+    cpg_handle_t handle,
+    const struct cpg_name *group,
+    unsigned int flags)
+{
 	cs_error_t error;
 	struct cpg_inst *cpg_inst;
 	struct iovec iov[2];
@@ -651,6 +1223,10 @@ cs_error_t cpg_join (
 		return (CS_ERR_NAME_TOO_LONG);
 	}
 
+	if ((flags & ~(CPG_JOIN_FLAG_LOCAL_ONLY)) != 0) {
+		return (CS_ERR_INVALID_PARAM);
+	}
+
 	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
 	if (error != CS_OK) {
 		return (error);
@@ -658,7 +1234,12 @@ cs_error_t cpg_join (
 
 	/* Now join */
 	req_lib_cpg_join.header.size = sizeof (struct req_lib_cpg_join);
-	req_lib_cpg_join.header.id = MESSAGE_REQ_CPG_JOIN;
+	/*
+	 * Local only join uses its own request, so older corosync refuses it
+	 * (with CS_ERR_INVALID_PARAM) instead of joining cluster wide group
+	 */
+	req_lib_cpg_join.header.id = ((flags & CPG_JOIN_FLAG_LOCAL_ONLY) ?
+	    MESSAGE_REQ_CPG_JOIN_LOCAL_ONLY : MESSAGE_REQ_CPG_JOIN);
 	req_lib_cpg_join.pid = getpid();
 	req_lib_cpg_join.flags = 0;
 
@@ -848,7 +1429,7 @@ cs_error_t cpg_flow_control_state_get (
 	if (error != CS_OK) {
 		return (error);
 	}
-	*flow_control_state = CPG_FLOW_CONTROL_DISABLED;
+	*flow_control_state = cpg_inst->flow_control_state;
 	error = CS_OK;
 
 	hdb_handle_put (&cpg_handle_t_db, handle);
@@ -856,6 +1437,49 @@ cs_error_t cpg_flow_control_state_get (
 	return (error);
 }
 
+cs_error_t cpg_async_send_error_get (
+	cpg_handle_t handle,
+	cs_error_t *async_send_error,
+	uint32_t *failed_msgs)
+{
+	cs_error_t error;
+	struct cpg_inst *cpg_inst;
+
+	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	*async_send_error = cpg_inst->async_send_error;
+	*failed_msgs = cpg_inst->async_send_failed_msgs;
+
+	cpg_inst->async_send_error = CS_OK;
+	cpg_inst->async_send_failed_msgs = 0;
+
+	hdb_handle_put (&cpg_handle_t_db, handle);
+
+	return (error);
+}
+
+/*
+ * Remember result of async send for cpg_flow_control_state_get
+ */
+static void cpg_async_send_result_set (
+	struct cpg_inst *cpg_inst,
+	cs_error_t error)
+{
+
+	if (!(cpg_inst->model_v1_data.flags & CPG_MODEL_V1_ASYNC_SEND)) {
+		return ;
+	}
+
+	if (error == CS_ERR_TRY_AGAIN) {
+		cpg_inst->flow_control_state = CPG_FLOW_CONTROL_ENABLED;
+	} else if (error == CS_OK) {
+		cpg_inst->flow_control_state = CPG_FLOW_CONTROL_DISABLED;
+	}
+}
+
 static int
 memory_map (char *path, const char *file, void **buf, size_t bytes)
 {
@@ -937,6 +1561,113 @@ error_close_unlink:
 	return -1;
 }
 
+/*
+ * Map zero copy arena and make it known to corosync. Only one thread
+ * is allowed to do the initialization, other threads use old per buffer
+ * mapping until arena is ready.
+ */
+static int cpg_zc_arena_init (struct cpg_inst *cpg_inst)
+{
+	int state;
+	void *buf = NULL;
+	char path[PATH_MAX];
+	mar_req_coroipcc_zc_alloc_t req_coroipcc_zc_alloc;
+	struct qb_ipc_response_header res_coroipcs_zc_arena_map;
+	size_t map_size;
+	struct iovec iovec;
+	cs_error_t error;
+
+	state = CPG_ZC_ARENA_STATE_NONE;
+	if (!__atomic_compare_exchange_n (&cpg_inst->zc_arena_state, &state,
+	    CPG_ZC_ARENA_STATE_INITIALIZING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+		return (state == CPG_ZC_ARENA_STATE_READY ? 0 : -1);
+	}
+
+	map_size = CPG_ZC_ARENA_SLOTS * CPG_ZC_ARENA_SLOT_SIZE;
+	if (memory_map (path, "corosync_zerocopy-XXXXXX", &buf, map_size) == -1) {
+		goto error_exit;
+	}
+
+	if (strlen(path) >= CPG_ZC_PATH_LEN) {
+		goto error_unmap;
+	}
+
+	req_coroipcc_zc_alloc.header.size = sizeof (mar_req_coroipcc_zc_alloc_t);
+	req_coroipcc_zc_alloc.header.id = MESSAGE_REQ_CPG_ZC_ARENA_MAP;
+	req_coroipcc_zc_alloc.map_size = map_size;
+	strcpy (req_coroipcc_zc_alloc.path_to_file, path);
+
+	iovec.iov_base = (void *)&req_coroipcc_zc_alloc;
+	iovec.iov_len = sizeof (mar_req_coroipcc_zc_alloc_t);
+
+	error = coroipcc_msg_send_reply_receive (
+		cpg_inst->c,
+		&iovec,
+		1,
+		&res_coroipcs_zc_arena_map,
+		sizeof (struct qb_ipc_response_header));
+
+	if (error != CS_OK || res_coroipcs_zc_arena_map.error != CS_OK) {
+		goto error_unmap;
+	}
+
+	cpg_inst->zc_arena = buf;
+	__atomic_store_n (&cpg_inst->zc_arena_state, CPG_ZC_ARENA_STATE_READY, __ATOMIC_RELEASE);
+
+	return (0);
+
+error_unmap:
+	unlink (path);
+	munmap (buf, map_size);
+error_exit:
+	__atomic_store_n (&cpg_inst->zc_arena_state, CPG_ZC_ARENA_STATE_FAILED, __ATOMIC_RELEASE);
+
+	return (-1);
+}
+
+static int cpg_zc_arena_slot_alloc (struct cpg_inst *cpg_inst)
+{
+	uint64_t used_slots;
+	uint64_t new_used_slots;
+	int slot;
+
+	used_slots = __atomic_load_n (&cpg_inst->zc_arena_used_slots, __ATOMIC_RELAXED);
+
+	do {
+		if (~used_slots == 0) {
+			return (-1);
+		}
+
+		slot = __builtin_ctzll (~used_slots);
+		new_used_slots = used_slots | ((uint64_t)1 << slot);
+	} while (!__atomic_compare_exchange_n (&cpg_inst->zc_arena_used_slots, &used_slots,
+	    new_used_slots, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	return (slot);
+}
+
+static void cpg_zc_arena_slot_free (struct cpg_inst *cpg_inst, int slot)
+{
+
+	__atomic_fetch_and (&cpg_inst->zc_arena_used_slots, ~((uint64_t)1 << slot), __ATOMIC_RELEASE);
+}
+
+/*
+ * Returns slot number if header is part of arena, otherwise -1
+ */
+static int cpg_zc_arena_slot_get (struct cpg_inst *cpg_inst, const void *header)
+{
+	const char *addr = header;
+
+	if (__atomic_load_n (&cpg_inst->zc_arena_state, __ATOMIC_ACQUIRE) != CPG_ZC_ARENA_STATE_READY ||
+	    addr < cpg_inst->zc_arena ||
+	    addr >= cpg_inst->zc_arena + CPG_ZC_ARENA_SLOTS * CPG_ZC_ARENA_SLOT_SIZE) {
+		return (-1);
+	}
+
+	return ((addr - cpg_inst->zc_arena) / CPG_ZC_ARENA_SLOT_SIZE);
+}
+
 cs_error_t cpg_zcb_alloc (
 	cpg_handle_t handle,
 	size_t size,
@@ -951,6 +1682,7 @@ cs_error_t cpg_zcb_alloc (
 	struct coroipcs_zc_header *hdr;
 	cs_error_t error;
 	struct cpg_inst *cpg_inst;
+	int slot;
 
 	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
 	if (error != CS_OK) {
@@ -958,6 +1690,18 @@ cs_error_t cpg_zcb_alloc (
 	}
 
 	map_size = size + sizeof (struct req_lib_cpg_mcast) + sizeof (struct coroipcs_zc_header);
+
+	if (map_size <= CPG_ZC_ARENA_SLOT_SIZE && cpg_zc_arena_init (cpg_inst) == 0 &&
+	    (slot = cpg_zc_arena_slot_alloc (cpg_inst)) != -1) {
+		buf = cpg_inst->zc_arena + slot * CPG_ZC_ARENA_SLOT_SIZE;
+
+		hdr = (struct coroipcs_zc_header *)buf;
+		hdr->map_size = CPG_ZC_ARENA_SLOT_SIZE;
+		*buffer = ((char *)buf) + sizeof (struct coroipcs_zc_header) + sizeof (struct req_lib_cpg_mcast);
+
+		goto error_exit;
+	}
+
 	assert(memory_map (path, "corosync_zerocopy-XXXXXX", &buf, map_size) != -1);
 
 	if (strlen(path) >= CPG_ZC_PATH_LEN) {
@@ -1005,12 +1749,20 @@ cs_error_t cpg_zcb_free (
 	struct qb_ipc_response_header res_coroipcs_zc_free;
 	struct iovec iovec;
 	struct coroipcs_zc_header *header = (struct coroipcs_zc_header *)((char *)buffer - sizeof (struct coroipcs_zc_header) - sizeof (struct req_lib_cpg_mcast));
+	int slot;
 
 	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
 	if (error != CS_OK) {
 		return (error);
 	}
 
+	slot = cpg_zc_arena_slot_get (cpg_inst, header);
+	if (slot != -1) {
+		cpg_zc_arena_slot_free (cpg_inst, slot);
+
+		goto error_exit;
+	}
+
 	req_coroipcc_zc_free.header.size = sizeof (mar_req_coroipcc_zc_free_t);
 	req_coroipcc_zc_free.header.id = MESSAGE_REQ_CPG_ZC_FREE;
 	req_coroipcc_zc_free.map_size = header->map_size;
@@ -1054,8 +1806,10 @@ cs_error_t cpg_zcb_mcast_joined (
 	struct req_lib_cpg_mcast *req_lib_cpg_mcast;
 	struct res_lib_cpg_mcast res_lib_cpg_mcast;
 	mar_req_coroipcc_zc_execute_t req_coroipcc_zc_execute;
+	mar_req_coroipcc_zc_arena_execute_t req_coroipcc_zc_arena_execute;
 	struct coroipcs_zc_header *hdr;
 	struct iovec iovec;
+	int slot;
 
 	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
 	if (error != CS_OK) {
@@ -1077,12 +1831,30 @@ cs_error_t cpg_zcb_mcast_joined (
 
 	hdr = (struct coroipcs_zc_header *)(((char *)req_lib_cpg_mcast) - sizeof (struct coroipcs_zc_header));
 
-	req_coroipcc_zc_execute.header.size = sizeof (mar_req_coroipcc_zc_execute_t);
-	req_coroipcc_zc_execute.header.id = MESSAGE_REQ_CPG_ZC_EXECUTE;
-	req_coroipcc_zc_execute.server_address = hdr->server_address;
+	slot = cpg_zc_arena_slot_get (cpg_inst, hdr);
+	if (slot != -1) {
+		if ((char *)msg + msg_len > cpg_inst->zc_arena + (slot + 1) * CPG_ZC_ARENA_SLOT_SIZE) {
+			error = CS_ERR_TOO_BIG;
+			goto error_exit;
+		}
 
-	iovec.iov_base = (void *)&req_coroipcc_zc_execute;
-	iovec.iov_len = sizeof (mar_req_coroipcc_zc_execute_t);
+		/*
+		 * Arena is already mapped by corosync so only offset is needed
+		 */
+		req_coroipcc_zc_arena_execute.header.size = sizeof (mar_req_coroipcc_zc_arena_execute_t);
+		req_coroipcc_zc_arena_execute.header.id = MESSAGE_REQ_CPG_ZC_ARENA_EXECUTE;
+		req_coroipcc_zc_arena_execute.offset = (char *)req_lib_cpg_mcast - cpg_inst->zc_arena;
+
+		iovec.iov_base = (void *)&req_coroipcc_zc_arena_execute;
+		iovec.iov_len = sizeof (mar_req_coroipcc_zc_arena_execute_t);
+	} else {
+		req_coroipcc_zc_execute.header.size = sizeof (mar_req_coroipcc_zc_execute_t);
+		req_coroipcc_zc_execute.header.id = MESSAGE_REQ_CPG_ZC_EXECUTE;
+		req_coroipcc_zc_execute.server_address = hdr->server_address;
+
+		iovec.iov_base = (void *)&req_coroipcc_zc_execute;
+		iovec.iov_len = sizeof (mar_req_coroipcc_zc_execute_t);
+	}
 
 	error = coroipcc_msg_send_reply_receive (
 		cpg_inst->c,
@@ -1118,8 +1890,10 @@ static cs_error_t send_fragments (
 	size_t sent = 0;
 	size_t iov_sent = 0;
 	int retry_count;
+	int async_send = (cpg_inst->model_v1_data.flags & CPG_MODEL_V1_ASYNC_SEND);
 
-	req_lib_cpg_mcast.header.id = MESSAGE_REQ_CPG_PARTIAL_MCAST;
+	req_lib_cpg_mcast.header.id = (async_send ? MESSAGE_REQ_CPG_PARTIAL_MCAST_ASYNC :
+	    MESSAGE_REQ_CPG_PARTIAL_MCAST);
 	req_lib_cpg_mcast.guarantee = guarantee;
 	req_lib_cpg_mcast.msglen = msg_len;
 
@@ -1155,9 +1929,14 @@ static cs_error_t send_fragments (
 		iov[1].iov_base = (char *)iovec[i].iov_base + iov_sent;
 
 	resend:
-		error = coroipcc_msg_send_reply_receive (cpg_inst->c, iov, 2,
-							 &res_lib_cpg_partial_send,
-							 sizeof (res_lib_cpg_partial_send));
+		if (async_send) {
+			error = qb_to_cs_error(qb_ipcc_sendv(cpg_inst->c, iov, 2));
+			res_lib_cpg_partial_send.header.error = error;
+		} else {
+			error = coroipcc_msg_send_reply_receive (cpg_inst->c, iov, 2,
+								 &res_lib_cpg_partial_send,
+								 sizeof (res_lib_cpg_partial_send));
+		}
 
 		if (error == CS_ERR_TRY_AGAIN) {
 			fprintf(stderr, "sleep. counter=%d\n", retry_count);
@@ -1209,6 +1988,7 @@ cs_error_t cpg_mcast_joined (
 
 	if (msg_len > cpg_inst->max_msg_size) {
 		error = send_fragments(cpg_inst, guarantee, msg_len, iovec, iov_len);
+		cpg_async_send_result_set (cpg_inst, error);
 		goto error_exit;
 	}
 
@@ -1227,6 +2007,105 @@ cs_error_t cpg_mcast_joined (
 	error = qb_to_cs_error(qb_ipcc_sendv(cpg_inst->c, iov, iov_len + 1));
 	qb_ipcc_fc_enable_max_set(cpg_inst->c,  1);
 
+	cpg_async_send_result_set (cpg_inst, error);
+
+error_exit:
+	hdb_handle_put (&cpg_handle_t_db, handle);
+
+	return (error);
+}
+
+cs_error_t cpg_mcast_joined_batch (
+	cpg_handle_t handle,
+	cpg_guarantee_t guarantee,
+	const struct iovec *msgs,
+	unsigned int msg_count)
+{
+	static const char zero_padding[8];
+	unsigned int i;
+	cs_error_t error;
+	struct cpg_inst *cpg_inst;
+	struct iovec iov_static[1 + 3 * CPG_MCAST_BATCH_STATIC_MSGS];
+	struct iovec *iov;
+	unsigned int iov_len;
+	struct cpg_mcast_batch_entry entries_static[CPG_MCAST_BATCH_STATIC_MSGS];
+	struct cpg_mcast_batch_entry *entries;
+	struct req_lib_cpg_mcast_batch req_lib_cpg_mcast_batch;
+	size_t packed_len = 0;
+
+	if (msg_count == 0) {
+		return (CS_ERR_INVALID_PARAM);
+	}
+
+	for (i = 0; i < msg_count; i++) {
+		packed_len += CPG_MCAST_BATCH_ENTRY_SIZE(msgs[i].iov_len);
+	}
+
+	error = hdb_error_to_cs (hdb_handle_get (&cpg_handle_t_db, handle, (void *)&cpg_inst));
+	if (error != CS_OK) {
+		return (error);
+	}
+
+	if (packed_len > cpg_inst->max_msg_size) {
+		error = CS_ERR_TOO_BIG;
+		goto error_exit;
+	}
+
+	if (msg_count <= CPG_MCAST_BATCH_STATIC_MSGS) {
+		iov = iov_static;
+		entries = entries_static;
+	} else {
+		iov = malloc (sizeof (*iov) * (1 + 3 * msg_count));
+		entries = malloc (sizeof (*entries) * msg_count);
+		if (iov == NULL || entries == NULL) {
+			free (iov);
+			free (entries);
+			error = CS_ERR_NO_MEMORY;
+			goto error_exit;
+		}
+	}
+
+	req_lib_cpg_mcast_batch.header.size = sizeof (struct req_lib_cpg_mcast_batch) +
+		packed_len;
+	req_lib_cpg_mcast_batch.header.id = MESSAGE_REQ_CPG_MCAST_BATCH;
+	req_lib_cpg_mcast_batch.guarantee = guarantee;
+	req_lib_cpg_mcast_batch.msg_count = msg_count;
+
+	iov[0].iov_base = (void *)&req_lib_cpg_mcast_batch;
+	iov[0].iov_len = sizeof (struct req_lib_cpg_mcast_batch);
+	iov_len = 1;
+
+	for (i = 0; i < msg_count; i++) {
+		entries[i].msglen = msgs[i].iov_len;
+
+		iov[iov_len].iov_base = (void *)&entries[i];
+		iov[iov_len].iov_len = sizeof (struct cpg_mcast_batch_entry);
+		iov_len++;
+
+		if (msgs[i].iov_len > 0) {
+			iov[iov_len].iov_base = msgs[i].iov_base;
+			iov[iov_len].iov_len = msgs[i].iov_len;
+			iov_len++;
+		}
+
+		if (msgs[i].iov_len % 8 != 0) {
+			iov[iov_len].iov_base = (void *)zero_padding;
+			iov[iov_len].iov_len = 8 - msgs[i].iov_len % 8;
+			iov_len++;
+		}
+	}
+
+	qb_ipcc_fc_enable_max_set(cpg_inst->c,  2);
+	error = qb_to_cs_error(qb_ipcc_sendv(cpg_inst->c, iov, iov_len));
+	qb_ipcc_fc_enable_max_set(cpg_inst->c,  1);
+
+	cpg_async_send_result_set (cpg_inst, error);
+
+	if (iov != iov_static) {
+		free (iov);
+		free (entries);
+	}
+
 error_exit:
 	hdb_handle_put (&cpg_handle_t_db, handle);
 
@@ -52,6 +52,7 @@ enum qdevice_tool_operation {
 	QDEVICE_TOOL_OPERATION_NONE,
 	QDEVICE_TOOL_OPERATION_SHUTDOWN,
 	QDEVICE_TOOL_OPERATION_STATUS,
+	QDEVICE_TOOL_OPERATION_HEURISTICS_RESULT,
 };
 
 enum qdevice_tool_exit_code {
@@ -66,18 +67,20 @@ static void
 usage(void)
 {
 
-	printf("usage: %s [-Hhsv] [-p qdevice_ipc_socket_path]\n",
+	printf("usage: %s [-Hhsv] [-r exec_name=pass|fail] [-p qdevice_ipc_socket_path]\n",
 	    QDEVICE_TOOL_PROGRAM_NAME);
 }
 
 static void
 cli_parse(int argc, char * const argv[], enum qdevice_tool_operation *operation,
-    int *verbose, char **socket_path)
+    int *verbose, char **socket_path, char **heuristics_result)
 {
 	int ch;
+	char *ep;
 
 	*operation = QDEVICE_TOOL_OPERATION_NONE;
 	*verbose = 0;
+	*heuristics_result = NULL;
 	*socket_path = strdup(QDEVICE_DEFAULT_LOCAL_SOCKET_FILE);
 
 	if (*socket_path == NULL) {
@@ -85,7 +88,7 @@ cli_parse(int argc, char * const argv[], enum qdevice_tool_operation *operation,
 		    "Can't alloc memory for socket path string");
 	}
 
-	while ((ch = getopt(argc, argv, "Hhsvp:")) != -1) {
+	while ((ch = getopt(argc, argv, "Hhsvp:r:")) != -1) {
 		switch (ch) {
 		case 'H':
 			*operation = QDEVICE_TOOL_OPERATION_SHUTDOWN;
@@ -96,6 +99,27 @@ cli_parse(int argc, char * const argv[], enum qdevice_tool_operation *operation,
 		case 'v':
 			*verbose = 1;
 			break;
+		case 'r':
+			*operation = QDEVICE_TOOL_OPERATION_HEURISTICS_RESULT;
+			free(*heuristics_result);
+			*heuristics_result = strdup(optarg);
+			if (*heuristics_result == NULL) {
+				errx(QDEVICE_TOOL_EXIT_CODE_INTERNAL_ERROR,
+				    "Can't alloc memory for heuristics result string");
+			}
+
+			ep = strrchr(*heuristics_result, '=');
+			if (ep == NULL || ep == *heuristics_result ||
+			    (strcasecmp(ep + 1, "pass") != 0 && strcasecmp(ep + 1, "fail") != 0)) {
+				errx(QDEVICE_TOOL_EXIT_CODE_USAGE,
+				    "Heuristics result must be in exec_name=pass|fail format");
+			}
+
+			/*
+			 * Replace = by space so string can be passed to IPC as it is
+			 */
+			*ep = ' ';
+			break;
 		case 'p':
 			free(*socket_path);
 			*socket_path = strdup(optarg);
@@ -119,7 +143,8 @@ cli_parse(int argc, char * const argv[], enum qdevice_tool_operation *operation,
 }
 
 static int
-store_command(struct dynar *str, enum qdevice_tool_operation operation, int verbose)
+store_command(struct dynar *str, enum qdevice_tool_operation operation, int verbose,
+    const char *heuristics_result)
 {
 	const char *nline = "\n\0";
 	const int nline_len = 2;
@@ -138,6 +163,13 @@ store_command(struct dynar *str, enum qdevice_tool_operation operation, int verb
 			return (-1);
 		}
 		break;
+	case QDEVICE_TOOL_OPERATION_HEURISTICS_RESULT:
+		if (dynar_str_cat(str, "heuristics-result ") != 0 ||
+		    dynar_str_cat(str, heuristics_result) != 0 ||
+		    dynar_str_cat(str, " ") != 0) {
+			return (-1);
+		}
+		break;
 	}
 
 	if (verbose) {
@@ -222,6 +254,7 @@ main(int argc, char * const argv[])
 	enum qdevice_tool_operation operation;
 	int verbose;
 	char *socket_path;
+	char *heuristics_result;
 	int sock_fd;
 	FILE *sock;
 	struct dynar send_str;
@@ -230,7 +263,7 @@ main(int argc, char * const argv[])
 
 	exit_code = QDEVICE_TOOL_EXIT_CODE_NO_ERROR;
 
-	cli_parse(argc, argv, &operation, &verbose, &socket_path);
+	cli_parse(argc, argv, &operation, &verbose, &socket_path, &heuristics_result);
 
 	dynar_init(&send_str, QDEVICE_DEFAULT_IPC_MAX_RECEIVE_SIZE);
 
@@ -245,7 +278,7 @@ main(int argc, char * const argv[])
 		err(QDEVICE_TOOL_EXIT_CODE_INTERNAL_ERROR, "Can't open QDevice socket fd");
 	}
 
-	if (store_command(&send_str, operation, verbose) != 0) {
+	if (store_command(&send_str, operation, verbose, heuristics_result) != 0) {
 		errx(QDEVICE_TOOL_EXIT_CODE_INTERNAL_ERROR, "Can't store command");
 	}
 
@@ -275,6 +308,7 @@ main(int argc, char * const argv[])
 	}
 
 	free(socket_path);
+	free(heuristics_result);
 	dynar_destroy(&send_str);
 
 	return (exit_code);
@@ -0,0 +1,1051 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Load generator for corosync-qnetd. Simulates many qdevice-net clients
+ * (clusters x nodes) connected to a single (usually local) qnetd. Every client
+ * performs full init (optionally with TLS), sends config node list, periodic
+ * heartbeats (echo requests) and for every round a new membership node list.
+ * Odd rounds split every cluster into two halves, even rounds merge them back.
+ * Round is finished when every client receives final vote (directly in node list
+ * reply or later in vote info). Decision and heartbeat latency percentiles
+ * are reported together with CPU and memory usage of loadgen and (if pid is given)
+ * qnetd.
+ */
+
+#include <config.h>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include <err.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nss.h>
+#include <ssl.h>
+
+#include "qnet-config.h"
+
+#include "dynar.h"
+#include "msg.h"
+#include "msgio.h"
+#include "node-list.h"
+#include "nss-sock.h"
+#include "send-buffer-list.h"
+#include "tlv.h"
+#include "utils.h"
+
+#define LOADGEN_DEFAULT_HOST_ADDR		"localhost"
+#define LOADGEN_DEFAULT_CLUSTERS		100
+#define LOADGEN_DEFAULT_NODES			2
+#define LOADGEN_DEFAULT_ROUNDS			10
+#define LOADGEN_DEFAULT_HEARTBEAT_INTERVAL	(8*1000)
+#define LOADGEN_DEFAULT_ROUND_INTERVAL		0
+#define LOADGEN_DEFAULT_ROUND_TIMEOUT		(30*1000)
+#define LOADGEN_MAX_SEND_BUFFERS		32
+#define LOADGEN_CONNECT_POLL_INTERVAL		(100*1000)
+#define LOADGEN_CLUSTER_NAME_PREFIX		"loadgen"
+
+struct loadgen_options {
+	char *host_addr;
+	uint16_t host_port;
+	uint32_t clusters;
+	uint32_t nodes;
+	uint32_t rounds;
+	enum tlv_decision_algorithm_type algorithm;
+	int tls;
+	char *nss_db_dir;
+	uint32_t heartbeat_interval;
+	uint32_t round_interval;
+	uint32_t round_timeout;
+	pid_t qnetd_pid;
+};
+
+struct loadgen_client {
+	PRFileDesc *socket;
+	uint32_t cluster_no;
+	uint32_t node_id;
+	uint32_t msg_seq_num;
+	struct dynar receive_buffer;
+	size_t msg_already_received_bytes;
+	int skipping_msg;
+	struct send_buffer_list send_buffer_list;
+	struct tlv_ring_id ring_id;
+	uint32_t membership_msg_seq_num;
+	uint64_t membership_sent_time;
+	int decision_pending;
+	uint32_t echo_msg_seq_num;
+	uint64_t echo_sent_time;
+	uint64_t next_echo_time;
+};
+
+struct loadgen_latencies {
+	uint64_t *values;
+	size_t size;
+	size_t allocated;
+};
+
+struct loadgen_proc_usage {
+	uint64_t cpu_ms;
+	uint64_t rss_kb;
+};
+
+struct loadgen_instance {
+	struct loadgen_options options;
+	struct loadgen_client *clients;
+	size_t no_clients;
+	PRPollDesc *pfds;
+	struct node_list config_node_list;
+	struct node_list membership_node_list[2];
+	uint32_t round;
+	size_t decisions_pending;
+	struct loadgen_latencies decision_latencies;
+	struct loadgen_latencies echo_latencies;
+	uint64_t votes[TLV_VOTE_NO_CHANGE + 1];
+};
+
+static uint64_t
+loadgen_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static void
+usage(void)
+{
+
+	printf("usage: %s [-h] [-H host_addr] [-p port] [-c clusters] [-n nodes] [-r rounds]\n",
+	    QNETD_LOADGEN_PROGRAM_NAME);
+	printf("%*s [-a test|ffsplit|2nodelms|lms] [-t on|off] [-d nss_db_dir]\n",
+	    (int)strlen(QNETD_LOADGEN_PROGRAM_NAME), "");
+	printf("%*s [-b heartbeat_ms] [-i round_interval_ms] [-T round_timeout_ms] [-P qnetd_pid]\n",
+	    (int)strlen(QNETD_LOADGEN_PROGRAM_NAME), "");
+}
+
+static uint32_t
+cli_parse_uint32(const char *str, const char *opt_name, unsigned long long min_val,
+    unsigned long long max_val)
+{
+	unsigned long long tmpll;
+	char *ep;
+
+	errno = 0;
+	tmpll = strtoull(str, &ep, 10);
+	if (errno != 0 || *ep != '\0' || *str == '-' || tmpll < min_val || tmpll > max_val) {
+		errx(1, "%s must be in range %llu-%llu", opt_name, min_val, max_val);
+	}
+
+	return ((uint32_t)tmpll);
+}
+
+static void
+cli_parse(int argc, char * const argv[], struct loadgen_options *options)
+{
+	int ch;
+	int tmpi;
+
+	memset(options, 0, sizeof(*options));
+	options->host_addr = LOADGEN_DEFAULT_HOST_ADDR;
+	options->host_port = QNETD_DEFAULT_HOST_PORT;
+	options->clusters = LOADGEN_DEFAULT_CLUSTERS;
+	options->nodes = LOADGEN_DEFAULT_NODES;
+	options->rounds = LOADGEN_DEFAULT_ROUNDS;
+	options->algorithm = TLV_DECISION_ALGORITHM_TYPE_FFSPLIT;
+	options->tls = 0;
+	options->nss_db_dir = QDEVICE_NET_DEFAULT_NSS_DB_DIR;
+	options->heartbeat_interval = LOADGEN_DEFAULT_HEARTBEAT_INTERVAL;
+	options->round_interval = LOADGEN_DEFAULT_ROUND_INTERVAL;
+	options->round_timeout = LOADGEN_DEFAULT_ROUND_TIMEOUT;
+	options->qnetd_pid = 0;
+
+	while ((ch = getopt(argc, argv, "ha:b:c:d:H:i:n:p:P:r:t:T:")) != -1) {
+		switch (ch) {
+		case 'a':
+			if (strcmp(optarg, "test") == 0) {
+				options->algorithm = TLV_DECISION_ALGORITHM_TYPE_TEST;
+			} else if (strcmp(optarg, "ffsplit") == 0) {
+				options->algorithm = TLV_DECISION_ALGORITHM_TYPE_FFSPLIT;
+			} else if (strcmp(optarg, "2nodelms") == 0) {
+				options->algorithm = TLV_DECISION_ALGORITHM_TYPE_2NODELMS;
+			} else if (strcmp(optarg, "lms") == 0) {
+				options->algorithm = TLV_DECISION_ALGORITHM_TYPE_LMS;
+			} else {
+				errx(1, "algorithm must be one of test, ffsplit, 2nodelms, lms");
+			}
+			break;
+		case 'b':
+			options->heartbeat_interval = cli_parse_uint32(optarg, "heartbeat interval",
+			    QNETD_DEFAULT_HEARTBEAT_INTERVAL_MIN, QNETD_DEFAULT_HEARTBEAT_INTERVAL_MAX);
+			break;
+		case 'c':
+			options->clusters = cli_parse_uint32(optarg, "number of clusters", 1, 1000000);
+			break;
+		case 'd':
+			options->nss_db_dir = optarg;
+			break;
+		case 'H':
+			options->host_addr = optarg;
+			break;
+		case 'i':
+			options->round_interval = cli_parse_uint32(optarg, "round interval",
+			    0, UINT32_MAX);
+			break;
+		case 'n':
+			options->nodes = cli_parse_uint32(optarg, "number of nodes", 1, 1000);
+			break;
+		case 'p':
+			options->host_port = cli_parse_uint32(optarg, "host port", 1, 65535);
+			break;
+		case 'P':
+			options->qnetd_pid = cli_parse_uint32(optarg, "qnetd pid", 1, INT32_MAX);
+			break;
+		case 'r':
+			options->rounds = cli_parse_uint32(optarg, "number of rounds", 0, 1000000);
+			break;
+		case 't':
+			if ((tmpi = utils_parse_bool_str(optarg)) == -1) {
+				errx(1, "tls should be on/yes/1, off/no/0");
+			}
+			options->tls = tmpi;
+			break;
+		case 'T':
+			options->round_timeout = cli_parse_uint32(optarg, "round timeout",
+			    1, UINT32_MAX);
+			break;
+		case 'h':
+		case '?':
+			usage();
+			exit(1);
+			break;
+		}
+	}
+
+	if (optind != argc) {
+		usage();
+		exit(1);
+	}
+
+	if (options->algorithm == TLV_DECISION_ALGORITHM_TYPE_2NODELMS && options->nodes != 2) {
+		errx(1, "2nodelms algorithm requires exactly 2 nodes");
+	}
+}
+
+/*
+ * Return CPU time (user + system) and RSS of process pid. pid 0 means loadgen itself.
+ */
+static int
+loadgen_proc_usage_get(pid_t pid, struct loadgen_proc_usage *usage)
+{
+	char path[PATH_MAX];
+	char line[1024];
+	FILE *f;
+	char *p;
+	unsigned long utime, stime;
+	unsigned long long rss;
+	int res;
+
+	memset(usage, 0, sizeof(*usage));
+
+	if (pid == 0) {
+		pid = getpid();
+	}
+
+	snprintf(path, sizeof(path), "/proc/%ld/stat", (long)pid);
+	if ((f = fopen(path, "r")) == NULL) {
+		return (-1);
+	}
+
+	p = fgets(line, sizeof(line), f);
+	fclose(f);
+
+	/*
+	 * Command can contain spaces and parentheses so skip to last ')'. Utime and stime
+	 * are then 12th and 13th field.
+	 */
+	if (p == NULL || (p = strrchr(line, ')')) == NULL) {
+		return (-1);
+	}
+
+	res = sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+	    &utime, &stime);
+	if (res != 2) {
+		return (-1);
+	}
+
+	usage->cpu_ms = (uint64_t)(utime + stime) * 1000 / sysconf(_SC_CLK_TCK);
+
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	if ((f = fopen(path, "r")) == NULL) {
+		return (-1);
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "VmRSS: %llu", &rss) == 1) {
+			usage->rss_kb = rss;
+			break;
+		}
+	}
+
+	fclose(f);
+
+	return (0);
+}
+
+static void
+loadgen_latencies_add(struct loadgen_latencies *latencies, uint64_t value)
+{
+	uint64_t *new_values;
+	size_t new_allocated;
+
+	if (latencies->size >= latencies->allocated) {
+		new_allocated = (latencies->allocated == 0 ? 1024 : latencies->allocated * 2);
+
+		new_values = realloc(latencies->values, new_allocated * sizeof(*new_values));
+		if (new_values == NULL) {
+			errx(1, "Can't alloc memory for latencies");
+		}
+
+		latencies->values = new_values;
+		latencies->allocated = new_allocated;
+	}
+
+	latencies->values[latencies->size++] = value;
+}
+
+static int
+loadgen_latencies_cmp(const void *a, const void *b)
+{
+	uint64_t va, vb;
+
+	va = *(const uint64_t *)a;
+	vb = *(const uint64_t *)b;
+
+	return ((va > vb) - (va < vb));
+}
+
+static void
+loadgen_latencies_print(const char *name, struct loadgen_latencies *latencies)
+{
+	const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+	uint64_t sum;
+	size_t zi;
+	size_t index;
+
+	if (latencies->size == 0) {
+		printf("%s latency: no samples\n", name);
+		return ;
+	}
+
+	qsort(latencies->values, latencies->size, sizeof(*latencies->values),
+	    loadgen_latencies_cmp);
+
+	sum = 0;
+	for (zi = 0; zi < latencies->size; zi++) {
+		sum += latencies->values[zi];
+	}
+
+	printf("%s latency (us, %zu samples): avg %"PRIu64, name, latencies->size,
+	    sum / latencies->size);
+
+	for (zi = 0; zi < sizeof(percentiles) / sizeof(percentiles[0]); zi++) {
+		index = (size_t)(percentiles[zi] / 100.0 * (latencies->size - 1) + 0.5);
+		printf(", p%g %"PRIu64, percentiles[zi], latencies->values[index]);
+	}
+
+	printf(", max %"PRIu64"\n", latencies->values[latencies->size - 1]);
+}
+
+static struct dynar *
+loadgen_client_get_send_buffer(struct loadgen_client *client)
+{
+	struct send_buffer_list_entry *send_buffer;
+
+	send_buffer = send_buffer_list_get_new(&client->send_buffer_list);
+	if (send_buffer == NULL) {
+		errx(1, "Send buffer list of client %u/%u is full. Qnetd is not reading?",
+		    client->cluster_no, client->node_id);
+	}
+
+	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+
+	return (&send_buffer->buffer);
+}
+
+static void
+loadgen_client_send_blocking(struct loadgen_client *client, const struct dynar *msg)
+{
+
+	if (msgio_send_blocking(client->socket, dynar_data(msg), dynar_size(msg)) !=
+	    (ssize_t)dynar_size(msg)) {
+		errx(1, "Can't send message to qnetd (client %u/%u). Error %d",
+		    client->cluster_no, client->node_id, PR_GetError());
+	}
+}
+
+static void
+loadgen_client_read_blocking(struct loadgen_client *client, struct msg_decoded *msg,
+    enum msg_type expected_type)
+{
+	int res;
+
+	dynar_clean(&client->receive_buffer);
+	client->msg_already_received_bytes = 0;
+	client->skipping_msg = 0;
+
+	do {
+		res = msgio_read(client->socket, &client->receive_buffer,
+		    &client->msg_already_received_bytes, &client->skipping_msg);
+
+		if (res < 0) {
+			errx(1, "Can't receive message from qnetd (client %u/%u). Error %d",
+			    client->cluster_no, client->node_id, res);
+		}
+	} while (res != 1);
+
+	client->msg_already_received_bytes = 0;
+
+	if (client->skipping_msg) {
+		errx(1, "Received invalid message from qnetd (client %u/%u)",
+		    client->cluster_no, client->node_id);
+	}
+
+	msg_decoded_init(msg);
+
+	if (msg_decode(&client->receive_buffer, msg) != 0) {
+		errx(1, "Can't decode message from qnetd (client %u/%u)",
+		    client->cluster_no, client->node_id);
+	}
+
+	if (msg->type != expected_type) {
+		errx(1, "Received unexpected message %s instead of %s (client %u/%u). "
+		    "Error code %u", msg_type_to_str(msg->type), msg_type_to_str(expected_type),
+		    client->cluster_no, client->node_id,
+		    (msg->reply_error_code_set ? msg->reply_error_code : 0));
+	}
+
+	if (msg->reply_error_code_set &&
+	    msg->reply_error_code != TLV_REPLY_ERROR_CODE_NO_ERROR) {
+		errx(1, "Qnetd returned error code %u (client %u/%u)",
+		    msg->reply_error_code, client->cluster_no, client->node_id);
+	}
+}
+
+/*
+ * Connect client, do preinit, (optionally) starttls, init and send config node list.
+ * Communication is blocking, socket is switched to non-blocking mode at the end.
+ */
+static void
+loadgen_client_connect(struct loadgen_instance *instance, struct loadgen_client *client)
+{
+	struct dynar msg;
+	struct msg_decoded decoded_msg;
+	char cluster_name[64];
+	struct tlv_tie_breaker tie_breaker;
+	enum msg_type *supported_msgs;
+	size_t no_supported_msgs;
+	enum tlv_opt_type *supported_opts;
+	size_t no_supported_opts;
+	PRFileDesc *new_socket;
+	int tls_client_cert_required;
+
+	dynar_init(&msg, QDEVICE_NET_DEFAULT_MAX_MSG_RECEIVE_SIZE);
+
+	client->socket = nss_sock_create_client_socket(instance->options.host_addr,
+	    instance->options.host_port, PR_AF_UNSPEC, PR_INTERVAL_NO_TIMEOUT);
+	if (client->socket == NULL) {
+		errx(1, "Can't connect to qnetd (client %u/%u). Error %d",
+		    client->cluster_no, client->node_id, PR_GetError());
+	}
+
+	snprintf(cluster_name, sizeof(cluster_name), "%s%u", LOADGEN_CLUSTER_NAME_PREFIX,
+	    client->cluster_no);
+
+	if (msg_create_preinit(&msg, cluster_name, 1, client->msg_seq_num++) == 0) {
+		errx(1, "Can't create preinit message");
+	}
+	loadgen_client_send_blocking(client, &msg);
+
+	loadgen_client_read_blocking(client, &decoded_msg, MSG_TYPE_PREINIT_REPLY);
+	tls_client_cert_required = (decoded_msg.tls_client_cert_required_set &&
+	    decoded_msg.tls_client_cert_required);
+
+	if (instance->options.tls) {
+		if (!decoded_msg.tls_supported_set ||
+		    decoded_msg.tls_supported == TLV_TLS_UNSUPPORTED) {
+			errx(1, "Qnetd doesn't support TLS");
+		}
+	} else {
+		if (decoded_msg.tls_supported_set &&
+		    decoded_msg.tls_supported == TLV_TLS_REQUIRED) {
+			errx(1, "Qnetd requires TLS");
+		}
+	}
+	msg_decoded_destroy(&decoded_msg);
+
+	if (instance->options.tls) {
+		if (msg_create_starttls(&msg, 1, client->msg_seq_num++) == 0) {
+			errx(1, "Can't create starttls message");
+		}
+		loadgen_client_send_blocking(client, &msg);
+
+		new_socket = nss_sock_start_ssl_as_client(client->socket,
+		    QDEVICE_NET_DEFAULT_NSS_QNETD_CN, NULL,
+		    (tls_client_cert_required ? NSS_GetClientAuthData : NULL),
+		    (void *)QDEVICE_NET_DEFAULT_NSS_CLIENT_CERT_NICKNAME, 1, 1, 0, NULL);
+		if (new_socket == NULL) {
+			errx(1, "Can't start TLS (client %u/%u). Error %d",
+			    client->cluster_no, client->node_id, PR_GetError());
+		}
+		client->socket = new_socket;
+	}
+
+	msg_get_supported_messages(&supported_msgs, &no_supported_msgs);
+	tlv_get_supported_options(&supported_opts, &no_supported_opts);
+
+	memset(&tie_breaker, 0, sizeof(tie_breaker));
+	tie_breaker.mode = TLV_TIE_BREAKER_MODE_LOWEST;
+
+	if (msg_create_init(&msg, 1, client->msg_seq_num++, instance->options.algorithm,
+	    supported_msgs, no_supported_msgs, supported_opts, no_supported_opts,
+	    client->node_id, instance->options.heartbeat_interval, &tie_breaker,
+	    &client->ring_id) == 0) {
+		errx(1, "Can't create init message");
+	}
+	loadgen_client_send_blocking(client, &msg);
+
+	loadgen_client_read_blocking(client, &decoded_msg, MSG_TYPE_INIT_REPLY);
+	msg_decoded_destroy(&decoded_msg);
+
+	if (msg_create_node_list(&msg, client->msg_seq_num++, TLV_NODE_LIST_TYPE_INITIAL_CONFIG,
+	    0, NULL, 1, 1, 0, 0, 0, TLV_HEURISTICS_UNDEFINED,
+	    &instance->config_node_list) == 0) {
+		errx(1, "Can't create config node list message");
+	}
+	loadgen_client_send_blocking(client, &msg);
+
+	loadgen_client_read_blocking(client, &decoded_msg, MSG_TYPE_NODE_LIST_REPLY);
+	msg_decoded_destroy(&decoded_msg);
+
+	dynar_destroy(&msg);
+	dynar_clean(&client->receive_buffer);
+
+	if (nss_sock_set_non_blocking(client->socket) != 0) {
+		errx(1, "Can't set socket non-blocking");
+	}
+}
+
+static void
+loadgen_client_decision(struct loadgen_instance *instance, struct loadgen_client *client,
+    enum tlv_vote vote)
+{
+
+	if (!client->decision_pending) {
+		return ;
+	}
+
+	if (vote != TLV_VOTE_ACK && vote != TLV_VOTE_NACK && vote != TLV_VOTE_NO_CHANGE) {
+		return ;
+	}
+
+	loadgen_latencies_add(&instance->decision_latencies,
+	    loadgen_time_us() - client->membership_sent_time);
+	instance->votes[vote]++;
+	client->decision_pending = 0;
+	instance->decisions_pending--;
+}
+
+static void
+loadgen_client_msg_received(struct loadgen_instance *instance, struct loadgen_client *client)
+{
+	struct msg_decoded msg;
+
+	msg_decoded_init(&msg);
+
+	if (msg_decode(&client->receive_buffer, &msg) != 0) {
+		errx(1, "Can't decode message from qnetd (client %u/%u)",
+		    client->cluster_no, client->node_id);
+	}
+
+	switch (msg.type) {
+	case MSG_TYPE_ECHO_REPLY:
+		if (client->echo_sent_time != 0 && msg.seq_number == client->echo_msg_seq_num) {
+			loadgen_latencies_add(&instance->echo_latencies,
+			    loadgen_time_us() - client->echo_sent_time);
+			client->echo_sent_time = 0;
+		}
+		break;
+	case MSG_TYPE_NODE_LIST_REPLY:
+		if (msg.node_list_type == TLV_NODE_LIST_TYPE_MEMBERSHIP &&
+		    msg.seq_number == client->membership_msg_seq_num && msg.vote_set) {
+			loadgen_client_decision(instance, client, msg.vote);
+		}
+		break;
+	case MSG_TYPE_VOTE_INFO:
+		if (msg_create_vote_info_reply(loadgen_client_get_send_buffer(client),
+		    msg.seq_number) == 0) {
+			errx(1, "Can't create vote info reply message");
+		}
+
+		if (msg.ring_id_set && msg.vote_set &&
+		    tlv_ring_id_eq(&msg.ring_id, &client->ring_id)) {
+			loadgen_client_decision(instance, client, msg.vote);
+		}
+		break;
+	case MSG_TYPE_SERVER_ERROR:
+		errx(1, "Qnetd returned error code %u (client %u/%u)",
+		    (msg.reply_error_code_set ? msg.reply_error_code : 0),
+		    client->cluster_no, client->node_id);
+		break;
+	default:
+		/*
+		 * Other replies are not interesting
+		 */
+		break;
+	}
+
+	msg_decoded_destroy(&msg);
+}
+
+static void
+loadgen_client_read(struct loadgen_instance *instance, struct loadgen_client *client)
+{
+	int res;
+
+	while ((res = msgio_read(client->socket, &client->receive_buffer,
+	    &client->msg_already_received_bytes, &client->skipping_msg)) == 1) {
+		if (!client->skipping_msg) {
+			loadgen_client_msg_received(instance, client);
+		}
+
+		dynar_clean(&client->receive_buffer);
+		client->msg_already_received_bytes = 0;
+		client->skipping_msg = 0;
+	}
+
+	switch (res) {
+	case 0:
+		break;
+	case -1:
+		errx(1, "Qnetd closed connection (client %u/%u)", client->cluster_no,
+		    client->node_id);
+		break;
+	default:
+		errx(1, "Can't receive message from qnetd (client %u/%u). Error %d",
+		    client->cluster_no, client->node_id, res);
+		break;
+	}
+}
+
+static void
+loadgen_client_write(struct loadgen_client *client)
+{
+	struct send_buffer_list_entry *send_buffer;
+	int res;
+
+	res = msgio_write_list(client->socket, &client->send_buffer_list, MSGIO_MAX_IOV);
+	if (res < 0) {
+		errx(1, "Can't send message to qnetd (client %u/%u). Error %d",
+		    client->cluster_no, client->node_id, res);
+	}
+
+	while ((send_buffer = send_buffer_list_get_active(&client->send_buffer_list)) != NULL &&
+	    send_buffer->msg_already_sent_bytes == dynar_size(&send_buffer->buffer)) {
+		send_buffer_list_delete(&client->send_buffer_list, send_buffer);
+	}
+}
+
+static void
+loadgen_client_send_echo_request(struct loadgen_client *client, uint64_t now)
+{
+
+	client->echo_msg_seq_num = client->msg_seq_num++;
+
+	if (msg_create_echo_request(loadgen_client_get_send_buffer(client), 1,
+	    client->echo_msg_seq_num) == 0) {
+		errx(1, "Can't create echo request message");
+	}
+
+	client->echo_sent_time = now;
+}
+
+/*
+ * Send due heartbeats, wait (at most until deadline) for events on first no_clients
+ * clients and process them.
+ */
+static void
+loadgen_poll(struct loadgen_instance *instance, size_t no_clients, uint64_t deadline)
+{
+	struct loadgen_client *client;
+	uint64_t now;
+	uint64_t timeout;
+	PRInt32 poll_res;
+	size_t zi;
+
+	now = loadgen_time_us();
+	timeout = deadline;
+
+	for (zi = 0; zi < no_clients; zi++) {
+		client = &instance->clients[zi];
+
+		if (client->next_echo_time <= now) {
+			loadgen_client_send_echo_request(client, now);
+			client->next_echo_time = now +
+			    (uint64_t)instance->options.heartbeat_interval * 1000;
+		}
+
+		if (client->next_echo_time < timeout) {
+			timeout = client->next_echo_time;
+		}
+
+		instance->pfds[zi].fd = client->socket;
+		instance->pfds[zi].in_flags = PR_POLL_READ;
+		if (!send_buffer_list_empty(&client->send_buffer_list)) {
+			instance->pfds[zi].in_flags |= PR_POLL_WRITE;
+		}
+		instance->pfds[zi].out_flags = 0;
+	}
+
+	timeout = (timeout > now ? (timeout - now + 999) / 1000 : 0);
+
+	poll_res = PR_Poll(instance->pfds, no_clients, PR_MillisecondsToInterval(timeout));
+	if (poll_res < 0) {
+		errx(1, "Poll failed. Error %d", PR_GetError());
+	}
+
+	for (zi = 0; zi < no_clients && poll_res > 0; zi++) {
+		client = &instance->clients[zi];
+
+		if (instance->pfds[zi].out_flags & (PR_POLL_ERR | PR_POLL_NVAL | PR_POLL_HUP)) {
+			errx(1, "Qnetd connection error (client %u/%u)",
+			    client->cluster_no, client->node_id);
+		}
+
+		if (instance->pfds[zi].out_flags & PR_POLL_READ) {
+			loadgen_client_read(instance, client);
+		}
+
+		if (instance->pfds[zi].out_flags & PR_POLL_WRITE) {
+			loadgen_client_write(client);
+		}
+	}
+}
+
+/*
+ * Send membership node list for given round to every client. Odd rounds split each
+ * cluster into two halves (each with its own ring id), even rounds merge them back.
+ */
+static void
+loadgen_round_start(struct loadgen_instance *instance, uint32_t round)
+{
+	struct loadgen_client *client;
+	const struct node_list *nodes;
+	size_t zi;
+	int partition;
+	uint64_t now;
+
+	now = loadgen_time_us();
+
+	for (zi = 0; zi < instance->no_clients; zi++) {
+		client = &instance->clients[zi];
+
+		partition = (round % 2 == 1 && instance->options.nodes > 1 &&
+		    client->node_id > instance->options.nodes / 2);
+
+		client->ring_id.node_id = (partition ? instance->options.nodes / 2 + 1 : 1);
+		client->ring_id.seq = round + 2;
+
+		if (round % 2 == 1 && instance->options.nodes > 1) {
+			nodes = &instance->membership_node_list[partition];
+		} else {
+			nodes = &instance->config_node_list;
+		}
+
+		client->membership_msg_seq_num = client->msg_seq_num++;
+
+		if (msg_create_node_list(loadgen_client_get_send_buffer(client),
+		    client->membership_msg_seq_num, TLV_NODE_LIST_TYPE_MEMBERSHIP,
+		    1, &client->ring_id, 0, 0, 0, 0, 1, TLV_HEURISTICS_PASS, nodes) == 0) {
+			errx(1, "Can't create membership node list message");
+		}
+
+		client->membership_sent_time = now;
+		client->decision_pending = 1;
+	}
+
+	instance->decisions_pending = instance->no_clients;
+}
+
+static void
+loadgen_init_node_lists(struct loadgen_instance *instance)
+{
+	uint32_t node_id;
+	uint32_t nodes;
+
+	nodes = instance->options.nodes;
+
+	node_list_init(&instance->config_node_list);
+	node_list_init(&instance->membership_node_list[0]);
+	node_list_init(&instance->membership_node_list[1]);
+
+	for (node_id = 1; node_id <= nodes; node_id++) {
+		if (node_list_add(&instance->config_node_list, node_id, 0,
+		    TLV_NODE_STATE_NOT_SET) == NULL ||
+		    node_list_add(&instance->membership_node_list[node_id > nodes / 2], node_id, 0,
+		    TLV_NODE_STATE_MEMBER) == NULL) {
+			errx(1, "Can't alloc node list");
+		}
+	}
+}
+
+static void
+loadgen_set_nofile_limit(size_t no_clients)
+{
+	struct rlimit rlim;
+	rlim_t needed;
+
+	needed = no_clients + 64;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) != 0 || rlim.rlim_cur >= needed) {
+		return ;
+	}
+
+	rlim.rlim_cur = (rlim.rlim_max < needed ? rlim.rlim_max : needed);
+	if (setrlimit(RLIMIT_NOFILE, &rlim) != 0 || rlim.rlim_cur < needed) {
+		warnx("Can't raise open files limit to %llu, connecting may fail",
+		    (unsigned long long)needed);
+	}
+}
+
+static void
+loadgen_print_usage(const char *name, const struct loadgen_proc_usage *before,
+    const struct loadgen_proc_usage *after, size_t no_clients, size_t no_events)
+{
+
+	printf("%s: CPU %"PRIu64" ms (%.1f us/client", name, after->cpu_ms - before->cpu_ms,
+	    (double)(after->cpu_ms - before->cpu_ms) * 1000.0 / no_clients);
+	if (no_events > 0) {
+		printf(", %.1f us/decision", (double)(after->cpu_ms - before->cpu_ms) * 1000.0 /
+		    no_events);
+	}
+	printf("), RSS %"PRIu64" KiB\n", after->rss_kb);
+}
+
+int
+main(int argc, char * const argv[])
+{
+	struct loadgen_instance instance;
+	struct loadgen_client *client;
+	struct loadgen_proc_usage qnetd_usage[3], loadgen_usage[3];
+	uint64_t connect_start, last_poll, run_start, now, round_start, next_round_time;
+	uint32_t cluster_no, node_id;
+	size_t zi;
+	int round_in_progress;
+
+	memset(&instance, 0, sizeof(instance));
+	cli_parse(argc, argv, &instance.options);
+
+	instance.no_clients = (size_t)instance.options.clusters * instance.options.nodes;
+	instance.clients = calloc(instance.no_clients, sizeof(*instance.clients));
+	instance.pfds = calloc(instance.no_clients, sizeof(*instance.pfds));
+	if (instance.clients == NULL || instance.pfds == NULL) {
+		errx(1, "Can't alloc memory for clients");
+	}
+
+	loadgen_set_nofile_limit(instance.no_clients);
+	loadgen_init_node_lists(&instance);
+
+	if (instance.options.tls) {
+		if (nss_sock_init_nss(instance.options.nss_db_dir) != 0) {
+			errx(1, "Can't init nss (%d)", PR_GetError());
+		}
+	}
+
+	if (instance.options.qnetd_pid != 0 &&
+	    loadgen_proc_usage_get(instance.options.qnetd_pid, &qnetd_usage[0]) != 0) {
+		errx(1, "Can't get usage of qnetd process %ld", (long)instance.options.qnetd_pid);
+	}
+	loadgen_proc_usage_get(0, &loadgen_usage[0]);
+
+	printf("Connecting %zu clients (%u clusters x %u nodes), algorithm %s, TLS %s\n",
+	    instance.no_clients, instance.options.clusters, instance.options.nodes,
+	    tlv_decision_algorithm_type_to_str(instance.options.algorithm),
+	    (instance.options.tls ? "on" : "off"));
+
+	connect_start = loadgen_time_us();
+	last_poll = connect_start;
+
+	zi = 0;
+	for (cluster_no = 0; cluster_no < instance.options.clusters; cluster_no++) {
+		for (node_id = 1; node_id <= instance.options.nodes; node_id++) {
+			client = &instance.clients[zi++];
+
+			client->cluster_no = cluster_no;
+			client->node_id = node_id;
+			client->msg_seq_num = 1;
+			client->ring_id.node_id = 1;
+			client->ring_id.seq = 1;
+			dynar_init(&client->receive_buffer, QDEVICE_NET_DEFAULT_MAX_MSG_RECEIVE_SIZE);
+			send_buffer_list_init(&client->send_buffer_list, LOADGEN_MAX_SEND_BUFFERS,
+			    QDEVICE_NET_DEFAULT_MAX_MSG_RECEIVE_SIZE);
+
+			loadgen_client_connect(&instance, client);
+			client->next_echo_time = loadgen_time_us() +
+			    (uint64_t)instance.options.heartbeat_interval * 1000;
+
+			/*
+			 * Connecting many clients (especially with TLS) can take longer than
+			 * heartbeat interval so keep already connected clients alive
+			 */
+			now = loadgen_time_us();
+			if (now - last_poll >= LOADGEN_CONNECT_POLL_INTERVAL) {
+				loadgen_poll(&instance, zi, now);
+				last_poll = now;
+			}
+		}
+	}
+
+	now = loadgen_time_us();
+	printf("Connected in %.3f s (%.1f us/client)\n", (now - connect_start) / 1000000.0,
+	    (double)(now - connect_start) / instance.no_clients);
+
+	if (instance.options.qnetd_pid != 0) {
+		loadgen_proc_usage_get(instance.options.qnetd_pid, &qnetd_usage[1]);
+	}
+	loadgen_proc_usage_get(0, &loadgen_usage[1]);
+
+	/*
+	 * Heartbeats answered during connect phase are delayed by connecting of other clients
+	 */
+	instance.echo_latencies.size = 0;
+
+	run_start = now;
+	round_in_progress = 0;
+	round_start = 0;
+	next_round_time = run_start;
+
+	while (round_in_progress || instance.round < instance.options.rounds) {
+		now = loadgen_time_us();
+
+		if (!round_in_progress && now >= next_round_time) {
+			loadgen_round_start(&instance, instance.round);
+			round_in_progress = 1;
+			round_start = now;
+		}
+
+		if (round_in_progress &&
+		    now - round_start > (uint64_t)instance.options.round_timeout * 1000) {
+			errx(1, "Round %u timed out with %zu decisions pending", instance.round,
+			    instance.decisions_pending);
+		}
+
+		loadgen_poll(&instance, instance.no_clients, (round_in_progress ? round_start +
+		    (uint64_t)instance.options.round_timeout * 1000 : next_round_time));
+
+		if (round_in_progress && instance.decisions_pending == 0) {
+			round_in_progress = 0;
+			instance.round++;
+			next_round_time = loadgen_time_us() +
+			    (uint64_t)instance.options.round_interval * 1000;
+		}
+	}
+
+	now = loadgen_time_us();
+
+	if (instance.options.qnetd_pid != 0) {
+		loadgen_proc_usage_get(instance.options.qnetd_pid, &qnetd_usage[2]);
+	}
+	loadgen_proc_usage_get(0, &loadgen_usage[2]);
+
+	printf("Finished %u rounds in %.3f s (%.0f decisions/s)\n", instance.round,
+	    (now - run_start) / 1000000.0,
+	    (now > run_start ? instance.decision_latencies.size * 1000000.0 / (now - run_start) :
+	    0.0));
+	printf("Votes: ACK %"PRIu64", NACK %"PRIu64", NO_CHANGE %"PRIu64"\n",
+	    instance.votes[TLV_VOTE_ACK], instance.votes[TLV_VOTE_NACK],
+	    instance.votes[TLV_VOTE_NO_CHANGE]);
+	loadgen_latencies_print("Decision", &instance.decision_latencies);
+	loadgen_latencies_print("Heartbeat", &instance.echo_latencies);
+
+	if (instance.options.qnetd_pid != 0) {
+		loadgen_print_usage("Qnetd connect", &qnetd_usage[0], &qnetd_usage[1],
+		    instance.no_clients, 0);
+		loadgen_print_usage("Qnetd run", &qnetd_usage[1], &qnetd_usage[2],
+		    instance.no_clients, instance.decision_latencies.size);
+		printf("Qnetd memory: %.1f KiB/client\n",
+		    ((double)qnetd_usage[1].rss_kb - qnetd_usage[0].rss_kb) / instance.no_clients);
+	}
+
+	loadgen_print_usage("Loadgen connect", &loadgen_usage[0], &loadgen_usage[1],
+	    instance.no_clients, 0);
+	loadgen_print_usage("Loadgen run", &loadgen_usage[1], &loadgen_usage[2],
+	    instance.no_clients, instance.decision_latencies.size);
+
+	for (zi = 0; zi < instance.no_clients; zi++) {
+		client = &instance.clients[zi];
+
+		PR_Close(client->socket);
+		dynar_destroy(&client->receive_buffer);
+		send_buffer_list_free(&client->send_buffer_list);
+	}
+
+	node_list_free(&instance.config_node_list);
+	node_list_free(&instance.membership_node_list[0]);
+	node_list_free(&instance.membership_node_list[1]);
+	free(instance.decision_latencies.values);
+	free(instance.echo_latencies.values);
+	free(instance.clients);
+	free(instance.pfds);
+
+	if (instance.options.tls) {
+		SSL_ClearSessionCache();
+
+		if (NSS_Shutdown() != SECSuccess) {
+			warnx("Can't shutdown NSS");
+		}
+	}
+
+	PR_Cleanup();
+
+	return (0);
+}
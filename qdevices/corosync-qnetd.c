@@ -44,7 +44,7 @@
 #include "dynar-str.h"
 #include "dynar-getopt-lex.h"
 #include "nss-sock.h"
-#include "pr-poll-array.h"
+#include "pr-poll-set.h"
 #include "qnetd-advanced-settings.h"
 #include "qnetd-algorithm.h"
 #include "qnetd-instance.h"
@@ -53,6 +53,7 @@
 #include "qnetd-client-net.h"
 #include "qnetd-client-msg-received.h"
 #include "qnetd-poll-array-user-data.h"
+#include "qnetd-worker.h"
 #include "utils.h"
 #include "msg.h"
 
@@ -89,144 +90,133 @@ qnetd_warn_nss(void)
 	qnetd_log_nss(LOG_WARNING, "NSS warning");
 }
 
-static PRPollDesc *
-qnetd_pr_poll_array_create(struct qnetd_instance *instance)
+/*
+ * Recompute poll interest of clients whose state changed since last wait (new send
+ * buffer, scheduled disconnect). Other clients keep their registration untouched.
+ */
+static void
+qnetd_poll_update_changed_clients(struct qnetd_instance *instance)
 {
-	struct pr_poll_array *poll_array;
-	const struct qnetd_client_list *client_list;
 	struct qnetd_client *client;
-	PRPollDesc *poll_desc;
-	struct qnetd_poll_array_user_data *user_data;
-	const struct unix_socket_client_list *ipc_client_list;
-	struct unix_socket_client *ipc_client;
-
-	poll_array = &instance->poll_array;
-	client_list = &instance->clients;
-	ipc_client_list = &instance->local_ipc.clients;
-
-	pr_poll_array_clean(poll_array);
-
-	if (pr_poll_array_add(poll_array, &poll_desc, (void **)&user_data) < 0) {
-		return (NULL);
-	}
-
-	poll_desc->fd = instance->server.socket;
-	poll_desc->in_flags = PR_POLL_READ;
-
-	user_data->type = QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET;
+	PRInt16 in_flags;
 
-	if (qnetd_ipc_is_closed(instance)) {
-		qnetd_log(LOG_DEBUG, "Listening socket is closed");
-
-		return (NULL);
-	}
-
-	if (pr_poll_array_add(poll_array, &poll_desc, (void **)&user_data) < 0) {
-		return (NULL);
-	}
+	while ((client = TAILQ_FIRST(&instance->poll_changed_clients)) != NULL) {
+		TAILQ_REMOVE(&instance->poll_changed_clients, client, poll_changed_entries);
+		client->poll_changed = 0;
 
-	poll_desc->fd = instance->ipc_socket_poll_fd;
-	poll_desc->in_flags = PR_POLL_READ;
-	user_data->type = QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_SOCKET;
-
-	TAILQ_FOREACH(client, client_list, entries) {
-		if (pr_poll_array_add(poll_array, &poll_desc, (void **)&user_data) < 0) {
-			return (NULL);
-		}
-		poll_desc->fd = client->socket;
-		poll_desc->in_flags = PR_POLL_READ;
-
-		if (!send_buffer_list_empty(&client->send_buffer_list)) {
-			poll_desc->in_flags |= PR_POLL_WRITE;
-		}
+		if (client->schedule_disconnect) {
+			qnetd_instance_client_disconnect(instance, client, 0);
 
-		user_data->type = QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT;
-		user_data->client = client;
-	}
-
-	TAILQ_FOREACH(ipc_client, ipc_client_list, entries) {
-		if (!ipc_client->reading_line && !ipc_client->writing_buffer) {
 			continue;
 		}
 
-		if (pr_poll_array_add(poll_array, &poll_desc, (void **)&user_data) < 0) {
-			return (NULL);
-		}
+		in_flags = PR_POLL_READ;
 
-		poll_desc->fd = ((struct qnetd_ipc_user_data *)ipc_client->user_data)->nspr_poll_fd;
-		if (ipc_client->reading_line) {
-			poll_desc->in_flags |= PR_POLL_READ;
+		if (!send_buffer_list_empty(&client->send_buffer_list)) {
+			in_flags |= PR_POLL_WRITE;
 		}
 
-		if (ipc_client->writing_buffer) {
-			poll_desc->in_flags |= PR_POLL_WRITE;
-		}
+		if (pr_poll_set_update(&instance->poll_set, &client->poll_entry, client->socket,
+		    in_flags) != 0) {
+			qnetd_log_err(LOG_ERR, "Can't update client poll set entry. "
+			    "Disconnecting client");
 
-		user_data->type = QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT;
-		user_data->ipc_client = ipc_client;
+			qnetd_instance_client_disconnect(instance, client, 0);
+		}
 	}
-
-	pr_poll_array_gc(poll_array);
-
-	return (poll_array->array);
 }
 
 static int
 qnetd_poll(struct qnetd_instance *instance)
 {
 	struct qnetd_client *client;
-	PRPollDesc *pfds;
-	PRInt32 poll_res;
+	struct pr_poll_set_entry *poll_entry;
+	ssize_t poll_res;
 	ssize_t i;
+	PRInt16 out_flags;
 	int client_disconnect;
-	struct qnetd_poll_array_user_data *user_data;
+	int res;
 	struct unix_socket_client *ipc_client;
 
 	client = NULL;
 	client_disconnect = 0;
 
-	pfds = qnetd_pr_poll_array_create(instance);
-	if (pfds == NULL) {
+	if (instance->worker != NULL) {
+		if (instance->worker->quit) {
+			return (-1);
+		}
+	} else if (qnetd_ipc_is_closed(instance)) {
+		qnetd_log(LOG_DEBUG, "Listening socket is closed");
+
 		return (-1);
 	}
 
-	if ((poll_res = PR_Poll(pfds, pr_poll_array_size(&instance->poll_array),
-	    timer_list_time_to_expire(&instance->main_timer_list))) >= 0) {
+	qnetd_poll_update_changed_clients(instance);
+
+	/*
+	 * Worker holds its mutex all the time except when waiting
+	 */
+	if (instance->worker != NULL) {
+		pthread_mutex_unlock(&instance->worker->mutex);
+	}
+
+	poll_res = pr_poll_set_wait(&instance->poll_set,
+	    timer_list_time_to_expire(&instance->main_timer_list));
+
+	if (instance->worker != NULL) {
+		pthread_mutex_lock(&instance->worker->mutex);
+	}
+
+	if (poll_res >= 0) {
 		timer_list_expire(&instance->main_timer_list);
 
 		/*
-		 * Walk thru pfds array and process events
+		 * Walk thru ready entries and process events
 		 */
-		for (i = 0; i < pr_poll_array_size(&instance->poll_array); i++) {
-			user_data = pr_poll_array_get_user_data(&instance->poll_array, i);
+		for (i = 0; i < poll_res; i++) {
+			poll_entry = pr_poll_set_get_result(&instance->poll_set, i, &out_flags);
+			if (poll_entry == NULL) {
+				/*
+				 * Entry was deleted when processing previous event
+				 */
+				continue;
+			}
 
 			client = NULL;
 			ipc_client = NULL;
 			client_disconnect = 0;
 
-			switch (user_data->type) {
+			switch (poll_entry->type) {
 			case QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET:
 				break;
 			case QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT:
-				client = user_data->client;
+				client = poll_entry->user_data;
 				client_disconnect = client->schedule_disconnect;
 				break;
 			case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_SOCKET:
 				break;
 			case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT:
-				ipc_client = user_data->ipc_client;
+				ipc_client = poll_entry->user_data;
 				client_disconnect = ipc_client->schedule_disconnect;
+				break;
+			case QNETD_POLL_ARRAY_USER_DATA_TYPE_WORKER_WAKEUP:
+				break;
 			}
 
-			if (!client_disconnect && poll_res > 0 &&
-			    pfds[i].out_flags & PR_POLL_READ) {
-				switch (user_data->type) {
+			if (!client_disconnect && out_flags & PR_POLL_READ) {
+				switch (poll_entry->type) {
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET:
 					qnetd_client_net_accept(instance);
 					break;
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT:
-					if (qnetd_client_net_read(instance, client) == -1) {
+					res = qnetd_client_net_read(instance, client);
+					if (res == -1) {
 						client_disconnect = 1;
+					} else if (res == 1) {
+						/*
+						 * Client was handed off to worker
+						 */
+						continue;
 					}
 					break;
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_SOCKET:
@@ -235,12 +225,14 @@ qnetd_poll(struct qnetd_instance *instance)
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT:
 					qnetd_ipc_io_read(instance, ipc_client);
 					break;
+				case QNETD_POLL_ARRAY_USER_DATA_TYPE_WORKER_WAKEUP:
+					qnetd_worker_handoff_process(instance->worker);
+					break;
 				}
 			}
 
-			if (!client_disconnect && poll_res > 0 &&
-			    pfds[i].out_flags & PR_POLL_WRITE) {
-				switch (user_data->type) {
+			if (!client_disconnect && out_flags & PR_POLL_WRITE) {
+				switch (poll_entry->type) {
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET:
 					/*
 					 * Poll write on listen socket -> fatal error
@@ -261,22 +253,32 @@ qnetd_poll(struct qnetd_instance *instance)
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT:
 					qnetd_ipc_io_write(instance, ipc_client);
 					break;
+				case QNETD_POLL_ARRAY_USER_DATA_TYPE_WORKER_WAKEUP:
+					qnetd_log(LOG_CRIT, "POLL_WRITE on worker wakeup pipe");
+					return (-1);
+					break;
 				}
 			}
 
-			if (!client_disconnect && poll_res > 0 &&
-			    (pfds[i].out_flags & (PR_POLL_ERR|PR_POLL_NVAL|PR_POLL_HUP|PR_POLL_EXCEPT)) &&
-			    !(pfds[i].out_flags & (PR_POLL_READ|PR_POLL_WRITE))) {
-				switch (user_data->type) {
+			if (!client_disconnect &&
+			    (out_flags & (PR_POLL_ERR|PR_POLL_NVAL|PR_POLL_HUP|PR_POLL_EXCEPT)) &&
+			    !(out_flags & (PR_POLL_READ|PR_POLL_WRITE))) {
+				switch (poll_entry->type) {
+				case QNETD_POLL_ARRAY_USER_DATA_TYPE_WORKER_WAKEUP:
+					qnetd_log(LOG_CRIT, "POLL_ERR (%u) on worker wakeup pipe",
+					    out_flags);
+
+					return (-1);
+					break;
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET:
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_SOCKET:
-					if (pfds[i].out_flags != PR_POLL_NVAL) {
+					if (out_flags != PR_POLL_NVAL) {
 						/*
 						 * Poll ERR on listening socket is fatal error.
 						 * POLL_NVAL is used as a signal to quit poll loop.
 						 */
 						 qnetd_log(LOG_CRIT, "POLL_ERR (%u) on listening "
-						    "socket", pfds[i].out_flags);
+						    "socket", out_flags);
 					} else {
 						qnetd_log(LOG_DEBUG, "Listening socket is closed");
 					}
@@ -285,13 +287,13 @@ qnetd_poll(struct qnetd_instance *instance)
 					break;
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT:
 					qnetd_log(LOG_DEBUG, "POLL_ERR (%u) on client socket. "
-					    "Disconnecting.", pfds[i].out_flags);
+					    "Disconnecting.", out_flags);
 
 					client_disconnect = 1;
 					break;
 				case QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT:
 					qnetd_log(LOG_DEBUG, "POLL_ERR (%u) on ipc client socket."
-					    " Disconnecting.", pfds[i].out_flags);
+					    " Disconnecting.", out_flags);
 
 					client_disconnect = 1;
 					break;
@@ -299,14 +301,25 @@ qnetd_poll(struct qnetd_instance *instance)
 			}
 
 			/*
-			 * If client is scheduled for disconnect, disconnect it
+			 * If client is scheduled for disconnect, disconnect it. Otherwise
+			 * I/O may have changed state of client (or its NSPR layer) so poll
+			 * interest has to be recomputed.
 			 */
-			if (user_data->type == QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT &&
-			    client_disconnect) {
-				qnetd_instance_client_disconnect(instance, client, 0);
-			} else if (user_data->type == QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT &&
-			    (client_disconnect || ipc_client->schedule_disconnect)) {
-				qnetd_ipc_client_disconnect(instance, ipc_client);
+			if (poll_entry->type == QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT) {
+				if (client_disconnect) {
+					qnetd_instance_client_disconnect(instance, client, 0);
+				} else {
+					qnetd_client_poll_changed(client);
+				}
+			} else if (poll_entry->type == QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT) {
+				if (client_disconnect || ipc_client->schedule_disconnect) {
+					qnetd_ipc_client_disconnect(instance, ipc_client);
+				} else if (qnetd_ipc_poll_update(instance, ipc_client) != 0) {
+					qnetd_log_err(LOG_ERR, "Can't update IPC client poll set "
+					    "entry. Disconnecting client");
+
+					qnetd_ipc_client_disconnect(instance, ipc_client);
+				}
 			}
 		}
 	}
@@ -315,6 +328,28 @@ qnetd_poll(struct qnetd_instance *instance)
 	return (0);
 }
 
+static void *
+qnetd_worker_thread(void *arg)
+{
+	struct qnetd_worker *worker;
+
+	worker = (struct qnetd_worker *)arg;
+
+	pthread_mutex_lock(&worker->mutex);
+
+	while (qnetd_poll(&worker->instance) == 0) {
+	}
+
+	if (!worker->quit) {
+		qnetd_log(LOG_CRIT, "Worker thread main loop failed");
+		exit(1);
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+
+	return (NULL);
+}
+
 static void
 signal_int_handler(int sig)
 {
@@ -518,6 +553,7 @@ int
 main(int argc, char * const argv[])
 {
 	struct qnetd_instance instance;
+	struct qnetd_worker_pool worker_pool;
 	struct qnetd_advanced_settings advanced_settings;
 	char *host_addr;
 	uint16_t host_port;
@@ -538,6 +574,10 @@ main(int argc, char * const argv[])
 	cli_parse(argc, argv, &host_addr, &host_port, &foreground, &debug_log, &bump_log_priority,
 	    &tls_supported, &client_cert_required, &max_clients, &address_family, &advanced_settings);
 
+	if (advanced_settings.handshake_threads > 0 && advanced_settings.worker_threads == 0) {
+		errx(1, "handshake_threads requires worker_threads");
+	}
+
 	if (foreground) {
 		qnetd_log_init(QNETD_LOG_TARGET_STDERR);
 	} else {
@@ -571,7 +611,8 @@ main(int argc, char * const argv[])
 		qnetd_err_nss();
 	}
 
-	if (SSL_ConfigServerSessionIDCache(0, 0, 0, NULL) != SECSuccess) {
+	if (SSL_ConfigServerSessionIDCache(advanced_settings.tls_session_cache_size, 0,
+	    advanced_settings.tls_session_timeout, NULL) != SECSuccess) {
 		qnetd_err_nss();
 	}
 
@@ -608,6 +649,13 @@ main(int argc, char * const argv[])
 		qnetd_err_nss();
 	}
 
+	if (pr_poll_set_add(&instance.poll_set, &instance.server_poll_entry,
+	    instance.server.socket, PR_POLL_READ, QNETD_POLL_ARRAY_USER_DATA_TYPE_SOCKET,
+	    NULL) != 0) {
+		qnetd_log_err(LOG_ERR, "Can't add listening socket to poll set");
+		exit(1);
+	}
+
 	global_instance = &instance;
 	signal_handlers_register();
 
@@ -616,6 +664,18 @@ main(int argc, char * const argv[])
 		exit(1);
 	}
 
+	if (advanced_settings.worker_threads > 0) {
+		qnetd_log(LOG_DEBUG, "Starting %zu worker and %zu handshake threads",
+		    advanced_settings.worker_threads, advanced_settings.handshake_threads);
+
+		if (qnetd_worker_pool_init(&worker_pool, &instance, advanced_settings.worker_threads,
+		    advanced_settings.handshake_threads) != 0 ||
+		    qnetd_worker_pool_start(&worker_pool, qnetd_worker_thread) != 0) {
+			qnetd_log(LOG_ERR, "Can't initialize worker threads");
+			exit(1);
+		}
+	}
+
 	qnetd_log(LOG_DEBUG, "QNetd ready to provide service");
 
 #ifdef HAVE_LIBSYSTEMD
@@ -631,8 +691,15 @@ main(int argc, char * const argv[])
 	/*
 	 * Cleanup
 	 */
+	if (instance.worker_pool != NULL) {
+		qnetd_worker_pool_stop(&worker_pool);
+		qnetd_worker_pool_destroy(&worker_pool);
+		instance.worker_pool = NULL;
+	}
+
 	qnetd_ipc_destroy(&instance);
 
+	pr_poll_set_del(&instance.poll_set, &instance.server_poll_entry);
 	if (PR_Close(instance.server.socket) != PR_SUCCESS) {
 		qnetd_warn_nss();
 	}
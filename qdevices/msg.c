@@ -528,9 +528,42 @@ msg_create_node_list(struct dynar *msg,
 {
 	struct node_list_entry *node_info;
 	struct tlv_node_info tlv_ni;
+	size_t msg_size;
 
 	dynar_clean(msg);
 
+	/*
+	 * Compute message size first and allocate buffer at once, so it is not
+	 * reallocated for every added node info option
+	 */
+	msg_size = MSG_TYPE_LENGTH + MSG_LENGTH_LENGTH + tlv_get_opt_size(sizeof(uint32_t)) +
+	    tlv_get_opt_size(sizeof(uint8_t));
+
+	if (add_ring_id) {
+		msg_size += tlv_get_opt_size(sizeof(uint32_t) + sizeof(uint64_t));
+	}
+
+	if (add_config_version) {
+		msg_size += tlv_get_opt_size(sizeof(uint64_t));
+	}
+
+	if (add_quorate) {
+		msg_size += tlv_get_opt_size(sizeof(uint8_t));
+	}
+
+	TAILQ_FOREACH(node_info, nodes, entries) {
+		node_list_entry_to_tlv_node_info(node_info, &tlv_ni);
+		msg_size += tlv_get_node_info_size(&tlv_ni);
+	}
+
+	if (add_heuristics && heuristics != TLV_HEURISTICS_UNDEFINED) {
+		msg_size += tlv_get_opt_size(sizeof(uint8_t));
+	}
+
+	if (dynar_prealloc(msg, msg_size) == -1) {
+		goto small_buf_err;
+	}
+
 	msg_add_type(msg, MSG_TYPE_NODE_LIST);
 	msg_add_len(msg);
 
@@ -37,6 +37,10 @@
 
 #define MSGIO_LOCAL_BUF_SIZE			(1 << 10)
 
+#if MSGIO_MAX_IOV > PR_MAX_IOVECTOR_SIZE
+#error MSGIO_MAX_IOV must not be larger than PR_MAX_IOVECTOR_SIZE
+#endif
+
 ssize_t
 msgio_send(PRFileDesc *sock, const char *msg, size_t msg_len, size_t *start_pos)
 {
@@ -128,6 +132,88 @@ msgio_write(PRFileDesc *sock, const struct dynar *msg, size_t *already_sent_byte
 	return (0);
 }
 
+/*
+ * Send as many messages (at most max_msgs, but no more than MSGIO_MAX_IOV) queued in
+ * sblist as possible by single (scatter-gather) write. msg_already_sent_bytes of
+ * affected entries is updated, but entries are not removed from the list. Caller is
+ * expected to remove all fully sent entries from the head of the list.
+ *
+ * -1 = send returned 0,
+ * -2 = unhandled error.
+ *  0 = success but no message was fully sent
+ *  1 = at least one message was fully sent
+ */
+int
+msgio_write_list(PRFileDesc *sock, struct send_buffer_list *sblist, size_t max_msgs)
+{
+	PRIOVec iov[MSGIO_MAX_IOV];
+	struct send_buffer_list_entry *entry;
+	PRInt32 iov_size;
+	PRInt32 sent;
+	size_t to_account;
+	size_t remaining;
+	int res;
+
+	if (max_msgs > MSGIO_MAX_IOV) {
+		max_msgs = MSGIO_MAX_IOV;
+	}
+
+	iov_size = 0;
+	TAILQ_FOREACH(entry, &sblist->list, entries) {
+		if ((size_t)iov_size >= max_msgs) {
+			break;
+		}
+
+		iov[iov_size].iov_base = dynar_data(&entry->buffer) + entry->msg_already_sent_bytes;
+		iov[iov_size].iov_len = dynar_size(&entry->buffer) - entry->msg_already_sent_bytes;
+		iov_size++;
+	}
+
+	if (iov_size == 0) {
+		return (0);
+	}
+
+	if (iov_size == 1) {
+		sent = PR_Send(sock, iov[0].iov_base, iov[0].iov_len, 0, PR_INTERVAL_NO_TIMEOUT);
+	} else {
+		sent = PR_Writev(sock, iov, iov_size, PR_INTERVAL_NO_TIMEOUT);
+	}
+
+	if (sent == 0) {
+		return (-1);
+	}
+
+	if (sent < 0) {
+		if (PR_GetError() != PR_WOULD_BLOCK_ERROR) {
+			return (-2);
+		}
+
+		return (0);
+	}
+
+	res = 0;
+	to_account = sent;
+	TAILQ_FOREACH(entry, &sblist->list, entries) {
+		if (to_account == 0) {
+			break;
+		}
+
+		remaining = dynar_size(&entry->buffer) - entry->msg_already_sent_bytes;
+		if (remaining > to_account) {
+			remaining = to_account;
+		}
+
+		entry->msg_already_sent_bytes += remaining;
+		to_account -= remaining;
+
+		if (entry->msg_already_sent_bytes == dynar_size(&entry->buffer)) {
+			res = 1;
+		}
+	}
+
+	return (res);
+}
+
 /*
  *  1 Full message received
  *  0 Partial read (no error)
@@ -142,11 +228,14 @@ int
 msgio_read(PRFileDesc *sock, struct dynar *msg, size_t *already_received_bytes, int *skipping_msg)
 {
 	char local_read_buffer[MSGIO_LOCAL_BUF_SIZE];
+	char *read_buffer;
 	PRInt32 readed;
 	PRInt32 to_read;
+	int store_failed;
 	int ret;
 
 	ret = 0;
+	store_failed = 0;
 
 	if (*already_received_bytes < msg_get_header_length()) {
 		/*
@@ -160,18 +249,33 @@ msgio_read(PRFileDesc *sock, struct dynar *msg, size_t *already_received_bytes,
 		to_read = (msg_get_header_length() + msg_get_len(msg)) - *already_received_bytes;
 	}
 
-	if (to_read > MSGIO_LOCAL_BUF_SIZE) {
-		to_read = MSGIO_LOCAL_BUF_SIZE;
+	if (!*skipping_msg && dynar_prealloc(msg, to_read) == -1) {
+		store_failed = 1;
+	}
+
+	if (!*skipping_msg && !store_failed) {
+		/*
+		 * Read directly to message buffer
+		 */
+		read_buffer = dynar_data(msg) + dynar_size(msg);
+	} else {
+		read_buffer = local_read_buffer;
+
+		if (to_read > MSGIO_LOCAL_BUF_SIZE) {
+			to_read = MSGIO_LOCAL_BUF_SIZE;
+		}
 	}
 
-	readed = PR_Recv(sock, local_read_buffer, to_read, 0, PR_INTERVAL_NO_TIMEOUT);
+	readed = PR_Recv(sock, read_buffer, to_read, 0, PR_INTERVAL_NO_TIMEOUT);
 	if (readed > 0) {
 		*already_received_bytes += readed;
 
 		if (!*skipping_msg) {
-			if (dynar_cat(msg, local_read_buffer, readed) == -1) {
+			if (store_failed) {
 				*skipping_msg = 1;
 				ret = -4;
+			} else {
+				(void)dynar_set_size(msg, dynar_size(msg) + readed);
 			}
 		}
 
@@ -38,11 +38,17 @@
 #include <nspr.h>
 
 #include "dynar.h"
+#include "send-buffer-list.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Maximum number of messages sent by single msgio_write_list call
+ */
+#define MSGIO_MAX_IOV		16
+
 extern ssize_t	msgio_send(PRFileDesc *sock, const char *msg, size_t msg_len,
     size_t *start_pos);
 
@@ -50,6 +56,9 @@ extern ssize_t	msgio_send_blocking(PRFileDesc *sock, const char *msg, size_t msg
 
 extern int	msgio_write(PRFileDesc *sock, const struct dynar *msg, size_t *already_sent_bytes);
 
+extern int	msgio_write_list(PRFileDesc *sock, struct send_buffer_list *sblist,
+    size_t max_msgs);
+
 extern int	msgio_read(PRFileDesc *sock, struct dynar *msg, size_t *already_received_bytes,
     int *skipping_msg);
 
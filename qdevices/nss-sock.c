@@ -372,16 +372,35 @@ nss_sock_non_blocking_client_succeeded(const PRPollDesc *pfd)
 	return (res);
 }
 
+/*
+ * Set session cache (resumption using session ID) and session tickets options of
+ * SSL socket.
+ */
+static int
+nss_sock_set_ssl_session_options(PRFileDesc *ssl_sock, int session_cache, int session_tickets)
+{
+
+	if ((SSL_OptionSet(ssl_sock, SSL_NO_CACHE, !session_cache) != SECSuccess) ||
+	    (SSL_OptionSet(ssl_sock, SSL_ENABLE_SESSION_TICKETS,
+	    session_cache && session_tickets) != SECSuccess)) {
+		return (-1);
+	}
+
+	return (0);
+}
+
 /*
  * Start client side SSL connection. This can block.
  *
  * ssl_url is expected server URL, bad_cert_hook is callback called when server certificate
- * verification fails.
+ * verification fails. When session_cache is set, session of previous connection to the
+ * same server is resumed if possible (full handshake is skipped).
  */
 PRFileDesc *
 nss_sock_start_ssl_as_client(PRFileDesc *input_sock, const char *ssl_url,
     SSLBadCertHandler bad_cert_hook, SSLGetClientAuthData client_auth_hook,
-    void *client_auth_hook_arg, int force_handshake, int *reset_would_block)
+    void *client_auth_hook_arg, int session_cache, int session_tickets, int force_handshake,
+    int *reset_would_block)
 {
 	PRFileDesc *ssl_sock;
 
@@ -403,6 +422,11 @@ nss_sock_start_ssl_as_client(PRFileDesc *input_sock, const char *ssl_url,
 	    (SSL_OptionSet(ssl_sock, SSL_HANDSHAKE_AS_CLIENT, PR_TRUE) != SECSuccess)) {
 		return (NULL);
 	}
+
+	if (nss_sock_set_ssl_session_options(ssl_sock, session_cache, session_tickets) != 0) {
+		return (NULL);
+	}
+
 	if (bad_cert_hook != NULL && SSL_BadCertHook(ssl_sock, bad_cert_hook, NULL) != SECSuccess) {
 		return (NULL);
 	}
@@ -433,8 +457,8 @@ nss_sock_start_ssl_as_client(PRFileDesc *input_sock, const char *ssl_url,
 
 PRFileDesc *
 nss_sock_start_ssl_as_server(PRFileDesc *input_sock, CERTCertificate *server_cert,
-    SECKEYPrivateKey *server_key, int require_client_cert, int force_handshake,
-    int *reset_would_block)
+    SECKEYPrivateKey *server_key, int require_client_cert, int session_cache,
+    int session_tickets, int force_handshake, int *reset_would_block)
 {
 	PRFileDesc *ssl_sock;
 
@@ -460,6 +484,10 @@ nss_sock_start_ssl_as_server(PRFileDesc *input_sock, CERTCertificate *server_cer
 		return (NULL);
 	}
 
+	if (nss_sock_set_ssl_session_options(ssl_sock, session_cache, session_tickets) != 0) {
+		return (NULL);
+	}
+
 	if (SSL_ResetHandshake(ssl_sock, PR_TRUE) != SECSuccess) {
 		return (NULL);
 	}
@@ -66,11 +66,12 @@ extern PRFileDesc 	*nss_sock_create_client_socket(const char *hostname, uint16_t
 
 extern PRFileDesc	*nss_sock_start_ssl_as_client(PRFileDesc *input_sock, const char *ssl_url,
     SSLBadCertHandler bad_cert_hook, SSLGetClientAuthData client_auth_hook,
-    void *client_auth_hook_arg, int force_handshake, int *reset_would_block);
+    void *client_auth_hook_arg, int session_cache, int session_tickets, int force_handshake,
+    int *reset_would_block);
 
 extern PRFileDesc	*nss_sock_start_ssl_as_server(PRFileDesc *input_sock,
     CERTCertificate *server_cert, SECKEYPrivateKey *server_key, int require_client_cert,
-    int force_handshake, int *reset_would_block);
+    int session_cache, int session_tickets, int force_handshake, int *reset_would_block);
 
 extern int		 nss_sock_non_blocking_client_init(const char *host_name,
     uint16_t port, PRIntn af, struct nss_sock_non_blocking_client *client);
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pr-poll-set.h"
+
+/*
+ * Needed for getting unix fd from nspr handle
+ */
+#include <private/pprio.h>
+
+#define PR_POLL_SET_MAX_EVENTS		256
+
+static int
+pr_poll_set_results_reserve(struct pr_poll_set *poll_set, size_t size)
+{
+	struct pr_poll_set_result *new_results;
+
+	if (size <= poll_set->results_allocated) {
+		return (0);
+	}
+
+	new_results = realloc(poll_set->results, sizeof(*new_results) * size);
+	if (new_results == NULL) {
+		return (-1);
+	}
+
+	poll_set->results = new_results;
+	poll_set->results_allocated = size;
+
+	return (0);
+}
+
+static void
+pr_poll_set_result_add(struct pr_poll_set *poll_set, struct pr_poll_set_entry *entry,
+    PRInt16 out_flags)
+{
+
+	poll_set->results[poll_set->no_results].entry = entry;
+	poll_set->results[poll_set->no_results].out_flags = out_flags;
+	poll_set->no_results++;
+}
+
+int
+pr_poll_set_init(struct pr_poll_set *poll_set)
+{
+
+	memset(poll_set, 0, sizeof(*poll_set));
+
+	TAILQ_INIT(&poll_set->entry_list);
+	TAILQ_INIT(&poll_set->ready_list);
+	pr_poll_array_init(&poll_set->poll_array, sizeof(struct pr_poll_set_entry *));
+
+#ifdef HAVE_SYS_EPOLL_H
+	poll_set->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (poll_set->epoll_fd == -1) {
+		return (-1);
+	}
+
+	poll_set->events = malloc(sizeof(struct epoll_event) * PR_POLL_SET_MAX_EVENTS);
+	if (poll_set->events == NULL) {
+		close(poll_set->epoll_fd);
+		poll_set->epoll_fd = -1;
+
+		return (-1);
+	}
+#else
+	poll_set->epoll_fd = -1;
+#endif
+
+	return (0);
+}
+
+void
+pr_poll_set_destroy(struct pr_poll_set *poll_set)
+{
+
+	if (poll_set->epoll_fd != -1) {
+		close(poll_set->epoll_fd);
+	}
+
+	free(poll_set->events);
+	free(poll_set->results);
+	pr_poll_array_destroy(&poll_set->poll_array);
+
+	memset(poll_set, 0, sizeof(*poll_set));
+	poll_set->epoll_fd = -1;
+	TAILQ_INIT(&poll_set->entry_list);
+	TAILQ_INIT(&poll_set->ready_list);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Ask NSPR layers (SSL) which OS events are needed to satisfy requested in_flags. This is
+ * exactly what PR_Poll does for every descriptor on every call. Layer may also report
+ * that descriptor is ready right now (for example decrypted data are buffered), then
+ * entry is put to ready list and returned by next pr_poll_set_wait without OS poll.
+ */
+static uint32_t
+pr_poll_set_entry_translate(struct pr_poll_set *poll_set, struct pr_poll_set_entry *entry)
+{
+	PRInt16 out_flags_read;
+	PRInt16 out_flags_write;
+	PRInt16 sys_flags;
+	uint32_t events;
+
+	out_flags_read = 0;
+	out_flags_write = 0;
+	entry->in_flags_read = 0;
+	entry->in_flags_write = 0;
+
+	if (entry->in_flags != 0) {
+		entry->in_flags_read = (entry->fd->methods->poll)(entry->fd,
+		    entry->in_flags & ~PR_POLL_WRITE, &out_flags_read);
+		entry->in_flags_write = (entry->fd->methods->poll)(entry->fd,
+		    entry->in_flags & ~PR_POLL_READ, &out_flags_write);
+	}
+
+	if ((entry->in_flags_read & out_flags_read) || (entry->in_flags_write & out_flags_write)) {
+		entry->ready_out_flags = out_flags_read | out_flags_write;
+
+		if (!entry->ready) {
+			TAILQ_INSERT_TAIL(&poll_set->ready_list, entry, ready_entries);
+			entry->ready = 1;
+		}
+	} else {
+		entry->ready_out_flags = 0;
+
+		if (entry->ready) {
+			TAILQ_REMOVE(&poll_set->ready_list, entry, ready_entries);
+			entry->ready = 0;
+		}
+	}
+
+	sys_flags = entry->in_flags_read | entry->in_flags_write;
+	events = 0;
+
+	if (sys_flags & PR_POLL_READ) {
+		events |= EPOLLIN;
+	}
+
+	if (sys_flags & PR_POLL_WRITE) {
+		events |= EPOLLOUT;
+	}
+
+	if (sys_flags & PR_POLL_EXCEPT) {
+		events |= EPOLLPRI;
+	}
+
+	return (events);
+}
+
+static PRInt16
+pr_poll_set_entry_out_flags(const struct pr_poll_set_entry *entry, uint32_t events)
+{
+	PRInt16 out_flags;
+
+	out_flags = 0;
+
+	if (events & EPOLLIN) {
+		if (entry->in_flags_read & PR_POLL_READ) {
+			out_flags |= PR_POLL_READ;
+		}
+
+		if (entry->in_flags_write & PR_POLL_READ) {
+			out_flags |= PR_POLL_WRITE;
+		}
+	}
+
+	if (events & EPOLLOUT) {
+		if (entry->in_flags_read & PR_POLL_WRITE) {
+			out_flags |= PR_POLL_READ;
+		}
+
+		if (entry->in_flags_write & PR_POLL_WRITE) {
+			out_flags |= PR_POLL_WRITE;
+		}
+	}
+
+	if ((events & EPOLLPRI) && (entry->in_flags & PR_POLL_EXCEPT)) {
+		out_flags |= PR_POLL_EXCEPT;
+	}
+
+	if (events & EPOLLERR) {
+		out_flags |= PR_POLL_ERR;
+	}
+
+	if (events & EPOLLHUP) {
+		out_flags |= PR_POLL_HUP;
+	}
+
+	return (out_flags);
+}
+#endif
+
+int
+pr_poll_set_add(struct pr_poll_set *poll_set, struct pr_poll_set_entry *entry, PRFileDesc *fd,
+    PRInt16 in_flags, int type, void *user_data)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event event;
+#endif
+
+	memset(entry, 0, sizeof(*entry));
+	entry->fd = fd;
+	entry->in_flags = in_flags;
+	entry->type = type;
+	entry->user_data = user_data;
+
+	entry->os_fd = PR_FileDesc2NativeHandle(fd);
+	if (entry->os_fd == -1) {
+		return (-1);
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	memset(&event, 0, sizeof(event));
+	event.events = pr_poll_set_entry_translate(poll_set, entry);
+	event.data.ptr = entry;
+
+	if (epoll_ctl(poll_set->epoll_fd, EPOLL_CTL_ADD, entry->os_fd, &event) == -1) {
+		if (entry->ready) {
+			TAILQ_REMOVE(&poll_set->ready_list, entry, ready_entries);
+			entry->ready = 0;
+		}
+
+		return (-1);
+	}
+
+	entry->registered_events = event.events;
+#endif
+
+	TAILQ_INSERT_TAIL(&poll_set->entry_list, entry, entries);
+	poll_set->no_entries++;
+
+	return (0);
+}
+
+/*
+ * Must be called when in_flags changes and also after every I/O operation on fd, because
+ * NSPR layer state (SSL handshake, buffered data) may require different OS events.
+ * fd may differ from previous one only when new layer was pushed on the same OS socket.
+ */
+int
+pr_poll_set_update(struct pr_poll_set *poll_set, struct pr_poll_set_entry *entry,
+    PRFileDesc *fd, PRInt16 in_flags)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event event;
+#endif
+
+	entry->fd = fd;
+	entry->in_flags = in_flags;
+
+#ifdef HAVE_SYS_EPOLL_H
+	memset(&event, 0, sizeof(event));
+	event.events = pr_poll_set_entry_translate(poll_set, entry);
+	event.data.ptr = entry;
+
+	if (event.events != entry->registered_events) {
+		if (epoll_ctl(poll_set->epoll_fd, EPOLL_CTL_MOD, entry->os_fd, &event) == -1) {
+			return (-1);
+		}
+
+		entry->registered_events = event.events;
+	}
+#endif
+
+	return (0);
+}
+
+/*
+ * Must be called before fd is closed. It's safe to call this function while results
+ * of pr_poll_set_wait are processed, pr_poll_set_get_result then returns NULL for
+ * deleted entry.
+ */
+int
+pr_poll_set_del(struct pr_poll_set *poll_set, struct pr_poll_set_entry *entry)
+{
+	size_t i;
+	int res;
+
+	res = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (epoll_ctl(poll_set->epoll_fd, EPOLL_CTL_DEL, entry->os_fd, NULL) == -1) {
+		res = -1;
+	}
+#endif
+
+	if (entry->ready) {
+		TAILQ_REMOVE(&poll_set->ready_list, entry, ready_entries);
+		entry->ready = 0;
+	}
+
+	TAILQ_REMOVE(&poll_set->entry_list, entry, entries);
+	poll_set->no_entries--;
+
+	for (i = 0; i < poll_set->no_results; i++) {
+		if (poll_set->results[i].entry == entry) {
+			poll_set->results[i].entry = NULL;
+		}
+	}
+
+	return (res);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+ssize_t
+pr_poll_set_wait(struct pr_poll_set *poll_set, PRIntervalTime timeout)
+{
+	struct epoll_event *events;
+	struct pr_poll_set_entry *entry;
+	size_t no_ready;
+	int timeout_ms;
+	int no_events;
+	int i;
+	PRInt16 out_flags;
+
+	poll_set->no_results = 0;
+
+	no_ready = 0;
+	TAILQ_FOREACH(entry, &poll_set->ready_list, ready_entries) {
+		no_ready++;
+	}
+
+	if (pr_poll_set_results_reserve(poll_set, no_ready + PR_POLL_SET_MAX_EVENTS) != 0) {
+		return (-1);
+	}
+
+	TAILQ_FOREACH(entry, &poll_set->ready_list, ready_entries) {
+		pr_poll_set_result_add(poll_set, entry, entry->ready_out_flags);
+	}
+
+	if (no_ready > 0) {
+		timeout_ms = 0;
+	} else if (timeout == PR_INTERVAL_NO_TIMEOUT) {
+		timeout_ms = -1;
+	} else {
+		/*
+		 * Round up, otherwise timer which expires in less than 1ms would cause busy loop
+		 */
+		timeout_ms = PR_IntervalToMilliseconds(timeout);
+		if (PR_MillisecondsToInterval(timeout_ms) < timeout) {
+			timeout_ms++;
+		}
+	}
+
+	events = poll_set->events;
+
+	no_events = epoll_wait(poll_set->epoll_fd, events, PR_POLL_SET_MAX_EVENTS, timeout_ms);
+	if (no_events == -1) {
+		if (errno != EINTR) {
+			return (-1);
+		}
+
+		no_events = 0;
+	}
+
+	for (i = 0; i < no_events; i++) {
+		entry = (struct pr_poll_set_entry *)events[i].data.ptr;
+
+		if (entry->ready) {
+			/*
+			 * Already reported from ready list
+			 */
+			continue;
+		}
+
+		out_flags = pr_poll_set_entry_out_flags(entry, events[i].events);
+		if (out_flags != 0) {
+			pr_poll_set_result_add(poll_set, entry, out_flags);
+		}
+	}
+
+	return (poll_set->no_results);
+}
+#else
+ssize_t
+pr_poll_set_wait(struct pr_poll_set *poll_set, PRIntervalTime timeout)
+{
+	struct pr_poll_set_entry *entry;
+	struct pr_poll_set_entry **user_data;
+	PRPollDesc *poll_desc;
+	PRInt32 poll_res;
+	ssize_t i;
+
+	poll_set->no_results = 0;
+
+	if (pr_poll_set_results_reserve(poll_set, poll_set->no_entries) != 0) {
+		return (-1);
+	}
+
+	pr_poll_array_clean(&poll_set->poll_array);
+
+	TAILQ_FOREACH(entry, &poll_set->entry_list, entries) {
+		if (entry->in_flags == 0) {
+			continue;
+		}
+
+		if (pr_poll_array_add(&poll_set->poll_array, &poll_desc, (void **)&user_data) < 0) {
+			return (-1);
+		}
+
+		poll_desc->fd = entry->fd;
+		poll_desc->in_flags = entry->in_flags;
+		*user_data = entry;
+	}
+
+	pr_poll_array_gc(&poll_set->poll_array);
+
+	if ((poll_res = PR_Poll(poll_set->poll_array.array,
+	    pr_poll_array_size(&poll_set->poll_array), timeout)) < 0) {
+		return (-1);
+	}
+
+	for (i = 0; poll_res > 0 && i < pr_poll_array_size(&poll_set->poll_array); i++) {
+		poll_desc = pr_poll_array_get(&poll_set->poll_array, i);
+
+		if (poll_desc->out_flags != 0) {
+			user_data = pr_poll_array_get_user_data(&poll_set->poll_array, i);
+
+			pr_poll_set_result_add(poll_set, *user_data, poll_desc->out_flags);
+		}
+	}
+
+	return (poll_set->no_results);
+}
+#endif
+
+struct pr_poll_set_entry *
+pr_poll_set_get_result(const struct pr_poll_set *poll_set, ssize_t pos, PRInt16 *out_flags)
+{
+
+	if (pos < 0 || (size_t)pos >= poll_set->no_results) {
+		return (NULL);
+	}
+
+	*out_flags = poll_set->results[pos].out_flags;
+
+	return (poll_set->results[pos].entry);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PR_POLL_SET_H_
+#define _PR_POLL_SET_H_
+
+#include <sys/types.h>
+#include <sys/queue.h>
+#include <inttypes.h>
+
+#include <nspr.h>
+
+#include "pr-poll-array.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Persistent set of NSPR file descriptors. Unlike pr_poll_array, entries are registered
+ * once and only changed when interest of the caller (or state of NSPR layer like SSL)
+ * changes, so waiting costs are proportional to number of active descriptors. When
+ * epoll is available it's used, otherwise set falls back to PR_Poll.
+ */
+struct pr_poll_set_entry {
+	PRFileDesc *fd;
+	PRInt16 in_flags;
+	int type;
+	void *user_data;
+
+	/* Private - OS poll flags requested by NSPR layer to satisfy PR_POLL_READ/WRITE */
+	PRInt16 in_flags_read;
+	PRInt16 in_flags_write;
+	PRInt16 ready_out_flags;
+	uint32_t registered_events;
+	int os_fd;
+	int ready;
+
+	TAILQ_ENTRY(pr_poll_set_entry) entries;
+	TAILQ_ENTRY(pr_poll_set_entry) ready_entries;
+};
+
+struct pr_poll_set_result {
+	struct pr_poll_set_entry *entry;
+	PRInt16 out_flags;
+};
+
+struct pr_poll_set {
+	int epoll_fd;
+	void *events;
+	struct pr_poll_array poll_array;
+	struct pr_poll_set_result *results;
+	size_t results_allocated;
+	size_t no_results;
+	size_t no_entries;
+
+	TAILQ_HEAD(, pr_poll_set_entry) entry_list;
+	TAILQ_HEAD(, pr_poll_set_entry) ready_list;
+};
+
+extern int		 pr_poll_set_init(struct pr_poll_set *poll_set);
+
+extern void		 pr_poll_set_destroy(struct pr_poll_set *poll_set);
+
+extern int		 pr_poll_set_add(struct pr_poll_set *poll_set,
+    struct pr_poll_set_entry *entry, PRFileDesc *fd, PRInt16 in_flags, int type,
+    void *user_data);
+
+extern int		 pr_poll_set_update(struct pr_poll_set *poll_set,
+    struct pr_poll_set_entry *entry, PRFileDesc *fd, PRInt16 in_flags);
+
+extern int		 pr_poll_set_del(struct pr_poll_set *poll_set,
+    struct pr_poll_set_entry *entry);
+
+extern ssize_t		 pr_poll_set_wait(struct pr_poll_set *poll_set, PRIntervalTime timeout);
+
+extern struct pr_poll_set_entry *pr_poll_set_get_result(const struct pr_poll_set *poll_set,
+    ssize_t pos, PRInt16 *out_flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PR_POLL_SET_H_ */
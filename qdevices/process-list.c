@@ -43,6 +43,8 @@
 #include <err.h>
 #include <errno.h>
 #include <poll.h>
+#include <spawn.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "dynar.h"
@@ -59,21 +61,26 @@ static char 		**process_list_parse_command(const char *command, size_t *no_param
 static int		process_list_entry_exec(const struct process_list *plist,
     struct process_list_entry *entry);
 
+extern char **environ;
+
 void
 process_list_init(struct process_list *plist, size_t max_list_entries, int use_execvp,
-    process_list_notify_fn_t notify_fn, void *notify_fn_user_data)
+    int use_spawn, process_list_notify_fn_t notify_fn, void *notify_fn_user_data)
 {
 
 	memset(plist, 0, sizeof(*plist));
 
 	plist->max_list_entries = max_list_entries;
 	plist->allocated_list_entries = 0;
+	plist->command_cache_entries = 0;
 	plist->use_execvp = use_execvp;
+	plist->use_spawn = use_spawn;
 	plist->notify_fn = notify_fn;
 	plist->notify_fn_user_data = notify_fn_user_data;
 
 	TAILQ_INIT(&plist->active_list);
 	TAILQ_INIT(&plist->to_kill_list);
+	TAILQ_INIT(&plist->command_cache);
 }
 
 static void
@@ -91,11 +98,76 @@ static void
 process_list_entry_free(struct process_list_entry *entry)
 {
 
-	process_list_free_argv(entry->exec_argc, entry->exec_argv);
+	if (!entry->exec_argv_cached && entry->exec_argv != NULL) {
+		process_list_free_argv(entry->exec_argc, entry->exec_argv);
+	}
 	free(entry->name);
 	free(entry);
 }
 
+static void
+process_list_command_free(struct process_list_command *command)
+{
+
+	process_list_free_argv(command->exec_argc, command->exec_argv);
+	free(command->command);
+	free(command);
+}
+
+/*
+ * Find parsed command in cache or parse it and (if there is a space) store it in
+ * the cache. Return 0 on success (entry argv set), -1 on error.
+ */
+static int
+process_list_entry_set_command(struct process_list *plist, struct process_list_entry *entry,
+    const char *command)
+{
+	struct process_list_command *cache_entry;
+
+	TAILQ_FOREACH(cache_entry, &plist->command_cache, entries) {
+		if (strcmp(cache_entry->command, command) == 0) {
+			entry->exec_argv = cache_entry->exec_argv;
+			entry->exec_argc = cache_entry->exec_argc;
+			entry->exec_argv_cached = 1;
+
+			return (0);
+		}
+	}
+
+	entry->exec_argv = process_list_parse_command(command, &entry->exec_argc);
+	if (entry->exec_argv == NULL) {
+		return (-1);
+	}
+
+	if (plist->command_cache_entries >= plist->max_list_entries) {
+		/*
+		 * Cache is full -> entry owns argv
+		 */
+		return (0);
+	}
+
+	cache_entry = malloc(sizeof(*cache_entry));
+	if (cache_entry == NULL) {
+		return (0);
+	}
+
+	cache_entry->command = strdup(command);
+	if (cache_entry->command == NULL) {
+		free(cache_entry);
+
+		return (0);
+	}
+
+	cache_entry->exec_argv = entry->exec_argv;
+	cache_entry->exec_argc = entry->exec_argc;
+	entry->exec_argv_cached = 1;
+
+	plist->command_cache_entries++;
+	TAILQ_INSERT_TAIL(&plist->command_cache, cache_entry, entries);
+
+	return (0);
+}
+
 static char **
 process_list_parse_command(const char *command, size_t *no_params)
 {
@@ -207,8 +279,7 @@ process_list_add(struct process_list *plist, const char *name, const char *comma
 	}
 
 	entry->state = PROCESS_LIST_ENTRY_STATE_INITIALIZED;
-	entry->exec_argv = process_list_parse_command(command, &entry->exec_argc);
-	if (entry->exec_argv == NULL) {
+	if (process_list_entry_set_command(plist, entry, command) != 0) {
 		process_list_entry_free(entry);
 
 		return (NULL);
@@ -250,6 +321,43 @@ process_list_free(struct process_list *plist)
 
 	TAILQ_INIT(&plist->active_list);
 	TAILQ_INIT(&plist->to_kill_list);
+
+	process_list_command_cache_clear(plist);
+}
+
+/*
+ * Remove all parsed commands from the cache. Commands still needed by not yet executed
+ * entries are kept.
+ */
+void
+process_list_command_cache_clear(struct process_list *plist)
+{
+	struct process_list_command *cache_entry;
+	struct process_list_command *cache_entry_next;
+	struct process_list_entry *entry;
+	int in_use;
+
+	cache_entry = TAILQ_FIRST(&plist->command_cache);
+
+	while (cache_entry != NULL) {
+		cache_entry_next = TAILQ_NEXT(cache_entry, entries);
+
+		in_use = 0;
+		TAILQ_FOREACH(entry, &plist->active_list, entries) {
+			if (entry->exec_argv == cache_entry->exec_argv) {
+				in_use = 1;
+				break;
+			}
+		}
+
+		if (!in_use) {
+			TAILQ_REMOVE(&plist->command_cache, cache_entry, entries);
+			process_list_command_free(cache_entry);
+			plist->command_cache_entries--;
+		}
+
+		cache_entry = cache_entry_next;
+	}
 }
 
 static void
@@ -270,6 +378,48 @@ process_list_entry_exec_helper_set_stdfd(void)
 	close(devnull);
 }
 
+/*
+ * Start process using posix_spawn. Unlike fork, it doesn't copy parent address space
+ * (glibc uses vfork semantics) and failed exec is reported directly.
+ */
+static int
+process_list_entry_spawn(const struct process_list *plist, struct process_list_entry *entry,
+    pid_t *pid)
+{
+	posix_spawn_file_actions_t file_actions;
+	int res;
+
+	if (posix_spawn_file_actions_init(&file_actions) != 0) {
+		return (-1);
+	}
+
+	if (posix_spawn_file_actions_addopen(&file_actions, 0, "/dev/null", O_RDWR, 0) != 0 ||
+	    posix_spawn_file_actions_adddup2(&file_actions, 0, 1) != 0 ||
+	    posix_spawn_file_actions_adddup2(&file_actions, 0, 2) != 0) {
+		posix_spawn_file_actions_destroy(&file_actions);
+
+		return (-1);
+	}
+
+	if (!plist->use_execvp) {
+		res = posix_spawn(pid, entry->exec_argv[0], &file_actions, NULL, entry->exec_argv,
+		    environ);
+	} else {
+		res = posix_spawnp(pid, entry->exec_argv[0], &file_actions, NULL, entry->exec_argv,
+		    environ);
+	}
+
+	posix_spawn_file_actions_destroy(&file_actions);
+
+	if (res != 0) {
+		errno = res;
+
+		return (-1);
+	}
+
+	return (0);
+}
+
 static int
 process_list_entry_exec(const struct process_list *plist, struct process_list_entry *entry)
 {
@@ -279,7 +429,16 @@ process_list_entry_exec(const struct process_list *plist, struct process_list_en
 		return (-1);
 	}
 
-	pid = fork();
+	clock_gettime(CLOCK_MONOTONIC, &entry->exec_time);
+
+	if (plist->use_spawn) {
+		if (process_list_entry_spawn(plist, entry, &pid) != 0) {
+			return (-1);
+		}
+	} else {
+		pid = fork();
+	}
+
 	if (pid == -1) {
 		return (-1);
 	} else if (pid == 0) {
@@ -299,6 +458,14 @@ process_list_entry_exec(const struct process_list *plist, struct process_list_en
 		entry->pid = pid;
 		entry->state = PROCESS_LIST_ENTRY_STATE_RUNNING;
 
+		if (entry->exec_argv_cached) {
+			/*
+			 * Argv is no longer needed and cache may be cleared before entry is freed
+			 */
+			entry->exec_argv = NULL;
+			entry->exec_argc = 0;
+		}
+
 		if (plist->notify_fn != NULL) {
 			plist->notify_fn(PROCESS_LIST_NOTIFY_REASON_EXECUTED, entry,
 			    plist->notify_fn_user_data);
@@ -329,6 +496,7 @@ process_list_entry_waitpid(const struct process_list *plist, struct process_list
 {
 	pid_t wpid_res;
 	int status;
+	struct timespec now;
 
 	if (entry->state == PROCESS_LIST_ENTRY_STATE_INITIALIZED ||
 	    entry->state == PROCESS_LIST_ENTRY_STATE_FINISHED) {
@@ -349,6 +517,10 @@ process_list_entry_waitpid(const struct process_list *plist, struct process_list
 
 	entry->exit_status = status;
 
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	entry->run_time_us = (uint64_t)(now.tv_sec - entry->exec_time.tv_sec) * 1000000 +
+	    (now.tv_nsec - entry->exec_time.tv_nsec) / 1000;
+
 	if (entry->state == PROCESS_LIST_ENTRY_STATE_RUNNING) {
 		if (plist->notify_fn != NULL) {
 			plist->notify_fn(PROCESS_LIST_NOTIFY_REASON_FINISHED, entry,
@@ -37,6 +37,8 @@
 
 #include <signal.h>
 #include <sys/queue.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include "dynar.h"
 
@@ -62,29 +64,46 @@ struct process_list_entry {
 	enum process_list_entry_state state;
 	char **exec_argv;
 	size_t exec_argc;
+	int exec_argv_cached;
 	pid_t pid;
 	int exit_status;
+	struct timespec exec_time;
+	uint64_t run_time_us;	/* Valid only in finished state */
 
 	TAILQ_ENTRY(process_list_entry) entries;
 };
 
+/*
+ * Parsed command. Argv is shared by all entries with same command
+ */
+struct process_list_command {
+	char *command;
+	char **exec_argv;
+	size_t exec_argc;
+
+	TAILQ_ENTRY(process_list_command) entries;
+};
+
 typedef void (*process_list_notify_fn_t) (enum process_list_notify_reason reason,
     const struct process_list_entry *entry, void *user_data);
 
 struct process_list {
 	int use_execvp;
+	int use_spawn;
 	size_t max_list_entries;
 	size_t allocated_list_entries;
+	size_t command_cache_entries;
 	process_list_notify_fn_t notify_fn;
 	void *notify_fn_user_data;
 
 	TAILQ_HEAD(, process_list_entry) active_list;
 	TAILQ_HEAD(, process_list_entry) to_kill_list;
+	TAILQ_HEAD(, process_list_command) command_cache;
 };
 
 
 extern void				 process_list_init(struct process_list *plist,
-    size_t max_list_entries, int use_execvp, process_list_notify_fn_t notify_fn,
+    size_t max_list_entries, int use_execvp, int use_spawn, process_list_notify_fn_t notify_fn,
     void *notify_fn_user_data);
 
 extern struct process_list_entry	*process_list_add(struct process_list *plist,
@@ -92,6 +111,9 @@ extern struct process_list_entry	*process_list_add(struct process_list *plist,
 
 extern void				 process_list_free(struct process_list *plist);
 
+extern void				 process_list_command_cache_clear(
+    struct process_list *plist);
+
 extern int				 process_list_exec_initialized(struct process_list *plist);
 
 extern int				 process_list_waitpid(struct process_list *plist);
@@ -75,6 +75,7 @@ qdevice_advanced_settings_init(struct qdevice_advanced_settings *settings)
 	settings->heuristics_max_execs = QDEVICE_DEFAULT_HEURISTICS_MAX_EXECS;
 
 	settings->heuristics_use_execvp = QDEVICE_DEFAULT_HEURISTICS_USE_EXECVP;
+	settings->heuristics_use_spawn = QDEVICE_DEFAULT_HEURISTICS_USE_SPAWN;
 	settings->heuristics_max_processes = QDEVICE_DEFAULT_HEURISTICS_MAX_PROCESSES;
 	settings->heuristics_kill_list_interval = QDEVICE_DEFAULT_HEURISTICS_KILL_LIST_INTERVAL;
 
@@ -98,6 +99,7 @@ qdevice_advanced_settings_init(struct qdevice_advanced_settings *settings)
 	settings->net_min_connect_timeout = QDEVICE_NET_DEFAULT_MIN_CONNECT_TIMEOUT;
 	settings->net_max_connect_timeout = QDEVICE_NET_DEFAULT_MAX_CONNECT_TIMEOUT;
 	settings->net_test_algorithm_enabled = QDEVICE_NET_DEFAULT_TEST_ALGORITHM_ENABLED;
+	settings->net_tls_session_resumption = QDEVICE_NET_DEFAULT_TLS_SESSION_RESUMPTION;
 
 	settings->master_wins = QDEVICE_ADVANCED_SETTINGS_MASTER_WINS_MODEL;
 
@@ -236,6 +238,12 @@ qdevice_advanced_settings_set(struct qdevice_advanced_settings *settings,
 		}
 
 		settings->heuristics_use_execvp = (uint8_t)tmpll;
+	} else if (strcasecmp(option, "heuristics_use_spawn") == 0) {
+		if ((tmpll = utils_parse_bool_str(value)) == -1) {
+			return (-2);
+		}
+
+		settings->heuristics_use_spawn = (uint8_t)tmpll;
 	} else if (strcasecmp(option, "heuristics_max_processes") == 0) {
 		tmpll = strtoll(value, &ep, 10);
 		if (tmpll < QDEVICE_MIN_HEURISTICS_MAX_PROCESSES || errno != 0 || *ep != '\0') {
@@ -337,6 +345,12 @@ qdevice_advanced_settings_set(struct qdevice_advanced_settings *settings,
 		}
 
 		settings->net_test_algorithm_enabled = (uint8_t)tmpll;
+	} else if (strcasecmp(option, "net_tls_session_resumption") == 0) {
+		if ((tmpll = utils_parse_bool_str(value)) == -1) {
+			return (-2);
+		}
+
+		settings->net_tls_session_resumption = (uint8_t)tmpll;
 	} else if (strcasecmp(option, "master_wins") == 0) {
 		tmpll = utils_parse_bool_str(value);
 
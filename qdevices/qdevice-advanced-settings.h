@@ -63,6 +63,7 @@ struct qdevice_advanced_settings {
 	uint32_t heuristics_max_interval;
 	size_t heuristics_max_execs;
 	int heuristics_use_execvp;
+	int heuristics_use_spawn;
 	size_t heuristics_max_processes;
 	uint32_t heuristics_kill_list_interval;
 
@@ -82,6 +83,7 @@ struct qdevice_advanced_settings {
 	uint32_t net_min_connect_timeout;
 	uint32_t net_max_connect_timeout;
 	uint8_t net_test_algorithm_enabled;
+	uint8_t net_tls_session_resumption;
 };
 
 extern int		qdevice_advanced_settings_init(struct qdevice_advanced_settings *settings);
@@ -96,11 +96,15 @@ extern "C" {
 
 #define QDEVICE_DEFAULT_HEURISTICS_MODE				QDEVICE_HEURISTICS_MODE_DISABLED
 
+#define QDEVICE_DEFAULT_HEURISTICS_CACHE_TIMEOUT		0
+
 #define QDEVICE_DEFAULT_HEURISTICS_MAX_EXECS			32
 #define QDEVICE_MIN_HEURISTICS_MAX_EXECS			1
 
 #define QDEVICE_DEFAULT_HEURISTICS_USE_EXECVP			0
 
+#define QDEVICE_DEFAULT_HEURISTICS_USE_SPAWN			0
+
 #define QDEVICE_DEFAULT_HEURISTICS_MAX_PROCESSES		(QDEVICE_DEFAULT_HEURISTICS_MAX_EXECS * 5)
 #define QDEVICE_MIN_HEURISTICS_MAX_PROCESSES			1
 
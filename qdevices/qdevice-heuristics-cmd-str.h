@@ -43,11 +43,20 @@ extern "C" {
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_ADD		"exec-list-add"
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_ADD_SPACE		\
     QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_ADD " "
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT	"exec-list-cache-timeout"
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT_ADD_SPACE	\
+    QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT " "
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC				"exec"
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC_ADD_SPACE		QDEVICE_HEURISTICS_CMD_STR_EXEC " "
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT			"exec-result"
 #define QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_ADD_SPACE	\
     QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT " "
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET		"exec-result-set"
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET_ADD_SPACE	\
+    QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET " "
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME			"exec-time"
+#define QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME_ADD_SPACE		\
+    QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME " "
 
 #ifdef __cplusplus
 }
@@ -88,6 +88,32 @@ qdevice_heuristics_cmd_process_exec_result(struct qdevice_heuristics_instance *i
 	return (0);
 }
 
+static int
+qdevice_heuristics_cmd_process_exec_time(struct qdevice_heuristics_instance *instance,
+    struct dynar *data)
+{
+	uint64_t run_time_us;
+	char *str;
+	int name_pos;
+
+	str = dynar_data(data);
+	name_pos = 0;
+
+	if (sscanf(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME_ADD_SPACE "%"SCNu64" %n", &run_time_us,
+	    &name_pos) != 1 || name_pos == 0 || str[name_pos] == '\0') {
+		qdevice_log(LOG_CRIT, "Can't parse exec time command (sscanf)");
+
+		return (-1);
+	}
+
+	if (qdevice_heuristics_exec_stats_add(&instance->exec_stats, str + name_pos,
+	    run_time_us) != 0) {
+		qdevice_log(LOG_ERR, "Can't alloc heuristics exec stats entry");
+	}
+
+	return (0);
+}
+
 /*
  * 1 - Line processed
  * 0 - No line to process - everything processed
@@ -126,6 +152,11 @@ qdevice_heuristics_cmd_process_one_line(struct qdevice_heuristics_instance *inst
 		if (qdevice_heuristics_cmd_process_exec_result(instance, data) != 0) {
 			return (-1);
 		}
+	} else if (strncmp(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME_ADD_SPACE,
+	    strlen(QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME_ADD_SPACE)) == 0) {
+		if (qdevice_heuristics_cmd_process_exec_time(instance, data) != 0) {
+			return (-1);
+		}
 	} else {
 		qdevice_log(LOG_CRIT,
 		    "Heuristics worker sent unknown command \"%s\"", str);
@@ -320,6 +351,30 @@ qdevice_heuristics_cmd_write_exec_list(struct qdevice_heuristics_instance *insta
 		}
 
 		send_buffer_list_put(&instance->cmd_out_buffer_list, send_buffer);
+
+		if (entry->cache_timeout == 0) {
+			continue ;
+		}
+
+		send_buffer = send_buffer_list_get_new(&instance->cmd_out_buffer_list);
+		if (send_buffer == NULL) {
+			qdevice_log(LOG_ERR, "Can't alloc send list for cmd change exec list");
+
+			return (-1);
+		}
+
+		if (dynar_str_cpy(&send_buffer->buffer,
+		    QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT_ADD_SPACE) == -1 ||
+		    dynar_str_catf(&send_buffer->buffer, "%"PRIu32" %s\n", entry->cache_timeout,
+		    entry->name) == -1) {
+			qdevice_log(LOG_ERR, "Can't alloc list cache timeout message");
+
+			send_buffer_list_discard_new(&instance->cmd_out_buffer_list, send_buffer);
+
+			return (-1);
+		}
+
+		send_buffer_list_put(&instance->cmd_out_buffer_list, send_buffer);
 	}
 
 	return (0);
@@ -351,3 +406,31 @@ qdevice_heuristics_cmd_write_exec(struct qdevice_heuristics_instance *instance,
 
 	return (0);
 }
+
+int
+qdevice_heuristics_cmd_write_exec_result_set(struct qdevice_heuristics_instance *instance,
+    const char *exec_name, enum qdevice_heuristics_exec_result exec_result)
+{
+	struct send_buffer_list_entry *send_buffer;
+
+	send_buffer = send_buffer_list_get_new(&instance->cmd_out_buffer_list);
+	if (send_buffer == NULL) {
+		qdevice_log(LOG_ERR, "Can't alloc send list for cmd exec result set");
+
+		return (-1);
+	}
+
+	if (dynar_str_cpy(&send_buffer->buffer,
+	    QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET_ADD_SPACE) == -1 ||
+	    dynar_str_catf(&send_buffer->buffer, "%u %s\n", (int)exec_result, exec_name) == -1) {
+		qdevice_log(LOG_ERR, "Can't alloc exec result set message");
+
+		send_buffer_list_discard_new(&instance->cmd_out_buffer_list, send_buffer);
+
+		return (-1);
+	}
+
+	send_buffer_list_put(&instance->cmd_out_buffer_list, send_buffer);
+
+	return (0);
+}
@@ -50,6 +50,10 @@ extern int		qdevice_heuristics_cmd_write_exec_list(
 extern int		qdevice_heuristics_cmd_write_exec(struct qdevice_heuristics_instance *instance,
     uint32_t timeout, uint32_t seq_number);
 
+extern int		qdevice_heuristics_cmd_write_exec_result_set(
+    struct qdevice_heuristics_instance *instance, const char *exec_name,
+    enum qdevice_heuristics_exec_result exec_result);
+
 extern int		qdevice_heuristics_cmd_read_from_pipe(
     struct qdevice_heuristics_instance *instance);
 
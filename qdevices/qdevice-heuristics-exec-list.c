@@ -35,6 +35,7 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "qdevice-heuristics-exec-list.h"
 
@@ -119,15 +120,19 @@ qdevice_heuristics_exec_list_clone(struct qdevice_heuristics_exec_list *dst_list
     const struct qdevice_heuristics_exec_list *src_list)
 {
 	struct qdevice_heuristics_exec_list_entry *entry;
+	struct qdevice_heuristics_exec_list_entry *new_entry;
 
 	qdevice_heuristics_exec_list_init(dst_list);
 
 	TAILQ_FOREACH(entry, src_list, entries) {
-		if (qdevice_heuristics_exec_list_add(dst_list, entry->name, entry->command) == NULL) {
+		new_entry = qdevice_heuristics_exec_list_add(dst_list, entry->name, entry->command);
+		if (new_entry == NULL) {
 			qdevice_heuristics_exec_list_free(dst_list);
 
 			return (-1);
 		}
+
+		new_entry->cache_timeout = entry->cache_timeout;
 	}
 
 	return (0);
@@ -167,6 +172,52 @@ qdevice_heuristics_exec_list_find_name(const struct qdevice_heuristics_exec_list
 	return (NULL);
 }
 
+void
+qdevice_heuristics_exec_list_entry_set_result(struct qdevice_heuristics_exec_list_entry *entry,
+    int result_pass, int pushed)
+{
+
+	entry->result_cached = 1;
+	entry->result_pushed = pushed;
+	entry->result_pass = result_pass;
+	clock_gettime(CLOCK_MONOTONIC, &entry->result_time);
+}
+
+/*
+ * Returns 1 and sets result_pass if entry has cached result which is still valid (not older
+ * than cache_timeout), otherwise 0. Pushed result is always valid for the first call.
+ */
+int
+qdevice_heuristics_exec_list_entry_get_cached_result(
+    struct qdevice_heuristics_exec_list_entry *entry, int *result_pass)
+{
+	struct timespec now;
+	uint64_t age_ms;
+
+	if (entry->result_pushed) {
+		entry->result_pushed = 0;
+		*result_pass = entry->result_pass;
+
+		return (1);
+	}
+
+	if (entry->cache_timeout == 0 || !entry->result_cached) {
+		return (0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	age_ms = (uint64_t)(now.tv_sec - entry->result_time.tv_sec) * 1000 +
+	    (now.tv_nsec - entry->result_time.tv_nsec) / 1000000;
+
+	if (age_ms >= entry->cache_timeout) {
+		return (0);
+	}
+
+	*result_pass = entry->result_pass;
+
+	return (1);
+}
+
 int
 qdevice_heuristics_exec_list_eq(const struct qdevice_heuristics_exec_list *list1,
     const struct qdevice_heuristics_exec_list *list2)
@@ -189,7 +240,8 @@ qdevice_heuristics_exec_list_eq(const struct qdevice_heuristics_exec_list *list1
 			goto return_res;
 		}
 
-		if (strcmp(entry1->command, entry2->command) != 0) {
+		if (strcmp(entry1->command, entry2->command) != 0 ||
+		    entry1->cache_timeout != entry2->cache_timeout) {
 			res = 0;
 			goto return_res;
 		}
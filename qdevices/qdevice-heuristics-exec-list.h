@@ -39,6 +39,7 @@
 
 #include <sys/queue.h>
 #include <inttypes.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,6 +48,15 @@ extern "C" {
 struct qdevice_heuristics_exec_list_entry {
 	char *name;
 	char *command;
+	uint32_t cache_timeout;
+	/*
+	 * Cached result of last execution. Used only by heuristics worker.
+	 * Pushed result is used by next exec even when caching is disabled.
+	 */
+	int result_cached;
+	int result_pushed;
+	int result_pass;
+	struct timespec result_time;
 	TAILQ_ENTRY(qdevice_heuristics_exec_list_entry) entries;
 };
 
@@ -77,6 +87,12 @@ extern int						 qdevice_heuristics_exec_list_is_empty(
 extern struct qdevice_heuristics_exec_list_entry	*qdevice_heuristics_exec_list_find_name(
     const struct qdevice_heuristics_exec_list *list, const char *name);
 
+extern void						 qdevice_heuristics_exec_list_entry_set_result(
+    struct qdevice_heuristics_exec_list_entry *entry, int result_pass, int pushed);
+
+extern int						 qdevice_heuristics_exec_list_entry_get_cached_result(
+    struct qdevice_heuristics_exec_list_entry *entry, int *result_pass);
+
 extern int						 qdevice_heuristics_exec_list_eq(
     const struct qdevice_heuristics_exec_list *list1,
     const struct qdevice_heuristics_exec_list *list2);
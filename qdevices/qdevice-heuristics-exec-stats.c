@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dynar-str.h"
+#include "qdevice-heuristics-exec-stats.h"
+
+/*
+ * Upper limits (inclusive) of histogram buckets in ms
+ */
+static const uint32_t qdevice_heuristics_exec_stats_bucket_limits[
+    QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS - 1] = {
+	1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000,
+};
+
+void
+qdevice_heuristics_exec_stats_init(struct qdevice_heuristics_exec_stats *stats)
+{
+
+	TAILQ_INIT(stats);
+}
+
+static struct qdevice_heuristics_exec_stats_entry *
+qdevice_heuristics_exec_stats_find_or_add(struct qdevice_heuristics_exec_stats *stats,
+    const char *name)
+{
+	struct qdevice_heuristics_exec_stats_entry *entry;
+
+	TAILQ_FOREACH(entry, stats, entries) {
+		if (strcmp(entry->name, name) == 0) {
+			return (entry);
+		}
+	}
+
+	entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		return (NULL);
+	}
+
+	memset(entry, 0, sizeof(*entry));
+
+	entry->name = strdup(name);
+	if (entry->name == NULL) {
+		free(entry);
+
+		return (NULL);
+	}
+
+	TAILQ_INSERT_TAIL(stats, entry, entries);
+
+	return (entry);
+}
+
+int
+qdevice_heuristics_exec_stats_add(struct qdevice_heuristics_exec_stats *stats, const char *name,
+    uint64_t run_time_us)
+{
+	struct qdevice_heuristics_exec_stats_entry *entry;
+	size_t bucket;
+
+	entry = qdevice_heuristics_exec_stats_find_or_add(stats, name);
+	if (entry == NULL) {
+		return (-1);
+	}
+
+	for (bucket = 0; bucket < QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS - 1; bucket++) {
+		if (run_time_us <= (uint64_t)qdevice_heuristics_exec_stats_bucket_limits[bucket] *
+		    1000) {
+			break;
+		}
+	}
+
+	entry->histogram[bucket]++;
+	entry->no_execs++;
+	entry->total_time_us += run_time_us;
+	if (run_time_us > entry->max_time_us) {
+		entry->max_time_us = run_time_us;
+	}
+
+	return (0);
+}
+
+void
+qdevice_heuristics_exec_stats_free(struct qdevice_heuristics_exec_stats *stats)
+{
+	struct qdevice_heuristics_exec_stats_entry *entry;
+	struct qdevice_heuristics_exec_stats_entry *entry_next;
+
+	entry = TAILQ_FIRST(stats);
+
+	while (entry != NULL) {
+		entry_next = TAILQ_NEXT(entry, entries);
+
+		free(entry->name);
+		free(entry);
+
+		entry = entry_next;
+	}
+
+	TAILQ_INIT(stats);
+}
+
+/*
+ * Append human readable execution time statistics to outbuf.
+ * Returns 0 on success, -1 on failure.
+ */
+int
+qdevice_heuristics_exec_stats_str(const struct qdevice_heuristics_exec_stats *stats,
+    struct dynar *outbuf)
+{
+	struct qdevice_heuristics_exec_stats_entry *entry;
+	size_t bucket;
+	int first;
+
+	TAILQ_FOREACH(entry, stats, entries) {
+		if (dynar_str_catf(outbuf, "    %s:\t%"PRIu64" execs, avg %.3fms, max %.3fms\n",
+		    entry->name, entry->no_execs,
+		    (entry->no_execs > 0 ? entry->total_time_us / 1000.0 / entry->no_execs : 0.0),
+		    entry->max_time_us / 1000.0) == -1) {
+			return (-1);
+		}
+
+		if (dynar_str_catf(outbuf, "        ") == -1) {
+			return (-1);
+		}
+
+		first = 1;
+		for (bucket = 0; bucket < QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS; bucket++) {
+			if (entry->histogram[bucket] == 0) {
+				continue;
+			}
+
+			if (!first && dynar_str_catf(outbuf, ", ") == -1) {
+				return (-1);
+			}
+			first = 0;
+
+			if (bucket < QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS - 1) {
+				if (dynar_str_catf(outbuf, "<=%"PRIu32"ms: %"PRIu64,
+				    qdevice_heuristics_exec_stats_bucket_limits[bucket],
+				    entry->histogram[bucket]) == -1) {
+					return (-1);
+				}
+			} else {
+				if (dynar_str_catf(outbuf, ">%"PRIu32"ms: %"PRIu64,
+				    qdevice_heuristics_exec_stats_bucket_limits[bucket - 1],
+				    entry->histogram[bucket]) == -1) {
+					return (-1);
+				}
+			}
+		}
+
+		if (dynar_str_catf(outbuf, "\n") == -1) {
+			return (-1);
+		}
+	}
+
+	return (0);
+}
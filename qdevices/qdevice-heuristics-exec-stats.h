@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _QDEVICE_HEURISTICS_EXEC_STATS_H_
+#define _QDEVICE_HEURISTICS_EXEC_STATS_H_
+
+#include <sys/types.h>
+
+#include <sys/queue.h>
+#include <inttypes.h>
+
+#include "dynar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Number of histogram buckets. Last bucket is for times larger than largest limit.
+ */
+#define QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS		12
+
+struct qdevice_heuristics_exec_stats_entry {
+	char *name;
+	uint64_t no_execs;
+	uint64_t total_time_us;
+	uint64_t max_time_us;
+	uint64_t histogram[QDEVICE_HEURISTICS_EXEC_STATS_BUCKETS];
+	TAILQ_ENTRY(qdevice_heuristics_exec_stats_entry) entries;
+};
+
+TAILQ_HEAD(qdevice_heuristics_exec_stats, qdevice_heuristics_exec_stats_entry);
+
+extern void						 qdevice_heuristics_exec_stats_init(
+    struct qdevice_heuristics_exec_stats *stats);
+
+extern int						 qdevice_heuristics_exec_stats_add(
+    struct qdevice_heuristics_exec_stats *stats, const char *name, uint64_t run_time_us);
+
+extern void						 qdevice_heuristics_exec_stats_free(
+    struct qdevice_heuristics_exec_stats *stats);
+
+extern int						 qdevice_heuristics_exec_stats_str(
+    const struct qdevice_heuristics_exec_stats *stats, struct dynar *outbuf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _QDEVICE_HEURISTICS_EXEC_STATS_H_ */
@@ -40,6 +40,7 @@
 #include "qdevice-heuristics-mode.h"
 #include "qdevice-heuristics-exec-list.h"
 #include "qdevice-heuristics-exec-result.h"
+#include "qdevice-heuristics-exec-stats.h"
 #include "qdevice-heuristics-result-notifier.h"
 
 #ifdef __cplusplus
@@ -66,6 +67,8 @@ struct qdevice_heuristics_instance {
 
 	struct qdevice_heuristics_exec_list exec_list;
 
+	struct qdevice_heuristics_exec_stats exec_stats;
+
 	struct qdevice_instance *qdevice_instance_ptr;
 
 	struct qdevice_heuristics_result_notifier_list exec_result_notifier_list;
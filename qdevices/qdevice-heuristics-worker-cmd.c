@@ -128,6 +128,81 @@ qdevice_heuristics_worker_cmd_process_exec_list_add(struct qdevice_heuristics_wo
 	return (0);
 }
 
+static int
+qdevice_heuristics_worker_cmd_process_exec_list_cache_timeout(
+    struct qdevice_heuristics_worker_instance *instance, struct dynar *data)
+{
+	uint32_t cache_timeout;
+	char *str;
+	int name_pos;
+	struct qdevice_heuristics_exec_list_entry *exec_list_entry;
+
+	str = dynar_data(data);
+	name_pos = 0;
+
+	if (sscanf(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT_ADD_SPACE "%"PRIu32" %n",
+	    &cache_timeout, &name_pos) != 1 || name_pos == 0 || str[name_pos] == '\0') {
+		qdevice_heuristics_worker_log_printf(instance, LOG_CRIT,
+		    "qdevice_heuristics_worker_cmd_process_exec_list_cache_timeout: Can't parse "
+		    "command (sscanf)");
+		return (-1);
+	}
+
+	exec_list_entry = qdevice_heuristics_exec_list_find_name(&instance->exec_list,
+	    str + name_pos);
+	if (exec_list_entry == NULL) {
+		qdevice_heuristics_worker_log_printf(instance, LOG_CRIT,
+		    "qdevice_heuristics_worker_cmd_process_exec_list_cache_timeout: Unknown exec "
+		    "name \"%s\"", str + name_pos);
+		return (-1);
+	}
+
+	exec_list_entry->cache_timeout = cache_timeout;
+
+	return (0);
+}
+
+static int
+qdevice_heuristics_worker_cmd_process_exec_result_set(struct qdevice_heuristics_worker_instance *instance,
+    struct dynar *data)
+{
+	enum qdevice_heuristics_exec_result exec_result;
+	char *str;
+	int name_pos;
+	struct qdevice_heuristics_exec_list_entry *exec_list_entry;
+
+	str = dynar_data(data);
+	name_pos = 0;
+
+	if (sscanf(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET_ADD_SPACE "%u %n",
+	    &exec_result, &name_pos) != 1 || name_pos == 0 || str[name_pos] == '\0') {
+		qdevice_heuristics_worker_log_printf(instance, LOG_CRIT,
+		    "qdevice_heuristics_worker_cmd_process_exec_result_set: Can't parse command (sscanf)");
+		return (-1);
+	}
+
+	exec_list_entry = qdevice_heuristics_exec_list_find_name(&instance->exec_list,
+	    str + name_pos);
+	if (exec_list_entry == NULL) {
+		/*
+		 * Exec list may have changed in the meantime
+		 */
+		qdevice_heuristics_worker_log_printf(instance, LOG_DEBUG,
+		    "qdevice_heuristics_worker_cmd_process_exec_result_set: Unknown exec "
+		    "name \"%s\". Ignoring", str + name_pos);
+		return (0);
+	}
+
+	qdevice_heuristics_worker_log_printf(instance, LOG_DEBUG,
+	    "qdevice_heuristics_worker_cmd_process_exec_result_set: Received exec result set "
+	    "command for \"%s\" with result \"%u\"", exec_list_entry->name, exec_result);
+
+	qdevice_heuristics_exec_list_entry_set_result(exec_list_entry,
+	    (exec_result == QDEVICE_HEURISTICS_EXEC_RESULT_PASS), 1);
+
+	return (0);
+}
+
 static int
 qdevice_heuristics_worker_cmd_process_exec(struct qdevice_heuristics_worker_instance *instance,
     struct dynar *data)
@@ -137,6 +212,9 @@ qdevice_heuristics_worker_cmd_process_exec(struct qdevice_heuristics_worker_inst
 	char *str;
 	struct qdevice_heuristics_exec_list_entry *exec_list_entry;
 	struct process_list_entry *plist_entry;
+	size_t no_processes;
+	int cached_fail;
+	int result_pass;
 
 	str = dynar_data(data);
 
@@ -168,9 +246,28 @@ qdevice_heuristics_worker_cmd_process_exec(struct qdevice_heuristics_worker_inst
 		}
 	} else {
 		/*
-		 * Initialize process list (from exec list)
+		 * Initialize process list (from exec list). Execs with still valid cached
+		 * result are not executed.
 		 */
+		no_processes = 0;
+		cached_fail = 0;
+
 		TAILQ_FOREACH(exec_list_entry, &instance->exec_list, entries) {
+			if (qdevice_heuristics_exec_list_entry_get_cached_result(exec_list_entry,
+			    &result_pass)) {
+				qdevice_heuristics_worker_log_printf(instance, LOG_DEBUG,
+				    "qdevice_heuristics_worker_cmd_process_exec: Using cached "
+				    "result of %s (%s)", exec_list_entry->name,
+				    (result_pass ? "pass" : "fail"));
+
+				if (!result_pass) {
+					cached_fail = 1;
+					break;
+				}
+
+				continue ;
+			}
+
 			plist_entry = process_list_add(&instance->main_process_list,
 			    exec_list_entry->name, exec_list_entry->command);
 
@@ -190,6 +287,24 @@ qdevice_heuristics_worker_cmd_process_exec(struct qdevice_heuristics_worker_inst
 
 				return (0);
 			}
+
+			no_processes++;
+		}
+
+		if (cached_fail || no_processes == 0) {
+			/*
+			 * Result is known without executing anything
+			 */
+			process_list_move_active_entries_to_kill_list(&instance->main_process_list);
+
+			if (qdevice_heuristics_worker_cmd_write_exec_result(instance,
+			    instance->last_exec_seq_number,
+			    (cached_fail ? QDEVICE_HEURISTICS_EXEC_RESULT_FAIL :
+			    QDEVICE_HEURISTICS_EXEC_RESULT_PASS)) != 0) {
+				return (-1);
+			}
+
+			return (0);
 		}
 
 		if (process_list_exec_initialized(&instance->main_process_list) != 0) {
@@ -269,11 +384,22 @@ qdevice_heuristics_worker_cmd_process_one_line(struct qdevice_heuristics_worker_
 		    "qdevice_heuristics_worker_cmd_process_one_line: Received exec-list-clear command");
 
 		qdevice_heuristics_exec_list_free(&instance->exec_list);
+		process_list_command_cache_clear(&instance->main_process_list);
 	} else if (strncmp(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_ADD_SPACE,
 	    strlen(QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_ADD)) == 0) {
 		if (qdevice_heuristics_worker_cmd_process_exec_list_add(instance, data) != 0) {
 			return (-1);
 		}
+	} else if (strncmp(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT_ADD_SPACE,
+	    strlen(QDEVICE_HEURISTICS_CMD_STR_EXEC_LIST_CACHE_TIMEOUT_ADD_SPACE)) == 0) {
+		if (qdevice_heuristics_worker_cmd_process_exec_list_cache_timeout(instance, data) != 0) {
+			return (-1);
+		}
+	} else if (strncmp(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET_ADD_SPACE,
+	    strlen(QDEVICE_HEURISTICS_CMD_STR_EXEC_RESULT_SET_ADD_SPACE)) == 0) {
+		if (qdevice_heuristics_worker_cmd_process_exec_result_set(instance, data) != 0) {
+			return (-1);
+		}
 	} else if (strncmp(str, QDEVICE_HEURISTICS_CMD_STR_EXEC_ADD_SPACE,
 	    strlen(QDEVICE_HEURISTICS_CMD_STR_EXEC_ADD_SPACE)) == 0) {
 		if (qdevice_heuristics_worker_cmd_process_exec(instance, data) != 0) {
@@ -382,3 +508,23 @@ qdevice_heuristics_worker_cmd_write_exec_result(struct qdevice_heuristics_worker
 
 	return (0);
 }
+
+int
+qdevice_heuristics_worker_cmd_write_exec_time(struct qdevice_heuristics_worker_instance *instance,
+    const char *exec_name, uint64_t run_time_us)
+{
+	if (dynar_str_cpy(&instance->cmd_out_buffer,
+	    QDEVICE_HEURISTICS_CMD_STR_EXEC_TIME_ADD_SPACE) != -1 &&
+	    dynar_str_catf(&instance->cmd_out_buffer, "%"PRIu64" %s\n", run_time_us,
+	    exec_name) != -1) {
+		(void)qdevice_heuristics_io_blocking_write(QDEVICE_HEURISTICS_WORKER_CMD_OUT_FD,
+		    dynar_data(&instance->cmd_out_buffer), dynar_size(&instance->cmd_out_buffer));
+	} else {
+		qdevice_heuristics_worker_log_printf(instance, LOG_CRIT,
+		    "Can't alloc memory for exec time");
+
+		return (-1);
+	}
+
+	return (0);
+}
@@ -49,6 +49,10 @@ extern int		qdevice_heuristics_worker_cmd_write_exec_result(
     struct qdevice_heuristics_worker_instance *instance, uint32_t seq_number,
     enum qdevice_heuristics_exec_result exec_result);
 
+extern int		qdevice_heuristics_worker_cmd_write_exec_time(
+    struct qdevice_heuristics_worker_instance *instance, const char *exec_name,
+    uint64_t run_time_us);
+
 #ifdef __cplusplus
 }
 #endif
@@ -59,6 +59,8 @@ struct qdevice_heuristics_worker_instance {
 
 	uint32_t last_exec_seq_number;
 
+	int sigchld_pipe[2];
+
 	int schedule_exit;
 };
 
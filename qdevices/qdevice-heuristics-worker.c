@@ -34,6 +34,7 @@
 
 #include <limits.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -47,6 +48,7 @@
 #include "qdevice-heuristics-worker-instance.h"
 #include "qdevice-heuristics-worker-log.h"
 #include "qdevice-heuristics-worker-cmd.h"
+#include "utils.h"
 
 /*
  * Declarations
@@ -60,6 +62,11 @@ static void		qdevice_heuristics_worker_process_list_notify(
 
 static void		qdevice_heuristics_worker_signal_handlers_register(void);
 
+/*
+ * Write end of pipe used by SIGCHLD handler to wake up poll
+ */
+static int qdevice_heuristics_worker_sigchld_fd = -1;
+
 
 /*
  * Definitions
@@ -69,6 +76,7 @@ qdevice_heuristics_worker_process_list_notify(enum process_list_notify_reason re
     const struct process_list_entry *entry, void *user_data)
 {
 	struct qdevice_heuristics_worker_instance *instance;
+	struct qdevice_heuristics_exec_list_entry *exec_list_entry;
 
 	instance = (struct qdevice_heuristics_worker_instance *)user_data;
 
@@ -95,18 +103,47 @@ qdevice_heuristics_worker_process_list_notify(enum process_list_notify_reason re
 			qdevice_heuristics_worker_log_printf(instance, LOG_DEBUG,
 			    "process %s sucesfully finished", entry->name);
 		}
+
+		exec_list_entry = qdevice_heuristics_exec_list_find_name(&instance->exec_list,
+		    entry->name);
+		if (exec_list_entry != NULL) {
+			qdevice_heuristics_exec_list_entry_set_result(exec_list_entry,
+			    (WIFEXITED(entry->exit_status) && WEXITSTATUS(entry->exit_status) == 0), 0);
+		}
+
+		if (qdevice_heuristics_worker_cmd_write_exec_time(instance, entry->name,
+		    entry->run_time_us) != 0) {
+			instance->schedule_exit = 1;
+		}
 		break;
 	}
 }
 
+static void
+qdevice_heuristics_worker_sigchld_handler(int sig)
+{
+	int saved_errno;
+
+	saved_errno = errno;
+
+	if (qdevice_heuristics_worker_sigchld_fd != -1) {
+		(void)write(qdevice_heuristics_worker_sigchld_fd, "", 1);
+	}
+
+	errno = saved_errno;
+}
+
 static void
 qdevice_heuristics_worker_signal_handlers_register(void)
 {
 	struct sigaction act;
 
-	act.sa_handler = SIG_DFL;
+	/*
+	 * Finished process wakes up poll so result is sent without delay
+	 */
+	act.sa_handler = qdevice_heuristics_worker_sigchld_handler;
 	sigemptyset(&act.sa_mask);
-	act.sa_flags = SA_RESTART;
+	act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
 
 	sigaction(SIGCHLD, &act, NULL);
 
@@ -181,24 +218,38 @@ static int
 qdevice_heuristics_worker_poll(struct qdevice_heuristics_worker_instance *instance)
 {
 	int poll_res;
-	struct pollfd poll_input_fd;
+	struct pollfd poll_fds[2];
+	struct pollfd *poll_input_fd;
 	uint32_t timeout;
 	int plist_summary;
+	char buf[64];
 
 	/*
-	 * Poll command input
+	 * Poll command input and SIGCHLD pipe
 	 */
-	poll_input_fd.fd = QDEVICE_HEURISTICS_WORKER_CMD_IN_FD;
-	poll_input_fd.events = POLLIN;
-	poll_input_fd.revents = 0;
+	poll_input_fd = &poll_fds[0];
+	poll_input_fd->fd = QDEVICE_HEURISTICS_WORKER_CMD_IN_FD;
+	poll_input_fd->events = POLLIN;
+	poll_input_fd->revents = 0;
+
+	poll_fds[1].fd = instance->sigchld_pipe[0];
+	poll_fds[1].events = POLLIN;
+	poll_fds[1].revents = 0;
 
 	timeout = timer_list_time_to_expire_ms(&instance->main_timer_list);
 	if (timeout > QDEVICE_MIN_HEURISTICS_TIMEOUT) {
 		timeout = QDEVICE_MIN_HEURISTICS_TIMEOUT;
 	}
 
-	if ((poll_res = poll(&poll_input_fd, 1, timeout)) >= 0) {
-		if (poll_input_fd.revents & POLLIN) {
+	if ((poll_res = poll(poll_fds, 2, timeout)) >= 0) {
+		if (poll_fds[1].revents & POLLIN) {
+			/*
+			 * Drain pipe. Processes are waited bellow
+			 */
+			while (read(instance->sigchld_pipe[0], buf, sizeof(buf)) > 0) ;
+		}
+
+		if (poll_input_fd->revents & POLLIN) {
 			/*
 			 * POLLIN
 			 */
@@ -207,7 +258,7 @@ qdevice_heuristics_worker_poll(struct qdevice_heuristics_worker_instance *instan
 			}
 		}
 
-		if (poll_input_fd.revents & POLLOUT) {
+		if (poll_input_fd->revents & POLLOUT) {
 			/*
 			 * Pollout shouldn't happen (critical error)
 			 */
@@ -217,8 +268,8 @@ qdevice_heuristics_worker_poll(struct qdevice_heuristics_worker_instance *instan
 			return (-1);
 		}
 
-		if (poll_input_fd.revents & (POLLERR|POLLHUP|POLLNVAL) &&
-		    !(poll_input_fd.revents & (POLLIN|POLLOUT))) {
+		if (poll_input_fd->revents & (POLLERR|POLLHUP|POLLNVAL) &&
+		    !(poll_input_fd->revents & (POLLIN|POLLOUT))) {
 			/*
 			 * Qdevice closed pipe
 			 */
@@ -293,7 +344,7 @@ qdevice_heuristics_worker_poll(struct qdevice_heuristics_worker_instance *instan
 
 void
 qdevice_heuristics_worker_start(size_t ipc_max_send_receive_size, int use_execvp,
-    size_t max_processes, uint32_t kill_list_interval)
+    int use_spawn, size_t max_processes, uint32_t kill_list_interval)
 {
 	struct qdevice_heuristics_worker_instance instance;
 
@@ -305,9 +356,23 @@ qdevice_heuristics_worker_start(size_t ipc_max_send_receive_size, int use_execvp
 	dynar_init(&instance.cmd_out_buffer, ipc_max_send_receive_size);
 	dynar_init(&instance.log_out_buffer, ipc_max_send_receive_size);
 
-	process_list_init(&instance.main_process_list, max_processes, use_execvp,
+	process_list_init(&instance.main_process_list, max_processes, use_execvp, use_spawn,
 	    qdevice_heuristics_worker_process_list_notify, (void *)&instance);
 
+	/*
+	 * Pipe must not be inherited by executed processes
+	 */
+	if (pipe(instance.sigchld_pipe) != 0 ||
+	    utils_fd_set_non_blocking(instance.sigchld_pipe[0]) != 0 ||
+	    utils_fd_set_non_blocking(instance.sigchld_pipe[1]) != 0 ||
+	    fcntl(instance.sigchld_pipe[0], F_SETFD, FD_CLOEXEC) != 0 ||
+	    fcntl(instance.sigchld_pipe[1], F_SETFD, FD_CLOEXEC) != 0) {
+		qdevice_heuristics_worker_log_printf(&instance, LOG_CRIT,
+		    "Can't create SIGCHLD pipe");
+		return ;
+	}
+	qdevice_heuristics_worker_sigchld_fd = instance.sigchld_pipe[1];
+
 	timer_list_init(&instance.main_timer_list);
 	instance.kill_list_timer = timer_list_add(&instance.main_timer_list,
 	    kill_list_interval, qdevice_heuristics_worker_kill_list_timer_callback,
@@ -347,6 +412,10 @@ qdevice_heuristics_worker_start(size_t ipc_max_send_receive_size, int use_execvp
 
 	process_list_free(&instance.main_process_list);
 
+	qdevice_heuristics_worker_sigchld_fd = -1;
+	close(instance.sigchld_pipe[0]);
+	close(instance.sigchld_pipe[1]);
+
 	dynar_destroy(&instance.cmd_in_buffer);
 	dynar_destroy(&instance.cmd_out_buffer);
 	dynar_destroy(&instance.log_out_buffer);
@@ -44,7 +44,7 @@ extern "C" {
 #define QDEVICE_HEURISTICS_WORKER_LOG_OUT_FD		2
 
 void		qdevice_heuristics_worker_start(size_t ipc_max_send_receive_size,
-    int use_execvp, size_t max_processes, uint32_t kill_list_interval);
+    int use_execvp, int use_spawn, size_t max_processes, uint32_t kill_list_interval);
 
 int		qdevice_heuristics_worker_exec_timeout_timer_callback(void *data1, void *data2);
 
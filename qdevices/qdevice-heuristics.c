@@ -100,7 +100,8 @@ qdevice_heuristics_init(struct qdevice_heuristics_instance *instance,
 		close(pipe_log_out[1]);
 
 		qdevice_heuristics_worker_start(advanced_settings->heuristics_ipc_max_send_receive_size,
-		    advanced_settings->heuristics_use_execvp, advanced_settings->heuristics_max_processes,
+		    advanced_settings->heuristics_use_execvp, advanced_settings->heuristics_use_spawn,
+		    advanced_settings->heuristics_max_processes,
 		    advanced_settings->heuristics_kill_list_interval);
 
 		qdevice_advanced_settings_destroy(advanced_settings);
@@ -202,6 +203,7 @@ qdevice_heuristics_change_exec_list(struct qdevice_heuristics_instance *instance
 	}
 
 	qdevice_heuristics_exec_list_free(&instance->exec_list);
+	qdevice_heuristics_exec_stats_free(&instance->exec_stats);
 
 	if (new_exec_list != NULL) {
 		if (qdevice_heuristics_exec_list_clone(&instance->exec_list, new_exec_list) != 0) {
@@ -222,6 +224,28 @@ qdevice_heuristics_change_exec_list(struct qdevice_heuristics_instance *instance
 	return (0);
 }
 
+/*
+ * Store result of heuristics exec_name into worker result cache.
+ * Returns 0 on success, -1 on error and -2 if exec_name is not known.
+ */
+int
+qdevice_heuristics_push_result(struct qdevice_heuristics_instance *instance,
+    const char *exec_name, enum qdevice_heuristics_exec_result exec_result)
+{
+
+	if (qdevice_heuristics_exec_list_find_name(&instance->exec_list, exec_name) == NULL) {
+		return (-2);
+	}
+
+	qdevice_log(LOG_DEBUG, "Heuristics %s result pushed as %s", exec_name,
+	    qdevice_heuristics_exec_result_to_str(exec_result));
+
+	if (qdevice_heuristics_cmd_write_exec_result_set(instance, exec_name, exec_result) != 0) {
+		return (-1);
+	}
+
+	return (0);
+}
 
 int
 qdevice_heuristics_wait_for_initial_exec_result(struct qdevice_heuristics_instance *instance)
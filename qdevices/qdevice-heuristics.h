@@ -60,6 +60,10 @@ extern int		qdevice_heuristics_change_exec_list(
     struct qdevice_heuristics_instance *instance,
     const struct qdevice_heuristics_exec_list *new_exec_list, int sync_in_progress);
 
+extern int		qdevice_heuristics_push_result(
+    struct qdevice_heuristics_instance *instance, const char *exec_name,
+    enum qdevice_heuristics_exec_result exec_result);
+
 extern int		qdevice_heuristics_wait_for_initial_exec_result(
     struct qdevice_heuristics_instance *instance);
 
@@ -63,6 +63,38 @@ qdevice_instance_destroy(struct qdevice_instance *instance)
 	return (0);
 }
 
+/*
+ * Parse heuristics cache timeout key. Value of cache_timeout is unchanged if key doesn't exist.
+ * Returns 0 on success, -1 if value is not valid.
+ */
+static int
+qdevice_instance_get_heuristics_cache_timeout(struct qdevice_instance *instance,
+    const char *key_name, uint32_t *cache_timeout)
+{
+	char *str;
+	long int li;
+	char *ep;
+
+	if (cmap_get_string(instance->cmap_handle, key_name, &str) != CS_OK) {
+		return (0);
+	}
+
+	li = strtol(str, &ep, 10);
+	if (li < 0 || li > instance->advanced_settings->heuristics_max_interval || *ep != '\0') {
+		qdevice_log(LOG_ERR, "%s must be valid number in range <0,%"PRIu32">",
+		    key_name, instance->advanced_settings->heuristics_max_interval);
+
+		free(str);
+		return (-1);
+	}
+
+	*cache_timeout = li;
+
+	free(str);
+
+	return (0);
+}
+
 int
 qdevice_instance_configure_from_cmap_heuristics(struct qdevice_instance *instance)
 {
@@ -78,6 +110,8 @@ qdevice_instance_configure_from_cmap_heuristics(struct qdevice_instance *instanc
 	cmap_value_types_t type;
 	struct qdevice_heuristics_exec_list tmp_exec_list;
 	struct qdevice_heuristics_exec_list *exec_list;
+	struct qdevice_heuristics_exec_list_entry *exec_list_entry;
+	uint32_t cache_timeout;
 	char *command;
 	char exec_name[CMAP_KEYNAME_MAXLEN + 1];
 	char tmp_key[CMAP_KEYNAME_MAXLEN + 1];
@@ -213,6 +247,31 @@ qdevice_instance_configure_from_cmap_heuristics(struct qdevice_instance *instanc
 			free(command);
 		}
 
+		/*
+		 * Validity of cached results. Global value can be overridden per exec
+		 */
+		cache_timeout = QDEVICE_DEFAULT_HEURISTICS_CACHE_TIMEOUT;
+		if (qdevice_instance_get_heuristics_cache_timeout(instance,
+		    "quorum.device.heuristics.cache_timeout", &cache_timeout) != 0) {
+			qdevice_heuristics_exec_list_free(&tmp_exec_list);
+
+			return (-1);
+		}
+
+		TAILQ_FOREACH(exec_list_entry, &tmp_exec_list, entries) {
+			exec_list_entry->cache_timeout = cache_timeout;
+
+			snprintf(key_name, sizeof(key_name), "quorum.device.heuristics.cache_timeout_%s",
+			    exec_list_entry->name);
+
+			if (qdevice_instance_get_heuristics_cache_timeout(instance, key_name,
+			    &exec_list_entry->cache_timeout) != 0) {
+				qdevice_heuristics_exec_list_free(&tmp_exec_list);
+
+				return (-1);
+			}
+		}
+
 		no_execs = qdevice_heuristics_exec_list_size(&tmp_exec_list);
 
 		if (no_execs == 0) {
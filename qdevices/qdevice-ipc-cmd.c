@@ -32,6 +32,7 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "qdevice-heuristics.h"
 #include "qdevice-ipc-cmd.h"
 #include "qdevice-log.h"
 #include "qdevice-model.h"
@@ -252,8 +253,18 @@ qdevice_ipc_cmd_status_add_heuristics(struct qdevice_instance *instance, struct
 		return (1);
 	}
 
-	return (dynar_str_catf(outbuf, "Heuristics:\t\t%s\n",
-	    qdevice_heuristics_mode_to_str(instance->heuristics_instance.mode)) != 0);
+	if (dynar_str_catf(outbuf, "Heuristics:\t\t%s\n",
+	    qdevice_heuristics_mode_to_str(instance->heuristics_instance.mode)) == -1) {
+		return (0);
+	}
+
+	if (TAILQ_EMPTY(&instance->heuristics_instance.exec_stats)) {
+		return (1);
+	}
+
+	return (dynar_str_catf(outbuf, "Heuristics exec times:\n") != -1 &&
+	    qdevice_heuristics_exec_stats_str(&instance->heuristics_instance.exec_stats,
+	    outbuf) != -1);
 }
 
 int
@@ -277,3 +288,26 @@ qdevice_ipc_cmd_status(struct qdevice_instance *instance, struct dynar *outbuf,
 
 	return (-1);
 }
+
+/*
+ * 0 - No error
+ * -1 - Internal error
+ * -2 - Unknown heuristics exec name
+ */
+int
+qdevice_ipc_cmd_heuristics_result(struct qdevice_instance *instance, const char *exec_name,
+    enum qdevice_heuristics_exec_result exec_result)
+{
+	int res;
+
+	res = qdevice_heuristics_push_result(&instance->heuristics_instance, exec_name, exec_result);
+	if (res != 0) {
+		return (res);
+	}
+
+	if (qdevice_model_heuristics_result_pushed(instance) != 0) {
+		return (-1);
+	}
+
+	return (0);
+}
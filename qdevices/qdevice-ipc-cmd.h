@@ -37,6 +37,7 @@
 
 #include "dynar.h"
 #include "qdevice-instance.h"
+#include "qdevice-heuristics-exec-result.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,9 @@ extern "C" {
 extern int	qdevice_ipc_cmd_status(struct qdevice_instance *instance, struct dynar *outbuf,
     int verbose);
 
+extern int	qdevice_ipc_cmd_heuristics_result(struct qdevice_instance *instance,
+    const char *exec_name, enum qdevice_heuristics_exec_result exec_result);
+
 #ifdef __cplusplus
 }
 #endif
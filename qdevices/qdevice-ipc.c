@@ -191,6 +191,69 @@ qdevice_ipc_send_buffer(struct qdevice_instance *instance, struct unix_socket_cl
 	return (0);
 }
 
+static void
+qdevice_ipc_parse_heuristics_result(struct qdevice_instance *instance,
+    struct unix_socket_client *client, struct dynar_simple_lex *lex)
+{
+	struct dynar *token;
+	char *exec_name;
+	char *str;
+	enum qdevice_heuristics_exec_result exec_result;
+	int res;
+
+	token = dynar_simple_lex_token_next(lex);
+	if (token == NULL || (str = dynar_data(token), strcmp(str, "")) == 0) {
+		if (qdevice_ipc_send_error(instance, client, "Heuristics exec name not specified") != 0) {
+			client->schedule_disconnect = 1;
+		}
+
+		return ;
+	}
+
+	exec_name = strdup(str);
+	if (exec_name == NULL) {
+		qdevice_log(LOG_ERR, "Can't alloc memory for heuristics exec name");
+		client->schedule_disconnect = 1;
+
+		return ;
+	}
+
+	token = dynar_simple_lex_token_next(lex);
+	if (token != NULL && strcasecmp(dynar_data(token), "pass") == 0) {
+		exec_result = QDEVICE_HEURISTICS_EXEC_RESULT_PASS;
+	} else if (token != NULL && strcasecmp(dynar_data(token), "fail") == 0) {
+		exec_result = QDEVICE_HEURISTICS_EXEC_RESULT_FAIL;
+	} else {
+		if (qdevice_ipc_send_error(instance, client,
+		    "Heuristics result must be pass or fail") != 0) {
+			client->schedule_disconnect = 1;
+		}
+
+		free(exec_name);
+		return ;
+	}
+
+	qdevice_log(LOG_DEBUG, "IPC client pushed heuristics %s result", exec_name);
+
+	res = qdevice_ipc_cmd_heuristics_result(instance, exec_name, exec_result);
+	if (res == -2) {
+		if (qdevice_ipc_send_error(instance, client, "Unknown heuristics exec '%s'",
+		    exec_name) != 0) {
+			client->schedule_disconnect = 1;
+		}
+	} else if (res != 0) {
+		if (qdevice_ipc_send_error(instance, client, "Can't store heuristics result") != 0) {
+			client->schedule_disconnect = 1;
+		}
+	} else {
+		if (qdevice_ipc_send_buffer(instance, client) != 0) {
+			client->schedule_disconnect = 1;
+		}
+	}
+
+	free(exec_name);
+}
+
 static void
 qdevice_ipc_parse_line(struct qdevice_instance *instance, struct unix_socket_client *client)
 {
@@ -249,6 +312,8 @@ qdevice_ipc_parse_line(struct qdevice_instance *instance, struct unix_socket_cli
 				client->schedule_disconnect = 1;
 			}
 		}
+	} else if (strcasecmp(str, "heuristics-result") == 0) {
+		qdevice_ipc_parse_heuristics_result(instance, client, &lex);
 	} else {
 		qdevice_log(LOG_DEBUG, "IPC client sent unknown command");
 		if (qdevice_ipc_send_error(instance, client, "Unknown command '%s'", str) != 0) {
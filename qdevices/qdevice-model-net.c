@@ -649,6 +649,21 @@ qdevice_model_net_cmap_changed(struct qdevice_instance *instance,
 	return (0);
 }
 
+int
+qdevice_model_net_heuristics_result_pushed(struct qdevice_instance *instance)
+{
+	struct qdevice_net_instance *net_instance;
+
+	net_instance = instance->model_data;
+
+	/*
+	 * Error is handled by scheduling disconnect
+	 */
+	(void)qdevice_net_heuristics_exec_regular_now(net_instance);
+
+	return (0);
+}
+
 int
 qdevice_model_net_ipc_cmd_status(struct qdevice_instance *instance,
     struct dynar *outbuf, int verbose)
@@ -676,6 +691,7 @@ static struct qdevice_model qdevice_model_net = {
 	.votequorum_node_list_heuristics_notify	= qdevice_model_net_votequorum_node_list_heuristics_notify,
 	.votequorum_expected_votes_notify	= qdevice_model_net_votequorum_expected_votes_notify,
 	.cmap_changed				= qdevice_model_net_cmap_changed,
+	.heuristics_result_pushed		= qdevice_model_net_heuristics_result_pushed,
 	.ipc_cmd_status				= qdevice_model_net_ipc_cmd_status,
 };
 
@@ -70,6 +70,8 @@ extern int 	qdevice_model_net_votequorum_expected_votes_notify(struct qdevice_in
 extern int      qdevice_model_net_cmap_changed(struct qdevice_instance *instance,
     const struct qdevice_cmap_change_events *events);
 
+extern int	qdevice_model_net_heuristics_result_pushed(struct qdevice_instance *instance);
+
 extern int	qdevice_model_net_ipc_cmd_status(struct qdevice_instance *instance,
     struct dynar *outbuf, int verbose);
 
@@ -196,6 +196,20 @@ qdevice_model_cmap_changed(struct qdevice_instance *instance,
 	    cmap_changed(instance, events));
 }
 
+int
+qdevice_model_heuristics_result_pushed(struct qdevice_instance *instance)
+{
+
+	if (instance->model_type >= QDEVICE_MODEL_TYPE_ARRAY_SIZE ||
+	    qdevice_model_array[instance->model_type] == NULL) {
+		qdevice_log(LOG_CRIT, "qdevice_model_heuristics_result_pushed unhandled model");
+		exit(1);
+	}
+
+	return (qdevice_model_array[instance->model_type]->
+	    heuristics_result_pushed(instance));
+}
+
 int
 qdevice_model_register(enum qdevice_model_type model_type,
     struct qdevice_model *model)
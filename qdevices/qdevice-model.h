@@ -74,6 +74,8 @@ extern int	qdevice_model_ipc_cmd_status(struct qdevice_instance *instance,
 extern int	qdevice_model_cmap_changed(struct qdevice_instance *instance,
     const struct qdevice_cmap_change_events *events);
 
+extern int	qdevice_model_heuristics_result_pushed(struct qdevice_instance *instance);
+
 struct qdevice_model {
 	const char *name;
 	int (*init)(struct qdevice_instance *instance);
@@ -95,6 +97,7 @@ struct qdevice_model {
 	int (*ipc_cmd_status)(struct qdevice_instance *instance, struct dynar *outbuf, int verbose);
 	int (*cmap_changed)(struct qdevice_instance *instance,
 	    const struct qdevice_cmap_change_events *events);
+	int (*heuristics_result_pushed)(struct qdevice_instance *instance);
 };
 
 extern int		 qdevice_model_register(
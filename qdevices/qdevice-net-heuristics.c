@@ -404,6 +404,49 @@ qdevice_net_heuristics_schedule_timer(struct qdevice_net_instance *net_instance)
 	return (0);
 }
 
+/*
+ * Run regular heuristics as soon as possible (instead of waiting for interval) so
+ * change of heuristics result is propagated to qnetd without delay.
+ */
+int
+qdevice_net_heuristics_exec_regular_now(struct qdevice_net_instance *net_instance)
+{
+	struct qdevice_heuristics_instance *heuristics_instance;
+
+	heuristics_instance = &net_instance->qdevice_instance_ptr->heuristics_instance;
+
+	if (net_instance->regular_heuristics_timer == NULL) {
+		qdevice_log(LOG_DEBUG, "Not executing regular heuristics now because they are "
+		    "not scheduled");
+
+		return (0);
+	}
+
+	if (qdevice_heuristics_waiting_for_result(heuristics_instance)) {
+		qdevice_log(LOG_DEBUG, "Not executing regular heuristics now because other "
+		    "heuristics is already running");
+
+		return (0);
+	}
+
+	timer_list_delete(&net_instance->main_timer_list, net_instance->regular_heuristics_timer);
+
+	net_instance->regular_heuristics_timer = timer_list_add(&net_instance->main_timer_list,
+		0,
+		qdevice_net_heuristics_timer_callback,
+	        (void *)net_instance, NULL);
+
+	if (net_instance->regular_heuristics_timer == NULL) {
+		qdevice_log(LOG_ERR, "Can't schedule regular heuristics.");
+
+		net_instance->disconnect_reason = QDEVICE_NET_DISCONNECT_REASON_CANT_SCHEDULE_HEURISTICS_TIMER;
+		net_instance->schedule_disconnect = 1;
+		return (-1);
+	}
+
+	return (0);
+}
+
 int
 qdevice_net_heuristics_init(struct qdevice_net_instance *net_instance)
 {
@@ -50,6 +50,9 @@ extern int			qdevice_net_heuristics_stop_timer(struct qdevice_net_instance *net_
 
 extern int			qdevice_net_heuristics_schedule_timer(struct qdevice_net_instance *net_instance);
 
+extern int			qdevice_net_heuristics_exec_regular_now(
+    struct qdevice_net_instance *net_instance);
+
 extern int			qdevice_net_heuristics_init(struct qdevice_net_instance *net_instance);
 
 extern int			qdevice_net_heuristics_exec_after_connect(struct qdevice_net_instance *net_instance);
@@ -142,8 +142,9 @@ qdevice_net_socket_write_finished(struct qdevice_net_instance *instance)
 		if ((new_pr_fd = nss_sock_start_ssl_as_client(instance->socket,
 		    instance->advanced_settings->net_nss_qnetd_cn,
 		    qdevice_net_nss_bad_cert_hook,
-		    qdevice_net_nss_get_client_auth_data,
-		    instance, 0, NULL)) == NULL) {
+		    qdevice_net_nss_get_client_auth_data, instance,
+		    instance->advanced_settings->net_tls_session_resumption,
+		    instance->advanced_settings->net_tls_session_resumption, 0, NULL)) == NULL) {
 			qdevice_log_nss(LOG_ERR, "Can't start TLS");
 			instance->disconnect_reason = QDEVICE_NET_DISCONNECT_REASON_CANT_START_TLS;
 			return (-1);
@@ -172,6 +173,7 @@ qdevice_net_socket_write(struct qdevice_net_instance *instance)
 	int res;
 	struct send_buffer_list_entry *send_buffer;
 	enum msg_type sent_msg_type;
+	size_t max_msgs;
 
 	send_buffer = send_buffer_list_get_active(&instance->send_buffer_list);
 	if (send_buffer == NULL) {
@@ -181,10 +183,21 @@ qdevice_net_socket_write(struct qdevice_net_instance *instance)
 		return (-1);
 	}
 
-	res = msgio_write(instance->socket, &send_buffer->buffer,
-	    &send_buffer->msg_already_sent_bytes);
+	/*
+	 * Socket is replaced by TLS one after StartTLS is sent, so no message queued after
+	 * StartTLS can be sent together with it.
+	 */
+	if (instance->state == QDEVICE_NET_INSTANCE_STATE_WAITING_STARTTLS_BEING_SENT) {
+		max_msgs = 1;
+	} else {
+		max_msgs = MSGIO_MAX_IOV;
+	}
+
+	res = msgio_write_list(instance->socket, &instance->send_buffer_list, max_msgs);
 
-	if (res == 1) {
+	while (res == 1 &&
+	    (send_buffer = send_buffer_list_get_active(&instance->send_buffer_list)) != NULL &&
+	    send_buffer->msg_already_sent_bytes == dynar_size(&send_buffer->buffer)) {
 		sent_msg_type = msg_get_type(&send_buffer->buffer);
 
 		send_buffer_list_delete(&instance->send_buffer_list, send_buffer);
@@ -65,6 +65,13 @@ extern "C" {
 
 #define QNETD_DEFAULT_TLS_SUPPORTED			TLV_TLS_SUPPORTED
 #define QNETD_DEFAULT_TLS_CLIENT_CERT_REQUIRED		1
+#define QNETD_DEFAULT_TLS_SESSION_CACHE			1
+#define QNETD_DEFAULT_TLS_SESSION_CACHE_SIZE		10000
+#define QNETD_MIN_TLS_SESSION_CACHE_SIZE		1
+#define QNETD_DEFAULT_TLS_SESSION_TIMEOUT		86400
+#define QNETD_MIN_TLS_SESSION_TIMEOUT			5
+#define QNETD_MAX_TLS_SESSION_TIMEOUT			86400
+#define QNETD_DEFAULT_TLS_SESSION_TICKETS		1
 
 #define QNETD_DEFAULT_HEARTBEAT_INTERVAL_MIN		(1*1000)
 #define QNETD_DEFAULT_HEARTBEAT_INTERVAL_MAX		(2*60*1000)
@@ -85,8 +92,14 @@ extern "C" {
 #define QNETD_DEFAULT_IPC_MAX_SEND_SIZE			(10*1024*1024)
 #define QNETD_MIN_IPC_RECEIVE_SEND_SIZE			1024
 
+#define QNETD_DEFAULT_WORKER_THREADS			0
+#define QNETD_DEFAULT_HANDSHAKE_THREADS			0
+#define QNETD_MAX_WORKER_THREADS			256
+
 #define QNETD_TOOL_PROGRAM_NAME				"corosync-qnetd-tool"
 
+#define QNETD_LOADGEN_PROGRAM_NAME			"corosync-qnetd-loadgen"
+
 #define QDEVICE_NET_DEFAULT_NSS_DB_DIR			COROSYSCONFDIR "/qdevice/net/nssdb"
 
 #define QDEVICE_NET_DEFAULT_INITIAL_MSG_RECEIVE_SIZE	(1 << 15)
@@ -105,6 +118,7 @@ extern "C" {
 #define QDEVICE_NET_DEFAULT_ALGORITHM			TLV_DECISION_ALGORITHM_TYPE_FFSPLIT
 
 #define QDEVICE_NET_DEFAULT_TLS_SUPPORTED		TLV_TLS_SUPPORTED
+#define QDEVICE_NET_DEFAULT_TLS_SESSION_RESUMPTION	1
 
 #define QDEVICE_NET_DEFAULT_TIE_BREAKER_MODE		TLV_TIE_BREAKER_MODE_LOWEST
 
@@ -72,6 +72,12 @@ qnetd_advanced_settings_init(struct qnetd_advanced_settings *settings)
 	settings->ipc_max_clients = QNETD_DEFAULT_IPC_MAX_CLIENTS;
 	settings->ipc_max_receive_size = QNETD_DEFAULT_IPC_MAX_RECEIVE_SIZE;
 	settings->ipc_max_send_size = QNETD_DEFAULT_IPC_MAX_SEND_SIZE;
+	settings->worker_threads = QNETD_DEFAULT_WORKER_THREADS;
+	settings->handshake_threads = QNETD_DEFAULT_HANDSHAKE_THREADS;
+	settings->tls_session_cache = QNETD_DEFAULT_TLS_SESSION_CACHE;
+	settings->tls_session_cache_size = QNETD_DEFAULT_TLS_SESSION_CACHE_SIZE;
+	settings->tls_session_timeout = QNETD_DEFAULT_TLS_SESSION_TIMEOUT;
+	settings->tls_session_tickets = QNETD_DEFAULT_TLS_SESSION_TICKETS;
 
 	return (0);
 }
@@ -205,6 +211,48 @@ qnetd_advanced_settings_set(struct qnetd_advanced_settings *settings,
 		}
 
 		settings->ipc_max_send_size = (size_t)tmpll;
+	} else if (strcasecmp(option, "worker_threads") == 0) {
+		tmpll = strtoll(value, &ep, 10);
+		if (tmpll < 0 || tmpll > QNETD_MAX_WORKER_THREADS || errno != 0 || *ep != '\0') {
+			return (-2);
+		}
+
+		settings->worker_threads = (size_t)tmpll;
+	} else if (strcasecmp(option, "handshake_threads") == 0) {
+		tmpll = strtoll(value, &ep, 10);
+		if (tmpll < 0 || tmpll > QNETD_MAX_WORKER_THREADS || errno != 0 || *ep != '\0') {
+			return (-2);
+		}
+
+		settings->handshake_threads = (size_t)tmpll;
+	} else if (strcasecmp(option, "tls_session_cache") == 0) {
+		if ((tmpll = utils_parse_bool_str(value)) == -1) {
+			return (-2);
+		}
+
+		settings->tls_session_cache = (uint8_t)tmpll;
+	} else if (strcasecmp(option, "tls_session_cache_size") == 0) {
+		tmpll = strtoll(value, &ep, 10);
+		if (tmpll < QNETD_MIN_TLS_SESSION_CACHE_SIZE || tmpll > UINT32_MAX ||
+		    errno != 0 || *ep != '\0') {
+			return (-2);
+		}
+
+		settings->tls_session_cache_size = (uint32_t)tmpll;
+	} else if (strcasecmp(option, "tls_session_timeout") == 0) {
+		tmpll = strtoll(value, &ep, 10);
+		if (tmpll < QNETD_MIN_TLS_SESSION_TIMEOUT || tmpll > QNETD_MAX_TLS_SESSION_TIMEOUT ||
+		    errno != 0 || *ep != '\0') {
+			return (-2);
+		}
+
+		settings->tls_session_timeout = (uint32_t)tmpll;
+	} else if (strcasecmp(option, "tls_session_tickets") == 0) {
+		if ((tmpll = utils_parse_bool_str(value)) == -1) {
+			return (-2);
+		}
+
+		settings->tls_session_tickets = (uint8_t)tmpll;
 	} else {
 		return (-1);
 	}
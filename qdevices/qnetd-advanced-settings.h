@@ -56,6 +56,12 @@ struct qnetd_advanced_settings {
 	size_t ipc_max_clients;
 	size_t ipc_max_send_size;
 	size_t ipc_max_receive_size;
+	size_t worker_threads;
+	size_t handshake_threads;
+	uint8_t tls_session_cache;
+	uint32_t tls_session_cache_size;
+	uint32_t tls_session_timeout;
+	uint8_t tls_session_tickets;
 };
 
 extern int		qnetd_advanced_settings_init(struct qnetd_advanced_settings *settings);
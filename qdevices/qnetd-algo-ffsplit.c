@@ -152,64 +152,80 @@ qnetd_algo_ffsplit_is_preferred_partition(const struct qnetd_client *client,
 	return (node_list_find_node_id(membership_node_list, preferred_node_id) != NULL);
 }
 
+/*
+ * Return 1 if all node ids from node_list1 are also in node_list2. Lists of clients
+ * in the same partition are usually equal (including order), so this case is
+ * detected first in linear time before searching for each node.
+ */
+static int
+qnetd_algo_ffsplit_node_list_is_subset(const struct node_list *node_list1,
+    const struct node_list *node_list2)
+{
+	const struct node_list_entry *iter_node1, *iter_node2;
+
+	iter_node2 = TAILQ_FIRST(node_list2);
+	TAILQ_FOREACH(iter_node1, node_list1, entries) {
+		if (iter_node2 == NULL || iter_node1->node_id != iter_node2->node_id) {
+			break;
+		}
+
+		iter_node2 = TAILQ_NEXT(iter_node2, entries);
+	}
+
+	if (iter_node1 == NULL) {
+		/*
+		 * node_list1 is prefix of node_list2
+		 */
+		return (1);
+	}
+
+	TAILQ_FOREACH(iter_node1, node_list1, entries) {
+		if (node_list_find_node_id(node_list2, iter_node1->node_id) == NULL) {
+			return (0);
+		}
+	}
+
+	return (1);
+}
+
 static int
 qnetd_algo_ffsplit_is_membership_stable(const struct qnetd_client *client, int client_leaving,
     const struct tlv_ring_id *ring_id, const struct node_list *config_node_list,
     const struct node_list *membership_node_list)
 {
 	const struct qnetd_client *iter_client1, *iter_client2;
-	const struct node_list *config_node_list1, *config_node_list2;
+	const struct node_list *config_node_list1, *ref_config_node_list;
 	const struct node_list *membership_node_list1, *membership_node_list2;
-	const struct node_list_entry *iter_node1, *iter_node2;
-	const struct node_list_entry *iter_node3, *iter_node4;
+	const struct node_list_entry *iter_node1;
 	const struct tlv_ring_id *ring_id1, *ring_id2;
 
 	/*
-	 * Test if all active clients share same config list.
+	 * Test if all active clients share same config list. All lists are equal when
+	 * each of them equals to config list of the first active client.
 	 */
+	ref_config_node_list = NULL;
 	TAILQ_FOREACH(iter_client1, &client->cluster->client_list, cluster_entries) {
-		TAILQ_FOREACH(iter_client2, &client->cluster->client_list, cluster_entries) {
-			if (iter_client1 == iter_client2) {
+		if (iter_client1->node_id == client->node_id) {
+			if (client_leaving) {
 				continue;
 			}
 
-			if (iter_client1->node_id == client->node_id) {
-				if (client_leaving) {
-					continue;
-				}
-
-				config_node_list1 = config_node_list;
-			} else {
-				config_node_list1 = &iter_client1->configuration_node_list;
-			}
+			config_node_list1 = config_node_list;
+		} else {
+			config_node_list1 = &iter_client1->configuration_node_list;
+		}
 
-			if (iter_client2->node_id == client->node_id) {
-				if (client_leaving) {
-					continue;
-				}
+		if (ref_config_node_list == NULL) {
+			ref_config_node_list = config_node_list1;
 
-				config_node_list2 = config_node_list;
-			} else {
-				config_node_list2 = &iter_client2->configuration_node_list;
-			}
+			continue;
+		}
 
-			/*
-			 * Walk thru all node ids in given config node list...
-			 */
-			TAILQ_FOREACH(iter_node1, config_node_list1, entries) {
-				/*
-				 * ... and try to find given node id in other list
-				 */
-				iter_node2 = node_list_find_node_id(config_node_list2, iter_node1->node_id);
-
-				if (iter_node2 == NULL) {
-					/*
-					 * Node with iter_node1->node_id was not found in
-					 * config_node_list2 -> lists doesn't match
-					 */
-					return (0);
-				}
-			}
+		if (!qnetd_algo_ffsplit_node_list_is_subset(config_node_list1,
+		    ref_config_node_list) ||
+		    !qnetd_algo_ffsplit_node_list_is_subset(ref_config_node_list,
+		    config_node_list1)) {
+			return (0);
 		}
 	}
 
@@ -265,22 +281,11 @@ qnetd_algo_ffsplit_is_membership_stable(const struct qnetd_client *client, int c
 			}
 
 			/*
-			 * Now compare that membership node list equals, so walk thru all
-			 * members ...
+			 * Now compare that membership node list equals
 			 */
-			TAILQ_FOREACH(iter_node3, membership_node_list1, entries) {
-				/*
-				 * ... and try to find given node id in other membership node list
-				 */
-				iter_node4 = node_list_find_node_id(membership_node_list2, iter_node3->node_id);
-
-				if (iter_node4 == NULL) {
-					/*
-					 * Node with iter_node3->node_id was not found in
-					 * membership_node_list2 -> lists doesn't match
-					 */
-					return (0);
-				}
+			if (!qnetd_algo_ffsplit_node_list_is_subset(membership_node_list1,
+			    membership_node_list2)) {
+				return (0);
 			}
 		}
 	}
@@ -556,7 +561,7 @@ qnetd_algo_ffsplit_send_votes(struct qnetd_client *client, int client_leaving,
 			if (qnetd_client_send_vote_info(iter_client,
 			    iter_client_data->vote_info_expected_seq_num, ring_id_to_send,
 			    vote_to_send) == -1) {
-				client->schedule_disconnect = 1;
+				qnetd_client_schedule_disconnect(client);
 			}
 		}
 	}
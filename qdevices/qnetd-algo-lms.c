@@ -62,16 +62,15 @@
 struct qnetd_algo_lms_info {
 	int num_config_nodes;
 	enum tlv_vote last_result;
-	partitions_list_t partition_list;
 };
 
 static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, const struct tlv_ring_id *cur_ring_id, enum tlv_vote *result_vote)
 {
  	struct qnetd_client *other_client;
 	struct qnetd_algo_lms_info *info = client->algorithm_data;
-	struct qnetd_algo_partition *cur_partition;
-	struct qnetd_algo_partition *largest_partition;
-	struct qnetd_algo_partition *best_score_partition;
+	struct qnetd_cluster_partition *cur_partition;
+	struct qnetd_cluster_partition *largest_partition;
+	struct qnetd_cluster_partition *best_score_partition;
 	const struct tlv_ring_id *ring_id = cur_ring_id;
 	int num_partitions;
 	int joint_leader;
@@ -88,11 +87,8 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 		return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 	}
 
-	/* Create and count the number of separate partitions */
-	if ( (num_partitions = qnetd_algo_create_partitions(client, &info->partition_list, ring_id)) == -1) {
-		qnetd_log(LOG_DEBUG, "algo-lms: Error creating partition list");
-		return (TLV_REPLY_ERROR_CODE_INTERNAL_ERROR);
-	}
+	/* Number of separate partitions is maintained by cluster */
+	num_partitions = client->cluster->no_partitions;
 
 	/* This can happen if we are first on the block */
 	if (num_partitions == 0) {
@@ -103,12 +99,11 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 		return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 	}
 
-	qnetd_algo_dump_partitions(&info->partition_list);
+	qnetd_algo_dump_partitions(client->cluster);
 
 	/* Only 1 partition - let votequorum sort it out */
 	if (num_partitions == 1) {
 		qnetd_log(LOG_DEBUG, "algo-lms: Only 1 partition. This is votequorum's problem, not ours");
-		qnetd_algo_free_partitions(&info->partition_list);
 		*result_vote = info->last_result = TLV_VOTE_ACK;
 		return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 	}
@@ -122,8 +117,6 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 			struct qnetd_algo_lms_info *other_info = other_client->algorithm_data;
 			if (!tlv_ring_id_eq(ring_id, &other_client->last_ring_id) &&
 			    other_info->last_result == TLV_VOTE_ACK) {
-				qnetd_algo_free_partitions(&info->partition_list);
-
 				/* Don't save NACK, we need to know subsequently if we haven't been voting */
 				*result_vote = TLV_VOTE_NACK;
 				qnetd_log(LOG_DEBUG, "algo-lms: we are a new partition and another active partition exists. NACK");
@@ -136,7 +129,7 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 	 * Find the partition with highest score
 	 */
 	best_score_partition = NULL;
-	TAILQ_FOREACH(cur_partition, &info->partition_list, entries) {
+	TAILQ_FOREACH(cur_partition, &client->cluster->partitions, entries) {
 		if (!best_score_partition ||
 		    best_score_partition->score < cur_partition->score) {
 			best_score_partition = cur_partition;
@@ -147,7 +140,7 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 
 	/* Now check if it's really the highest score, and not just the joint-highest */
 	joint_leader = 0;
-	TAILQ_FOREACH(cur_partition, &info->partition_list, entries) {
+	TAILQ_FOREACH(cur_partition, &client->cluster->partitions, entries) {
 		if (best_score_partition != cur_partition &&
 		    best_score_partition->score == cur_partition->score) {
 			joint_leader = 1;
@@ -165,8 +158,6 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 			*result_vote = info->last_result = TLV_VOTE_NACK;
 		}
 
-		qnetd_algo_free_partitions(&info->partition_list);
-
 		return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 	}
 
@@ -174,7 +165,7 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 	 * There are multiple partitions with same score. Find the largest partition
 	 */
 	largest_partition = NULL;
-	TAILQ_FOREACH(cur_partition, &info->partition_list, entries) {
+	TAILQ_FOREACH(cur_partition, &client->cluster->partitions, entries) {
 		if (!largest_partition ||
 		    largest_partition->num_nodes < cur_partition->num_nodes) {
 			largest_partition = cur_partition;
@@ -186,7 +177,7 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 
 	/* Now check if it's really the largest, and not just the joint-largest */
 	joint_leader = 0;
-	TAILQ_FOREACH(cur_partition, &info->partition_list, entries) {
+	TAILQ_FOREACH(cur_partition, &client->cluster->partitions, entries) {
 		if (largest_partition != cur_partition &&
 		    largest_partition->num_nodes == cur_partition->num_nodes) {
 			joint_leader = 1;
@@ -272,7 +263,6 @@ static enum tlv_reply_error_code do_lms_algorithm(struct qnetd_client *client, c
 		}
 	}
 
-	qnetd_algo_free_partitions(&info->partition_list);
 	return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 }
 
@@ -289,7 +279,6 @@ qnetd_algo_lms_client_init(struct qnetd_client *client)
 	memset(info, 0, sizeof(*info));
 	client->algorithm_data = info;
 	info->last_result = 0; /* status unknown, or NEW */
-	TAILQ_INIT(&info->partition_list);
 	return (TLV_REPLY_ERROR_CODE_NO_ERROR);
 }
 
@@ -92,87 +92,12 @@ qnetd_algo_all_ring_ids_match(struct qnetd_client *client, const struct tlv_ring
 	return (0);
 }
 
-struct qnetd_algo_partition *
-qnetd_algo_find_partition(partitions_list_t *partitions_list, const struct tlv_ring_id *ring_id)
-{
-	struct qnetd_algo_partition *cur_partition;
-
-	TAILQ_FOREACH(cur_partition, partitions_list, entries) {
-		if (tlv_ring_id_eq(&cur_partition->ring_id, ring_id)) {
-			return (cur_partition);
-		}
-	}
-
-	return (NULL);
-}
-
-int
-qnetd_algo_create_partitions(struct qnetd_client *client, partitions_list_t *partitions_list, const struct tlv_ring_id *ring_id)
-{
- 	struct qnetd_client *other_client;
-	int num_partitions = 0;
-
-	TAILQ_FOREACH(other_client, &client->cluster->client_list, cluster_entries) {
-		struct qnetd_algo_partition *partition;
-
-		if (other_client->last_ring_id.seq == 0){
-			continue; /* not initialised yet */
-		}
-		partition = qnetd_algo_find_partition(partitions_list, &other_client->last_ring_id);
-		if (!partition) {
-			partition = malloc(sizeof(struct qnetd_algo_partition));
-			if (!partition) {
-				return (-1);
-			}
-			partition->num_nodes = 0;
-			partition->score = 0;
-			memcpy(&partition->ring_id, &other_client->last_ring_id, sizeof(*ring_id));
-			num_partitions++;
-			TAILQ_INSERT_TAIL(partitions_list, partition, entries);
-		}
-		partition->num_nodes++;
-
-		/*
-		 * Score is computer similar way as in the ffsplit algorithm
-		 */
-		partition->score++;
-		if (other_client->last_heuristics == TLV_HEURISTICS_PASS) {
-			partition->score++;
-		} else if (other_client->last_heuristics == TLV_HEURISTICS_FAIL) {
-			partition->score--;
-		}
-
-	}
-
-	return (num_partitions);
-}
-
-
-void
-qnetd_algo_free_partitions(partitions_list_t *partitions_list)
-{
-	struct qnetd_algo_partition *cur_partition;
-	struct qnetd_algo_partition *partition_next;
-
-	cur_partition = TAILQ_FIRST(partitions_list);
-
-	while (cur_partition != NULL) {
-		partition_next = TAILQ_NEXT(cur_partition, entries);
-
-		free(cur_partition);
-
-		cur_partition = partition_next;
-	}
-
-	TAILQ_INIT(partitions_list);
-}
-
 void
-qnetd_algo_dump_partitions(partitions_list_t *partitions_list)
+qnetd_algo_dump_partitions(const struct qnetd_cluster *cluster)
 {
-	struct qnetd_algo_partition *partition;
+	struct qnetd_cluster_partition *partition;
 
-	TAILQ_FOREACH(partition, partitions_list, entries) {
+	TAILQ_FOREACH(partition, &cluster->partitions, entries) {
 		qnetd_log(LOG_DEBUG, "algo-util: partition (" UTILS_PRI_RING_ID ") (%p) has %d nodes",
 			  partition->ring_id.node_id, partition->ring_id.seq, partition, partition->num_nodes);
 	}
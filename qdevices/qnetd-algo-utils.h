@@ -39,27 +39,11 @@
 extern "C" {
 #endif
 
-struct qnetd_algo_partition {
-	struct tlv_ring_id ring_id;
-	int num_nodes;
-	int score;
-	TAILQ_ENTRY(qnetd_algo_partition) entries;
-};
-
-typedef TAILQ_HEAD(, qnetd_algo_partition) partitions_list_t;
-
 extern int				 qnetd_algo_all_ring_ids_match(struct qnetd_client *client,
     const struct tlv_ring_id *ring_id);
 
-extern struct qnetd_algo_partition	*qnetd_algo_find_partition(partitions_list_t *partitions,
-    const struct tlv_ring_id *ring_id);
-
-extern int				 qnetd_algo_create_partitions(struct qnetd_client *client,
-    partitions_list_t *partitions, const struct tlv_ring_id *ring_id);
-
-extern void				 qnetd_algo_free_partitions(partitions_list_t *partitions);
-
-extern void				 qnetd_algo_dump_partitions(partitions_list_t *partitions);
+extern void				 qnetd_algo_dump_partitions(
+    const struct qnetd_cluster *cluster);
 
 #ifdef __cplusplus
 }
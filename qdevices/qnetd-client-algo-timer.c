@@ -61,7 +61,7 @@ qnetd_client_algo_timer_callback(void *data1, void *data2)
 		    "Sending error reply.", client->addr_str);
 
 		if (qnetd_client_send_err(client, 0, 0, reply_error_code) != 0) {
-			client->schedule_disconnect = 1;
+			qnetd_client_schedule_disconnect(client);
 			return (0);
 		}
 
@@ -80,7 +80,7 @@ qnetd_client_algo_timer_callback(void *data1, void *data2)
 		if (qnetd_client_send_vote_info(client,
 		    client->algo_timer_vote_info_msq_seq_number, &client->last_ring_id,
 		    result_vote) != 0) {
-			client->schedule_disconnect = 1;
+			qnetd_client_schedule_disconnect(client);
 			return (0);
 		}
 	}
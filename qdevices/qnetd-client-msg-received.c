@@ -34,6 +34,8 @@
 
 #include <sys/types.h>
 
+#include <time.h>
+
 #include "qnetd-algorithm.h"
 #include "qnetd-instance.h"
 #include "qnetd-log.h"
@@ -44,6 +46,44 @@
 
 #include "qnetd-client-msg-received.h"
 
+static uint64_t
+qnetd_client_msg_received_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/*
+ * Called by NSS (inside of PR_Recv/PR_Send) when TLS handshake is finished. Result is
+ * only stored in client, instance statistics are updated by caller of I/O function.
+ */
+static void
+qnetd_client_msg_received_tls_handshake_cb(PRFileDesc *fd, void *client_data)
+{
+	struct qnetd_client *client;
+	SSLChannelInfo channel_info;
+	uint64_t duration;
+
+	client = (struct qnetd_client *)client_data;
+
+	duration = qnetd_client_msg_received_time_us() - client->tls_handshake_start;
+	if (duration > UINT32_MAX) {
+		duration = UINT32_MAX;
+	}
+
+	client->tls_handshake_time = (uint32_t)duration;
+	client->tls_handshake_resumed = 0;
+	if (SSL_GetChannelInfo(fd, &channel_info, sizeof(channel_info)) == SECSuccess) {
+		client->tls_handshake_resumed = channel_info.resumed;
+	}
+
+	client->tls_handshake_done = 1;
+	client->tls_handshake_stats_pending = 1;
+}
+
 /*
  *  0 - Success
  * -1 - Disconnect client
@@ -189,7 +229,7 @@ qnetd_client_msg_received_preinit(struct qnetd_instance *instance, struct qnetd_
 		return (-1);
 	};
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -235,13 +275,24 @@ qnetd_client_msg_received_starttls(struct qnetd_instance *instance, struct qnetd
 		return (0);
 	}
 
+	client->tls_handshake_start = qnetd_client_msg_received_time_us();
+
 	if ((new_pr_fd = nss_sock_start_ssl_as_server(client->socket, instance->server.cert,
-	    instance->server.private_key, instance->tls_client_cert_required, 0, NULL)) == NULL) {
+	    instance->server.private_key, instance->tls_client_cert_required,
+	    instance->advanced_settings->tls_session_cache,
+	    instance->advanced_settings->tls_session_tickets, 0, NULL)) == NULL) {
 		qnetd_log_nss(LOG_ERR, "Can't start TLS. Disconnecting client.");
 
 		return (-1);
 	}
 
+	if (SSL_HandshakeCallback(new_pr_fd, qnetd_client_msg_received_tls_handshake_cb,
+	    client) != SECSuccess) {
+		qnetd_log_nss(LOG_ERR, "Can't set TLS handshake callback. Disconnecting client.");
+
+		return (-1);
+	}
+
 	client->tls_started = 1;
 	client->tls_peer_certificate_verified = 0;
 	client->socket = new_pr_fd;
@@ -498,7 +549,7 @@ qnetd_client_msg_received_init(struct qnetd_instance *instance, struct qnetd_cli
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -580,7 +631,7 @@ qnetd_client_msg_received_set_option(struct qnetd_instance *instance, struct qne
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -632,7 +683,7 @@ qnetd_client_msg_received_echo_request(struct qnetd_instance *instance, struct q
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -803,6 +854,13 @@ qnetd_client_msg_received_node_list(struct qnetd_instance *instance, struct qnet
 		memcpy(&client->last_ring_id, &msg->ring_id, sizeof(struct tlv_ring_id));
 		client->last_membership_heuristics = msg->heuristics;
 		client->last_heuristics = msg->heuristics;
+
+		if (qnetd_cluster_client_partition_update(client->cluster, client) != 0) {
+			qnetd_log(LOG_ERR, "Can't alloc cluster partition. "
+			    "Disconnecting client connection.");
+
+			return (-1);
+		}
 		break;
 	case TLV_NODE_LIST_TYPE_QUORUM:
 		case_processed = 1;
@@ -852,7 +910,7 @@ qnetd_client_msg_received_node_list(struct qnetd_instance *instance, struct qnet
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -949,7 +1007,7 @@ qnetd_client_msg_received_ask_for_vote(struct qnetd_instance *instance, struct q
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -1094,6 +1152,13 @@ qnetd_client_msg_received_heuristics_change(struct qnetd_instance *instance, str
 	client->last_regular_heuristics = msg->heuristics;
 	client->last_heuristics = msg->heuristics;
 
+	if (qnetd_cluster_client_partition_update(client->cluster, client) != 0) {
+		qnetd_log(LOG_ERR, "Can't alloc cluster partition. "
+		    "Disconnecting client connection.");
+
+		return (-1);
+	}
+
 	send_buffer = send_buffer_list_get_new(&client->send_buffer_list);
 	if (send_buffer == NULL) {
 		qnetd_log(LOG_ERR, "Can't alloc heuristics change reply msg from list. "
@@ -1112,7 +1177,7 @@ qnetd_client_msg_received_heuristics_change(struct qnetd_instance *instance, str
 		return (-1);
 	}
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
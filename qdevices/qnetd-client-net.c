@@ -41,10 +41,18 @@
 #include "qnetd-client-net.h"
 #include "qnetd-client-send.h"
 #include "qnetd-client-msg-received.h"
+#include "qnetd-poll-array-user-data.h"
+#include "qnetd-worker.h"
 
 #define CLIENT_ADDR_STR_LEN_COLON_PORT	(1 + 5 + 1)
 #define CLIENT_ADDR_STR_LEN		(INET6_ADDRSTRLEN + CLIENT_ADDR_STR_LEN_COLON_PORT)
 
+/*
+ * Maximum number of reads done by single qnetd_client_net_read call. Bounds time
+ * spent with one client sending long (possibly skipped) message.
+ */
+#define QNETD_CLIENT_NET_MAX_READS	(4 * MSGIO_MAX_IOV)
+
 static int
 qnetd_client_net_write_finished(struct qnetd_instance *instance, struct qnetd_client *client)
 {
@@ -56,6 +64,31 @@ qnetd_client_net_write_finished(struct qnetd_instance *instance, struct qnetd_cl
 	return (0);
 }
 
+/*
+ * Account TLS handshake finished during last I/O operation
+ */
+static void
+qnetd_client_net_update_tls_stats(struct qnetd_instance *instance, struct qnetd_client *client)
+{
+	struct qnetd_tls_stats *stats;
+
+	if (!client->tls_handshake_stats_pending) {
+		return ;
+	}
+
+	client->tls_handshake_stats_pending = 0;
+
+	stats = &instance->tls_stats;
+	stats->handshakes++;
+	if (client->tls_handshake_resumed) {
+		stats->handshakes_resumed++;
+	}
+	stats->handshake_time_total += client->tls_handshake_time;
+	if (client->tls_handshake_time > stats->handshake_time_max) {
+		stats->handshake_time_max = client->tls_handshake_time;
+	}
+}
+
 int
 qnetd_client_net_write(struct qnetd_instance *instance, struct qnetd_client *client)
 {
@@ -69,10 +102,13 @@ qnetd_client_net_write(struct qnetd_instance *instance, struct qnetd_client *cli
 		return (-1);
 	}
 
-	res = msgio_write(client->socket, &send_buffer->buffer,
-	    &send_buffer->msg_already_sent_bytes);
+	res = msgio_write_list(client->socket, &client->send_buffer_list, MSGIO_MAX_IOV);
 
-	if (res == 1) {
+	qnetd_client_net_update_tls_stats(instance, client);
+
+	while (res == 1 &&
+	    (send_buffer = send_buffer_list_get_active(&client->send_buffer_list)) != NULL &&
+	    send_buffer->msg_already_sent_bytes == dynar_size(&send_buffer->buffer)) {
 		send_buffer_list_delete(&client->send_buffer_list, send_buffer);
 
 		if (qnetd_client_net_write_finished(instance, client) == -1) {
@@ -97,20 +133,72 @@ qnetd_client_net_write(struct qnetd_instance *instance, struct qnetd_client *cli
 
 
 /*
- * -1 means end of connection (EOF) or some other unhandled error. 0 = success
+ * Process fully received (or skipped) message stored in client receive buffer and
+ * prepare buffer for next message.
+ * -1 means client should be disconnected. 0 = success
  */
 int
-qnetd_client_net_read(struct qnetd_instance *instance, struct qnetd_client *client)
+qnetd_client_net_process_received_msg(struct qnetd_instance *instance,
+    struct qnetd_client *client)
+{
+	int ret_val;
+
+	ret_val = 0;
+
+	if (!client->skipping_msg) {
+		if (qnetd_client_msg_received(instance, client) == -1) {
+			ret_val = -1;
+		}
+	} else {
+		if (qnetd_client_send_err(client, 0, 0, client->skipping_msg_reason) != 0) {
+			ret_val = -1;
+		}
+	}
+
+	client->skipping_msg = 0;
+	client->skipping_msg_reason = TLV_REPLY_ERROR_CODE_NO_ERROR;
+	client->msg_already_received_bytes = 0;
+	dynar_clean(&client->receive_buffer);
+
+	return (ret_val);
+}
+
+/*
+ * With worker threads, init message is not processed by main thread or handshake worker.
+ * Instead client (together with received message) is moved to cluster worker which
+ * owns the cluster.
+ */
+static int
+qnetd_client_net_handoff_needed(struct qnetd_instance *instance, struct qnetd_client *client)
+{
+
+	return (instance->worker_pool != NULL &&
+	    (instance->worker == NULL || instance->worker->type != QNETD_WORKER_TYPE_CLUSTER) &&
+	    !client->skipping_msg && client->preinit_received &&
+	    msg_get_type(&client->receive_buffer) == MSG_TYPE_INIT);
+}
+
+/*
+ * -1 means end of connection (EOF) or some other unhandled error. 0 = success,
+ * 1 = client was handed off to cluster worker and must not be touched anymore.
+ * msg_processed is set when full message was received and processed.
+ */
+static int
+qnetd_client_net_read_msg(struct qnetd_instance *instance, struct qnetd_client *client,
+    int *msg_processed)
 {
 	int res;
 	int ret_val;
 	int orig_skipping_msg;
 
+	*msg_processed = 0;
 	orig_skipping_msg = client->skipping_msg;
 
 	res = msgio_read(client->socket, &client->receive_buffer,
 	    &client->msg_already_received_bytes, &client->skipping_msg);
 
+	qnetd_client_net_update_tls_stats(instance, client);
+
 	if (!orig_skipping_msg && client->skipping_msg) {
 		qnetd_log(LOG_DEBUG, "msgio_read set skipping_msg");
 	}
@@ -155,20 +243,18 @@ qnetd_client_net_read(struct qnetd_instance *instance, struct qnetd_client *clie
 		/*
 		 * Full message received / skipped
 		 */
-		if (!client->skipping_msg) {
-			if (qnetd_client_msg_received(instance, client) == -1) {
-				ret_val = -1;
-			}
-		} else {
-			if (qnetd_client_send_err(client, 0, 0, client->skipping_msg_reason) != 0) {
-				ret_val = -1;
-			}
+		if (qnetd_client_net_handoff_needed(instance, client)) {
+			pr_poll_set_del(&instance->poll_set, &client->poll_entry);
+			qnetd_worker_client_handoff(instance, client,
+			    qnetd_worker_pool_get_cluster_worker(instance->worker_pool,
+			    client->cluster_name, client->cluster_name_len));
+
+			ret_val = 1;
+			break;
 		}
 
-		client->skipping_msg = 0;
-		client->skipping_msg_reason = TLV_REPLY_ERROR_CODE_NO_ERROR;
-		client->msg_already_received_bytes = 0;
-		dynar_clean(&client->receive_buffer);
+		ret_val = qnetd_client_net_process_received_msg(instance, client);
+		*msg_processed = 1;
 		break;
 	default:
 		qnetd_log(LOG_ERR, "Unhandled msgio_read error %d\n", res);
@@ -179,6 +265,50 @@ qnetd_client_net_read(struct qnetd_instance *instance, struct qnetd_client *clie
 	return (ret_val);
 }
 
+/*
+ * Process all messages already received from client (up to MSGIO_MAX_IOV), so
+ * replies are queued together and sent by single write.
+ *
+ * -1 means end of connection (EOF) or some other unhandled error. 0 = success,
+ * 1 = client was handed off to cluster worker and must not be touched anymore.
+ */
+int
+qnetd_client_net_read(struct qnetd_instance *instance, struct qnetd_client *client)
+{
+	int ret_val;
+	int msg_processed;
+	int data_read;
+	size_t orig_received_bytes;
+	size_t no_msgs;
+	size_t no_reads;
+
+	no_msgs = 0;
+	no_reads = 0;
+
+	do {
+		orig_received_bytes = client->msg_already_received_bytes;
+
+		ret_val = qnetd_client_net_read_msg(instance, client, &msg_processed);
+
+		if (msg_processed) {
+			no_msgs++;
+		}
+		no_reads++;
+
+		/*
+		 * Header and rest of the message are read separately, so continue also
+		 * after partial read as long as some data was read
+		 */
+		data_read = (msg_processed ||
+		    client->msg_already_received_bytes != orig_received_bytes);
+	} while (ret_val == 0 && data_read && no_msgs < MSGIO_MAX_IOV &&
+	    no_reads < QNETD_CLIENT_NET_MAX_READS &&
+	    !client->schedule_disconnect &&
+	    !send_buffer_list_full(&client->send_buffer_list));
+
+	return (ret_val);
+}
+
 int
 qnetd_client_net_accept(struct qnetd_instance *instance)
 {
@@ -187,8 +317,11 @@ qnetd_client_net_accept(struct qnetd_instance *instance)
 	struct qnetd_client *client;
 	char *client_addr_str;
 	int res_err;
+	int client_reserved;
+	struct qnetd_worker *handshake_worker;
 
 	client_addr_str = NULL;
+	client_reserved = 0;
 
 	res_err = -1;
 
@@ -203,7 +336,15 @@ qnetd_client_net_accept(struct qnetd_instance *instance)
 		goto exit_close;
 	}
 
-	if (instance->max_clients != 0 &&
+	if (instance->worker_pool != NULL) {
+		if (qnetd_worker_pool_client_reserve(instance->worker_pool,
+		    instance->max_clients) != 0) {
+			qnetd_log(LOG_ERR, "Maximum clients reached. Not accepting connection");
+			goto exit_close;
+		}
+
+		client_reserved = 1;
+	} else if (instance->max_clients != 0 &&
 	    qnetd_client_list_no_clients(&instance->clients) >= instance->max_clients) {
 		qnetd_log(LOG_ERR, "Maximum clients reached. Not accepting connection");
 		goto exit_close;
@@ -238,11 +379,35 @@ qnetd_client_net_accept(struct qnetd_instance *instance)
 		goto exit_close;
 	}
 
+	client->poll_changed_list = &instance->poll_changed_clients;
+
+	if (instance->worker_pool != NULL &&
+	    (handshake_worker = qnetd_worker_pool_get_handshake_worker(instance->worker_pool)) !=
+	    NULL) {
+		return (qnetd_worker_client_handoff(instance, client, handshake_worker));
+	}
+
+	if (pr_poll_set_add(&instance->poll_set, &client->poll_entry, client_socket,
+	    PR_POLL_READ, QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT, client) != 0) {
+		qnetd_log_err(LOG_ERR, "Can't add client to poll set");
+		/*
+		 * Client owns addr str now
+		 */
+		qnetd_client_list_del(&instance->clients, client);
+		client_addr_str = NULL;
+		res_err = -2;
+		goto exit_close;
+	}
+
 	return (0);
 
 exit_close:
 	free(client_addr_str);
 	PR_Close(client_socket);
 
+	if (client_reserved) {
+		qnetd_worker_pool_client_release(instance->worker_pool);
+	}
+
 	return (res_err);
 }
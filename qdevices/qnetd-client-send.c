@@ -64,7 +64,7 @@ qnetd_client_send_err(struct qnetd_client *client, int add_msg_seq_number, uint3
 		return (-1);
 	};
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -101,7 +101,7 @@ qnetd_client_send_vote_info(struct qnetd_client *client, uint32_t msg_seq_number
 		return (-1);
 	};
 
-	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_send_buffer_put(client, send_buffer);
 
 	return (0);
 }
@@ -62,6 +62,11 @@ void
 qnetd_client_destroy(struct qnetd_client *client)
 {
 
+	if (client->poll_changed) {
+		TAILQ_REMOVE(client->poll_changed_list, client, poll_changed_entries);
+		client->poll_changed = 0;
+	}
+
 	free(client->cluster_name);
 	free(client->addr_str);
 	node_list_free(&client->last_quorum_node_list);
@@ -70,3 +75,36 @@ qnetd_client_destroy(struct qnetd_client *client)
 	send_buffer_list_free(&client->send_buffer_list);
 	dynar_destroy(&client->receive_buffer);
 }
+
+/*
+ * Queue client so main loop recomputes its poll interest (pending send buffers,
+ * scheduled disconnect) before next wait
+ */
+void
+qnetd_client_poll_changed(struct qnetd_client *client)
+{
+
+	if (client->poll_changed || client->poll_changed_list == NULL) {
+		return ;
+	}
+
+	TAILQ_INSERT_TAIL(client->poll_changed_list, client, poll_changed_entries);
+	client->poll_changed = 1;
+}
+
+void
+qnetd_client_send_buffer_put(struct qnetd_client *client,
+    struct send_buffer_list_entry *send_buffer)
+{
+
+	send_buffer_list_put(&client->send_buffer_list, send_buffer);
+	qnetd_client_poll_changed(client);
+}
+
+void
+qnetd_client_schedule_disconnect(struct qnetd_client *client)
+{
+
+	client->schedule_disconnect = 1;
+	qnetd_client_poll_changed(client);
+}
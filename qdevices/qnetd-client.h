@@ -45,6 +45,7 @@
 #include "tlv.h"
 #include "send-buffer-list.h"
 #include "node-list.h"
+#include "pr-poll-set.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,6 +61,11 @@ struct qnetd_client {
 	int skipping_msg;	/* When incorrect message was received skip it */
 	int tls_started;	/* Set after TLS started */
 	int tls_peer_certificate_verified;	/* Certificate is verified only once */
+	uint64_t tls_handshake_start;	/* Monotonic time (in us) of TLS start */
+	int tls_handshake_done;
+	int tls_handshake_resumed;
+	uint32_t tls_handshake_time;	/* Duration of TLS handshake in us */
+	int tls_handshake_stats_pending;	/* Handshake not yet counted in instance stats */
 	int preinit_received;
 	int init_received;
 	char *cluster_name;
@@ -79,6 +85,8 @@ struct qnetd_client {
 	struct tlv_ring_id last_ring_id;
 	struct qnetd_cluster *cluster;
 	struct qnetd_cluster_list *cluster_list;
+	struct qnetd_cluster_partition *cluster_partition;	/* Partition client is counted in */
+	int cluster_partition_score;	/* Score added to cluster_partition */
 	struct timer_list *main_timer_list;
 	struct timer_list_entry *algo_timer;
 	uint32_t algo_timer_vote_info_msq_seq_number;
@@ -90,16 +98,30 @@ struct qnetd_client {
 	enum tlv_heuristics last_membership_heuristics; /* Passed in membership node list */
 	enum tlv_heuristics last_regular_heuristics; /* Passed in heuristics change callback */
 	enum tlv_heuristics last_heuristics; /* Latest heuristics both membership and regular */
+	struct pr_poll_set_entry poll_entry;
+	int poll_changed;	/* Poll interest must be recomputed before next wait */
+	struct qnetd_client_poll_changed_list *poll_changed_list;
 	TAILQ_ENTRY(qnetd_client) entries;
 	TAILQ_ENTRY(qnetd_client) cluster_entries;
+	TAILQ_ENTRY(qnetd_client) node_id_hash_entries;
+	TAILQ_ENTRY(qnetd_client) poll_changed_entries;
 };
 
+TAILQ_HEAD(qnetd_client_poll_changed_list, qnetd_client);
+
 extern void		qnetd_client_init(struct qnetd_client *client, PRFileDesc *sock,
     PRNetAddr *addr, char *addr_str, size_t max_receive_size, size_t max_send_buffers,
     size_t max_send_size, struct timer_list *main_timer_list);
 
 extern void		qnetd_client_destroy(struct qnetd_client *client);
 
+extern void		qnetd_client_poll_changed(struct qnetd_client *client);
+
+extern void		qnetd_client_send_buffer_put(struct qnetd_client *client,
+    struct send_buffer_list_entry *send_buffer);
+
+extern void		qnetd_client_schedule_disconnect(struct qnetd_client *client);
+
 #ifdef __cplusplus
 }
 #endif
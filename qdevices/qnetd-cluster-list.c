@@ -38,11 +38,47 @@
 
 #include "qnetd-cluster-list.h"
 
+#define QNETD_CLUSTER_LIST_INITIAL_BUCKETS	64
+
 void
 qnetd_cluster_list_init(struct qnetd_cluster_list *list)
 {
 
-	TAILQ_INIT(list);
+	memset(list, 0, sizeof(*list));
+
+	TAILQ_INIT(&list->list);
+}
+
+/*
+ * Resize hash table to no_buckets (power of 2). On allocation failure old table is kept,
+ * it's still correct, just slower.
+ */
+static int
+qnetd_cluster_list_rehash(struct qnetd_cluster_list *list, size_t no_buckets)
+{
+	struct qnetd_cluster_list_head *buckets;
+	struct qnetd_cluster *cluster;
+	size_t zi;
+
+	buckets = malloc(sizeof(*buckets) * no_buckets);
+	if (buckets == NULL) {
+		return (-1);
+	}
+
+	for (zi = 0; zi < no_buckets; zi++) {
+		TAILQ_INIT(&buckets[zi]);
+	}
+
+	TAILQ_FOREACH(cluster, &list->list, entries) {
+		TAILQ_INSERT_TAIL(&buckets[cluster->cluster_name_hash & (no_buckets - 1)],
+		    cluster, hash_entries);
+	}
+
+	free(list->buckets);
+	list->buckets = buckets;
+	list->no_buckets = no_buckets;
+
+	return (0);
 }
 
 struct qnetd_cluster *
@@ -50,9 +86,17 @@ qnetd_cluster_list_find_by_name(struct qnetd_cluster_list *list,
     const char *cluster_name, size_t cluster_name_len)
 {
 	struct qnetd_cluster *cluster;
+	uint32_t hash;
+
+	if (list->no_buckets == 0) {
+		return (NULL);
+	}
 
-	TAILQ_FOREACH(cluster, list, entries) {
-		if (cluster->cluster_name_len == cluster_name_len &&
+	hash = qnetd_cluster_name_hash(cluster_name, cluster_name_len);
+
+	TAILQ_FOREACH(cluster, &list->buckets[hash & (list->no_buckets - 1)], hash_entries) {
+		if (cluster->cluster_name_hash == hash &&
+		    cluster->cluster_name_len == cluster_name_len &&
 		    memcmp(cluster->cluster_name, cluster_name, cluster_name_len) == 0) {
 			return (cluster);
 		}
@@ -61,6 +105,19 @@ qnetd_cluster_list_find_by_name(struct qnetd_cluster_list *list,
 	return (NULL);
 }
 
+static void
+qnetd_cluster_list_del_cluster(struct qnetd_cluster_list *list, struct qnetd_cluster *cluster)
+{
+
+	TAILQ_REMOVE(&list->list, cluster, entries);
+	TAILQ_REMOVE(&list->buckets[cluster->cluster_name_hash & (list->no_buckets - 1)],
+	    cluster, hash_entries);
+	list->no_clusters--;
+
+	qnetd_cluster_destroy(cluster);
+	free(cluster);
+}
+
 struct qnetd_cluster *
 qnetd_cluster_list_add_client(struct qnetd_cluster_list *list, struct qnetd_client *client)
 {
@@ -69,6 +126,15 @@ qnetd_cluster_list_add_client(struct qnetd_cluster_list *list, struct qnetd_clie
 	cluster = qnetd_cluster_list_find_by_name(list, client->cluster_name,
 	    client->cluster_name_len);
 	if (cluster == NULL) {
+		if (list->no_buckets == 0 &&
+		    qnetd_cluster_list_rehash(list, QNETD_CLUSTER_LIST_INITIAL_BUCKETS) != 0) {
+			return (NULL);
+		}
+
+		if (list->no_clusters >= list->no_buckets) {
+			(void)qnetd_cluster_list_rehash(list, list->no_buckets * 2);
+		}
+
 		cluster = (struct qnetd_cluster *)malloc(sizeof(*cluster));
 		if (cluster == NULL) {
 			return (NULL);
@@ -81,10 +147,19 @@ qnetd_cluster_list_add_client(struct qnetd_cluster_list *list, struct qnetd_clie
 			return (NULL);
 		}
 
-		TAILQ_INSERT_TAIL(list, cluster, entries);
+		TAILQ_INSERT_TAIL(&list->list, cluster, entries);
+		TAILQ_INSERT_TAIL(&list->buckets[cluster->cluster_name_hash & (list->no_buckets - 1)],
+		    cluster, hash_entries);
+		list->no_clusters++;
 	}
 
-	TAILQ_INSERT_TAIL(&cluster->client_list, client, cluster_entries);
+	if (qnetd_cluster_add_client(cluster, client) != 0) {
+		if (TAILQ_EMPTY(&cluster->client_list)) {
+			qnetd_cluster_list_del_cluster(list, cluster);
+		}
+
+		return (NULL);
+	}
 
 	return (cluster);
 }
@@ -94,13 +169,10 @@ qnetd_cluster_list_del_client(struct qnetd_cluster_list *list, struct qnetd_clus
     struct qnetd_client *client)
 {
 
-	TAILQ_REMOVE(&cluster->client_list, client, cluster_entries);
+	qnetd_cluster_del_client(cluster, client);
 
 	if (TAILQ_EMPTY(&cluster->client_list)) {
-		TAILQ_REMOVE(list, cluster, entries);
-
-		qnetd_cluster_destroy(cluster);
-		free(cluster);
+		qnetd_cluster_list_del_cluster(list, cluster);
 	}
 }
 
@@ -110,7 +182,7 @@ qnetd_cluster_list_free(struct qnetd_cluster_list *list)
 	struct qnetd_cluster *cluster;
 	struct qnetd_cluster *cluster_next;
 
-	cluster = TAILQ_FIRST(list);
+	cluster = TAILQ_FIRST(&list->list);
 	while (cluster != NULL) {
 		cluster_next = TAILQ_NEXT(cluster, entries);
 
@@ -120,20 +192,14 @@ qnetd_cluster_list_free(struct qnetd_cluster_list *list)
 		cluster = cluster_next;
 	}
 
-	TAILQ_INIT(list);
+	free(list->buckets);
+
+	qnetd_cluster_list_init(list);
 }
 
 size_t
 qnetd_cluster_list_size(const struct qnetd_cluster_list *list)
 {
-	size_t res;
-	struct qnetd_cluster *cluster;
-
-	res = 0;
-
-	TAILQ_FOREACH(cluster, list, entries) {
-		res++;
-	}
 
-	return (res);
+	return (list->no_clusters);
 }
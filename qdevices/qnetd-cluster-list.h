@@ -47,7 +47,19 @@
 extern "C" {
 #endif
 
-TAILQ_HEAD(qnetd_cluster_list, qnetd_cluster);
+TAILQ_HEAD(qnetd_cluster_list_head, qnetd_cluster);
+
+/*
+ * List of clusters (in order of creation) together with hash index on cluster name.
+ * Hash table is allocated on first add and grows so there is at most one cluster per
+ * bucket in average.
+ */
+struct qnetd_cluster_list {
+	struct qnetd_cluster_list_head list;
+	struct qnetd_cluster_list_head *buckets;
+	size_t no_buckets;
+	size_t no_clusters;
+};
 
 extern void				 qnetd_cluster_list_init(struct qnetd_cluster_list *list);
 
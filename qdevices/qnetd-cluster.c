@@ -38,6 +38,8 @@
 
 #include "qnetd-cluster.h"
 
+#define QNETD_CLUSTER_NODE_ID_INITIAL_BUCKETS	8
+
 int
 qnetd_cluster_init(struct qnetd_cluster *cluster, const char *cluster_name, size_t cluster_name_len)
 {
@@ -52,7 +54,9 @@ qnetd_cluster_init(struct qnetd_cluster *cluster, const char *cluster_name, size
 	memcpy(cluster->cluster_name, cluster_name, cluster_name_len);
 
 	cluster->cluster_name_len = cluster_name_len;
+	cluster->cluster_name_hash = qnetd_cluster_name_hash(cluster_name, cluster_name_len);
 	TAILQ_INIT(&cluster->client_list);
+	TAILQ_INIT(&cluster->partitions);
 
 	return (0);
 }
@@ -60,24 +64,91 @@ qnetd_cluster_init(struct qnetd_cluster *cluster, const char *cluster_name, size
 void
 qnetd_cluster_destroy(struct qnetd_cluster *cluster)
 {
+	struct qnetd_cluster_partition *partition;
+	struct qnetd_cluster_partition *partition_next;
 
 	free(cluster->cluster_name);
 	cluster->cluster_name = NULL;
+
+	free(cluster->node_id_buckets);
+	cluster->node_id_buckets = NULL;
+	cluster->no_node_id_buckets = 0;
+
+	partition = TAILQ_FIRST(&cluster->partitions);
+	while (partition != NULL) {
+		partition_next = TAILQ_NEXT(partition, entries);
+
+		free(partition);
+
+		partition = partition_next;
+	}
+	TAILQ_INIT(&cluster->partitions);
+	cluster->no_partitions = 0;
+}
+
+/*
+ * FNV-1a hash of cluster name
+ */
+uint32_t
+qnetd_cluster_name_hash(const char *cluster_name, size_t cluster_name_len)
+{
+	uint32_t hash;
+	size_t zi;
+
+	hash = 2166136261U;
+
+	for (zi = 0; zi < cluster_name_len; zi++) {
+		hash ^= (unsigned char)cluster_name[zi];
+		hash *= 16777619U;
+	}
+
+	return (hash);
 }
 
 size_t
 qnetd_cluster_size(const struct qnetd_cluster *cluster)
 {
-	size_t res;
+
+	return (cluster->no_clients);
+}
+
+static struct qnetd_client_list *
+qnetd_cluster_node_id_bucket(const struct qnetd_cluster *cluster, uint32_t node_id)
+{
+
+	return (&cluster->node_id_buckets[node_id & (cluster->no_node_id_buckets - 1)]);
+}
+
+/*
+ * Resize node id index. Clients keep their order in bucket so for duplicate node ids
+ * (not allowed by qnetd) first added client is found first, same as in client_list.
+ */
+static int
+qnetd_cluster_node_id_rehash(struct qnetd_cluster *cluster, size_t new_no_buckets)
+{
+	struct qnetd_client_list *new_buckets;
 	struct qnetd_client *client;
+	size_t zi;
+
+	new_buckets = malloc(sizeof(*new_buckets) * new_no_buckets);
+	if (new_buckets == NULL) {
+		return (-1);
+	}
 
-	res = 0;
+	for (zi = 0; zi < new_no_buckets; zi++) {
+		TAILQ_INIT(&new_buckets[zi]);
+	}
+
+	free(cluster->node_id_buckets);
+	cluster->node_id_buckets = new_buckets;
+	cluster->no_node_id_buckets = new_no_buckets;
 
 	TAILQ_FOREACH(client, &cluster->client_list, cluster_entries) {
-		res++;
+		TAILQ_INSERT_TAIL(qnetd_cluster_node_id_bucket(cluster, client->node_id),
+		    client, node_id_hash_entries);
 	}
 
-	return (res);
+	return (0);
 }
 
 struct qnetd_client *
@@ -85,7 +156,8 @@ qnetd_cluster_find_client_by_node_id(const struct qnetd_cluster *cluster, uint32
 {
 	struct qnetd_client *client;
 
-	TAILQ_FOREACH(client, &cluster->client_list, cluster_entries) {
+	TAILQ_FOREACH(client, qnetd_cluster_node_id_bucket(cluster, node_id),
+	    node_id_hash_entries) {
 		if (client->node_id == node_id) {
 			return (client);
 		}
@@ -93,3 +165,132 @@ qnetd_cluster_find_client_by_node_id(const struct qnetd_cluster *cluster, uint32
 
 	return (NULL);
 }
+
+struct qnetd_cluster_partition *
+qnetd_cluster_find_partition(const struct qnetd_cluster *cluster,
+    const struct tlv_ring_id *ring_id)
+{
+	struct qnetd_cluster_partition *partition;
+
+	TAILQ_FOREACH(partition, &cluster->partitions, entries) {
+		if (tlv_ring_id_eq(&partition->ring_id, ring_id)) {
+			return (partition);
+		}
+	}
+
+	return (NULL);
+}
+
+static void
+qnetd_cluster_client_partition_del(struct qnetd_cluster *cluster, struct qnetd_client *client)
+{
+	struct qnetd_cluster_partition *partition;
+
+	partition = client->cluster_partition;
+	if (partition == NULL) {
+		return ;
+	}
+
+	partition->num_nodes--;
+	partition->score -= client->cluster_partition_score;
+
+	if (partition->num_nodes == 0) {
+		TAILQ_REMOVE(&cluster->partitions, partition, entries);
+		cluster->no_partitions--;
+		free(partition);
+	}
+
+	client->cluster_partition = NULL;
+	client->cluster_partition_score = 0;
+}
+
+/*
+ * Move client to partition matching its last_ring_id and update score by its
+ * last_heuristics. Has to be called after client->last_ring_id or client->last_heuristics
+ * changes. Client with uninitialized ring id (seq == 0) is not part of any partition.
+ */
+int
+qnetd_cluster_client_partition_update(struct qnetd_cluster *cluster, struct qnetd_client *client)
+{
+	struct qnetd_cluster_partition *partition;
+	int score;
+
+	qnetd_cluster_client_partition_del(cluster, client);
+
+	if (client->last_ring_id.seq == 0) {
+		return (0);
+	}
+
+	partition = qnetd_cluster_find_partition(cluster, &client->last_ring_id);
+	if (partition == NULL) {
+		partition = malloc(sizeof(*partition));
+		if (partition == NULL) {
+			return (-1);
+		}
+
+		memset(partition, 0, sizeof(*partition));
+		memcpy(&partition->ring_id, &client->last_ring_id, sizeof(partition->ring_id));
+		TAILQ_INSERT_TAIL(&cluster->partitions, partition, entries);
+		cluster->no_partitions++;
+	}
+
+	/*
+	 * Score is computed similar way as in the ffsplit algorithm
+	 */
+	score = 1;
+	if (client->last_heuristics == TLV_HEURISTICS_PASS) {
+		score++;
+	} else if (client->last_heuristics == TLV_HEURISTICS_FAIL) {
+		score--;
+	}
+
+	partition->num_nodes++;
+	partition->score += score;
+
+	client->cluster_partition = partition;
+	client->cluster_partition_score = score;
+
+	return (0);
+}
+
+int
+qnetd_cluster_add_client(struct qnetd_cluster *cluster, struct qnetd_client *client)
+{
+
+	if (cluster->no_node_id_buckets == 0 &&
+	    qnetd_cluster_node_id_rehash(cluster, QNETD_CLUSTER_NODE_ID_INITIAL_BUCKETS) != 0) {
+		return (-1);
+	}
+
+	client->cluster_partition = NULL;
+	client->cluster_partition_score = 0;
+	if (qnetd_cluster_client_partition_update(cluster, client) != 0) {
+		return (-1);
+	}
+
+	TAILQ_INSERT_TAIL(&cluster->client_list, client, cluster_entries);
+	TAILQ_INSERT_TAIL(qnetd_cluster_node_id_bucket(cluster, client->node_id), client,
+	    node_id_hash_entries);
+	cluster->no_clients++;
+
+	if (cluster->no_clients > cluster->no_node_id_buckets) {
+		/*
+		 * Failure is not fatal, index only becomes slower
+		 */
+		(void)qnetd_cluster_node_id_rehash(cluster, cluster->no_node_id_buckets * 2);
+	}
+
+	return (0);
+}
+
+void
+qnetd_cluster_del_client(struct qnetd_cluster *cluster, struct qnetd_client *client)
+{
+
+	qnetd_cluster_client_partition_del(cluster, client);
+
+	TAILQ_REMOVE(&cluster->client_list, client, cluster_entries);
+	TAILQ_REMOVE(qnetd_cluster_node_id_bucket(cluster, client->node_id), client,
+	    node_id_hash_entries);
+	cluster->no_clients--;
+}
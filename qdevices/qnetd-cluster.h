@@ -47,12 +47,32 @@
 extern "C" {
 #endif
 
+/*
+ * Clients with same (initialized) ring id. Maintained incrementally when client joins,
+ * leaves or reports new ring id or heuristics result.
+ */
+struct qnetd_cluster_partition {
+	struct tlv_ring_id ring_id;
+	int num_nodes;
+	int score;
+	TAILQ_ENTRY(qnetd_cluster_partition) entries;
+};
+
+TAILQ_HEAD(qnetd_cluster_partition_list, qnetd_cluster_partition);
+
 struct qnetd_cluster {
 	char *cluster_name;
 	size_t cluster_name_len;
+	uint32_t cluster_name_hash;
 	void *algorithm_data;
 	struct qnetd_client_list client_list;
+	size_t no_clients;
+	struct qnetd_client_list *node_id_buckets;
+	size_t no_node_id_buckets;
+	struct qnetd_cluster_partition_list partitions;
+	size_t no_partitions;
 	TAILQ_ENTRY(qnetd_cluster) entries;
+	TAILQ_ENTRY(qnetd_cluster) hash_entries;
 };
 
 extern int			qnetd_cluster_init(struct qnetd_cluster *cluster,
@@ -60,11 +80,26 @@ extern int			qnetd_cluster_init(struct qnetd_cluster *cluster,
 
 extern void			qnetd_cluster_destroy(struct qnetd_cluster *cluster);
 
+extern uint32_t			qnetd_cluster_name_hash(const char *cluster_name,
+    size_t cluster_name_len);
+
 extern size_t			qnetd_cluster_size(const struct qnetd_cluster *cluster);
 
 extern struct qnetd_client	*qnetd_cluster_find_client_by_node_id(
     const struct qnetd_cluster *cluster, uint32_t node_id);
 
+extern int			qnetd_cluster_add_client(struct qnetd_cluster *cluster,
+    struct qnetd_client *client);
+
+extern void			qnetd_cluster_del_client(struct qnetd_cluster *cluster,
+    struct qnetd_client *client);
+
+extern int			qnetd_cluster_client_partition_update(
+    struct qnetd_cluster *cluster, struct qnetd_client *client);
+
+extern struct qnetd_cluster_partition *qnetd_cluster_find_partition(
+    const struct qnetd_cluster *cluster, const struct tlv_ring_id *ring_id);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,7 +56,7 @@ qnetd_dpd_timer_cb(void *data1, void *data2)
 				    "%"PRIu32"ms. Disconnecting",
 				    client->addr_str, client->dpd_time_since_last_check);
 
-				client->schedule_disconnect = 1;
+				qnetd_client_schedule_disconnect(client);
 			} else {
 				client->dpd_time_since_last_check = 0;
 				client->dpd_msg_received_since_last_check = 0;
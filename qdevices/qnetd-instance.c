@@ -40,8 +40,8 @@
 #include "qnetd-algorithm.h"
 #include "qnetd-log-debug.h"
 #include "qnetd-dpd-timer.h"
-#include "qnetd-poll-array-user-data.h"
 #include "qnetd-client-algo-timer.h"
+#include "qnetd-worker.h"
 
 int
 qnetd_instance_init(struct qnetd_instance *instance,
@@ -53,7 +53,10 @@ qnetd_instance_init(struct qnetd_instance *instance,
 
 	instance->advanced_settings = advanced_settings;
 
-	pr_poll_array_init(&instance->poll_array, sizeof(struct qnetd_poll_array_user_data));
+	if (pr_poll_set_init(&instance->poll_set) != 0) {
+		return (-1);
+	}
+	TAILQ_INIT(&instance->poll_changed_clients);
 	qnetd_client_list_init(&instance->clients);
 	qnetd_cluster_list_init(&instance->clusters);
 
@@ -88,7 +91,7 @@ qnetd_instance_destroy(struct qnetd_instance *instance)
 		client = client_next;
 	}
 
-	pr_poll_array_destroy(&instance->poll_array);
+	pr_poll_set_destroy(&instance->poll_set);
 	qnetd_cluster_list_free(&instance->clusters);
 	qnetd_client_list_free(&instance->clients);
 	timer_list_free(&instance->main_timer_list);
@@ -103,16 +106,25 @@ qnetd_instance_client_disconnect(struct qnetd_instance *instance, struct qnetd_c
 
 	qnetd_log_debug_client_disconnect(client, server_going_down);
 
+	if (client->tls_started && !client->tls_handshake_done) {
+		instance->tls_stats.handshakes_failed++;
+	}
+
 	if (client->init_received) {
 		qnetd_algorithm_client_disconnect(client, server_going_down);
 	}
 
+	pr_poll_set_del(&instance->poll_set, &client->poll_entry);
 	PR_Close(client->socket);
 	if (client->cluster != NULL) {
 		qnetd_cluster_list_del_client(&instance->clusters, client->cluster, client);
 	}
 	qnetd_client_algo_timer_abort(client);
 	qnetd_client_list_del(&instance->clients, client);
+
+	if (instance->worker_pool != NULL) {
+		qnetd_worker_pool_client_release(instance->worker_pool);
+	}
 }
 
 int
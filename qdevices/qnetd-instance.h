@@ -43,7 +43,7 @@
 
 #include "qnetd-client-list.h"
 #include "qnetd-cluster-list.h"
-#include "pr-poll-array.h"
+#include "pr-poll-set.h"
 #include "qnet-config.h"
 #include "timer-list.h"
 #include "unix-socket-ipc.h"
@@ -53,6 +53,17 @@
 extern "C" {
 #endif
 
+struct qnetd_worker;
+struct qnetd_worker_pool;
+
+struct qnetd_tls_stats {
+	uint64_t handshakes;
+	uint64_t handshakes_resumed;
+	uint64_t handshakes_failed;
+	uint64_t handshake_time_total;		/* us */
+	uint32_t handshake_time_max;		/* us */
+};
+
 struct qnetd_instance {
 	struct {
 		PRFileDesc *socket;
@@ -62,7 +73,10 @@ struct qnetd_instance {
 	size_t max_clients;
 	struct qnetd_client_list clients;
 	struct qnetd_cluster_list clusters;
-	struct pr_poll_array poll_array;
+	struct pr_poll_set poll_set;
+	struct pr_poll_set_entry server_poll_entry;
+	struct pr_poll_set_entry ipc_socket_poll_entry;
+	struct qnetd_client_poll_changed_list poll_changed_clients;
 	enum tlv_tls_supported tls_supported;
 	int tls_client_cert_required;
 	const char *host_addr;
@@ -72,6 +86,9 @@ struct qnetd_instance {
 	struct unix_socket_ipc local_ipc;
 	PRFileDesc *ipc_socket_poll_fd;
 	const struct qnetd_advanced_settings *advanced_settings;
+	struct qnetd_tls_stats tls_stats;
+	struct qnetd_worker *worker;			/* Worker owning instance, NULL for main */
+	struct qnetd_worker_pool *worker_pool;		/* NULL when running single threaded */
 };
 
 extern int		qnetd_instance_init(struct qnetd_instance *instance,
@@ -32,14 +32,66 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
+
 #include "dynar-str.h"
 #include "qnetd-ipc-cmd.h"
 #include "qnetd-log.h"
+#include "qnetd-worker.h"
 #include "utils.h"
 
+static void
+qnetd_ipc_cmd_add_tls_stats(struct qnetd_tls_stats *dst, const struct qnetd_tls_stats *src)
+{
+
+	dst->handshakes += src->handshakes;
+	dst->handshakes_resumed += src->handshakes_resumed;
+	dst->handshakes_failed += src->handshakes_failed;
+	dst->handshake_time_total += src->handshake_time_total;
+	if (src->handshake_time_max > dst->handshake_time_max) {
+		dst->handshake_time_max = src->handshake_time_max;
+	}
+}
+
+/*
+ * Count clients, clusters and TLS statistics of main instance and (when running with
+ * worker threads) of all workers. Worker state is read with worker mutex held.
+ */
+static void
+qnetd_ipc_cmd_get_counts(struct qnetd_instance *instance, size_t *no_clients,
+    size_t *no_clusters, struct qnetd_tls_stats *tls_stats)
+{
+	struct qnetd_worker *worker;
+	size_t zi;
+
+	*no_clients = qnetd_client_list_no_clients(&instance->clients);
+	*no_clusters = qnetd_cluster_list_size(&instance->clusters);
+	memset(tls_stats, 0, sizeof(*tls_stats));
+	qnetd_ipc_cmd_add_tls_stats(tls_stats, &instance->tls_stats);
+
+	if (instance->worker_pool == NULL) {
+		return ;
+	}
+
+	for (zi = 0; zi < qnetd_worker_pool_size(instance->worker_pool); zi++) {
+		worker = qnetd_worker_pool_get_worker(instance->worker_pool, zi);
+
+		pthread_mutex_lock(&worker->mutex);
+		*no_clients += qnetd_client_list_no_clients(&worker->instance.clients);
+		*no_clusters += qnetd_cluster_list_size(&worker->instance.clusters);
+		qnetd_ipc_cmd_add_tls_stats(tls_stats, &worker->instance.tls_stats);
+		pthread_mutex_unlock(&worker->mutex);
+	}
+}
+
 int
 qnetd_ipc_cmd_status(struct qnetd_instance *instance, struct dynar *outbuf, int verbose)
 {
+	size_t no_clients;
+	size_t no_clusters;
+	struct qnetd_tls_stats tls_stats;
+
+	qnetd_ipc_cmd_get_counts(instance, &no_clients, &no_clusters, &tls_stats);
 
 	if (dynar_str_catf(outbuf, "QNetd address:\t\t\t%s:%"PRIu16"\n",
 	    (instance->host_addr != NULL ? instance->host_addr : "*"), instance->host_port) == -1) {
@@ -53,13 +105,11 @@ qnetd_ipc_cmd_status(struct qnetd_instance *instance, struct dynar *outbuf, int
 		return (-1);
 	}
 
-	if (dynar_str_catf(outbuf, "Connected clients:\t\t%zu\n",
-	    qnetd_client_list_no_clients(&instance->clients)) == -1) {
+	if (dynar_str_catf(outbuf, "Connected clients:\t\t%zu\n", no_clients) == -1) {
 		return (-1);
 	}
 
-	if (dynar_str_catf(outbuf, "Connected clusters:\t\t%zu\n",
-	    qnetd_cluster_list_size(&instance->clusters)) == -1) {
+	if (dynar_str_catf(outbuf, "Connected clusters:\t\t%zu\n", no_clusters) == -1) {
 		return (-1);
 	}
 
@@ -80,6 +130,30 @@ qnetd_ipc_cmd_status(struct qnetd_instance *instance, struct dynar *outbuf, int
 		return (-1);
 	}
 
+	if (instance->tls_supported != TLV_TLS_UNSUPPORTED) {
+		if (dynar_str_catf(outbuf, "TLS handshakes:\t\t\t%"PRIu64" (resumed %"PRIu64
+		    ", failed %"PRIu64")\n", tls_stats.handshakes, tls_stats.handshakes_resumed,
+		    tls_stats.handshakes_failed) == -1) {
+			return (-1);
+		}
+
+		if (dynar_str_catf(outbuf, "TLS handshake time:\t\tavg %"PRIu64" us, "
+		    "max %"PRIu32" us\n",
+		    (tls_stats.handshakes > 0 ?
+		    tls_stats.handshake_time_total / tls_stats.handshakes : 0),
+		    tls_stats.handshake_time_max) == -1) {
+			return (-1);
+		}
+	}
+
+	if (instance->worker_pool != NULL) {
+		if (dynar_str_catf(outbuf, "Worker/handshake threads:\t%zu/%zu\n",
+		    instance->worker_pool->no_cluster_workers,
+		    instance->worker_pool->no_handshake_workers) == -1) {
+			return (-1);
+		}
+	}
+
 	return (0);
 }
 
@@ -258,8 +332,8 @@ qnetd_ipc_cmd_list_add_client_info(const struct qnetd_client *client, struct dyn
 	return (0);
 }
 
-int
-qnetd_ipc_cmd_list(struct qnetd_instance *instance, struct dynar *outbuf, int verbose,
+static int
+qnetd_ipc_cmd_list_instance(struct qnetd_instance *instance, struct dynar *outbuf, int verbose,
     const char *cluster_name)
 {
 	struct qnetd_cluster *cluster;
@@ -267,7 +341,7 @@ qnetd_ipc_cmd_list(struct qnetd_instance *instance, struct dynar *outbuf, int ve
 	size_t cluster_no, client_no;
 
 	cluster_no = 0;
-	TAILQ_FOREACH(cluster, &instance->clusters, entries) {
+	TAILQ_FOREACH(cluster, &instance->clusters.list, entries) {
 		if (cluster_name != NULL && strcmp(cluster_name, "") != 0 &&
 		    strcmp(cluster_name, cluster->cluster_name) != 0) {
 			continue;
@@ -305,3 +379,37 @@ qnetd_ipc_cmd_list(struct qnetd_instance *instance, struct dynar *outbuf, int ve
 
 	return (0);
 }
+
+int
+qnetd_ipc_cmd_list(struct qnetd_instance *instance, struct dynar *outbuf, int verbose,
+    const char *cluster_name)
+{
+	struct qnetd_worker *worker;
+	size_t zi;
+	int res;
+
+	if (qnetd_ipc_cmd_list_instance(instance, outbuf, verbose, cluster_name) != 0) {
+		return (-1);
+	}
+
+	if (instance->worker_pool == NULL) {
+		return (0);
+	}
+
+	/*
+	 * Clusters are owned only by cluster workers
+	 */
+	for (zi = 0; zi < instance->worker_pool->no_cluster_workers; zi++) {
+		worker = &instance->worker_pool->cluster_workers[zi];
+
+		pthread_mutex_lock(&worker->mutex);
+		res = qnetd_ipc_cmd_list_instance(&worker->instance, outbuf, verbose, cluster_name);
+		pthread_mutex_unlock(&worker->mutex);
+
+		if (res != 0) {
+			return (-1);
+		}
+	}
+
+	return (0);
+}
@@ -36,6 +36,7 @@
 #include "qnetd-ipc.h"
 #include "qnetd-ipc-cmd.h"
 #include "qnetd-log.h"
+#include "qnetd-poll-array-user-data.h"
 #include "unix-socket-ipc.h"
 #include "dynar-simple-lex.h"
 #include "dynar-str.h"
@@ -66,6 +67,14 @@ qnetd_ipc_init(struct qnetd_instance *instance)
 		return (-1);
 	}
 
+	if (pr_poll_set_add(&instance->poll_set, &instance->ipc_socket_poll_entry,
+	    instance->ipc_socket_poll_fd, PR_POLL_READ,
+	    QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_SOCKET, NULL) != 0) {
+		qnetd_log_err(LOG_CRIT, "Can't add IPC socket to poll set");
+
+		return (-1);
+	}
+
 	return (0);
 }
 
@@ -102,6 +111,11 @@ qnetd_ipc_destroy(struct qnetd_instance *instance)
 		free(client->user_data);
 	}
 
+	/*
+	 * Socket may be already closed (signal), so error is expected
+	 */
+	(void)pr_poll_set_del(&instance->poll_set, &instance->ipc_socket_poll_entry);
+
 	if (PR_DestroySocketPollFd(instance->ipc_socket_poll_fd) != PR_SUCCESS) {
 		qnetd_log_nss(LOG_WARNING, "Unable to destroy IPC poll socket fd");
 	}
@@ -166,6 +180,17 @@ qnetd_ipc_accept(struct qnetd_instance *instance, struct unix_socket_client **re
 
 	((struct qnetd_ipc_user_data *)(*res_client)->user_data)->nspr_poll_fd = prfd;
 
+	if (pr_poll_set_add(&instance->poll_set,
+	    &((struct qnetd_ipc_user_data *)(*res_client)->user_data)->poll_entry, prfd,
+	    PR_POLL_READ, QNETD_POLL_ARRAY_USER_DATA_TYPE_IPC_CLIENT, *res_client) != 0) {
+		qnetd_log_err(LOG_ERR, "Can't add IPC client to poll set. Disconnecting client");
+		qnetd_ipc_client_disconnect(instance, *res_client);
+		res = -1;
+
+		goto return_res;
+	}
+	((struct qnetd_ipc_user_data *)(*res_client)->user_data)->poll_entry_added = 1;
+
 return_res:
 	return (res);
 }
@@ -174,6 +199,11 @@ void
 qnetd_ipc_client_disconnect(struct qnetd_instance *instance, struct unix_socket_client *client)
 {
 
+	if (((struct qnetd_ipc_user_data *)(client)->user_data)->poll_entry_added) {
+		pr_poll_set_del(&instance->poll_set,
+		    &((struct qnetd_ipc_user_data *)(client)->user_data)->poll_entry);
+	}
+
 	if (PR_DestroySocketPollFd(
 	    ((struct qnetd_ipc_user_data *)(client)->user_data)->nspr_poll_fd) != PR_SUCCESS) {
 		qnetd_log_nss(LOG_WARNING, "Unable to destroy client IPC poll socket fd");
@@ -183,6 +213,28 @@ qnetd_ipc_client_disconnect(struct qnetd_instance *instance, struct unix_socket_
 	unix_socket_ipc_client_disconnect(&instance->local_ipc, client);
 }
 
+int
+qnetd_ipc_poll_update(struct qnetd_instance *instance, struct unix_socket_client *client)
+{
+	struct qnetd_ipc_user_data *ipc_user_data;
+	PRInt16 in_flags;
+
+	ipc_user_data = (struct qnetd_ipc_user_data *)client->user_data;
+
+	in_flags = 0;
+
+	if (client->reading_line) {
+		in_flags |= PR_POLL_READ;
+	}
+
+	if (client->writing_buffer) {
+		in_flags |= PR_POLL_WRITE;
+	}
+
+	return (pr_poll_set_update(&instance->poll_set, &ipc_user_data->poll_entry,
+	    ipc_user_data->nspr_poll_fd, in_flags));
+}
+
 int
 qnetd_ipc_send_error(struct qnetd_instance *instance, struct unix_socket_client *client,
     const char *error_fmt, ...)
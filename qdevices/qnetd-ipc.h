@@ -44,6 +44,8 @@ extern "C" {
 struct qnetd_ipc_user_data {
 	int shutdown_requested;
 	PRFileDesc *nspr_poll_fd;
+	struct pr_poll_set_entry poll_entry;
+	int poll_entry_added;
 };
 
 extern int		qnetd_ipc_init(struct qnetd_instance *instance);
@@ -66,6 +68,9 @@ extern void		qnetd_ipc_io_read(struct qnetd_instance *instance,
 extern void		qnetd_ipc_io_write(struct qnetd_instance *instance,
     struct unix_socket_client *client);
 
+extern int		qnetd_ipc_poll_update(struct qnetd_instance *instance,
+    struct unix_socket_client *client);
+
 extern int		qnetd_ipc_send_error(struct qnetd_instance *instance,
     struct unix_socket_client *client, const char *error_fmt, ...)
     __attribute__((__format__(__printf__, 3, 4)));
@@ -96,6 +96,11 @@ qnetd_log_vprintf(int priority, const char *format, va_list ap)
 
 	if (priority != LOG_DEBUG || (qnetd_log_config_debug)) {
 		if (qnetd_log_config_target & QNETD_LOG_TARGET_STDERR) {
+			/*
+			 * Keep line together when logging from worker threads
+			 */
+			flockfile(stderr);
+
 			current_time = time(NULL);
 			localtime_r(&current_time, &tm_res);
 
@@ -109,6 +114,8 @@ qnetd_log_vprintf(int priority, const char *format, va_list ap)
 			vfprintf(stderr, format, ap_copy);
 			va_end(ap_copy);
 			fprintf(stderr, "\n");
+
+			funlockfile(stderr);
 		}
 
 		if (qnetd_log_config_target & QNETD_LOG_TARGET_SYSLOG) {
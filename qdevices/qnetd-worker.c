@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "qnetd-client-net.h"
+#include "qnetd-log.h"
+#include "qnetd-poll-array-user-data.h"
+#include "qnetd-worker.h"
+
+/*
+ * Needed for creating nspr handle from unix fd
+ */
+#include <private/pprio.h>
+
+static int
+qnetd_worker_init(struct qnetd_worker *worker, struct qnetd_instance *main_instance,
+    struct qnetd_worker_pool *pool, enum qnetd_worker_type type)
+{
+	int i;
+
+	memset(worker, 0, sizeof(*worker));
+	worker->wakeup_pipe[0] = worker->wakeup_pipe[1] = -1;
+
+	if (qnetd_instance_init(&worker->instance, main_instance->tls_supported,
+	    main_instance->tls_client_cert_required, main_instance->max_clients,
+	    main_instance->advanced_settings) != 0) {
+		return (-1);
+	}
+
+	worker->instance.server.cert = main_instance->server.cert;
+	worker->instance.server.private_key = main_instance->server.private_key;
+	worker->instance.host_addr = main_instance->host_addr;
+	worker->instance.host_port = main_instance->host_port;
+	worker->instance.worker = worker;
+	worker->instance.worker_pool = pool;
+
+	worker->type = type;
+	qnetd_client_list_init(&worker->handoff_clients);
+	pthread_mutex_init(&worker->mutex, NULL);
+	pthread_mutex_init(&worker->handoff_mutex, NULL);
+
+	if (pipe(worker->wakeup_pipe) != 0) {
+		qnetd_log_err(LOG_ERR, "Can't create worker wakeup pipe");
+
+		return (-1);
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (fcntl(worker->wakeup_pipe[i], F_SETFL, O_NONBLOCK) == -1 ||
+		    fcntl(worker->wakeup_pipe[i], F_SETFD, FD_CLOEXEC) == -1) {
+			qnetd_log_err(LOG_ERR, "Can't set worker wakeup pipe flags");
+
+			return (-1);
+		}
+	}
+
+	if ((worker->wakeup_poll_fd = PR_CreateSocketPollFd(worker->wakeup_pipe[0])) == NULL) {
+		qnetd_log_nss(LOG_ERR, "Can't create NSPR worker wakeup poll fd");
+
+		return (-1);
+	}
+
+	if (pr_poll_set_add(&worker->instance.poll_set, &worker->wakeup_poll_entry,
+	    worker->wakeup_poll_fd, PR_POLL_READ, QNETD_POLL_ARRAY_USER_DATA_TYPE_WORKER_WAKEUP,
+	    worker) != 0) {
+		qnetd_log_err(LOG_ERR, "Can't add worker wakeup pipe to poll set");
+
+		return (-1);
+	}
+
+	return (0);
+}
+
+static void
+qnetd_worker_destroy(struct qnetd_worker *worker)
+{
+	struct qnetd_client *client;
+
+	/*
+	 * Clients which were handed off but never adopted are not registered anywhere
+	 */
+	TAILQ_FOREACH(client, &worker->handoff_clients, entries) {
+		PR_Close(client->socket);
+	}
+	qnetd_client_list_free(&worker->handoff_clients);
+
+	if (worker->wakeup_poll_fd != NULL) {
+		(void)pr_poll_set_del(&worker->instance.poll_set, &worker->wakeup_poll_entry);
+
+		if (PR_DestroySocketPollFd(worker->wakeup_poll_fd) != PR_SUCCESS) {
+			qnetd_log_nss(LOG_WARNING, "Unable to destroy worker wakeup poll fd");
+		}
+	}
+
+	if (worker->wakeup_pipe[0] != -1) {
+		close(worker->wakeup_pipe[0]);
+		close(worker->wakeup_pipe[1]);
+	}
+
+	qnetd_instance_destroy(&worker->instance);
+
+	pthread_mutex_destroy(&worker->handoff_mutex);
+	pthread_mutex_destroy(&worker->mutex);
+}
+
+int
+qnetd_worker_pool_init(struct qnetd_worker_pool *pool, struct qnetd_instance *main_instance,
+    size_t no_cluster_workers, size_t no_handshake_workers)
+{
+	size_t zi;
+
+	memset(pool, 0, sizeof(*pool));
+
+	pthread_mutex_init(&pool->no_clients_mutex, NULL);
+
+	pool->cluster_workers = calloc(no_cluster_workers, sizeof(*pool->cluster_workers));
+	if (pool->cluster_workers == NULL) {
+		return (-1);
+	}
+
+	if (no_handshake_workers > 0) {
+		pool->handshake_workers = calloc(no_handshake_workers,
+		    sizeof(*pool->handshake_workers));
+		if (pool->handshake_workers == NULL) {
+			return (-1);
+		}
+	}
+
+	for (zi = 0; zi < no_cluster_workers; zi++) {
+		pool->no_cluster_workers++;
+
+		if (qnetd_worker_init(&pool->cluster_workers[zi], main_instance, pool,
+		    QNETD_WORKER_TYPE_CLUSTER) != 0) {
+			return (-1);
+		}
+	}
+
+	for (zi = 0; zi < no_handshake_workers; zi++) {
+		pool->no_handshake_workers++;
+
+		if (qnetd_worker_init(&pool->handshake_workers[zi], main_instance, pool,
+		    QNETD_WORKER_TYPE_HANDSHAKE) != 0) {
+			return (-1);
+		}
+	}
+
+	main_instance->worker_pool = pool;
+
+	return (0);
+}
+
+size_t
+qnetd_worker_pool_size(const struct qnetd_worker_pool *pool)
+{
+
+	return (pool->no_cluster_workers + pool->no_handshake_workers);
+}
+
+/*
+ * Cluster workers are first, followed by handshake workers
+ */
+struct qnetd_worker *
+qnetd_worker_pool_get_worker(struct qnetd_worker_pool *pool, size_t pos)
+{
+
+	if (pos < pool->no_cluster_workers) {
+		return (&pool->cluster_workers[pos]);
+	}
+
+	return (&pool->handshake_workers[pos - pool->no_cluster_workers]);
+}
+
+/*
+ * Signals are handled by main thread (closing of IPC socket wakes its poll), so workers
+ * are started with SIGINT/SIGTERM blocked.
+ */
+int
+qnetd_worker_pool_start(struct qnetd_worker_pool *pool, void *(*start_routine)(void *))
+{
+	struct qnetd_worker *worker;
+	sigset_t block_set, orig_set;
+	size_t zi;
+	int res;
+
+	sigemptyset(&block_set);
+	sigaddset(&block_set, SIGINT);
+	sigaddset(&block_set, SIGTERM);
+
+	if ((res = pthread_sigmask(SIG_BLOCK, &block_set, &orig_set)) != 0) {
+		errno = res;
+		qnetd_log_err(LOG_ERR, "Can't block signals for worker threads");
+
+		return (-1);
+	}
+
+	res = 0;
+
+	for (zi = 0; zi < qnetd_worker_pool_size(pool) && res == 0; zi++) {
+		worker = qnetd_worker_pool_get_worker(pool, zi);
+
+		if ((res = pthread_create(&worker->thread, NULL, start_routine, worker)) != 0) {
+			errno = res;
+			qnetd_log_err(LOG_ERR, "Can't create worker thread");
+			res = -1;
+		} else {
+			worker->thread_started = 1;
+		}
+	}
+
+	(void)pthread_sigmask(SIG_SETMASK, &orig_set, NULL);
+
+	return (res);
+}
+
+static void
+qnetd_worker_wakeup(struct qnetd_worker *worker)
+{
+	char ch;
+
+	ch = 0;
+
+	/*
+	 * Full pipe (EAGAIN) is not an error, worker is going to wake up anyway
+	 */
+	if (write(worker->wakeup_pipe[1], &ch, sizeof(ch)) == -1 && errno != EAGAIN) {
+		qnetd_log_err(LOG_ERR, "Can't wake up worker thread");
+	}
+}
+
+void
+qnetd_worker_pool_stop(struct qnetd_worker_pool *pool)
+{
+	struct qnetd_worker *worker;
+	size_t zi;
+
+	for (zi = 0; zi < qnetd_worker_pool_size(pool); zi++) {
+		worker = qnetd_worker_pool_get_worker(pool, zi);
+
+		pthread_mutex_lock(&worker->mutex);
+		worker->quit = 1;
+		pthread_mutex_unlock(&worker->mutex);
+
+		qnetd_worker_wakeup(worker);
+	}
+
+	for (zi = 0; zi < qnetd_worker_pool_size(pool); zi++) {
+		worker = qnetd_worker_pool_get_worker(pool, zi);
+
+		if (worker->thread_started) {
+			pthread_join(worker->thread, NULL);
+			worker->thread_started = 0;
+		}
+	}
+}
+
+void
+qnetd_worker_pool_destroy(struct qnetd_worker_pool *pool)
+{
+	size_t zi;
+
+	for (zi = 0; zi < qnetd_worker_pool_size(pool); zi++) {
+		qnetd_worker_destroy(qnetd_worker_pool_get_worker(pool, zi));
+	}
+
+	free(pool->cluster_workers);
+	free(pool->handshake_workers);
+
+	pthread_mutex_destroy(&pool->no_clients_mutex);
+}
+
+/*
+ * All clients of one cluster must end in same worker.
+ */
+struct qnetd_worker *
+qnetd_worker_pool_get_cluster_worker(struct qnetd_worker_pool *pool, const char *cluster_name,
+    size_t cluster_name_len)
+{
+	uint32_t hash;
+
+	hash = qnetd_cluster_name_hash(cluster_name, cluster_name_len);
+
+	return (&pool->cluster_workers[hash % pool->no_cluster_workers]);
+}
+
+/*
+ * Round robin. Called only by main thread.
+ */
+struct qnetd_worker *
+qnetd_worker_pool_get_handshake_worker(struct qnetd_worker_pool *pool)
+{
+	struct qnetd_worker *worker;
+
+	if (pool->no_handshake_workers == 0) {
+		return (NULL);
+	}
+
+	worker = &pool->handshake_workers[pool->next_handshake_worker];
+	pool->next_handshake_worker = (pool->next_handshake_worker + 1) %
+	    pool->no_handshake_workers;
+
+	return (worker);
+}
+
+/*
+ * Clients are spread between instances of workers, so max_clients is enforced using
+ * shared counter. Returns -1 if max_clients (when not 0) is reached, otherwise counter
+ * is increased and 0 is returned.
+ */
+int
+qnetd_worker_pool_client_reserve(struct qnetd_worker_pool *pool, size_t max_clients)
+{
+	int res;
+
+	res = 0;
+
+	pthread_mutex_lock(&pool->no_clients_mutex);
+	if (max_clients != 0 && pool->no_clients >= max_clients) {
+		res = -1;
+	} else {
+		pool->no_clients++;
+	}
+	pthread_mutex_unlock(&pool->no_clients_mutex);
+
+	return (res);
+}
+
+void
+qnetd_worker_pool_client_release(struct qnetd_worker_pool *pool)
+{
+
+	pthread_mutex_lock(&pool->no_clients_mutex);
+	pool->no_clients--;
+	pthread_mutex_unlock(&pool->no_clients_mutex);
+}
+
+/*
+ * Move client from instance to worker. Client must be already removed from poll set of
+ * instance. Instance must not touch client after this function returns.
+ */
+int
+qnetd_worker_client_handoff(struct qnetd_instance *instance, struct qnetd_client *client,
+    struct qnetd_worker *worker)
+{
+
+	if (client->poll_changed) {
+		TAILQ_REMOVE(client->poll_changed_list, client, poll_changed_entries);
+		client->poll_changed = 0;
+	}
+	client->poll_changed_list = NULL;
+	client->main_timer_list = NULL;
+
+	TAILQ_REMOVE(&instance->clients, client, entries);
+
+	pthread_mutex_lock(&worker->handoff_mutex);
+	TAILQ_INSERT_TAIL(&worker->handoff_clients, client, entries);
+	pthread_mutex_unlock(&worker->handoff_mutex);
+
+	qnetd_worker_wakeup(worker);
+
+	return (0);
+}
+
+/*
+ * Called by worker when wakeup pipe is readable. Adopts all clients handed off to worker
+ * and processes message which caused handoff (if any).
+ */
+int
+qnetd_worker_handoff_process(struct qnetd_worker *worker)
+{
+	struct qnetd_instance *instance;
+	struct qnetd_client_list clients;
+	struct qnetd_client *client;
+	char buf[64];
+
+	instance = &worker->instance;
+
+	while (read(worker->wakeup_pipe[0], buf, sizeof(buf)) > 0) {
+	}
+
+	qnetd_client_list_init(&clients);
+
+	pthread_mutex_lock(&worker->handoff_mutex);
+	TAILQ_CONCAT(&clients, &worker->handoff_clients, entries);
+	pthread_mutex_unlock(&worker->handoff_mutex);
+
+	while ((client = TAILQ_FIRST(&clients)) != NULL) {
+		TAILQ_REMOVE(&clients, client, entries);
+		TAILQ_INSERT_TAIL(&instance->clients, client, entries);
+
+		client->main_timer_list = &instance->main_timer_list;
+		client->poll_changed_list = &instance->poll_changed_clients;
+
+		if (pr_poll_set_add(&instance->poll_set, &client->poll_entry, client->socket,
+		    PR_POLL_READ, QNETD_POLL_ARRAY_USER_DATA_TYPE_CLIENT, client) != 0) {
+			qnetd_log_err(LOG_ERR, "Can't add handed off client to poll set");
+
+			/*
+			 * Client is not in poll set so it can't be disconnected
+			 * using qnetd_instance_client_disconnect
+			 */
+			PR_Close(client->socket);
+			qnetd_client_list_del(&instance->clients, client);
+			qnetd_worker_pool_client_release(instance->worker_pool);
+
+			continue;
+		}
+
+		if (dynar_size(&client->receive_buffer) > 0) {
+			if (qnetd_client_net_process_received_msg(instance, client) == -1) {
+				qnetd_instance_client_disconnect(instance, client, 0);
+
+				continue;
+			}
+		}
+
+		qnetd_client_poll_changed(client);
+	}
+
+	return (0);
+}
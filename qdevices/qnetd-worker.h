@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _QNETD_WORKER_H_
+#define _QNETD_WORKER_H_
+
+#include <sys/types.h>
+
+#include <pthread.h>
+
+#include "qnetd-instance.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum qnetd_worker_type {
+	QNETD_WORKER_TYPE_CLUSTER,
+	QNETD_WORKER_TYPE_HANDSHAKE,
+};
+
+/*
+ * Worker thread owns its own instance (clients, clusters, timers and poll set), so
+ * all existing code working with instance runs unchanged in worker. Clients are moved
+ * between instances only thru handoff list. Mutex is held by worker all the time
+ * except when waiting for events, so main thread can safely read instance state
+ * (IPC commands) when it holds the mutex.
+ */
+struct qnetd_worker {
+	struct qnetd_instance instance;
+	enum qnetd_worker_type type;
+	pthread_t thread;
+	int thread_started;
+	pthread_mutex_t mutex;
+	int quit;
+	pthread_mutex_t handoff_mutex;
+	struct qnetd_client_list handoff_clients;
+	int wakeup_pipe[2];
+	PRFileDesc *wakeup_poll_fd;
+	struct pr_poll_set_entry wakeup_poll_entry;
+};
+
+/*
+ * Cluster workers serve clients after init message. Every cluster is served by exactly
+ * one cluster worker (selected by hash of cluster name) so algorithms never need locking.
+ * Handshake workers (optional) serve clients from accept until init message (preinit,
+ * TLS handshake). Without handshake workers main thread does handshakes itself.
+ */
+struct qnetd_worker_pool {
+	struct qnetd_worker *cluster_workers;
+	size_t no_cluster_workers;
+	struct qnetd_worker *handshake_workers;
+	size_t no_handshake_workers;
+	size_t next_handshake_worker;
+	pthread_mutex_t no_clients_mutex;
+	size_t no_clients;
+};
+
+extern int			 qnetd_worker_pool_init(struct qnetd_worker_pool *pool,
+    struct qnetd_instance *main_instance, size_t no_cluster_workers,
+    size_t no_handshake_workers);
+
+extern int			 qnetd_worker_pool_start(struct qnetd_worker_pool *pool,
+    void *(*start_routine)(void *));
+
+extern void			 qnetd_worker_pool_stop(struct qnetd_worker_pool *pool);
+
+extern void			 qnetd_worker_pool_destroy(struct qnetd_worker_pool *pool);
+
+extern size_t			 qnetd_worker_pool_size(const struct qnetd_worker_pool *pool);
+
+extern struct qnetd_worker	*qnetd_worker_pool_get_worker(struct qnetd_worker_pool *pool,
+    size_t pos);
+
+extern struct qnetd_worker	*qnetd_worker_pool_get_cluster_worker(
+    struct qnetd_worker_pool *pool, const char *cluster_name, size_t cluster_name_len);
+
+extern struct qnetd_worker	*qnetd_worker_pool_get_handshake_worker(
+    struct qnetd_worker_pool *pool);
+
+extern int			 qnetd_worker_pool_client_reserve(struct qnetd_worker_pool *pool,
+    size_t max_clients);
+
+extern void			 qnetd_worker_pool_client_release(struct qnetd_worker_pool *pool);
+
+extern int			 qnetd_worker_client_handoff(struct qnetd_instance *instance,
+    struct qnetd_client *client, struct qnetd_worker *worker);
+
+extern int			 qnetd_worker_handoff_process(struct qnetd_worker *worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _QNETD_WORKER_H_ */
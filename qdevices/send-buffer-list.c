@@ -132,6 +132,17 @@ send_buffer_list_empty(const struct send_buffer_list *sblist)
 	return (TAILQ_EMPTY(&sblist->list));
 }
 
+/*
+ * Return 1 if no more entries can be get from the list
+ */
+int
+send_buffer_list_full(const struct send_buffer_list *sblist)
+{
+
+	return (TAILQ_EMPTY(&sblist->free_list) &&
+	    sblist->allocated_list_entries >= sblist->max_list_entries);
+}
+
 void
 send_buffer_list_free(struct send_buffer_list *sblist)
 {
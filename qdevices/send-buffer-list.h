@@ -80,6 +80,9 @@ extern void				 send_buffer_list_delete(struct send_buffer_list *sblist,
 extern int				 send_buffer_list_empty(
     const struct send_buffer_list *sblist);
 
+extern int				 send_buffer_list_full(
+    const struct send_buffer_list *sblist);
+
 extern void				 send_buffer_list_free(struct send_buffer_list *sblist);
 
 extern void				 send_buffer_list_set_max_buffer_size(
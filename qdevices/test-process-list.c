@@ -83,13 +83,14 @@ main(void)
 {
 	struct process_list plist;
 	struct process_list_entry *plist_entry;
+	struct process_list_entry *plist_entry2;
 	int i;
 	int timeout;
 	int no_repeats;
 
 	signal_handlers_register();
 
-	process_list_init(&plist, 10, 1, plist_notify, (void *)0x42);
+	process_list_init(&plist, 10, 1, 0, plist_notify, (void *)0x42);
 	plist_entry = process_list_add(&plist, "test name", "command");
 	assert(plist_entry != NULL);
 	assert(strcmp(plist_entry->name, "test name") == 0);
@@ -325,7 +326,7 @@ main(void)
 	/*
 	 * Test 3 processes. Test if entries are properly deallocated
 	 */
-	process_list_init(&plist, 3, 1, plist_notify, (void *)0x42);
+	process_list_init(&plist, 3, 1, 0, plist_notify, (void *)0x42);
 	plist_entry = process_list_add(&plist, "true", "/bin/true");
 	assert(plist_entry != NULL);
 
@@ -432,7 +433,7 @@ main(void)
 	/*
 	 * Test 3 processes and difference between summary and short-circuit summary
 	 */
-	process_list_init(&plist, 3, 1, plist_notify, (void *)0x42);
+	process_list_init(&plist, 3, 1, 0, plist_notify, (void *)0x42);
 	plist_entry = process_list_add(&plist, "true", "/bin/true");
 	assert(plist_entry != NULL);
 
@@ -513,5 +514,57 @@ main(void)
 
 	process_list_free(&plist);
 
+	/*
+	 * Test spawn mode and command cache
+	 */
+	process_list_init(&plist, 10, 1, 1, plist_notify, (void *)0x42);
+	plist_entry = process_list_add(&plist, "true", "/bin/true");
+	assert(plist_entry != NULL);
+	assert(plist_entry->exec_argv_cached);
+
+	plist_entry2 = process_list_add(&plist, "true2", "/bin/true");
+	assert(plist_entry2 != NULL);
+	assert(plist_entry2->exec_argv == plist_entry->exec_argv);
+	assert(plist.command_cache_entries == 1);
+
+	plist_entry = process_list_add(&plist, "false", "/bin/false");
+	assert(plist_entry != NULL);
+	assert(plist.command_cache_entries == 2);
+
+	no_executed = 0;
+	no_finished = 0;
+	assert(process_list_exec_initialized(&plist) == 0);
+	assert(no_executed == 3);
+
+	no_repeats = 10;
+	timeout = 1000 / no_repeats;
+	for (i = 0; i < no_repeats; i++) {
+		assert(process_list_waitpid(&plist) == 0);
+		if (process_list_get_no_running(&plist) > 0) {
+			poll(NULL, 0, timeout);
+		}
+	}
+
+	assert(process_list_get_no_running(&plist) == 0);
+	assert(no_finished == 3);
+	assert(process_list_get_summary_result(&plist) == 1);
+	assert(plist_entry->run_time_us < 1000 * 1000);
+
+	process_list_move_active_entries_to_kill_list(&plist);
+	process_list_command_cache_clear(&plist);
+	assert(plist.command_cache_entries == 0);
+
+	/*
+	 * Command which doesn't exist fails directly with spawn
+	 */
+	plist_entry = process_list_add(&plist, "nonexistent", "/nonexistent/command");
+	assert(plist_entry != NULL);
+	process_list_command_cache_clear(&plist);
+	assert(plist.command_cache_entries == 1);
+	assert(process_list_exec_initialized(&plist) == -1);
+
+	process_list_free(&plist);
+	assert(plist.command_cache_entries == 0);
+
 	return (0);
 }
@@ -33,18 +33,26 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 
 #include "qnetd-cluster-list.h"
 #include "qnetd-client.h"
 #include "qnetd-client-list.h"
 
+#define MANY_CLUSTERS_NO_CLUSTERS	10000
+#define MANY_CLUSTERS_NO_NODES		2
+
+#define PARTITIONS_NO_NODES		64
+#define PARTITIONS_NO_ROUNDS		1000
+
 static struct qnetd_client_list clients;
 static struct qnetd_cluster_list clusters;
 
 static void
-add_client(const char *cluster_name, size_t cluster_name_len,
+add_client_with_node_id(const char *cluster_name, size_t cluster_name_len, uint32_t node_id,
     struct qnetd_client **client, struct qnetd_cluster **cluster)
 {
 	PRNetAddr addr;
@@ -63,6 +71,7 @@ add_client(const char *cluster_name, size_t cluster_name_len,
 	assert(tmp_client->cluster_name != NULL);
 	memcpy(tmp_client->cluster_name, cluster_name, cluster_name_len);
 	tmp_client->cluster_name_len = cluster_name_len;
+	tmp_client->node_id = node_id;
 
 	tmp_cluster = qnetd_cluster_list_add_client(&clusters, tmp_client);
 	assert(cluster != NULL);
@@ -72,6 +81,14 @@ add_client(const char *cluster_name, size_t cluster_name_len,
 	*cluster = tmp_cluster;
 }
 
+static void
+add_client(const char *cluster_name, size_t cluster_name_len,
+    struct qnetd_client **client, struct qnetd_cluster **cluster)
+{
+
+	add_client_with_node_id(cluster_name, cluster_name_len, 0, client, cluster);
+}
+
 static int
 no_clients_in_cluster(struct qnetd_cluster *cluster)
 {
@@ -95,10 +112,12 @@ no_clusters(void)
 
 	i = 0;
 
-	TAILQ_FOREACH(cluster, &clusters, entries) {
+	TAILQ_FOREACH(cluster, &clusters.list, entries) {
 		i++;
 	}
 
+	assert(i == (int)qnetd_cluster_list_size(&clusters));
+
 	return (i);
 }
 
@@ -124,6 +143,271 @@ del_client(struct qnetd_client *client)
 	qnetd_client_list_del(&clients, client);
 }
 
+static double
+time_diff_ms(const struct timespec *start, const struct timespec *end)
+{
+
+	return ((end->tv_sec - start->tv_sec) * 1000.0 +
+	    (end->tv_nsec - start->tv_nsec) / 1000000.0);
+}
+
+/*
+ * Partition computed from scratch (the way algorithms used to compute it)
+ */
+struct test_partition {
+	struct tlv_ring_id ring_id;
+	int num_nodes;
+	int score;
+};
+
+static int
+compute_partitions(const struct qnetd_cluster *cluster, struct test_partition *partitions)
+{
+	struct qnetd_client *client;
+	int no_partitions;
+	int i;
+
+	no_partitions = 0;
+
+	TAILQ_FOREACH(client, &cluster->client_list, cluster_entries) {
+		if (client->last_ring_id.seq == 0) {
+			continue;
+		}
+
+		for (i = 0; i < no_partitions; i++) {
+			if (tlv_ring_id_eq(&partitions[i].ring_id, &client->last_ring_id)) {
+				break;
+			}
+		}
+
+		if (i == no_partitions) {
+			memcpy(&partitions[i].ring_id, &client->last_ring_id,
+			    sizeof(partitions[i].ring_id));
+			partitions[i].num_nodes = 0;
+			partitions[i].score = 0;
+			no_partitions++;
+		}
+
+		partitions[i].num_nodes++;
+		partitions[i].score++;
+		if (client->last_heuristics == TLV_HEURISTICS_PASS) {
+			partitions[i].score++;
+		} else if (client->last_heuristics == TLV_HEURISTICS_FAIL) {
+			partitions[i].score--;
+		}
+	}
+
+	return (no_partitions);
+}
+
+static void
+check_partitions(const struct qnetd_cluster *cluster)
+{
+	struct test_partition partitions[PARTITIONS_NO_NODES];
+	struct qnetd_cluster_partition *partition;
+	int no_partitions;
+	int i;
+
+	no_partitions = compute_partitions(cluster, partitions);
+	assert(no_partitions == (int)cluster->no_partitions);
+
+	TAILQ_FOREACH(partition, &cluster->partitions, entries) {
+		assert(qnetd_cluster_find_partition(cluster, &partition->ring_id) == partition);
+
+		for (i = 0; i < no_partitions; i++) {
+			if (tlv_ring_id_eq(&partitions[i].ring_id, &partition->ring_id)) {
+				break;
+			}
+		}
+		assert(i < no_partitions);
+		assert(partitions[i].num_nodes == partition->num_nodes);
+		assert(partitions[i].score == partition->score);
+	}
+}
+
+/*
+ * Simulate 64 node cluster where nodes report (one by one, as they do after network
+ * split or merge) new ring id and heuristics result. Check incrementally maintained
+ * partitions and measure time compared to computing partitions for every report.
+ */
+static void
+test_partitions(void)
+{
+	struct qnetd_client *client[PARTITIONS_NO_NODES];
+	struct test_partition partitions[PARTITIONS_NO_NODES];
+	struct qnetd_cluster *cluster;
+	struct timespec start, end;
+	const char *cl_name;
+	int no_splits;
+	int round;
+	int i;
+	int res;
+
+	cl_name = "partitions";
+
+	for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+		add_client_with_node_id(cl_name, strlen(cl_name), i + 1, &client[i], &cluster);
+		assert(cluster == client[0]->cluster);
+	}
+
+	assert(qnetd_cluster_size(cluster) == PARTITIONS_NO_NODES);
+	assert(cluster->no_partitions == 0);
+
+	for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+		assert(qnetd_cluster_find_client_by_node_id(cluster, i + 1) == client[i]);
+	}
+	assert(qnetd_cluster_find_client_by_node_id(cluster, PARTITIONS_NO_NODES + 1) == NULL);
+
+	srand(1);
+
+	for (round = 0; round < PARTITIONS_NO_ROUNDS; round++) {
+		no_splits = 1 + rand() % 4;
+
+		for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+			client[i]->last_ring_id.node_id = 1 + rand() % no_splits;
+			client[i]->last_ring_id.seq = (round % 10 == 0 ? 0 : round);
+			client[i]->last_heuristics = rand() % 4;
+
+			assert(qnetd_cluster_client_partition_update(cluster, client[i]) == 0);
+			check_partitions(cluster);
+		}
+	}
+
+	/*
+	 * Measure same burst of reports with incremental update and full recompute
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (round = 0; round < PARTITIONS_NO_ROUNDS; round++) {
+		for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+			client[i]->last_ring_id.node_id = 1 + (i + round) % 2;
+			client[i]->last_ring_id.seq = round + 1;
+
+			res = qnetd_cluster_client_partition_update(cluster, client[i]);
+			assert(res == 0);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("Incrementally updated partitions of %u node cluster %u times in %0.3f ms\n",
+	    PARTITIONS_NO_NODES, PARTITIONS_NO_ROUNDS * PARTITIONS_NO_NODES,
+	    time_diff_ms(&start, &end));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (round = 0; round < PARTITIONS_NO_ROUNDS; round++) {
+		for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+			client[i]->last_ring_id.node_id = 1 + (i + round) % 2;
+			client[i]->last_ring_id.seq = round + 1;
+
+			res = compute_partitions(cluster, partitions);
+			assert(res > 0);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("Computed partitions of %u node cluster %u times in %0.3f ms\n",
+	    PARTITIONS_NO_NODES, PARTITIONS_NO_ROUNDS * PARTITIONS_NO_NODES,
+	    time_diff_ms(&start, &end));
+
+	for (i = 0; i < PARTITIONS_NO_NODES; i++) {
+		del_client(client[i]);
+		if (i < PARTITIONS_NO_NODES - 1) {
+			check_partitions(cluster);
+		}
+	}
+	assert(no_clusters() == 0);
+}
+
+/*
+ * Add nodes of many clusters in the same order as after qnetd restart (every cluster
+ * reconnects node by node), check lookup and measure time.
+ */
+static void
+test_many_clusters(void)
+{
+	static struct qnetd_client *client[MANY_CLUSTERS_NO_CLUSTERS][MANY_CLUSTERS_NO_NODES];
+	struct qnetd_cluster *cluster;
+	struct qnetd_cluster *first_cluster;
+	struct timespec start, end;
+	char cl_name[32];
+	int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (j = 0; j < MANY_CLUSTERS_NO_NODES; j++) {
+		for (i = 0; i < MANY_CLUSTERS_NO_CLUSTERS; i++) {
+			snprintf(cl_name, sizeof(cl_name), "cluster%d", i);
+			add_client(cl_name, strlen(cl_name), &client[i][j], &cluster);
+
+			if (j == 0) {
+				assert(no_clients_in_cluster(cluster) == 1);
+			} else {
+				assert(cluster == client[i][0]->cluster);
+			}
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("Added %u clients of %u clusters in %0.3f ms\n",
+	    MANY_CLUSTERS_NO_CLUSTERS * MANY_CLUSTERS_NO_NODES, MANY_CLUSTERS_NO_CLUSTERS,
+	    time_diff_ms(&start, &end));
+
+	assert(no_clusters() == MANY_CLUSTERS_NO_CLUSTERS);
+
+	for (i = 0; i < MANY_CLUSTERS_NO_CLUSTERS; i++) {
+		snprintf(cl_name, sizeof(cl_name), "cluster%d", i);
+		cluster = qnetd_cluster_list_find_by_name(&clusters, cl_name, strlen(cl_name));
+		assert(cluster == client[i][0]->cluster);
+		assert(strcmp(cluster->cluster_name, cl_name) == 0);
+		assert(no_clients_in_cluster(cluster) == MANY_CLUSTERS_NO_NODES);
+	}
+
+	/*
+	 * Prefix of existing cluster name must not match
+	 */
+	assert(qnetd_cluster_list_find_by_name(&clusters, "cluster1", 7) == NULL);
+	assert(qnetd_cluster_list_find_by_name(&clusters, "nonexistent",
+	    strlen("nonexistent")) == NULL);
+
+	/*
+	 * Delete every second cluster and check rest is still found
+	 */
+	first_cluster = TAILQ_FIRST(&clusters.list);
+	assert(first_cluster == client[0][0]->cluster);
+
+	for (i = 0; i < MANY_CLUSTERS_NO_CLUSTERS; i += 2) {
+		for (j = 0; j < MANY_CLUSTERS_NO_NODES; j++) {
+			del_client(client[i][j]);
+		}
+	}
+	assert(no_clusters() == MANY_CLUSTERS_NO_CLUSTERS / 2);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < MANY_CLUSTERS_NO_CLUSTERS; i++) {
+		snprintf(cl_name, sizeof(cl_name), "cluster%d", i);
+		cluster = qnetd_cluster_list_find_by_name(&clusters, cl_name, strlen(cl_name));
+		if (i % 2 == 0) {
+			assert(cluster == NULL);
+		} else {
+			assert(cluster == client[i][0]->cluster);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("Looked up %u clusters in %0.3f ms\n", MANY_CLUSTERS_NO_CLUSTERS,
+	    time_diff_ms(&start, &end));
+
+	for (i = 1; i < MANY_CLUSTERS_NO_CLUSTERS; i += 2) {
+		for (j = 0; j < MANY_CLUSTERS_NO_NODES; j++) {
+			del_client(client[i][j]);
+		}
+	}
+	assert(no_clusters() == 0);
+	assert(qnetd_cluster_list_find_by_name(&clusters, "cluster1", strlen("cluster1")) == NULL);
+}
+
 int
 main(void)
 {
@@ -203,5 +487,12 @@ main(void)
 	del_client(client[0]);
 	assert(no_clusters() == 0);
 
+	test_many_clusters();
+
+	test_partitions();
+
+	qnetd_cluster_list_free(&clusters);
+	qnetd_client_list_free(&clients);
+
 	return (0);
 }
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <time.h>
+
+#include "timer-list.h"
+
+#define SHORT_TIMEOUT			10
+#define BENCH_NO_TIMERS			100000
+
+static int timer_list_fn1_called = 0;
+static int timer_list_fn1_return = 0;
+static int timer_list_order[16];
+static int timer_list_order_pos = 0;
+
+static struct timer_list tlist;
+
+static int
+timer_list_fn1(void *data1, void *data2)
+{
+
+	assert(data1 == &timer_list_fn1_called);
+	assert(data2 == timer_list_fn1);
+
+	timer_list_fn1_called++;
+
+	return (timer_list_fn1_return);
+}
+
+static int
+timer_list_order_fn(void *data1, void *data2)
+{
+
+	assert(timer_list_order_pos < (int)(sizeof(timer_list_order) / sizeof(timer_list_order[0])));
+
+	timer_list_order[timer_list_order_pos++] = *(int *)data1;
+
+	return (0);
+}
+
+static int
+timer_list_bench_fn(void *data1, void *data2)
+{
+
+	(*(int *)data1)++;
+
+	return (0);
+}
+
+/*
+ * Check heap property of active entries
+ */
+static void
+check_timer_list(void)
+{
+	size_t zi;
+
+	for (zi = 0; zi < tlist.heap_size; zi++) {
+		assert(tlist.heap[zi]->heap_pos == zi);
+		assert(tlist.heap[zi]->is_active);
+
+		if (zi > 0) {
+			assert((PRInt32)(tlist.heap[(zi - 1) / 2]->expire_time -
+			    tlist.heap[zi]->expire_time) <= 0);
+		}
+	}
+}
+
+static void
+sleep_ms(int ms)
+{
+
+	poll(NULL, 0, ms);
+}
+
+static double
+time_diff_ms(const struct timespec *start, const struct timespec *end)
+{
+
+	return ((end->tv_sec - start->tv_sec) * 1000.0 +
+	    (end->tv_nsec - start->tv_nsec) / 1000000.0);
+}
+
+static void
+test_basic(void)
+{
+	struct timer_list_entry *entry;
+
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+	assert(timer_list_add(&tlist, 0, timer_list_fn1, NULL, NULL) == NULL);
+	assert(timer_list_add(&tlist, TIMER_LIST_MAX_INTERVAL + 1, timer_list_fn1, NULL,
+	    NULL) == NULL);
+
+	/*
+	 * Single shot timer
+	 */
+	timer_list_fn1_called = 0;
+	timer_list_fn1_return = 0;
+	entry = timer_list_add(&tlist, SHORT_TIMEOUT, timer_list_fn1, &timer_list_fn1_called,
+	    timer_list_fn1);
+	assert(entry != NULL);
+	assert(timer_list_time_to_expire_ms(&tlist) <= SHORT_TIMEOUT);
+	check_timer_list();
+
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 0);
+
+	sleep_ms(SHORT_TIMEOUT * 2);
+	assert(timer_list_time_to_expire(&tlist) == 0);
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 1);
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+	assert(!entry->is_active);
+
+	/*
+	 * Periodic timer
+	 */
+	timer_list_fn1_called = 0;
+	timer_list_fn1_return = -1;
+	entry = timer_list_add(&tlist, SHORT_TIMEOUT, timer_list_fn1, &timer_list_fn1_called,
+	    timer_list_fn1);
+	assert(entry != NULL);
+
+	sleep_ms(SHORT_TIMEOUT * 2);
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 1);
+	assert(entry->is_active);
+	assert(timer_list_time_to_expire(&tlist) != PR_INTERVAL_NO_TIMEOUT);
+
+	sleep_ms(SHORT_TIMEOUT * 2);
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 2);
+
+	timer_list_delete(&tlist, entry);
+	assert(!entry->is_active);
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+
+	/*
+	 * Deleted timer is not called
+	 */
+	timer_list_fn1_called = 0;
+	entry = timer_list_add(&tlist, SHORT_TIMEOUT, timer_list_fn1, &timer_list_fn1_called,
+	    timer_list_fn1);
+	assert(entry != NULL);
+	timer_list_delete(&tlist, entry);
+	sleep_ms(SHORT_TIMEOUT * 2);
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 0);
+
+	/*
+	 * Rescheduled timer expires later
+	 */
+	timer_list_fn1_return = 0;
+	entry = timer_list_add(&tlist, SHORT_TIMEOUT * 5, timer_list_fn1,
+	    &timer_list_fn1_called, timer_list_fn1);
+	assert(entry != NULL);
+	sleep_ms(SHORT_TIMEOUT * 3);
+	timer_list_reschedule(&tlist, entry);
+	assert(timer_list_time_to_expire_ms(&tlist) > SHORT_TIMEOUT * 3);
+	sleep_ms(SHORT_TIMEOUT * 3);
+	timer_list_expire(&tlist);
+	assert(timer_list_fn1_called == 0);
+	timer_list_delete(&tlist, entry);
+}
+
+static void
+test_order(void)
+{
+	int intervals[] = {50, 10, 40, 20, 30, 60};
+	int ids[] = {0, 1, 2, 3, 4, 5};
+	int expected[] = {1, 3, 4, 0};
+	struct timer_list_entry *entries[6];
+	size_t zi;
+
+	timer_list_order_pos = 0;
+
+	for (zi = 0; zi < sizeof(intervals) / sizeof(intervals[0]); zi++) {
+		entries[zi] = timer_list_add(&tlist, intervals[zi], timer_list_order_fn, &ids[zi],
+		    NULL);
+		assert(entries[zi] != NULL);
+		check_timer_list();
+	}
+
+	/*
+	 * Delete timers 2 (from middle of heap) and 5
+	 */
+	timer_list_delete(&tlist, entries[2]);
+	check_timer_list();
+	timer_list_delete(&tlist, entries[5]);
+	check_timer_list();
+
+	sleep_ms(70);
+	timer_list_expire(&tlist);
+
+	assert(timer_list_order_pos == sizeof(expected) / sizeof(expected[0]));
+	assert(memcmp(timer_list_order, expected, sizeof(expected)) == 0);
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+}
+
+/*
+ * Measure cost of add, reschedule, delete and expire of BENCH_NO_TIMERS timers
+ */
+static void
+test_bench(void)
+{
+	struct timer_list_entry **entries;
+	struct timespec start, end;
+	int no_expired;
+	size_t zi;
+
+	entries = malloc(sizeof(*entries) * BENCH_NO_TIMERS);
+	assert(entries != NULL);
+
+	srand(1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (zi = 0; zi < BENCH_NO_TIMERS; zi++) {
+		entries[zi] = timer_list_add(&tlist, 10000 + rand() % 100000,
+		    timer_list_bench_fn, &no_expired, NULL);
+		assert(entries[zi] != NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Add of %u timers: %0.3f ms\n", BENCH_NO_TIMERS, time_diff_ms(&start, &end));
+	check_timer_list();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (zi = 0; zi < BENCH_NO_TIMERS; zi++) {
+		timer_list_reschedule(&tlist, entries[rand() % BENCH_NO_TIMERS]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Reschedule of %u timers: %0.3f ms\n", BENCH_NO_TIMERS,
+	    time_diff_ms(&start, &end));
+	check_timer_list();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (zi = 0; zi < BENCH_NO_TIMERS; zi++) {
+		timer_list_delete(&tlist, entries[zi]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Delete of %u timers: %0.3f ms\n", BENCH_NO_TIMERS, time_diff_ms(&start, &end));
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+
+	for (zi = 0; zi < BENCH_NO_TIMERS; zi++) {
+		entries[zi] = timer_list_add(&tlist, 1 + rand() % SHORT_TIMEOUT,
+		    timer_list_bench_fn, &no_expired, NULL);
+		assert(entries[zi] != NULL);
+	}
+	check_timer_list();
+
+	sleep_ms(SHORT_TIMEOUT * 2);
+
+	no_expired = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	timer_list_expire(&tlist);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Expire of %u timers: %0.3f ms\n", BENCH_NO_TIMERS, time_diff_ms(&start, &end));
+	assert(no_expired == BENCH_NO_TIMERS);
+	assert(timer_list_time_to_expire(&tlist) == PR_INTERVAL_NO_TIMEOUT);
+
+	free(entries);
+}
+
+int
+main(void)
+{
+
+	timer_list_init(&tlist);
+
+	test_basic();
+	test_order();
+	test_bench();
+
+	timer_list_free(&tlist);
+
+	return (0);
+}
@@ -32,17 +32,19 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "timer-list.h"
 
+#define TIMER_LIST_HEAP_INITIAL_SIZE	16
+
 void
 timer_list_init(struct timer_list *tlist)
 {
 
 	memset(tlist, 0, sizeof(*tlist));
 
-	TAILQ_INIT(&tlist->list);
 	TAILQ_INIT(&tlist->free_list);
 }
 
@@ -62,51 +64,135 @@ timer_list_entry_time_to_expire(const struct timer_list_entry *entry, PRInterval
 	return (diff);
 }
 
+/*
+ * Returns non zero if entry1 expires before entry2. Expire times can overflow, but all
+ * active timers are less than half of interval range apart (TIMER_LIST_MAX_INTERVAL),
+ * so difference interpreted as signed number gives correct order.
+ */
 static int
-timer_list_entry_cmp(const struct timer_list_entry *entry1,
-    const struct timer_list_entry *entry2, PRIntervalTime current_time)
+timer_list_entry_lt(const struct timer_list_entry *entry1,
+    const struct timer_list_entry *entry2)
+{
+
+	return ((PRInt32)(entry1->expire_time - entry2->expire_time) < 0);
+}
+
+static void
+timer_list_heap_set(struct timer_list *tlist, size_t pos, struct timer_list_entry *entry)
 {
-	PRIntervalTime diff1, diff2;
-	int res;
 
-	diff1 = timer_list_entry_time_to_expire(entry1, current_time);
-	diff2 = timer_list_entry_time_to_expire(entry2, current_time);
+	tlist->heap[pos] = entry;
+	entry->heap_pos = pos;
+}
+
+static void
+timer_list_heap_sift_up(struct timer_list *tlist, size_t pos)
+{
+	struct timer_list_entry *entry;
+	size_t parent;
 
-	res = 0;
+	entry = tlist->heap[pos];
 
-	if (diff1 < diff2) res = -1;
-	if (diff1 > diff2) res = 1;
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
 
-	return (res);
+		if (!timer_list_entry_lt(entry, tlist->heap[parent])) {
+			break;
+		}
+
+		timer_list_heap_set(tlist, pos, tlist->heap[parent]);
+		pos = parent;
+	}
+
+	timer_list_heap_set(tlist, pos, entry);
 }
 
 static void
-timer_list_insert_into_list(struct timer_list *tlist, struct timer_list_entry *new_entry)
+timer_list_heap_sift_down(struct timer_list *tlist, size_t pos)
 {
 	struct timer_list_entry *entry;
+	size_t child;
+
+	entry = tlist->heap[pos];
+
+	while ((child = pos * 2 + 1) < tlist->heap_size) {
+		if (child + 1 < tlist->heap_size &&
+		    timer_list_entry_lt(tlist->heap[child + 1], tlist->heap[child])) {
+			child++;
+		}
+
+		if (!timer_list_entry_lt(tlist->heap[child], entry)) {
+			break;
+		}
+
+		timer_list_heap_set(tlist, pos, tlist->heap[child]);
+		pos = child;
+	}
+
+	timer_list_heap_set(tlist, pos, entry);
+}
+
+/*
+ * Compute expire time of entry (epoch and interval are already set) and put entry on
+ * correct place in heap. Entry must already be in heap.
+ */
+static void
+timer_list_heap_update(struct timer_list *tlist, struct timer_list_entry *entry)
+{
 
 	/*
 	 * This can overflow and it's not a problem
 	 */
-	new_entry->expire_time = new_entry->epoch + PR_MillisecondsToInterval(new_entry->interval);
+	entry->expire_time = entry->epoch + PR_MillisecondsToInterval(entry->interval);
 
-	entry = TAILQ_FIRST(&tlist->list);
-	while (entry != NULL) {
-		if (timer_list_entry_cmp(entry, new_entry, new_entry->epoch) > 0) {
-			/*
-			 * Insert new entry right before current entry
-			 */
-			TAILQ_INSERT_BEFORE(entry, new_entry, entries);
+	timer_list_heap_sift_up(tlist, entry->heap_pos);
+	timer_list_heap_sift_down(tlist, entry->heap_pos);
+}
 
-			break;
-		}
+static int
+timer_list_heap_reserve(struct timer_list *tlist)
+{
+	struct timer_list_entry **new_heap;
+	size_t new_size;
 
-		entry = TAILQ_NEXT(entry, entries);
+	if (tlist->heap_size < tlist->heap_allocated) {
+		return (0);
 	}
 
-	if (entry == NULL) {
-		TAILQ_INSERT_TAIL(&tlist->list, new_entry, entries);
+	new_size = (tlist->heap_allocated == 0 ? TIMER_LIST_HEAP_INITIAL_SIZE :
+	    tlist->heap_allocated * 2);
+
+	new_heap = realloc(tlist->heap, sizeof(*new_heap) * new_size);
+	if (new_heap == NULL) {
+		return (-1);
 	}
+
+	tlist->heap = new_heap;
+	tlist->heap_allocated = new_size;
+
+	return (0);
+}
+
+static void
+timer_list_heap_remove(struct timer_list *tlist, struct timer_list_entry *entry)
+{
+	struct timer_list_entry *last_entry;
+	size_t pos;
+
+	pos = entry->heap_pos;
+	tlist->heap_size--;
+
+	if (pos == tlist->heap_size) {
+		return ;
+	}
+
+	/*
+	 * Move last entry to the freed position and restore heap property
+	 */
+	last_entry = tlist->heap[tlist->heap_size];
+	timer_list_heap_set(tlist, pos, last_entry);
+	timer_list_heap_sift_up(tlist, pos);
+	timer_list_heap_sift_down(tlist, last_entry->heap_pos);
 }
 
 struct timer_list_entry *
@@ -119,6 +205,10 @@ timer_list_add(struct timer_list *tlist, PRUint32 interval, timer_list_cb_fn fun
 		return (NULL);
 	}
 
+	if (timer_list_heap_reserve(tlist) != 0) {
+		return (NULL);
+	}
+
 	if (!TAILQ_EMPTY(&tlist->free_list)) {
 		/*
 		 * Use free list entry
@@ -143,7 +233,9 @@ timer_list_add(struct timer_list *tlist, PRUint32 interval, timer_list_cb_fn fun
 	new_entry->user_data2 = data2;
 	new_entry->is_active = 1;
 
-	timer_list_insert_into_list(tlist, new_entry);
+	timer_list_heap_set(tlist, tlist->heap_size, new_entry);
+	tlist->heap_size++;
+	timer_list_heap_update(tlist, new_entry);
 
 	return (new_entry);
 }
@@ -154,8 +246,7 @@ timer_list_reschedule(struct timer_list *tlist, struct timer_list_entry *entry)
 
 	if (entry->is_active) {
 		entry->epoch = PR_IntervalNow();
-		TAILQ_REMOVE(&tlist->list, entry, entries);
-		timer_list_insert_into_list(tlist, entry);
+		timer_list_heap_update(tlist, entry);
 	}
 }
 
@@ -168,8 +259,8 @@ timer_list_expire(struct timer_list *tlist)
 
 	now = PR_IntervalNow();
 
-	while ((entry = TAILQ_FIRST(&tlist->list)) != NULL &&
-	    timer_list_entry_time_to_expire(entry, now) == 0) {
+	while (tlist->heap_size > 0 &&
+	    timer_list_entry_time_to_expire((entry = tlist->heap[0]), now) == 0) {
 		/*
 		 * Expired
 		 */
@@ -184,8 +275,7 @@ timer_list_expire(struct timer_list *tlist)
 			 * Schedule again
 			 */
 			entry->epoch = now;
-			TAILQ_REMOVE(&tlist->list, entry, entries);
-			timer_list_insert_into_list(tlist, entry);
+			timer_list_heap_update(tlist, entry);
 		}
 	}
 }
@@ -193,29 +283,26 @@ timer_list_expire(struct timer_list *tlist)
 PRIntervalTime
 timer_list_time_to_expire(struct timer_list *tlist)
 {
-	struct timer_list_entry *entry;
 
-	entry = TAILQ_FIRST(&tlist->list);
-	if (entry == NULL) {
+	if (tlist->heap_size == 0) {
 		return (PR_INTERVAL_NO_TIMEOUT);
 	}
 
-	return (timer_list_entry_time_to_expire(entry, PR_IntervalNow()));
+	return (timer_list_entry_time_to_expire(tlist->heap[0], PR_IntervalNow()));
 }
 
 uint32_t
 timer_list_time_to_expire_ms(struct timer_list *tlist)
 {
-	struct timer_list_entry *entry;
 	uint32_t u32;
 
-	entry = TAILQ_FIRST(&tlist->list);
-	if (entry == NULL) {
+	if (tlist->heap_size == 0) {
 		u32 = ~((uint32_t)0);
 		return (u32);
 	}
 
-	return (PR_IntervalToMilliseconds(timer_list_entry_time_to_expire(entry, PR_IntervalNow())));
+	return (PR_IntervalToMilliseconds(timer_list_entry_time_to_expire(tlist->heap[0],
+	    PR_IntervalNow())));
 }
 
 void
@@ -226,7 +313,7 @@ timer_list_delete(struct timer_list *tlist, struct timer_list_entry *entry)
 		/*
 		 * Move item to free list
 		 */
-		TAILQ_REMOVE(&tlist->list, entry, entries);
+		timer_list_heap_remove(tlist, entry);
 		TAILQ_INSERT_HEAD(&tlist->free_list, entry, entries);
 		entry->is_active = 0;
 	}
@@ -237,18 +324,14 @@ timer_list_free(struct timer_list *tlist)
 {
 	struct timer_list_entry *entry;
 	struct timer_list_entry *entry_next;
+	size_t zi;
 
-
-	entry = TAILQ_FIRST(&tlist->list);
-
-	while (entry != NULL) {
-		entry_next = TAILQ_NEXT(entry, entries);
-
-		free(entry);
-
-		entry = entry_next;
+	for (zi = 0; zi < tlist->heap_size; zi++) {
+		free(tlist->heap[zi]);
 	}
 
+	free(tlist->heap);
+
 	entry = TAILQ_FIRST(&tlist->free_list);
 
 	while (entry != NULL) {
@@ -62,11 +62,20 @@ struct timer_list_entry {
 	void *user_data1;
 	void *user_data2;
 	int is_active;
+	/* Position in heap (valid only for active entry) */
+	size_t heap_pos;
+	/* Used only for free list */
 	TAILQ_ENTRY(timer_list_entry) entries;
 };
 
+/*
+ * Active entries are kept in binary min-heap ordered by expire_time, so add, reschedule
+ * and delete are O(log n) and nearest timer is always heap[0].
+ */
 struct timer_list {
-	TAILQ_HEAD(, timer_list_entry) list;
+	struct timer_list_entry **heap;
+	size_t heap_size;
+	size_t heap_allocated;
 	TAILQ_HEAD(, timer_list_entry) free_list;
 };
 
@@ -84,26 +84,51 @@ enum tlv_opt_type tlv_static_supported_options[TLV_STATIC_SUPPORTED_OPTIONS_SIZE
     TLV_OPT_HEURISTICS,
 };
 
-int
-tlv_add(struct dynar *msg, enum tlv_opt_type opt_type, uint16_t opt_len, const void *value)
+static void
+tlv_add_header(struct dynar *msg, enum tlv_opt_type opt_type, uint16_t opt_len)
 {
+	char tmp_buf[TLV_TYPE_LENGTH + TLV_LENGTH_LENGTH];
 	uint16_t nlen;
 	uint16_t nopt_type;
 
-	if (dynar_size(msg) + sizeof(nopt_type) + sizeof(nlen) + opt_len > dynar_max_size(msg)) {
+	nopt_type = htons((uint16_t)opt_type);
+	nlen = htons(opt_len);
+
+	memcpy(tmp_buf, &nopt_type, sizeof(nopt_type));
+	memcpy(tmp_buf + sizeof(nopt_type), &nlen, sizeof(nlen));
+
+	dynar_cat(msg, tmp_buf, sizeof(tmp_buf));
+}
+
+int
+tlv_add(struct dynar *msg, enum tlv_opt_type opt_type, uint16_t opt_len, const void *value)
+{
+
+	if (dynar_size(msg) + TLV_TYPE_LENGTH + TLV_LENGTH_LENGTH + opt_len >
+	    dynar_max_size(msg)) {
 		return (-1);
 	}
 
-	nopt_type = htons((uint16_t)opt_type);
-	nlen = htons(opt_len);
+	/*
+	 * Allocate space for whole option at once
+	 */
+	if (dynar_prealloc(msg, TLV_TYPE_LENGTH + TLV_LENGTH_LENGTH + opt_len) == -1) {
+		return (-1);
+	}
 
-	dynar_cat(msg, &nopt_type, sizeof(nopt_type));
-	dynar_cat(msg, &nlen, sizeof(nlen));
+	tlv_add_header(msg, opt_type, opt_len);
 	dynar_cat(msg, value, opt_len);
 
 	return (0);
 }
 
+size_t
+tlv_get_opt_size(uint16_t opt_len)
+{
+
+	return (TLV_TYPE_LENGTH + TLV_LENGTH_LENGTH + opt_len);
+}
+
 int
 tlv_add_u32(struct dynar *msg, enum tlv_opt_type opt_type, uint32_t u32)
 {
@@ -348,43 +373,63 @@ tlv_add_node_state(struct dynar *msg, enum tlv_node_state node_state)
 	return (tlv_add_u8(msg, TLV_OPT_NODE_STATE, node_state));
 }
 
+static uint16_t
+tlv_get_node_info_value_size(const struct tlv_node_info *node_info)
+{
+	uint16_t res;
+
+	res = tlv_get_opt_size(sizeof(uint32_t));
+
+	if (node_info->data_center_id != 0) {
+		res += tlv_get_opt_size(sizeof(uint32_t));
+	}
+
+	if (node_info->node_state != TLV_NODE_STATE_NOT_SET) {
+		res += tlv_get_opt_size(sizeof(uint8_t));
+	}
+
+	return (res);
+}
+
+size_t
+tlv_get_node_info_size(const struct tlv_node_info *node_info)
+{
+
+	return (tlv_get_opt_size(tlv_get_node_info_value_size(node_info)));
+}
+
 int
 tlv_add_node_info(struct dynar *msg, const struct tlv_node_info *node_info)
 {
-	struct dynar opt_value;
-	int res;
+	uint16_t opt_len;
 
-	res = 0;
 	/*
-	 * Create sub message,
+	 * Sub options are stored directly to msg so check (and allocate) space
+	 * for whole option first. Adding of sub options then cannot fail.
 	 */
-	dynar_init(&opt_value, 1024);
-	if ((res = tlv_add_node_id(&opt_value, node_info->node_id)) != 0) {
-		goto exit_dynar_destroy;
-	}
+	opt_len = tlv_get_node_info_value_size(node_info);
 
-	if (node_info->data_center_id != 0) {
-		if ((res = tlv_add_data_center_id(&opt_value, node_info->data_center_id)) != 0) {
-			goto exit_dynar_destroy;
-		}
+	if (dynar_size(msg) + tlv_get_opt_size(opt_len) > dynar_max_size(msg)) {
+		return (-1);
 	}
 
-	if (node_info->node_state != TLV_NODE_STATE_NOT_SET) {
-		if ((res = tlv_add_node_state(&opt_value, node_info->node_state)) != 0) {
-			goto exit_dynar_destroy;
-		}
+	if (dynar_prealloc(msg, tlv_get_opt_size(opt_len)) == -1) {
+		return (-1);
 	}
 
-	res = tlv_add(msg, TLV_OPT_NODE_INFO, dynar_size(&opt_value), dynar_data(&opt_value));
-	if (res != 0) {
-		goto exit_dynar_destroy;
-	}
+	tlv_add_header(msg, TLV_OPT_NODE_INFO, opt_len);
 
+	(void)tlv_add_node_id(msg, node_info->node_id);
 
-exit_dynar_destroy:
-	dynar_destroy(&opt_value);
+	if (node_info->data_center_id != 0) {
+		(void)tlv_add_data_center_id(msg, node_info->data_center_id);
+	}
 
-	return (res);
+	if (node_info->node_state != TLV_NODE_STATE_NOT_SET) {
+		(void)tlv_add_node_state(msg, node_info->node_state);
+	}
+
+	return (0);
 }
 
 int
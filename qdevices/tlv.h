@@ -173,6 +173,8 @@ struct tlv_iterator {
 extern int			 tlv_add(struct dynar *msg, enum tlv_opt_type opt_type,
     uint16_t opt_len, const void *value);
 
+extern size_t			 tlv_get_opt_size(uint16_t opt_len);
+
 extern int			 tlv_add_u32(struct dynar *msg, enum tlv_opt_type opt_type,
     uint32_t u32);
 
@@ -243,6 +245,8 @@ extern int			 tlv_add_node_state(struct dynar *msg,
 extern int			 tlv_add_node_info(struct dynar *msg,
     const struct tlv_node_info *node_info);
 
+extern size_t			 tlv_get_node_info_size(const struct tlv_node_info *node_info);
+
 extern int			 tlv_add_node_list_type(struct dynar *msg,
     enum tlv_node_list_type node_list_type);
 
@@ -40,6 +40,7 @@
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -103,38 +104,146 @@ static cpg_callbacks_t callbacks = {
 };
 
 #define ONE_MEG 1048576
-static char data[ONE_MEG];
+#define DATASIZE (ONE_MEG * 16)
+static char data[DATASIZE];
 
-static void cpg_benchmark (
+#define MAX_BATCH_SIZE 1024
+
+/*
+ * Number of messages sent by one cpg_mcast_joined_batch call. 0 means
+ * cpg_mcast_joined is used.
+ */
+static unsigned int batch_size;
+
+/*
+ * Send messages by cpg_zcb_mcast_joined
+ */
+static int zero_copy;
+
+/*
+ * Print results as one comma separated line per run
+ * (size,messages,seconds,tp_s,mb_s)
+ */
+static int machine_readable;
+
+static unsigned int run_time = 10;
+
+static cpg_model_v1_data_t model1_data = {
+	.cpg_deliver_fn		= cpg_bm_deliver_fn,
+	.cpg_confchg_fn		= cpg_bm_confchg_fn,
+};
+
+static cs_error_t cpg_benchmark (
 	cpg_handle_t handle_in,
 	int write_size)
 {
 	struct timeval tv1, tv2, tv_elapsed;
 	struct iovec iov;
+	static struct iovec batch_iov[MAX_BATCH_SIZE];
+	unsigned int batch_msgs;
+	uint32_t max_msg_size;
 	unsigned int res;
+	unsigned int i;
+	cpg_flow_control_state_t flow_control_state;
+	cs_error_t async_send_error;
+	uint32_t async_send_failed_msgs;
+	void *zcb_buffer = NULL;
+	double elapsed;
 
 	alarm_notice = 0;
 	iov.iov_base = data;
 	iov.iov_len = write_size;
 
+	/*
+	 * Whole batch must fit into one IPC message
+	 */
+	batch_msgs = batch_size;
+	if (batch_msgs > 0) {
+		if (cpg_max_atomic_msgsize_get (handle_in, &max_msg_size) != CS_OK) {
+			max_msg_size = ONE_MEG;
+		}
+
+		if (batch_msgs > max_msg_size / (write_size + 16)) {
+			batch_msgs = max_msg_size / (write_size + 16);
+		}
+
+		for (i = 0; i < batch_msgs; i++) {
+			batch_iov[i] = iov;
+		}
+	}
+
+	if (zero_copy) {
+		res = cpg_zcb_alloc (handle_in, write_size, &zcb_buffer);
+		if (res != CS_OK) {
+			fprintf (stderr, "cpg_zcb_alloc failed with result %d\n", res);
+			return (res);
+		}
+		memcpy (zcb_buffer, data, write_size);
+	}
+
 	write_count = 0;
-	alarm (10);
+	alarm (run_time);
 
 	gettimeofday (&tv1, NULL);
 	do {
-		res = cpg_mcast_joined (handle_in, CPG_TYPE_AGREED, &iov, 1);
+		if (model1_data.flags & CPG_MODEL_V1_ASYNC_SEND) {
+			/*
+			 * Don't spin on flow control, wait for dispatch thread to
+			 * receive something
+			 */
+			cpg_flow_control_state_get (handle_in, &flow_control_state);
+			if (flow_control_state == CPG_FLOW_CONTROL_ENABLED) {
+				usleep (100);
+				res = CS_ERR_TRY_AGAIN;
+				continue;
+			}
+		}
+
+		if (zero_copy) {
+			res = cpg_zcb_mcast_joined (handle_in, CPG_TYPE_AGREED, zcb_buffer, write_size);
+		} else if (batch_msgs > 1) {
+			res = cpg_mcast_joined_batch (handle_in, CPG_TYPE_AGREED, batch_iov, batch_msgs);
+		} else {
+			res = cpg_mcast_joined (handle_in, CPG_TYPE_AGREED, &iov, 1);
+		}
 	} while (alarm_notice == 0 && (res == CS_OK || res == CS_ERR_TRY_AGAIN));
 	gettimeofday (&tv2, NULL);
 	timersub (&tv2, &tv1, &tv_elapsed);
+	elapsed = tv_elapsed.tv_sec + (tv_elapsed.tv_usec / 1000000.0);
+
+	if (zcb_buffer != NULL) {
+		cpg_zcb_free (handle_in, zcb_buffer);
+	}
+
+	if (res != CS_OK && res != CS_ERR_TRY_AGAIN) {
+		fprintf (stderr, "send of %d bytes message failed with result %d\n", write_size, res);
+		return (res);
+	}
+
+	if (machine_readable) {
+		printf ("%d,%u,%.3f,%.3f,%.3f\n", write_size, write_count, elapsed,
+			((double)write_count) / elapsed,
+			((double)write_count) * ((double)write_size) / (elapsed * 1000000.0));
+		return (CS_OK);
+	}
 
 	printf ("%5d messages received ", write_count);
 	printf ("%5d bytes per write ", write_size);
-	printf ("%7.3f Seconds runtime ",
-		(tv_elapsed.tv_sec + (tv_elapsed.tv_usec / 1000000.0)));
-	printf ("%9.3f TP/s ",
-		((float)write_count) /  (tv_elapsed.tv_sec + (tv_elapsed.tv_usec / 1000000.0)));
-	printf ("%7.3f MB/s.\n",
-		((float)write_count) * ((float)write_size) /  ((tv_elapsed.tv_sec + (tv_elapsed.tv_usec / 1000000.0)) * 1000000.0));
+	if (batch_msgs > 1) {
+		printf ("%4u messages per batch ", batch_msgs);
+	}
+	if (model1_data.flags & CPG_MODEL_V1_ASYNC_SEND) {
+		if (cpg_async_send_error_get (handle_in, &async_send_error,
+		    &async_send_failed_msgs) == CS_OK && async_send_failed_msgs > 0) {
+			printf ("%5u async send failures (last error %d) ", async_send_failed_msgs,
+			    async_send_error);
+		}
+	}
+	printf ("%7.3f Seconds runtime ", elapsed);
+	printf ("%9.3f TP/s ", ((float)write_count) / elapsed);
+	printf ("%7.3f MB/s.\n", ((float)write_count) * ((float)write_size) / (elapsed * 1000000.0));
+
+	return (CS_OK);
 }
 
 static void sigalrm_handler (int num)
@@ -147,16 +256,96 @@ static struct cpg_name group_name = {
 	.length = 6
 };
 
+/*
+ * All pending messages are dispatched by one cpg_dispatch_batch call
+ * after poll reports cpg fd readable
+ */
 static void* dispatch_thread (void *arg)
 {
-	cpg_dispatch (handle, CS_DISPATCH_BLOCKING);
+	struct pollfd pfd;
+	int fd;
+	cs_error_t res;
+
+	if (cpg_fd_get (handle, &fd) != CS_OK) {
+		return NULL;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	do {
+		if (poll (&pfd, 1, -1) == -1 && errno != EINTR) {
+			break;
+		}
+
+		res = cpg_dispatch_batch (handle, 0, NULL);
+	} while (res == CS_OK);
+
 	return NULL;
 }
 
-int main (void) {
+static void usage (const char *progname)
+{
+	printf ("%s [-a] [-b batch_size] [-z] [-M] [-s size] [-t seconds]\n", progname);
+	printf ("	-a	Use async send mode (CPG_MODEL_V1_ASYNC_SEND)\n");
+	printf ("	-b	Send batch_size (1-%u) messages by one cpg_mcast_joined_batch call\n",
+		MAX_BATCH_SIZE);
+	printf ("	-z	Send messages by cpg_zcb_mcast_joined\n");
+	printf ("	-M	Print machine readable results (size,messages,seconds,tp_s,mb_s)\n");
+	printf ("	-s	Run only one test with messages of size bytes (1-%u)\n", DATASIZE);
+	printf ("	-t	Duration of one test in seconds (default 10)\n");
+}
+
+int main (int argc, char *argv[]) {
 	unsigned int size;
+	unsigned int fixed_size = 0;
 	int i;
 	unsigned int res;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ab:zMs:t:h")) != -1) {
+		switch (opt) {
+		case 'a':
+			model1_data.flags |= CPG_MODEL_V1_ASYNC_SEND;
+			break;
+		case 'b':
+			batch_size = atoi(optarg);
+			if (batch_size < 1 || batch_size > MAX_BATCH_SIZE) {
+				usage (argv[0]);
+				exit (1);
+			}
+			break;
+		case 'z':
+			zero_copy = 1;
+			break;
+		case 'M':
+			machine_readable = 1;
+			break;
+		case 's':
+			fixed_size = atoi(optarg);
+			if (fixed_size < 1 || fixed_size > DATASIZE) {
+				usage (argv[0]);
+				exit (1);
+			}
+			break;
+		case 't':
+			run_time = atoi(optarg);
+			if (run_time < 1) {
+				usage (argv[0]);
+				exit (1);
+			}
+			break;
+		case 'h':
+		default:
+			usage (argv[0]);
+			exit (1);
+		}
+	}
+
+	if (zero_copy && batch_size > 0) {
+		fprintf (stderr, "Zero copy send can't be combined with batch send\n");
+		exit (1);
+	}
 
 	qb_log_init("cpgbench", LOG_USER, LOG_EMERG);
 	qb_log_ctl(QB_LOG_SYSLOG, QB_LOG_CONF_ENABLED, QB_FALSE);
@@ -166,7 +355,11 @@ int main (void) {
 
 	size = 64;
 	signal (SIGALRM, sigalrm_handler);
-	res = cpg_initialize (&handle, &callbacks);
+	if (model1_data.flags & CPG_MODEL_V1_ASYNC_SEND) {
+		res = cpg_model_initialize (&handle, CPG_MODEL_V1, (cpg_model_data_t *)&model1_data, NULL);
+	} else {
+		res = cpg_initialize (&handle, &callbacks);
+	}
 	if (res != CS_OK) {
 		printf ("cpg_initialize failed with result %d\n", res);
 		exit (1);
@@ -179,6 +372,12 @@ int main (void) {
 		exit (1);
 	}
 
+	if (fixed_size > 0) {
+		res = cpg_benchmark (handle, fixed_size);
+		cpg_finalize (handle);
+		return (res == CS_OK ? 0 : 1);
+	}
+
 	for (i = 0; i < 10; i++) { /* number of repetitions - up to 50k */
 		cpg_benchmark (handle, size);
 		signal (SIGALRM, sigalrm_handler);
@@ -0,0 +1,212 @@
+#!@BASHPATH@
+
+#
+# Run cpgbench for every combination of send mode, number of senders and
+# message size against local corosync and print comma separated results.
+# Results of two runs (for example of two different builds) can be compared.
+#
+
+set -e
+
+bench_dir="$(dirname "$0")"
+sizes="16 256 4K 64K 256K 1M 4M 16M"
+senders="1 2 4"
+modes="copy zc"
+run_time="5"
+output=""
+compare_file=""
+threshold="5"
+
+usage() {
+	echo "cpgbenchsuite [options]"
+	echo "cpgbenchsuite [-r percent] -c old_results new_results"
+	echo ""
+	echo "Options:"
+	echo " -d dir          Directory with cpgbench binary (default $bench_dir)"
+	echo " -s sizes        Message sizes, K and M suffixes are allowed (default \"$sizes\")"
+	echo " -p senders      Numbers of concurrent senders (default \"$senders\")"
+	echo " -m modes        Send modes - copy, async, batch and zc (default \"$modes\")"
+	echo " -t seconds      Duration of one test (default $run_time)"
+	echo " -o file         Write results into file instead of stdout"
+	echo " -c file         Compare results in file (old) with results in next argument (new)"
+	echo " -r percent      Throughput decrease reported as regression (default $threshold)"
+	echo " -h              display this help"
+	echo ""
+	echo "Results are in format mode,senders,size,messages,tp_s,mb_s where messages"
+	echo "is the number of messages received by one sender and tp_s/mb_s are"
+	echo "averages of all senders. NA means test failed (for example zero copy"
+	echo "doesn't support fragmented messages)."
+	echo ""
+	echo "To compare two builds, run suite with -d pointing to test directory of"
+	echo "every build (corosync of given build must be running) and then compare"
+	echo "results with -c. Exit code of compare is 1 if any regression is found."
+}
+
+size_to_bytes() {
+	case "$1" in
+	*K|*k)
+		echo $(( ${1%[Kk]} * 1024 ))
+		;;
+	*M|*m)
+		echo $(( ${1%[Mm]} * 1024 * 1024 ))
+		;;
+	*)
+		echo "$1"
+		;;
+	esac
+}
+
+mode_args() {
+	case "$1" in
+	copy)
+		echo ""
+		;;
+	async)
+		echo "-a"
+		;;
+	batch)
+		echo "-b 64"
+		;;
+	zc)
+		echo "-z"
+		;;
+	*)
+		echo "Unknown mode $1" >&2
+		exit 1
+		;;
+	esac
+}
+
+run_test() {
+	local mode="$1"
+	local nsenders="$2"
+	local size="$3"
+	local args
+	local pids=""
+	local failed=0
+	local i
+
+	args="$(mode_args "$mode")"
+
+	for i in $(seq "$nsenders"); do
+		"$bench_dir/cpgbench" $args -M -s "$size" -t "$run_time" > "$tmp_dir/$i" 2> /dev/null &
+		pids="$pids $!"
+	done
+
+	for i in $pids; do
+		wait "$i" || failed=1
+	done
+
+	if [ "$failed" -eq 1 ]; then
+		echo "$mode,$nsenders,$size,NA,NA,NA"
+	else
+		cat "$tmp_dir"/* | awk -F, -v mode="$mode" -v nsenders="$nsenders" -v size="$size" '
+		    { msgs += $2; tp += $4; mb += $5 }
+		    END { printf("%s,%u,%u,%u,%.3f,%.3f\n", mode, nsenders, size, msgs / NR, tp / NR, mb / NR) }'
+	fi
+
+	rm -f "$tmp_dir"/*
+}
+
+compare_results() {
+	awk -F, -v threshold="$threshold" '
+	    NR == FNR {
+		if (FNR > 1) {
+			old[$1 "," $2 "," $3] = $5
+		}
+		next
+	    }
+	    FNR == 1 {
+		print "mode,senders,size,old_tp_s,new_tp_s,change_percent"
+		next
+	    }
+	    {
+		key = $1 "," $2 "," $3
+		if (!(key in old) || old[key] == "NA" || $5 == "NA" || old[key] == 0) {
+			printf("%s,%s,%s,NA\n", key, (key in old ? old[key] : "NA"), $5)
+			next
+		}
+		change = ($5 - old[key]) * 100 / old[key]
+		printf("%s,%s,%s,%.1f", key, old[key], $5, change)
+		if (change < -threshold) {
+			printf(",REGRESSION")
+			regressions++
+		}
+		printf("\n")
+	    }
+	    END { exit (regressions > 0) }' "$1" "$2"
+}
+
+while getopts "hd:s:p:m:t:o:c:r:" optflag; do
+		case "$optflag" in
+		h)
+			usage
+			exit 0
+		;;
+		d)
+			bench_dir="$OPTARG"
+		;;
+		s)
+			sizes="$OPTARG"
+		;;
+		p)
+			senders="$OPTARG"
+		;;
+		m)
+			modes="$OPTARG"
+		;;
+		t)
+			run_time="$OPTARG"
+		;;
+		o)
+			output="$OPTARG"
+		;;
+		c)
+			compare_file="$OPTARG"
+		;;
+		r)
+			threshold="$OPTARG"
+		;;
+		\?|:)
+			usage
+			exit 1
+		;;
+		esac
+done
+shift $((OPTIND - 1))
+
+if [ -n "$compare_file" ]; then
+	if [ -z "$1" ]; then
+		usage
+		exit 1
+	fi
+
+	compare_results "$compare_file" "$1"
+	exit $?
+fi
+
+if [ ! -x "$bench_dir/cpgbench" ]; then
+	echo "Can't find cpgbench in $bench_dir" >&2
+	exit 1
+fi
+
+if [ -n "$output" ]; then
+	exec > "$output"
+fi
+
+for mode in $modes; do
+	mode_args "$mode" > /dev/null
+done
+
+tmp_dir="$(mktemp -d)"
+trap 'rm -rf "$tmp_dir"' EXIT
+
+echo "mode,senders,size,messages,tp_s,mb_s"
+
+for mode in $modes; do
+	for nsenders in $senders; do
+		for size in $sizes; do
+			run_test "$mode" "$nsenders" "$(size_to_bytes "$size")"
+		done
+	done
+done
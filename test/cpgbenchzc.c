@@ -97,6 +97,12 @@ static cpg_callbacks_t callbacks = {
 
 void *data;
 
+/*
+ * When set, zero copy buffer is allocated and freed for every message so
+ * cost of allocation is included in results
+ */
+static int alloc_per_message;
+
 static void cpg_benchmark (
 	cpg_handle_t handle,
 	int write_size)
@@ -117,11 +123,21 @@ static void cpg_benchmark (
 		 */
 		cpg_flow_control_state_get (handle, &flow_control_state);
 		if (flow_control_state == CPG_FLOW_CONTROL_DISABLED) {
+			if (alloc_per_message) {
+				res = cpg_zcb_alloc (handle, write_size, &data);
+				if (res != CS_OK) {
+					printf ("cpg_zcb_alloc couldn't allocate zero copy buffer %d\n", res);
+					exit (1);
+				}
+			}
 retry:
 			res = cpg_zcb_mcast_joined (handle, CPG_TYPE_AGREED, data, write_size);
 			if (res == CS_ERR_TRY_AGAIN) {
 				goto retry;
 			}
+			if (alloc_per_message) {
+				cpg_zcb_free (handle, data);
+			}
 		}
 		res = cpg_dispatch (handle, CS_DISPATCH_ALL);
 		if (res != CS_OK) {
@@ -152,13 +168,21 @@ static struct cpg_name group_name = {
 	.length = 6
 };
 
-int main (void) {
+int main (int argc, char *argv[]) {
 	cpg_handle_t handle;
 	unsigned int size;
 	int i;
 	unsigned int res;
-
-
+	const char *options = "a";
+	int opt;
+
+	while ((opt = getopt(argc, argv, options)) != -1) {
+		switch (opt) {
+		case 'a':
+			alloc_per_message = 1;
+			break;
+		}
+	}
 
 	size = 1000;
 	signal (SIGALRM, sigalrm_handler);
@@ -167,10 +191,12 @@ int main (void) {
 		printf ("cpg_initialize failed with result %d\n", res);
 		exit (1);
 	}
-	cpg_zcb_alloc (handle, 500000, &data);
-	if (res != CS_OK) {
-		printf ("cpg_zcb_alloc couldn't allocate zero copy buffer %d\n", res);
-		exit (1);
+	if (!alloc_per_message) {
+		res = cpg_zcb_alloc (handle, 500000, &data);
+		if (res != CS_OK) {
+			printf ("cpg_zcb_alloc couldn't allocate zero copy buffer %d\n", res);
+			exit (1);
+		}
 	}
 
 	res = cpg_join (handle, &group_name);
@@ -81,6 +81,7 @@ static int alarm_notice;
 #define ONE_MEG 1048576
 #define DATASIZE (ONE_MEG*20)
 static char data[DATASIZE];
+static char iov_recv_data[DATASIZE];
 static int send_counter = 0;
 static int do_syslog = 0;
 static int quiet = 0;
@@ -328,6 +329,35 @@ static void cpg_bm_deliver_fn (
 
 }
 
+/*
+ * Fragmented messages delivered as iovec are linearized and checked
+ * by the standard deliver function
+ */
+static void cpg_bm_deliver_iov_fn (
+	cpg_handle_t handle_in,
+	const struct cpg_name *group_name,
+	uint32_t nodeid,
+	uint32_t pid,
+	const struct iovec *iov,
+	unsigned int iov_len,
+	size_t msg_len)
+{
+	unsigned int i;
+	size_t pos = 0;
+
+	if (msg_len > DATASIZE) {
+		cpgh_log_printf(CPGH_LOG_ERR, "%s: message too large (%zu) from node %d\n", group_name->value, msg_len, nodeid);
+		exit(2);
+	}
+
+	for (i = 0; i < iov_len; i++) {
+		memcpy(iov_recv_data + pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+
+	cpg_bm_deliver_fn(handle_in, group_name, nodeid, pid, iov_recv_data, pos);
+}
+
 static cpg_model_v1_data_t model1_data = {
 	.cpg_deliver_fn		= cpg_bm_deliver_fn,
 	.cpg_confchg_fn		= cpg_bm_confchg_fn,
@@ -531,6 +561,8 @@ static void usage(char *cmd)
 	fprintf(stderr, " -s                       Also send errors to syslog.\n");
 	fprintf(stderr, " -f, --flood              Flood test CPG (cpgbench). see --flood-* long options\n");
 	fprintf(stderr, " -a                       Abort on crc/length/sequence error\n");
+	fprintf(stderr, " -A, --async              Use async send mode (CPG_MODEL_V1_ASYNC_SEND, model 1 only)\n");
+	fprintf(stderr, " -I, --iov                Receive fragmented messages as iovec (cpg_deliver_iov_callback_set)\n");
 	fprintf(stderr, " -q, --quiet              Quiet. Don't print messages every 10s (see also -p)\n");
 	fprintf(stderr, " -qq                      Very quiet. Don't print stats at the end\n");
 	fprintf(stderr, "     --flood-start=bytes  Start value for --flood\n");
@@ -589,7 +621,10 @@ int main (int argc, char *argv[]) {
 	int listen_only = 0;
 	int flood = 0;
 	int model = 1;
+	int deliver_iov = 0;
 	int option_index = 0;
+	cs_error_t async_send_error;
+	uint32_t async_send_failed_msgs;
 	struct option long_options[] = {
 		{"flood-start", required_argument, 0,  0  },
 		{"flood-mult",  required_argument, 0,  0  },
@@ -601,11 +636,13 @@ int main (int argc, char *argv[]) {
 		{"flood",       no_argument,       0, 'f' },
 		{"quiet",       no_argument,       0, 'q' },
 		{"listen",      no_argument,       0, 'l' },
+		{"async",       no_argument,       0, 'A' },
+		{"iov",         no_argument,       0, 'I' },
 		{"help",        no_argument,       0, '?' },
 		{0,             0,                 0,  0  }
 	};
 
-	while ( (opt = getopt_long(argc, argv, "qlstafMEn:d:r:p:m:w:W:D:",
+	while ( (opt = getopt_long(argc, argv, "qlstaAIfMEn:d:r:p:m:w:W:D:",
 				   long_options, &option_index)) != -1 ) {
 		switch (opt) {
 			case 0: // Long-only options
@@ -669,6 +706,12 @@ int main (int argc, char *argv[]) {
 		case 'a':
 			abort_on_error = 1;
 			break;
+		case 'A':
+			model1_data.flags |= CPG_MODEL_V1_ASYNC_SEND;
+			break;
+		case 'I':
+			deliver_iov = 1;
+			break;
 		case 'd':
 			delay_time = atoi(optarg);
 			break;
@@ -707,6 +750,11 @@ int main (int argc, char *argv[]) {
 		write_size = flood_start;
 	}
 
+	if ((model1_data.flags & CPG_MODEL_V1_ASYNC_SEND) && model != 1) {
+		fprintf(stderr, "%s: Async send mode requires model 1\n", argv[0]);
+		exit(1);
+	}
+
 	signal (SIGALRM, sigalrm_handler);
 	signal (SIGINT, sigint_handler);
 	switch (model) {
@@ -727,6 +775,14 @@ int main (int argc, char *argv[]) {
 	}
 	cpg_local_get(handle, &g_our_nodeid);
 
+	if (deliver_iov) {
+		res = cpg_deliver_iov_callback_set(handle, cpg_bm_deliver_iov_fn);
+		if (res != CS_OK) {
+			cpgh_log_printf(CPGH_LOG_ERR, "cpg_deliver_iov_callback_set failed with result %d\n", res);
+			exit (1);
+		}
+	}
+
 	pthread_create (&thread, NULL, dispatch_thread, NULL);
 
 	res = cpg_join (handle, &group_name);
@@ -790,6 +846,18 @@ int main (int argc, char *argv[]) {
 		}
 	}
 
+	if (model1_data.flags & CPG_MODEL_V1_ASYNC_SEND) {
+		/*
+		 * Failures of async sends are reported via dispatch
+		 */
+		res = cpg_async_send_error_get (handle, &async_send_error, &async_send_failed_msgs);
+		if (res == CS_OK && async_send_failed_msgs > 0) {
+			cpgh_log_printf(CPGH_LOG_ERR, "async send failed: %d (%u messages)\n",
+			    async_send_error, async_send_failed_msgs);
+			send_fails += async_send_failed_msgs;
+		}
+	}
+
 	res = cpg_finalize (handle);
 	if (res != CS_OK) {
 		cpgh_log_printf(CPGH_LOG_ERR, "cpg_finalize failed with result %d\n", res);
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2026 Red Hat, Inc.
+ *
+ * All rights reserved.
+ *
+ * This software licensed under BSD license, the text of which follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Red Hat, Inc. nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measure latency of cpg message delivery. Message is sent and time until
+ * it is delivered back to the sender is measured. Running it with and
+ * without -l compares normal (totem) and local only groups.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <qb/qbdefs.h>
+#include <qb/qbutil.h>
+
+#include <corosync/corotypes.h>
+#include <corosync/cpg.h>
+
+#define MAX_MSG_SIZE	(1024 * 1024)
+
+static struct cpg_name group_name = {
+	.value = "cpg_latency",
+	.length = 11
+};
+
+static char data[MAX_MSG_SIZE];
+
+static uint32_t my_pid;
+static uint32_t expected_seq;
+static int delivered;
+
+static void cpg_latency_deliver_fn (
+	cpg_handle_t handle,
+	const struct cpg_name *group,
+	uint32_t nodeid,
+	uint32_t pid,
+	void *msg,
+	size_t msg_len)
+{
+	uint32_t seq;
+
+	if (pid != my_pid || msg_len < sizeof (seq)) {
+		return ;
+	}
+
+	memcpy (&seq, msg, sizeof (seq));
+	if (seq == expected_seq) {
+		delivered = 1;
+	}
+}
+
+static void cpg_latency_confchg_fn (
+	cpg_handle_t handle,
+	const struct cpg_name *group,
+	const struct cpg_address *member_list, size_t member_list_entries,
+	const struct cpg_address *left_list, size_t left_list_entries,
+	const struct cpg_address *joined_list, size_t joined_list_entries)
+{
+}
+
+static cpg_callbacks_t callbacks = {
+	.cpg_deliver_fn		= cpg_latency_deliver_fn,
+	.cpg_confchg_fn		= cpg_latency_confchg_fn
+};
+
+static int uint64_cmp (const void *a, const void *b)
+{
+	uint64_t ua = *(const uint64_t *)a;
+	uint64_t ub = *(const uint64_t *)b;
+
+	return ((ua > ub) - (ua < ub));
+}
+
+static void usage (void)
+{
+
+	printf ("cpglatency [options]\n");
+	printf ("\n");
+	printf ("Options:\n");
+	printf (" -l           Join local only group (CPG_JOIN_FLAG_LOCAL_ONLY)\n");
+	printf (" -n count     Number of messages (default 10000)\n");
+	printf (" -s size      Size of message (default 64)\n");
+	printf (" -M           Print results as one comma separated line\n");
+	printf ("              (mode,size,messages,min_us,avg_us,p99_us,max_us)\n");
+	printf (" -h           display this help\n");
+}
+
+int main (int argc, char *argv[])
+{
+	cpg_handle_t handle;
+	cs_error_t res;
+	struct iovec iov;
+	unsigned int join_flags = 0;
+	unsigned int count = 10000;
+	unsigned int size = 64;
+	int machine_readable = 0;
+	uint64_t *latencies;
+	uint64_t start_time;
+	uint64_t sum;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt (argc, argv, "ln:s:Mh")) != -1) {
+		switch (opt) {
+		case 'l':
+			join_flags |= CPG_JOIN_FLAG_LOCAL_ONLY;
+			break;
+		case 'n':
+			count = strtoul (optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoul (optarg, NULL, 0);
+			break;
+		case 'M':
+			machine_readable = 1;
+			break;
+		case 'h':
+			usage ();
+			exit (0);
+		default:
+			usage ();
+			exit (1);
+		}
+	}
+
+	if (count == 0 || size < sizeof (uint32_t) || size > MAX_MSG_SIZE) {
+		usage ();
+		exit (1);
+	}
+
+	latencies = malloc (sizeof (*latencies) * count);
+	if (latencies == NULL) {
+		fprintf (stderr, "Can't allocate memory\n");
+		exit (1);
+	}
+
+	my_pid = getpid ();
+
+	res = cpg_initialize (&handle, &callbacks);
+	if (res != CS_OK) {
+		fprintf (stderr, "cpg_initialize failed with result %d\n", res);
+		exit (1);
+	}
+
+	res = cpg_join_flags (handle, &group_name, join_flags);
+	if (res != CS_OK) {
+		fprintf (stderr, "cpg_join_flags failed with result %d\n", res);
+		exit (1);
+	}
+
+	iov.iov_base = data;
+	iov.iov_len = size;
+
+	for (i = 0; i < count; i++) {
+		expected_seq = i;
+		delivered = 0;
+		memcpy (data, &expected_seq, sizeof (expected_seq));
+
+		start_time = qb_util_nano_current_get ();
+		do {
+			res = cpg_mcast_joined (handle, CPG_TYPE_AGREED, &iov, 1);
+		} while (res == CS_ERR_TRY_AGAIN);
+
+		if (res != CS_OK) {
+			fprintf (stderr, "cpg_mcast_joined failed with result %d\n", res);
+			exit (1);
+		}
+
+		while (!delivered) {
+			res = cpg_dispatch (handle, CS_DISPATCH_ONE);
+			if (res != CS_OK && res != CS_ERR_TRY_AGAIN) {
+				fprintf (stderr, "cpg_dispatch failed with result %d\n", res);
+				exit (1);
+			}
+		}
+
+		latencies[i] = (qb_util_nano_current_get () - start_time) / QB_TIME_NS_IN_USEC;
+	}
+
+	cpg_finalize (handle);
+
+	qsort (latencies, count, sizeof (*latencies), uint64_cmp);
+	sum = 0;
+	for (i = 0; i < count; i++) {
+		sum += latencies[i];
+	}
+
+	if (machine_readable) {
+		printf ("%s,%u,%u,%llu,%llu,%llu,%llu\n",
+			(join_flags & CPG_JOIN_FLAG_LOCAL_ONLY ? "local" : "totem"),
+			size, count,
+			(unsigned long long)latencies[0],
+			(unsigned long long)(sum / count),
+			(unsigned long long)latencies[(count - 1) * 99 / 100],
+			(unsigned long long)latencies[count - 1]);
+	} else {
+		printf ("%s group, %u messages of %u bytes, latency (us): "
+			"min %llu, avg %llu, 99%% %llu, max %llu\n",
+			(join_flags & CPG_JOIN_FLAG_LOCAL_ONLY ? "Local only" : "Totem"),
+			count, size,
+			(unsigned long long)latencies[0],
+			(unsigned long long)(sum / count),
+			(unsigned long long)latencies[(count - 1) * 99 / 100],
+			(unsigned long long)latencies[count - 1]);
+	}
+
+	free (latencies);
+
+	return (0);
+}
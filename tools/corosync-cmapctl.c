@@ -37,6 +37,8 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include <corosync/corotypes.h>
 #include <corosync/cmap.h>
@@ -57,6 +59,19 @@ enum user_action {
 	ACTION_TRACK,
 	ACTION_LOAD,
 	ACTION_CLEARSTATS,
+	ACTION_SNAPSHOT,
+	ACTION_SNAPSHOT_DECODE,
+};
+
+struct snapshot_field {
+	cmap_value_types_t type;
+	char name[CMAP_KEYNAME_MAXLEN + 1];
+};
+
+struct snapshot_schema {
+	uint16_t schema_id;
+	uint16_t no_fields;
+	struct snapshot_field *fields;
 };
 
 struct name_to_type_item {
@@ -96,7 +111,7 @@ static int convert_name_to_type(const char *name)
 static int print_help(void)
 {
 	printf("\n");
-	printf("usage:  corosync-cmapctl [-b] [-DdghsTCt] [-p filename] [-m map] [params...]\n");
+	printf("usage:  corosync-cmapctl [-b] [-DdghsTCtS] [-p filename] [-m map] [-o filename] [-r filename] [params...]\n");
 	printf("\n");
 	printf("    -b show binary values\n");
 	printf("\n");
@@ -114,7 +129,7 @@ static int print_help(void)
 	printf("    about the networking and IPC traffic in some detail.\n");
 	printf("\n");
 	printf("Clear stats:\n");
-	printf("    corosync-cmapctl -C [knet|ipc|totem|all]\n");
+	printf("    corosync-cmapctl -C [knet|ipc|totem|cmap|config|all]\n");
 	printf("    The 'stats' map is implied\n");
 	printf("\n");
 	printf("Load settings from a file:\n");
@@ -148,6 +163,15 @@ static int print_help(void)
 	printf("Track changes on keys with key prefix:\n");
 	printf("    corosync-cmapctl [-b] -T key_prefix\n");
 	printf("\n");
+	printf("Display consistent snapshot of all stats (optionally only keys with prefix):\n");
+	printf("    corosync-cmapctl -S [key_prefix...]\n");
+	printf("\n");
+	printf("Store binary stats snapshot into file:\n");
+	printf("    corosync-cmapctl -S -o filename\n");
+	printf("\n");
+	printf("Display binary stats snapshot previously stored into file:\n");
+	printf("    corosync-cmapctl -r filename [key_prefix...]\n");
+	printf("\n");
 
 	return (0);
 }
@@ -393,6 +417,290 @@ static void print_iter(cmap_handle_t handle, const char *prefix)
 	cmap_iter_finalize(handle, iter_handle);
 }
 
+static int snapshot_read(const char **pos, const char *end, void *dst, size_t len)
+{
+
+	if (len > (size_t)(end - *pos)) {
+		return (-1);
+	}
+
+	if (dst != NULL) {
+		memcpy(dst, *pos, len);
+	}
+	*pos += len;
+
+	return (0);
+}
+
+static size_t snapshot_value_len(cmap_value_types_t type)
+{
+
+	switch (type) {
+	case CMAP_VALUETYPE_INT8:
+	case CMAP_VALUETYPE_UINT8:
+		return (sizeof(uint8_t));
+	case CMAP_VALUETYPE_INT16:
+	case CMAP_VALUETYPE_UINT16:
+		return (sizeof(uint16_t));
+	case CMAP_VALUETYPE_INT32:
+	case CMAP_VALUETYPE_UINT32:
+		return (sizeof(uint32_t));
+	case CMAP_VALUETYPE_INT64:
+	case CMAP_VALUETYPE_UINT64:
+		return (sizeof(uint64_t));
+	case CMAP_VALUETYPE_FLOAT:
+		return (sizeof(float));
+	case CMAP_VALUETYPE_DOUBLE:
+		return (sizeof(double));
+	default:
+		return (0);
+	}
+}
+
+static int snapshot_key_matches(const char *key_name, int no_prefixes, char *prefixes[])
+{
+	int i;
+
+	if (no_prefixes == 0) {
+		return (1);
+	}
+
+	for (i = 0; i < no_prefixes; i++) {
+		if (strncmp(key_name, prefixes[i], strlen(prefixes[i])) == 0) {
+			return (1);
+		}
+	}
+
+	return (0);
+}
+
+static int print_stats_snapshot(const char *snapshot, size_t snapshot_len, int no_prefixes, char *prefixes[])
+{
+	struct cmap_stats_snapshot_header header;
+	struct cmap_stats_snapshot_schema schema;
+	struct cmap_stats_snapshot_field field;
+	struct cmap_stats_snapshot_instance instance;
+	struct snapshot_schema *schemas = NULL;
+	struct snapshot_schema *inst_schema;
+	const char *pos, *end;
+	char inst_name[CMAP_KEYNAME_MAXLEN + 1];
+	char key_name[CMAP_KEYNAME_MAXLEN + 1];
+	union {
+		uint64_t u64;
+		double dbl;
+		char str[UINT16_MAX + 1];
+	} value;
+	size_t value_len;
+	uint16_t str_len;
+	uint32_t i, j, k;
+	int res = -1;
+
+	pos = snapshot;
+	end = snapshot + snapshot_len;
+
+	if (snapshot_read(&pos, end, &header, sizeof(header)) != 0 ||
+	    header.magic != CMAP_STATS_SNAPSHOT_MAGIC) {
+		fprintf(stderr, "Invalid stats snapshot\n");
+		return (-1);
+	}
+
+	if (header.version != CMAP_STATS_SNAPSHOT_VERSION) {
+		fprintf(stderr, "Unsupported stats snapshot version %u\n", header.version);
+		return (-1);
+	}
+
+	if (header.header_len < sizeof(header) || header.total_len > snapshot_len) {
+		fprintf(stderr, "Stats snapshot is truncated\n");
+		return (-1);
+	}
+	end = snapshot + header.total_len;
+
+	/* Newer versions may extend the header */
+	pos = snapshot + header.header_len;
+
+	schemas = calloc(header.no_schemas, sizeof(*schemas));
+	if (schemas == NULL && header.no_schemas > 0) {
+		fprintf(stderr, "Can't alloc memory\n");
+		return (-1);
+	}
+
+	for (i = 0; i < header.no_schemas; i++) {
+		if (snapshot_read(&pos, end, &schema, sizeof(schema)) != 0) {
+			goto invalid;
+		}
+
+		schemas[i].schema_id = schema.schema_id;
+		schemas[i].no_fields = schema.no_fields;
+		schemas[i].fields = calloc(schema.no_fields, sizeof(*schemas[i].fields));
+		if (schemas[i].fields == NULL && schema.no_fields > 0) {
+			fprintf(stderr, "Can't alloc memory\n");
+			goto free_exit;
+		}
+
+		for (j = 0; j < schema.no_fields; j++) {
+			if (snapshot_read(&pos, end, &field, sizeof(field)) != 0 ||
+			    snapshot_read(&pos, end, schemas[i].fields[j].name, field.name_len) != 0) {
+				goto invalid;
+			}
+			schemas[i].fields[j].type = field.value_type;
+		}
+	}
+
+	for (i = 0; i < header.no_instances; i++) {
+		if (snapshot_read(&pos, end, &instance, sizeof(instance)) != 0 ||
+		    instance.name_len > CMAP_KEYNAME_MAXLEN ||
+		    snapshot_read(&pos, end, inst_name, instance.name_len) != 0) {
+			goto invalid;
+		}
+		inst_name[instance.name_len] = '\0';
+
+		inst_schema = NULL;
+		for (k = 0; k < header.no_schemas; k++) {
+			if (schemas[k].schema_id == instance.schema_id) {
+				inst_schema = &schemas[k];
+				break;
+			}
+		}
+		if (inst_schema == NULL) {
+			goto invalid;
+		}
+
+		for (j = 0; j < inst_schema->no_fields; j++) {
+			if (inst_schema->fields[j].type == CMAP_VALUETYPE_STRING) {
+				if (snapshot_read(&pos, end, &str_len, sizeof(str_len)) != 0 ||
+				    str_len == 0) {
+					goto invalid;
+				}
+				value_len = str_len;
+			} else {
+				value_len = snapshot_value_len(inst_schema->fields[j].type);
+				if (value_len == 0) {
+					goto invalid;
+				}
+			}
+
+			if (snapshot_read(&pos, end, &value, value_len) != 0) {
+				goto invalid;
+			}
+			if (inst_schema->fields[j].type == CMAP_VALUETYPE_STRING) {
+				value.str[value_len - 1] = '\0';
+			}
+
+			snprintf(key_name, sizeof(key_name), "%s.%s", inst_name, inst_schema->fields[j].name);
+			if (snapshot_key_matches(key_name, no_prefixes, prefixes)) {
+				print_key(0, key_name, value_len, &value, inst_schema->fields[j].type);
+			}
+		}
+	}
+
+	res = 0;
+	goto free_exit;
+
+invalid:
+	fprintf(stderr, "Stats snapshot is corrupted\n");
+
+free_exit:
+	for (i = 0; i < header.no_schemas; i++) {
+		free(schemas[i].fields);
+	}
+	free(schemas);
+
+	return (res);
+}
+
+static int stats_snapshot(cmap_handle_t handle, const char *output_file, int no_prefixes, char *prefixes[])
+{
+	void *snapshot;
+	size_t snapshot_len;
+	cs_error_t err;
+	int no_retries;
+	int fd;
+	int res;
+
+	no_retries = 0;
+	while ((err = cmap_stats_snapshot_get(handle, &snapshot, &snapshot_len)) == CS_ERR_TRY_AGAIN &&
+	    no_retries++ < MAX_TRY_AGAIN) {
+		sleep(1);
+	}
+
+	if (err != CS_OK) {
+		fprintf(stderr, "Can't get stats snapshot. Error %s\n", cs_strerror(err));
+		return (-1);
+	}
+
+	if (output_file == NULL) {
+		res = print_stats_snapshot(snapshot, snapshot_len, no_prefixes, prefixes);
+		free(snapshot);
+		return (res);
+	}
+
+	res = 0;
+	fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd == -1) {
+		perror("Can't open output file");
+		res = -1;
+	} else {
+		if (write(fd, snapshot, snapshot_len) != (ssize_t)snapshot_len) {
+			perror("Can't write output file");
+			res = -1;
+		}
+		close(fd);
+	}
+
+	free(snapshot);
+	return (res);
+}
+
+static int decode_stats_snapshot(const char *input_file, int no_prefixes, char *prefixes[])
+{
+	FILE *fi;
+	char *snapshot;
+	size_t snapshot_len;
+	size_t alloced;
+	size_t nread;
+	char *new_snapshot;
+	int res;
+
+	fi = fopen(input_file, "r");
+	if (fi == NULL) {
+		perror("Can't open input file");
+		return (-1);
+	}
+
+	snapshot = NULL;
+	snapshot_len = 0;
+	alloced = 0;
+
+	do {
+		if (snapshot_len == alloced) {
+			alloced = (alloced > 0 ? alloced * 2 : 1024 * 64);
+			new_snapshot = realloc(snapshot, alloced);
+			if (new_snapshot == NULL) {
+				fprintf(stderr, "Can't alloc memory\n");
+				free(snapshot);
+				fclose(fi);
+				return (-1);
+			}
+			snapshot = new_snapshot;
+		}
+
+		nread = fread(snapshot + snapshot_len, 1, alloced - snapshot_len, fi);
+		snapshot_len += nread;
+	} while (nread > 0);
+
+	if (ferror(fi)) {
+		perror("Can't read input file");
+		res = -1;
+	} else {
+		res = print_stats_snapshot(snapshot, snapshot_len, no_prefixes, prefixes);
+	}
+
+	free(snapshot);
+	fclose(fi);
+
+	return (res);
+}
+
 static void delete_with_prefix(cmap_handle_t handle, const char *prefix)
 {
 	cmap_iter_handle_t iter_handle;
@@ -770,11 +1078,12 @@ int main(int argc, char *argv[])
 	int no_retries;
 	char * clear_opt = NULL;
 	char * settings_file = NULL;
+	char * snapshot_file = NULL;
 
 	action = ACTION_PRINT_PREFIX;
 	track_prefix = 1;
 
-	while ((c = getopt(argc, argv, "m:hgsdDtTbp:C:")) != -1) {
+	while ((c = getopt(argc, argv, "m:hgsdDtTbp:C:So:r:")) != -1) {
 		switch (c) {
 		case 'h':
 			return print_help();
@@ -802,6 +1111,8 @@ int main(int argc, char *argv[])
 			if (strcmp(optarg, "knet") == 0 ||
 			    strcmp(optarg, "totem") == 0 ||
 			    strcmp(optarg, "ipc") == 0 ||
+			    strcmp(optarg, "cmap") == 0 ||
+			    strcmp(optarg, "config") == 0 ||
 			    strcmp(optarg, "all") == 0) {
 				action = ACTION_CLEARSTATS;
 				clear_opt = optarg;
@@ -810,7 +1121,7 @@ int main(int argc, char *argv[])
 				map = CMAP_MAP_STATS;
 			}
 			else {
-				fprintf(stderr, "argument to -C should be 'knet', 'totem', 'ipc' or 'all'\n");
+				fprintf(stderr, "argument to -C should be 'knet', 'totem', 'ipc', 'cmap', 'config' or 'all'\n");
 				return (EXIT_FAILURE);
 			}
 			break;
@@ -818,6 +1129,16 @@ int main(int argc, char *argv[])
 			action = ACTION_TRACK;
 			track_prefix = 0;
 			break;
+		case 'S':
+			action = ACTION_SNAPSHOT;
+			break;
+		case 'o':
+			snapshot_file = optarg;
+			break;
+		case 'r':
+			snapshot_file = optarg;
+			action = ACTION_SNAPSHOT_DECODE;
+			break;
 		case 'T':
 			action = ACTION_TRACK;
 			break;
@@ -851,11 +1172,21 @@ int main(int argc, char *argv[])
 	if (argc == 0 &&
 	    action != ACTION_LOAD &&
 	    action != ACTION_CLEARSTATS &&
+	    action != ACTION_SNAPSHOT &&
+	    action != ACTION_SNAPSHOT_DECODE &&
 	    action != ACTION_PRINT_PREFIX) {
 		fprintf(stderr, "Expected key after options\n");
 		return (EXIT_FAILURE);
 	}
 
+	if (action == ACTION_SNAPSHOT_DECODE) {
+		/* Stored snapshot is decoded without corosync running */
+		if (decode_stats_snapshot(snapshot_file, argc, argv) != 0) {
+			return (EXIT_FAILURE);
+		}
+		return (EXIT_SUCCESS);
+	}
+
 	no_retries = 0;
 
 	while ((err = cmap_initialize_map(&handle, map)) == CS_ERR_TRY_AGAIN && no_retries++ < MAX_TRY_AGAIN) {
@@ -920,6 +1251,14 @@ int main(int argc, char *argv[])
 	case ACTION_CLEARSTATS:
 		clear_stats(handle, clear_opt);
 		break;
+	case ACTION_SNAPSHOT:
+		if (stats_snapshot(handle, snapshot_file, argc, argv) != 0) {
+			cmap_finalize(handle);
+			return (EXIT_FAILURE);
+		}
+		break;
+	case ACTION_SNAPSHOT_DECODE:
+		break;
 
 	}
 